@@ -171,6 +171,29 @@ Java_com_google_android_filament_View_nSetSoftShadowOptions(JNIEnv*, jclass, jlo
     view->setSoftShadowOptions(options);
 }
 
+extern "C" JNIEXPORT void JNICALL
+Java_com_google_android_filament_View_nSetShadowCacheOptions(JNIEnv*, jclass, jlong nativeView,
+        jboolean enabled, jint distantCascadeUpdateInterval) {
+    View* view = (View*) nativeView;
+    View::ShadowCacheOptions options;
+    options.enabled = (bool)enabled;
+    options.distantCascadeUpdateInterval = (uint8_t)distantCascadeUpdateInterval;
+    view->setShadowCacheOptions(options);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_google_android_filament_View_nSetPostProcessResolutionOptions(JNIEnv*, jclass,
+        jlong nativeView, jboolean enabled, jint resolution, jboolean dynamic,
+        jint minResolution) {
+    View* view = (View*) nativeView;
+    View::PostProcessResolutionOptions options;
+    options.enabled = (bool)enabled;
+    options.resolution = (View::PostProcessResolutionOptions::Resolution)resolution;
+    options.dynamic = (bool)dynamic;
+    options.minResolution = (View::PostProcessResolutionOptions::Resolution)minResolution;
+    view->setPostProcessResolutionOptions(options);
+}
+
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_google_android_filament_View_nSetRenderQuality(JNIEnv*, jclass,
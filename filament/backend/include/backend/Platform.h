@@ -46,6 +46,13 @@ public:
          * Driver clamps to valid values.
          */
         size_t handleArenaSize = 0;
+
+        /*
+         * When the backend compiles programs asynchronously, skip draw calls that use a program
+         * that isn't ready yet, instead of waiting for it. Objects can then be missing from
+         * a few frames, but these frames don't stall.
+         */
+        bool skipDrawsWithPendingPrograms = false;
     };
 
     Platform() noexcept;
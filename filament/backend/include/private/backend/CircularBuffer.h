@@ -58,6 +58,12 @@ public:
 
     void* getTail() const noexcept { return mTail; }
 
+    // Number of bytes that can be allocated contiguously from the head. Note that this is
+    // the addressable space, not the space that is free, which CommandBufferQueue tracks.
+    size_t getContiguousSize() const noexcept {
+        return size_t(static_cast<char*>(mData) + mSize * 2 - static_cast<char*>(mHead));
+    }
+
     // call at least once every getRequiredSize() bytes allocated from the buffer
     void circularize() noexcept;
 
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_BACKEND_PRIVATE_COMMANDCAPTURE_H
+#define TNT_FILAMENT_BACKEND_PRIVATE_COMMANDCAPTURE_H
+
+#include <backend/BufferDescriptor.h>
+#include <backend/DriverEnums.h>
+#include <backend/Handle.h>
+#include <backend/PipelineState.h>
+#include <backend/PixelBufferDescriptor.h>
+#include <backend/Program.h>
+#include <backend/TargetBufferInfo.h>
+
+#include <utils/compiler.h>
+#include <utils/CString.h>
+
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace filament::backend {
+
+class CommandStream;
+
+/*
+ * A capture of the asynchronous commands recorded into a CommandStream, which can be replayed
+ * later into another CommandStream (e.g. using the NoopDriver).
+ *
+ * A capture starts with a header, followed by one record per command: the CommandId, then the
+ * handle returned by the command if any, then the command's arguments. Trivially copyable
+ * arguments are stored as-is, BufferDescriptor payloads and Programs are stored inline.
+ *
+ * Limitations:
+ * - synchronous calls are not captured (they don't go through the CommandStream).
+ * - callbacks, CallbackHandlers and native pointers (e.g. native windows) can't be captured,
+ *   they are replayed as nullptr.
+ * - handles that were created before the capture started are replayed as-is, which is only
+ *   meaningful with the NoopDriver.
+ */
+
+// Identifies a command in a capture. This depends on the order of DriverAPI.inc, so captures can
+// only be replayed by the version of filament that created them.
+enum class CommandId : uint32_t {
+#define DECL_DRIVER_API(methodName, paramsDecl, params) methodName,
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) methodName,
+#include "private/backend/DriverAPI.inc"
+    COUNT
+};
+
+class CommandCaptureWriter {
+public:
+    // creates the capture file, check isOpen() for errors
+    explicit CommandCaptureWriter(const char* path) noexcept;
+    ~CommandCaptureWriter() noexcept;
+
+    CommandCaptureWriter(CommandCaptureWriter const& rhs) = delete;
+    CommandCaptureWriter& operator=(CommandCaptureWriter const& rhs) = delete;
+
+    bool isOpen() const noexcept { return mFile != nullptr; }
+
+    // records a command, for commands returning a handle the handle is the first argument
+    template<typename ... ARGS>
+    void write(CommandId id, ARGS const& ... args) noexcept {
+        writeValue(uint32_t(id));
+        (writeArgument(args), ...);
+    }
+
+private:
+    void writeBytes(void const* data, size_t size) noexcept;
+    void alignTo(size_t alignment) noexcept;
+
+    template<typename T>
+    void writeValue(T const& value) noexcept {
+        writeBytes(&value, sizeof(T));
+    }
+
+    template<typename T, typename = std::enable_if_t<
+            std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>>>
+    void writeArgument(T const& value) noexcept {
+        writeValue(value);
+    }
+
+    // pointers can't be captured, except strings
+    template<typename T>
+    void writeArgument(T* const&) noexcept { }
+
+    void writeArgument(const char* const& string) noexcept;
+    void writeArgument(BufferDescriptor const& buffer) noexcept;
+    void writeArgument(PixelBufferDescriptor const& buffer) noexcept;
+    void writeArgument(Program const& program) noexcept;
+    void writeString(utils::CString const& string) noexcept;
+
+    FILE* mFile = nullptr;
+    size_t mOffset = 0;
+};
+
+class CommandCaptureReader {
+public:
+    /*
+     * data is the content of a capture file, it must be aligned to 16 bytes and stay valid
+     * until all replayed commands have executed, since BufferDescriptors point into it.
+     * It must be writable, read-back commands write into it.
+     */
+    CommandCaptureReader(void* data, size_t size) noexcept;
+
+    // returns whether the capture was made by this version of filament
+    bool isValid() const noexcept { return mValid; }
+
+    /*
+     * Swap chains are created without their native window, which not all backends support.
+     * If set, createSwapChain is replaced by createSwapChainHeadless with this size.
+     */
+    void setHeadlessSwapChainSize(uint32_t width, uint32_t height) noexcept {
+        mHeadlessWidth = width;
+        mHeadlessHeight = height;
+    }
+
+    /*
+     * Replays the next command into stream and returns its id, or CommandId::COUNT at the end
+     * of the capture or if the capture is truncated or corrupted, see isCorrupted().
+     */
+    CommandId replayNext(CommandStream& stream);
+
+    // returns whether the replay stopped before the end of the capture because it's truncated
+    // or holds an unknown command
+    bool isCorrupted() const noexcept { return mCorrupted; }
+
+    // restarts from the beginning of the capture
+    void rewind() noexcept;
+
+private:
+    template<CommandId ID, typename R, typename ... ARGS>
+    void replay(CommandStream& stream, R (CommandStream::*method)(ARGS...));
+
+    uint8_t* readBytes(size_t size) noexcept;
+    void alignTo(size_t alignment) noexcept;
+
+    template<typename T>
+    void readValue(T& value) noexcept {
+        uint8_t const* const p = readBytes(sizeof(T));
+        if (UTILS_LIKELY(p)) {
+            memcpy(&value, p, sizeof(T));
+        } else {
+            value = T{};
+        }
+    }
+
+    template<typename T, typename = std::enable_if_t<
+            std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>>>
+    void readArgument(T& value) noexcept {
+        readValue(value);
+        remap(value);
+    }
+
+    template<typename T>
+    void readArgument(T*& pointer) noexcept { pointer = nullptr; }
+
+    void readArgument(const char*& string) noexcept;
+    void readArgument(BufferDescriptor& buffer) noexcept;
+    void readArgument(PixelBufferDescriptor& buffer) noexcept;
+    void readArgument(Program& program) noexcept;
+    utils::CString readString() noexcept;
+
+    // translate handles from the capture to the handles created by the replay
+    template<typename T>
+    void remap(T&) noexcept { }
+
+    template<typename T>
+    void remap(Handle<T>& handle) noexcept {
+        if (handle) {
+            auto const pos = mHandles.find(handle.getId());
+            if (pos != mHandles.end()) {
+                handle = Handle<T>(pos->second);
+            }
+        }
+    }
+
+    void remap(PipelineState& pipelineState) noexcept;
+    void remap(TargetBufferInfo& info) noexcept;
+    void remap(MRT& mrt) noexcept;
+
+    // the sampler group payload holds texture handles
+    void remapSamplerGroup(BufferDescriptor& buffer) noexcept;
+
+    uint8_t* const mData;
+    size_t const mSize;
+    size_t mOffset = 0;
+    size_t mFirstCommandOffset = 0;
+    uint32_t mHeadlessWidth = 0;
+    uint32_t mHeadlessHeight = 0;
+    bool mValid = false;
+    bool mCorrupted = false;
+    std::unordered_map<HandleBase::HandleId, HandleBase::HandleId> mHandles;
+};
+
+} // namespace filament::backend
+
+#endif // TNT_FILAMENT_BACKEND_PRIVATE_COMMANDCAPTURE_H
@@ -18,6 +18,7 @@
 #define TNT_FILAMENT_BACKEND_PRIVATE_COMMANDSTREAM_H
 
 #include "private/backend/CircularBuffer.h"
+#include "private/backend/CommandCapture.h"
 #include "private/backend/Dispatcher.h"
 #include "private/backend/Driver.h"
 
@@ -34,8 +35,10 @@
 #include <utils/compiler.h>
 #include <utils/ThreadUtils.h>
 
+#include <atomic>
 #include <cstddef>
 #include <functional>
+#include <memory>
 #include <tuple>
 #include <utility>
 
@@ -208,6 +211,9 @@ class CommandStream {
 public:
     CommandStream(Driver& driver, CircularBuffer& buffer) noexcept;
 
+    // Creates a sub-stream of parent, see fork()
+    explicit CommandStream(CommandStream* parent) noexcept;
+
     CommandStream(CommandStream const& rhs) noexcept = delete;
     CommandStream& operator=(CommandStream const& rhs) noexcept = delete;
 
@@ -215,6 +221,9 @@ public:
 #define DECL_DRIVER_API(methodName, paramsDecl, params)                                         \
     inline void methodName(paramsDecl) {                                                        \
         DEBUG_COMMAND_BEGIN(methodName, false, params);                                         \
+        if (UTILS_UNLIKELY(mCapture)) {                                                         \
+            mCapture->write(CommandId::methodName, params);                                     \
+        }                                                                                       \
         using Cmd = COMMAND_TYPE(methodName);                                                   \
         void* const p = allocateCommand(CommandBase::align(sizeof(Cmd)));                       \
         new(p) Cmd(mDispatcher.methodName##_, APPLY(std::move, params));                        \
@@ -234,6 +243,9 @@ public:
     inline RetType methodName(paramsDecl) {                                                     \
         DEBUG_COMMAND_BEGIN(methodName, false, params);                                         \
         RetType result = mDriver.methodName##S();                                               \
+        if (UTILS_UNLIKELY(mCapture)) {                                                         \
+            mCapture->write(CommandId::methodName, result, params);                             \
+        }                                                                                       \
         using Cmd = COMMAND_TYPE(methodName##R);                                                \
         void* const p = allocateCommand(CommandBase::align(sizeof(Cmd)));                       \
         new(p) Cmd(mDispatcher.methodName##_, RetType(result), APPLY(std::move, params));       \
@@ -253,6 +265,34 @@ public:
 #endif
     }
 
+    /*
+     * Recording commands from several threads.
+     *
+     * fork() reserves the remaining space of the CircularBuffer for sub-streams, which are
+     * constructed from this CommandStream. Each sub-stream can be used by a different thread,
+     * they allocate their sub-buffers from the reserved space in chunks, without locking.
+     * join() then stitches the commands of the given sub-streams, in that order, at the point
+     * where fork() was called. Only the space actually used by the sub-streams is consumed.
+     *
+     * This CommandStream can't be used between fork() and join(), and the sub-streams can't be
+     * used outside of fork() and join(). Only asynchronous commands can be recorded into a
+     * sub-stream, i.e. no synchronous calls and no object creation.
+     */
+    void fork() noexcept;
+    void join(CommandStream* const* subStreams, size_t count) noexcept;
+
+    /*
+     * Capturing commands.
+     *
+     * While a capture is active, every asynchronous command recorded into this CommandStream is
+     * also serialized to the file at 'path', along with its BufferDescriptor payloads.
+     * The capture can be replayed with CommandCaptureReader. Sub-streams are never captured.
+     * startCommandCapture() returns false if the file couldn't be created.
+     */
+    bool startCommandCapture(const char* path) noexcept;
+    void stopCommandCapture() noexcept;
+    bool isCapturingCommands() const noexcept { return mCapture != nullptr; }
+
     void execute(void* buffer);
 
     /*
@@ -277,15 +317,37 @@ public:
             size_t count = 1, size_t alignment = alignof(PodType)) noexcept;
 
 private:
+    // size of the chunks sub-streams allocate from the reserved space
+    static constexpr size_t SUB_BUFFER_CHUNK_SIZE = 8192;
+
+    // state shared by all sub-streams of a CommandStream, between fork() and join()
+    struct SubBuffers {
+        std::atomic<size_t> used{};     // space allocated in the reserved space
+        char* base = nullptr;           // start of the reserved space
+        size_t capacity = 0;            // size of the reserved space
+        void* forkPoint = nullptr;      // where the jump to the first sub-stream goes
+    };
+
     inline void* allocateCommand(size_t size) {
+        if (UTILS_UNLIKELY(mParentSubBuffers)) {
+            char* const p = mChunkHead;
+            if (UTILS_LIKELY(size_t(mChunkEnd - p) >= size)) {
+                mChunkHead = p + size;
+                return p;
+            }
+            return allocateChunk(size);
+        }
         assert_invariant(utils::ThreadUtils::isThisThread(mThreadId));
-        return mCurrentBuffer.allocate(size);
+        return mCurrentBuffer->allocate(size);
     }
 
+    // allocates a new chunk of the reserved space for this sub-stream
+    void* allocateChunk(size_t size) noexcept;
+
     // We use a copy of Dispatcher (instead of a pointer) because this removes one dereference
     // when executing driver commands.
     Driver& UTILS_RESTRICT mDriver;
-    CircularBuffer& UTILS_RESTRICT mCurrentBuffer;
+    CircularBuffer* const UTILS_RESTRICT mCurrentBuffer;    // nullptr for sub-streams
     Dispatcher mDispatcher;
 
 #ifndef NDEBUG
@@ -294,6 +356,18 @@ private:
 #endif
 
     bool mUsePerformanceCounter = false;
+
+    // parent streams only
+    SubBuffers mSubBuffers;
+
+    // sub-streams only: the current chunk always has room for a NoopCommand after mChunkEnd
+    SubBuffers* const mParentSubBuffers = nullptr;
+    char* mChunkHead = nullptr;
+    char* mChunkEnd = nullptr;
+    char* mFirstCommand = nullptr;
+
+    // non-null while commands are being captured
+    std::unique_ptr<CommandCaptureWriter> mCapture;
 };
 
 void* CommandStream::allocate(size_t size, size_t alignment) noexcept {
@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "private/backend/CommandCapture.h"
+
+#include "private/backend/CommandStream.h"
+
+#include <backend/SamplerDescriptor.h>
+
+#include <utils/debug.h>
+
+#include <algorithm>
+
+#include <stdlib.h>
+
+using namespace utils;
+
+namespace filament::backend {
+
+namespace {
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t commandCount;
+    uint32_t reserved;
+};
+
+// 'FCMD'
+constexpr uint32_t CAPTURE_MAGIC = 0x444D4346;
+constexpr uint32_t CAPTURE_VERSION = 1;
+
+// BufferDescriptor payloads are aligned so that they can be used in place by the replay
+constexpr size_t PAYLOAD_ALIGNMENT = 16;
+
+constexpr uint32_t NULL_STRING = UINT32_MAX;
+
+static_assert(sizeof(Header) % PAYLOAD_ALIGNMENT == 0);
+
+} // anonymous namespace
+
+// ------------------------------------------------------------------------------------------------
+
+CommandCaptureWriter::CommandCaptureWriter(const char* path) noexcept
+        : mFile(fopen(path, "wb")) {
+    if (mFile) {
+        writeValue(Header{ CAPTURE_MAGIC, CAPTURE_VERSION, uint32_t(CommandId::COUNT), 0 });
+    }
+}
+
+CommandCaptureWriter::~CommandCaptureWriter() noexcept {
+    if (mFile) {
+        fclose(mFile);
+    }
+}
+
+void CommandCaptureWriter::writeBytes(void const* data, size_t size) noexcept {
+    if (UTILS_LIKELY(mFile && size)) {
+        fwrite(data, 1, size, mFile);
+        mOffset += size;
+    }
+}
+
+void CommandCaptureWriter::alignTo(size_t alignment) noexcept {
+    static constexpr uint8_t zeroes[PAYLOAD_ALIGNMENT] = {};
+    assert_invariant(alignment <= PAYLOAD_ALIGNMENT);
+    writeBytes(zeroes, (alignment - (mOffset % alignment)) % alignment);
+}
+
+void CommandCaptureWriter::writeArgument(const char* const& string) noexcept {
+    if (!string) {
+        writeValue(NULL_STRING);
+        return;
+    }
+    uint32_t const length = uint32_t(strlen(string));
+    writeValue(length);
+    writeBytes(string, length + 1);
+}
+
+void CommandCaptureWriter::writeString(CString const& string) noexcept {
+    uint32_t const length = uint32_t(string.size());
+    writeValue(length);
+    writeBytes(string.c_str_safe(), length + 1);
+}
+
+void CommandCaptureWriter::writeArgument(BufferDescriptor const& buffer) noexcept {
+    uint64_t const size = buffer.size;
+    uint32_t const hasData = buffer.buffer != nullptr;
+    writeValue(size);
+    writeValue(hasData);
+    alignTo(PAYLOAD_ALIGNMENT);
+    if (hasData) {
+        writeBytes(buffer.buffer, size);
+    }
+}
+
+void CommandCaptureWriter::writeArgument(PixelBufferDescriptor const& buffer) noexcept {
+    writeArgument(static_cast<BufferDescriptor const&>(buffer));
+    bool const compressed = buffer.type == PixelDataType::COMPRESSED;
+    writeValue(buffer.left);
+    writeValue(buffer.top);
+    writeValue(compressed ? buffer.imageSize : buffer.stride);
+    writeValue(compressed ? uint32_t(buffer.compressedFormat) : uint32_t(buffer.format));
+    writeValue(uint8_t(buffer.type));
+    writeValue(uint8_t(buffer.alignment));
+}
+
+void CommandCaptureWriter::writeArgument(Program const& program) noexcept {
+    writeString(program.getName());
+    writeValue(program.getCacheId());
+
+    for (auto const& blob : program.getShadersSource()) {
+        writeValue(uint64_t(blob.size()));
+        writeBytes(blob.data(), blob.size());
+    }
+
+    for (auto const& name : program.getUniformBlockBindings()) {
+        writeString(name);
+    }
+
+    for (auto const& group : program.getSamplerGroupInfo()) {
+        writeValue(group.stageFlags);
+        writeValue(uint32_t(group.samplers.size()));
+        for (auto const& sampler : group.samplers) {
+            writeString(sampler.name);
+            writeValue(sampler.binding);
+        }
+    }
+
+    for (auto const& uniforms : program.getBindingUniformInfo()) {
+        writeValue(uint32_t(uniforms.size()));
+        for (auto const& uniform : uniforms) {
+            writeString(uniform.name);
+            writeValue(uniform.offset);
+            writeValue(uniform.size);
+            writeValue(uniform.type);
+        }
+    }
+
+    auto const& attributes = program.getAttributes();
+    writeValue(uint32_t(attributes.size()));
+    for (auto const& [name, location] : attributes) {
+        writeString(name);
+        writeValue(location);
+    }
+
+    auto const& constants = program.getSpecializationConstants();
+    writeValue(uint32_t(constants.size()));
+    for (auto const& constant : constants) {
+        writeValue(constant.id);
+        writeValue(uint32_t(constant.value.index()));
+        std::visit([this](auto value) { writeValue(value); }, constant.value);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+
+CommandCaptureReader::CommandCaptureReader(void* data, size_t size) noexcept
+        : mData(static_cast<uint8_t*>(data)), mSize(size) {
+    assert_invariant(uintptr_t(data) % PAYLOAD_ALIGNMENT == 0);
+    if (size >= sizeof(Header)) {
+        Header header{};
+        memcpy(&header, data, sizeof(Header));
+        mValid = header.magic == CAPTURE_MAGIC &&
+                 header.version == CAPTURE_VERSION &&
+                 header.commandCount == uint32_t(CommandId::COUNT);
+    }
+    mFirstCommandOffset = sizeof(Header);
+    mOffset = mFirstCommandOffset;
+}
+
+void CommandCaptureReader::rewind() noexcept {
+    mOffset = mFirstCommandOffset;
+    mCorrupted = false;
+    mHandles.clear();
+}
+
+uint8_t* CommandCaptureReader::readBytes(size_t size) noexcept {
+    // reading past the end stops the replay, see replayNext()
+    if (UTILS_UNLIKELY(size > mSize - mOffset)) {
+        mCorrupted = true;
+        mOffset = mSize;
+        return nullptr;
+    }
+    uint8_t* const p = mData + mOffset;
+    mOffset += size;
+    return p;
+}
+
+void CommandCaptureReader::alignTo(size_t alignment) noexcept {
+    mOffset = std::min((mOffset + alignment - 1) & ~(alignment - 1), mSize);
+}
+
+void CommandCaptureReader::readArgument(const char*& string) noexcept {
+    uint32_t length;
+    readValue(length);
+    string = length == NULL_STRING ? nullptr : (const char*)readBytes(length + 1);
+}
+
+CString CommandCaptureReader::readString() noexcept {
+    uint32_t length;
+    readValue(length);
+    const char* const string = (const char*)readBytes(length + 1);
+    return string ? CString{ string, length } : CString{};
+}
+
+void CommandCaptureReader::readArgument(BufferDescriptor& buffer) noexcept {
+    uint64_t size;
+    uint32_t hasData;
+    readValue(size);
+    readValue(hasData);
+    alignTo(PAYLOAD_ALIGNMENT);
+    // the payload is used in place, there is nothing to release
+    void* const data = hasData ? readBytes(size) : nullptr;
+    buffer = BufferDescriptor(data, hasData && !data ? 0 : size);
+}
+
+void CommandCaptureReader::readArgument(PixelBufferDescriptor& buffer) noexcept {
+    BufferDescriptor data;
+    readArgument(data);
+    uint32_t left, top, stride, format;
+    uint8_t type, alignment;
+    readValue(left);
+    readValue(top);
+    readValue(stride);
+    readValue(format);
+    readValue(type);
+    readValue(alignment);
+    if (PixelDataType(type) == PixelDataType::COMPRESSED) {
+        buffer = PixelBufferDescriptor(data.buffer, data.size,
+                CompressedPixelDataType(format), stride, nullptr);
+    } else {
+        buffer = PixelBufferDescriptor(data.buffer, data.size,
+                PixelDataFormat(format), PixelDataType(type), alignment, left, top, stride);
+    }
+}
+
+void CommandCaptureReader::readArgument(Program& program) noexcept {
+    CString name = readString();
+    uint64_t cacheId;
+    readValue(cacheId);
+    program.cacheId(cacheId);
+    program.diagnostics(name, [name](io::ostream& out) -> io::ostream& {
+        return out << name.c_str_safe();
+    });
+
+    for (auto& blob : program.getShadersSource()) {
+        uint64_t size;
+        readValue(size);
+        uint8_t const* const data = readBytes(size);
+        blob = Program::ShaderBlob(data ? size : 0);
+        if (data && size) {
+            memcpy(blob.data(), data, size);
+        }
+    }
+
+    for (auto& uniformBlockName : program.getUniformBlockBindings()) {
+        uniformBlockName = readString();
+    }
+
+    for (auto& group : program.getSamplerGroupInfo()) {
+        uint32_t count;
+        readValue(group.stageFlags);
+        readValue(count);
+        group.samplers = FixedCapacityVector<Program::Sampler>::with_capacity(count);
+        for (uint32_t i = 0; i < count; i++) {
+            Program::Sampler sampler{ readString() };
+            readValue(sampler.binding);
+            group.samplers.push_back(std::move(sampler));
+        }
+    }
+
+    for (auto& uniforms : program.getBindingUniformInfo()) {
+        uint32_t count;
+        readValue(count);
+        uniforms = Program::UniformInfo::with_capacity(count);
+        for (uint32_t i = 0; i < count; i++) {
+            Program::Uniform uniform{ readString() };
+            readValue(uniform.offset);
+            readValue(uniform.size);
+            readValue(uniform.type);
+            uniforms.push_back(std::move(uniform));
+        }
+    }
+
+    uint32_t attributeCount;
+    readValue(attributeCount);
+    auto& attributes = program.getAttributes();
+    attributes = FixedCapacityVector<std::pair<CString, uint8_t>>::with_capacity(attributeCount);
+    for (uint32_t i = 0; i < attributeCount; i++) {
+        CString attributeName = readString();
+        uint8_t location;
+        readValue(location);
+        attributes.emplace_back(std::move(attributeName), location);
+    }
+
+    uint32_t constantCount;
+    readValue(constantCount);
+    auto& constants = program.getSpecializationConstants();
+    constants = FixedCapacityVector<Program::SpecializationConstant>::with_capacity(constantCount);
+    for (uint32_t i = 0; i < constantCount; i++) {
+        Program::SpecializationConstant constant{};
+        uint32_t index;
+        readValue(constant.id);
+        readValue(index);
+        switch (index) {
+            case 0: { int32_t v; readValue(v); constant.value = v; break; }
+            case 1: { float v;   readValue(v); constant.value = v; break; }
+            default:{ bool v;    readValue(v); constant.value = v; break; }
+        }
+        constants.push_back(constant);
+    }
+}
+
+void CommandCaptureReader::remap(PipelineState& pipelineState) noexcept {
+    remap(pipelineState.program);
+}
+
+void CommandCaptureReader::remap(TargetBufferInfo& info) noexcept {
+    remap(info.handle);
+}
+
+void CommandCaptureReader::remap(MRT& mrt) noexcept {
+    for (size_t i = 0; i < MRT::MAX_SUPPORTED_RENDER_TARGET_COUNT; i++) {
+        remap(mrt[i]);
+    }
+}
+
+void CommandCaptureReader::remapSamplerGroup(BufferDescriptor& buffer) noexcept {
+    if (!buffer.buffer || mHandles.empty()) {
+        return;
+    }
+    // the payload can be replayed several times, so we must not patch it in place
+    void* const copy = malloc(buffer.size);
+    memcpy(copy, buffer.buffer, buffer.size);
+    SamplerDescriptor* const samplers = static_cast<SamplerDescriptor*>(copy);
+    for (size_t i = 0, c = buffer.size / sizeof(SamplerDescriptor); i < c; i++) {
+        remap(samplers[i].t);
+    }
+    buffer = BufferDescriptor(copy, buffer.size, [](void* p, size_t, void*) { free(p); });
+}
+
+template<CommandId ID, typename R, typename ... ARGS>
+void CommandCaptureReader::replay(CommandStream& stream, R (CommandStream::*method)(ARGS...)) {
+    using Arguments = std::tuple<std::decay_t<ARGS>...>;
+
+    if constexpr (std::is_void_v<R>) {
+        Arguments args;
+        std::apply([this](auto& ... arg) { (readArgument(arg), ...); }, args);
+        if (UTILS_UNLIKELY(mCorrupted)) {
+            return;
+        }
+        if constexpr (ID == CommandId::updateSamplerGroup) {
+            remapSamplerGroup(std::get<1>(args));
+        }
+        std::apply([&](auto& ... arg) { (stream.*method)(std::move(arg)...); }, args);
+    } else {
+        // the handle returned when the capture was made comes first
+        R captured;
+        readValue(captured);
+        Arguments args;
+        std::apply([this](auto& ... arg) { (readArgument(arg), ...); }, args);
+        if (UTILS_UNLIKELY(mCorrupted)) {
+            return;
+        }
+
+        R result;
+        if constexpr (ID == CommandId::createSwapChain) {
+            if (mHeadlessWidth && mHeadlessHeight) {
+                result = stream.createSwapChainHeadless(
+                        mHeadlessWidth, mHeadlessHeight, std::get<1>(args));
+            } else {
+                result = std::apply([&](auto& ... arg) {
+                    return (stream.*method)(std::move(arg)...);
+                }, args);
+            }
+        } else {
+            result = std::apply([&](auto& ... arg) {
+                return (stream.*method)(std::move(arg)...);
+            }, args);
+        }
+
+        if (captured && result) {
+            mHandles[captured.getId()] = result.getId();
+        }
+    }
+}
+
+CommandId CommandCaptureReader::replayNext(CommandStream& stream) {
+    if (!mValid || mCorrupted || mSize - mOffset < sizeof(uint32_t)) {
+        return CommandId::COUNT;
+    }
+
+    uint32_t id;
+    readValue(id);
+    switch (CommandId(id)) {
+#define DECL_DRIVER_API(methodName, paramsDecl, params)                                         \
+        case CommandId::methodName:                                                             \
+            replay<CommandId::methodName>(stream, &CommandStream::methodName);                  \
+            break;
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params)                         \
+        case CommandId::methodName:                                                             \
+            replay<CommandId::methodName>(stream, &CommandStream::methodName);                  \
+            break;
+#include "private/backend/DriverAPI.inc"
+        default:
+            mCorrupted = true;
+            break;
+    }
+    // the command is dropped if its arguments were truncated
+    return mCorrupted ? CommandId::COUNT : CommandId(id);
+}
+
+} // namespace filament::backend
@@ -21,9 +21,11 @@
 #endif
 
 #include <utils/Log.h>
+#include <utils/Panic.h>
 #include <utils/Profiler.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
 #include <functional>
 
 #ifdef __ANDROID__
@@ -60,7 +62,7 @@ static UTILS_NOINLINE UTILS_UNUSED std::string extractMethodName(std::string& co
 
 CommandStream::CommandStream(Driver& driver, CircularBuffer& buffer) noexcept
         : mDriver(driver),
-          mCurrentBuffer(buffer),
+          mCurrentBuffer(&buffer),
           mDispatcher(driver.getDispatcher())
 #ifndef NDEBUG
           , mThreadId(ThreadUtils::getThreadId())
@@ -73,6 +75,98 @@ CommandStream::CommandStream(Driver& driver, CircularBuffer& buffer) noexcept
 #endif
 }
 
+CommandStream::CommandStream(CommandStream* parent) noexcept
+        : mDriver(parent->mDriver),
+          mCurrentBuffer(nullptr),
+          mDispatcher(parent->mDispatcher),
+          mParentSubBuffers(&parent->mSubBuffers) {
+}
+
+void CommandStream::fork() noexcept {
+    assert_invariant(mCurrentBuffer);
+    assert_invariant(!mSubBuffers.base);
+
+    // reserve the jump to the first sub-stream, we don't know where it is yet
+    mSubBuffers.forkPoint = allocateCommand(CommandBase::align(sizeof(NoopCommand)));
+
+    // the sub-streams can use everything after that
+    mSubBuffers.base = static_cast<char*>(mCurrentBuffer->getHead());
+    mSubBuffers.capacity = mCurrentBuffer->getContiguousSize();
+    mSubBuffers.used.store(0, std::memory_order_relaxed);
+}
+
+void CommandStream::join(CommandStream* const* subStreams, size_t count) noexcept {
+    SYSTRACE_CALL();
+    assert_invariant(mSubBuffers.base);
+
+    // This must be synchronized with the threads using the sub-streams by the caller, so we're
+    // guaranteed to see all their allocations.
+    size_t const used = mSubBuffers.used.load(std::memory_order_relaxed);
+
+    // skip over the sub-buffers, this is where this stream continues
+    mCurrentBuffer->allocate(used);
+    void* const joinPoint = mCurrentBuffer->getHead();
+
+    // link the sub-streams together, in order
+    void* jump = mSubBuffers.forkPoint;
+    for (size_t i = 0; i < count; i++) {
+        CommandStream* const UTILS_RESTRICT subStream = subStreams[i];
+        assert_invariant(subStream->mParentSubBuffers == &mSubBuffers);
+        if (subStream->mFirstCommand) {
+            new(jump) NoopCommand(subStream->mFirstCommand);
+            // there is always room for the NoopCommand at the end of the last chunk
+            jump = subStream->mChunkHead;
+        }
+        subStream->mChunkHead = nullptr;
+        subStream->mChunkEnd = nullptr;
+        subStream->mFirstCommand = nullptr;
+    }
+    new(jump) NoopCommand(joinPoint);
+
+    mSubBuffers.forkPoint = nullptr;
+    mSubBuffers.base = nullptr;
+    mSubBuffers.capacity = 0;
+}
+
+void* CommandStream::allocateChunk(size_t size) noexcept {
+    constexpr size_t NOOP_COMMAND_SIZE = CommandBase::align(sizeof(NoopCommand));
+    SubBuffers& UTILS_RESTRICT subBuffers = *mParentSubBuffers;
+    assert_invariant(subBuffers.base);
+
+    size_t const chunkSize = std::max(SUB_BUFFER_CHUNK_SIZE, size + NOOP_COMMAND_SIZE);
+    size_t const offset = subBuffers.used.fetch_add(chunkSize, std::memory_order_relaxed);
+
+    ASSERT_POSTCONDITION(offset + chunkSize <= subBuffers.capacity,
+            "Backend CommandStream overflow while recording from multiple threads.\n"
+            "Please increase minCommandBufferSizeMB inside the Config passed to Engine::create.");
+
+    char* const chunk = subBuffers.base + offset;
+    if (mChunkHead) {
+        // link the previous chunk to this one
+        new(mChunkHead) NoopCommand(chunk);
+    } else {
+        mFirstCommand = chunk;
+    }
+    mChunkHead = chunk + size;
+    mChunkEnd = chunk + chunkSize - NOOP_COMMAND_SIZE;
+    return chunk;
+}
+
+bool CommandStream::startCommandCapture(const char* path) noexcept {
+    assert_invariant(mCurrentBuffer);
+    auto capture = std::make_unique<CommandCaptureWriter>(path);
+    if (!capture->isOpen()) {
+        slog.e << "Couldn't create command capture file " << path << io::endl;
+        return false;
+    }
+    mCapture = std::move(capture);
+    return true;
+}
+
+void CommandStream::stopCommandCapture() noexcept {
+    mCapture.reset();
+}
+
 void CommandStream::execute(void* buffer) {
     SYSTRACE_CALL();
     SYSTRACE_CONTEXT();
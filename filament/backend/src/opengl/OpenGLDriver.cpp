@@ -32,6 +32,8 @@
 #include <utils/Panic.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
+
 #if defined(__EMSCRIPTEN__)
 #include <emscripten.h>
 #endif
@@ -146,7 +148,8 @@ Driver* OpenGLDriver::create(OpenGLPlatform* const platform,
 
     size_t const defaultSize = FILAMENT_OPENGL_HANDLE_ARENA_SIZE_IN_MB * 1024U * 1024U;
     Platform::DriverConfig const validConfig {
-        .handleArenaSize = std::max(driverConfig.handleArenaSize, defaultSize) };
+        .handleArenaSize = std::max(driverConfig.handleArenaSize, defaultSize),
+        .skipDrawsWithPendingPrograms = driverConfig.skipDrawsWithPendingPrograms };
     OpenGLDriver* const driver = new OpenGLDriver(ec, validConfig);
     return driver;
 }
@@ -167,7 +170,8 @@ OpenGLDriver::DebugMarker::~DebugMarker() noexcept {
 OpenGLDriver::OpenGLDriver(OpenGLPlatform* platform, const Platform::DriverConfig& driverConfig) noexcept
         : mHandleAllocator("Handles", driverConfig.handleArenaSize),
           mSamplerMap(32),
-          mPlatform(*platform) {
+          mPlatform(*platform),
+          mSkipDrawsWithPendingPrograms(driverConfig.skipDrawsWithPendingPrograms) {
   
     std::fill(mSamplerBindings.begin(), mSamplerBindings.end(), nullptr);
 
@@ -1465,6 +1469,9 @@ void OpenGLDriver::destroyProgram(Handle<HwProgram> ph) {
     if (ph) {
         OpenGLProgram* p = handle_cast<OpenGLProgram*>(ph);
         cancelRunAtNextPassOp(p);
+        auto& pending = mPendingPrograms;
+        pending.erase(std::remove_if(pending.begin(), pending.end(),
+                [p](auto const& item) { return item.first == p; }), pending.end());
         destruct(ph, p);
     }
 }
@@ -2613,6 +2620,24 @@ void OpenGLDriver::compilePrograms(CallbackHandler* handler,
     //       materials. If that changed, we'd have to only execute the callbacks related to
     //       material compilation.
     executeRenderPassOps();
+
+    updatePendingPrograms();
+    if (!mPendingPrograms.empty()) {
+        // With KHR_parallel_shader_compile, the driver might still be compiling some programs,
+        // the callback is only scheduled once all the programs created so far are ready.
+        uint64_t const serial = mPendingProgramSerial;
+        runEveryNowAndThen([this, serial, handler, callback, user]() -> bool {
+            updatePendingPrograms();
+            // programs are in creation order, so we only need to check the oldest one
+            if (!mPendingPrograms.empty() && mPendingPrograms.front().second <= serial) {
+                return false;
+            }
+            scheduleCallback(handler, user, callback);
+            return true;
+        });
+        return;
+    }
+
     scheduleCallback(handler, user, callback);
 }
 
@@ -3229,6 +3254,20 @@ void OpenGLDriver::cancelRunAtNextPassOp(void* token) noexcept {
     mRunAtNextRenderPassOps.erase(token);
 }
 
+void OpenGLDriver::addPendingProgram(OpenGLProgram* p) noexcept {
+    mPendingPrograms.emplace_back(p, ++mPendingProgramSerial);
+}
+
+void OpenGLDriver::updatePendingPrograms() noexcept {
+    auto& pending = mPendingPrograms;
+    if (!pending.empty()) {
+        // this doesn't block, and preserves the creation order
+        pending.erase(std::remove_if(pending.begin(), pending.end(),
+                [this](auto const& item) { return item.first->isReady(mContext); }),
+                pending.end());
+    }
+}
+
 void OpenGLDriver::executeRenderPassOps() noexcept {
     auto& ops = mRunAtNextRenderPassOps;
     if (!ops.empty()) {
@@ -3247,6 +3286,7 @@ void OpenGLDriver::tick(int) {
     DEBUG_MARKER()
     executeGpuCommandsCompleteOps();
     executeEveryNowAndThenOps();
+    updatePendingPrograms();
 }
 
 void OpenGLDriver::beginFrame(
@@ -3511,6 +3551,12 @@ void OpenGLDriver::draw(PipelineState state, Handle<HwRenderPrimitive> rph, uint
         return;
     }
 
+    // When requested, skip the draw rather than wait for a program the driver is still
+    // compiling (this only happens with KHR_parallel_shader_compile).
+    if (UTILS_UNLIKELY(mSkipDrawsWithPendingPrograms && !p->isReady(gl))) {
+        return;
+    }
+
     useProgram(p);
 
     GLRenderPrimitive* rp = handle_cast<GLRenderPrimitive *>(rph);
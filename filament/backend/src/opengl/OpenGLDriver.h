@@ -392,6 +392,15 @@ private:
     void cancelRunAtNextPassOp(void* token) noexcept;
     tsl::robin_map<void*, std::function<void()>> mRunAtNextRenderPassOps;
 
+    // programs being compiled and linked by the driver with KHR_parallel_shader_compile, along
+    // with an increasing serial number, in creation order.
+    void addPendingProgram(OpenGLProgram* p) noexcept;
+    void updatePendingPrograms() noexcept;
+    std::vector<std::pair<OpenGLProgram*, uint64_t>> mPendingPrograms;
+    uint64_t mPendingProgramSerial = 0;
+    // whether draws using a program that's not ready yet are skipped, instead of waiting for it
+    bool mSkipDrawsWithPendingPrograms = false;
+
     // timer query implementation
     OpenGLTimerQueryInterface* mTimerQueryImpl = nullptr;
     bool mFrameTimeSupported = false;
@@ -86,6 +86,18 @@ OpenGLProgram::OpenGLProgram(OpenGLDriver& gld, Program&& program) noexcept
                 gl.shaders,
                 mLazyInitializationData->shaderSourceCode);
 
+        if (context.ext.KHR_parallel_shader_compile) {
+            // The driver compiles and links in its own threads, so we can link right away,
+            // this doesn't block. Completion is polled with GL_COMPLETION_STATUS_KHR and the
+            // status is only checked when the program is first used, after which the program
+            // binary can be cached without blocking either.
+            gl.program = OpenGLProgram::linkProgram(context,
+                    mLazyInitializationData, gl.shaders);
+            mLazyInitializationData->blobCacheKey = std::move(key);
+            gld.addPendingProgram(this);
+            return;
+        }
+
         gld.runAtNextRenderPass(this, [this, &gld, &context, key = std::move(key)]() {
             // by this point we must not have a GL program
             assert_invariant(!gl.program);
@@ -363,7 +375,19 @@ bool OpenGLProgram::checkProgramStatus(const char* name,
     return false;
 }
 
-void OpenGLProgram::initialize(OpenGLContext& context) {
+bool OpenGLProgram::isLinkComplete(OpenGLContext& context) const noexcept {
+    if (!context.ext.KHR_parallel_shader_compile || !gl.program) {
+        // without KHR_parallel_shader_compile, we'll block when the program is first used
+        return true;
+    }
+    GLint status = GL_FALSE;
+    glGetProgramiv(gl.program, GL_COMPLETION_STATUS_KHR, &status);
+    return status == GL_TRUE;
+}
+
+void OpenGLProgram::initialize(OpenGLDriver& gld) {
+    OpenGLContext& context = gld.getContext();
+
     // by this point we must have a GL program
     assert_invariant(gl.program);
     // we also can't be in the initialized state
@@ -381,6 +405,10 @@ void OpenGLProgram::initialize(OpenGLContext& context) {
 
     if (UTILS_LIKELY(mValid)) {
         initializeProgramState(context, gl.program, *pInitializationData);
+        if (pInitializationData->blobCacheKey) {
+            // the program was linked asynchronously, it can be cached now that it's complete
+            OpenGLBlobCache::insert(gld.mPlatform, pInitializationData->blobCacheKey, gl.program);
+        }
     }
 
     // and destroy all temporary init data
@@ -17,6 +17,7 @@
 #ifndef TNT_FILAMENT_BACKEND_OPENGL_OPENGLPROGRAM_H
 #define TNT_FILAMENT_BACKEND_OPENGL_OPENGLPROGRAM_H
 
+#include "BlobCacheKey.h"
 #include "DriverBase.h"
 #include "OpenGLDriver.h"
 
@@ -43,9 +44,18 @@ public:
 
     bool isValid() const noexcept { return mValid; }
 
+    // Returns whether the program can be used without waiting for the driver to finish
+    // compiling and linking it. This can only return false with KHR_parallel_shader_compile.
+    bool isReady(OpenGLContext& context) const noexcept {
+        if (UTILS_LIKELY(mInitialized)) {
+            return true;
+        }
+        return isLinkComplete(context);
+    }
+
     void use(OpenGLDriver* const gld, OpenGLContext& context) noexcept {
         if (UTILS_UNLIKELY(!mInitialized)) {
-            initialize(context);
+            initialize(*gld);
         }
 
         context.useProgram(gl.program);
@@ -83,6 +93,8 @@ private:
         std::array<Program::UniformInfo, Program::UNIFORM_BINDING_COUNT> bindingUniformInfo;
         utils::FixedCapacityVector<std::pair<utils::CString, uint8_t>> attributes;
         std::array<utils::CString, Program::SHADER_TYPE_COUNT> shaderSourceCode;
+        // key used to cache the program binary once it's linked, when the link is asynchronous
+        BlobCacheKey blobCacheKey;
     };
 
     static void compileShaders(OpenGLContext& context,
@@ -106,7 +118,9 @@ private:
             GLuint& program, GLuint shaderIds[Program::SHADER_TYPE_COUNT],
             std::array<utils::CString, Program::SHADER_TYPE_COUNT> const& shaderSourceCode) noexcept;
 
-    void initialize(OpenGLContext& context);
+    bool isLinkComplete(OpenGLContext& context) const noexcept;
+
+    void initialize(OpenGLDriver& gld);
 
     void initializeProgramState(OpenGLContext& context, GLuint program,
             LazyInitializationData& lazyInitializationData) noexcept;
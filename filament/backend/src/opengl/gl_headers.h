@@ -230,6 +230,12 @@ using namespace glext;
 #define GL_TEXTURE_EXTERNAL_OES           0x8D65
 #endif
 
+// KHR_parallel_shader_compile is detected at runtime, and shares its tokens with
+// ARB_parallel_shader_compile on desktop.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR          0x91B1
+#endif
+
 // This is an odd duck function that exists in WebGL 2.0 but not in OpenGL ES.
 #if defined(__EMSCRIPTEN__)
 extern "C" {
@@ -79,4 +79,9 @@ constexpr static const int VK_MAX_PIPELINE_AGE = 10;
 // destroying any unused pipeline object.
 static_assert(VK_MAX_PIPELINE_AGE >= VK_MAX_COMMAND_BUFFERS);
 
+// Minimum number of command buffer submissions between two saves of the VkPipelineCache data
+// through the platform's blob functions. Saving serializes the whole cache, so we don't want to do
+// it every time a pipeline is created, e.g. while the first frames of a scene are rendered.
+constexpr static const int VK_PIPELINE_CACHE_SAVE_INTERVAL = 1000;
+
 #endif
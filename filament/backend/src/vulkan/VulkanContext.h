@@ -174,6 +174,10 @@ public:
         return mPhysicalDeviceProperties.limits;
     }
 
+    inline VkPhysicalDeviceProperties const& getPhysicalDeviceProperties() const noexcept {
+        return mPhysicalDeviceProperties;
+    }
+
     inline uint32_t getPhysicalDeviceVendorId() const noexcept {
         return mPhysicalDeviceProperties.vendorID;
     }
@@ -204,6 +208,9 @@ public:
     inline bool isMaintenance3Supported() const noexcept {
         return mMaintenanceSupported[2];
     }
+    inline bool isPipelineCreationFeedbackSupported() const noexcept {
+        return mPipelineCreationFeedbackSupported;
+    }
 
 private:
     VkPhysicalDeviceMemoryProperties mMemoryProperties = {};
@@ -214,6 +221,7 @@ private:
     bool mPortabilitySubsetSupported = false;
     bool mPortabilityEnumerationSupported = false;
     bool mMaintenanceSupported[3] = {};
+    bool mPipelineCreationFeedbackSupported = false;
 
     VkFormat mDepthFormat;
 
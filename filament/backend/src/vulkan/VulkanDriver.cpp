@@ -190,6 +190,8 @@ VulkanDriver::VulkanDriver(VulkanPlatform* platform, VulkanContext const& contex
             mPlatform->getGraphicsQueue(), mPlatform->getGraphicsQueueFamilyIndex());
     mCommands->setObserver(&mPipelineCache);
     mPipelineCache.setDevice(mPlatform->getDevice(), mAllocator);
+    mPipelineCache.createPipelineCache(*mPlatform, mContext.getPhysicalDeviceProperties(),
+            mContext.isPipelineCreationFeedbackSupported());
 
     // TOOD: move them all to be initialized by constructor
     mStagePool.initialize(mAllocator, mCommands);
@@ -236,6 +238,7 @@ void VulkanDriver::terminate() {
     mDisposer.reset();
 
     mStagePool.reset();
+    mPipelineCache.savePipelineCache(true);
     mPipelineCache.destroyCache();
     mFramebufferCache.reset();
     mSamplerCache.reset();
@@ -264,6 +267,7 @@ void VulkanDriver::collectGarbage() {
     mFramebufferCache.gc();
     mDisposer.gc();
     mCommands->gc();
+    mPipelineCache.savePipelineCache();
 }
 
 void VulkanDriver::beginFrame(int64_t monotonic_clock_ns, uint32_t frameId) {
@@ -17,9 +17,13 @@
 #include "vulkan/VulkanMemory.h"
 #include "vulkan/VulkanPipelineCache.h"
 
+#include <backend/Platform.h>
+
 #include <utils/Log.h>
 #include <utils/Panic.h>
 
+#include <string.h>
+
 #include "VulkanConstants.h"
 #include "VulkanHandles.h"
 #include "VulkanUtility.h"
@@ -469,7 +473,19 @@ VulkanPipelineCache::PipelineCacheEntry* VulkanPipelineCache::createPipeline() n
         utils::slog.d << "vkCreateGraphicsPipelines with shaders = ("
                 << shaderStages[0].module << ", " << shaderStages[1].module << ")" << utils::io::endl;
     }
-    VkResult error = vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo,
+
+    // When supported, ask the driver whether the pipeline was found in the pipeline cache.
+    VkPipelineCreationFeedbackEXT creationFeedback = {};
+    VkPipelineCreationFeedbackCreateInfoEXT creationFeedbackInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT,
+        .pPipelineCreationFeedback = &creationFeedback,
+    };
+    if (mCreationFeedbackSupported) {
+        pipelineCreateInfo.pNext = &creationFeedbackInfo;
+    }
+
+    seedPipelineCache();
+    VkResult error = vkCreateGraphicsPipelines(mDevice, mVkPipelineCache, 1, &pipelineCreateInfo,
             VKALLOC, &cacheEntry.handle);
     assert_invariant(error == VK_SUCCESS);
     if (error != VK_SUCCESS) {
@@ -477,6 +493,17 @@ VulkanPipelineCache::PipelineCacheEntry* VulkanPipelineCache::createPipeline() n
         return nullptr;
     }
 
+    mPipelineCacheStatistics.createdCount++;
+    mPipelineCacheDirty = true;
+    if (creationFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT) {
+        if (creationFeedback.flags &
+                VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) {
+            mPipelineCacheStatistics.hitCount++;
+        } else {
+            mPipelineCacheStatistics.missCount++;
+        }
+    }
+
     return &mPipelines.emplace(mPipelineRequirements, cacheEntry).first.value();
 }
 
@@ -639,6 +666,119 @@ void VulkanPipelineCache::bindInputAttachment(uint32_t bindingIndex,
     mDescriptorRequirements.inputAttachments[bindingIndex] = targetInfo;
 }
 
+void VulkanPipelineCache::createPipelineCache(Platform& platform,
+        VkPhysicalDeviceProperties const& properties, bool creationFeedbackSupported) noexcept {
+    assert_invariant(mDevice != VK_NULL_HANDLE);
+    assert_invariant(mVkPipelineCache == VK_NULL_HANDLE);
+
+    mPlatform = &platform;
+    mCreationFeedbackSupported = creationFeedbackSupported;
+
+    PipelineCacheBlobKey& key = mPipelineCacheBlobKey;
+    key = {};
+    strncpy(key.tag, "vkpipelinecache", sizeof(key.tag));
+    key.vendorID = properties.vendorID;
+    key.deviceID = properties.deviceID;
+    key.driverVersion = properties.driverVersion;
+    memcpy(key.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    VkPipelineCacheCreateInfo const createInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+    };
+    VkResult const error = vkCreatePipelineCache(mDevice, &createInfo, VKALLOC, &mVkPipelineCache);
+    if (error != VK_SUCCESS) {
+        // we can still create pipelines without a cache
+        utils::slog.w << "vkCreatePipelineCache error " << error << utils::io::endl;
+        mVkPipelineCache = VK_NULL_HANDLE;
+    }
+
+    mPipelineCacheStatistics = {};
+    mPipelineCacheSavedTime = mCurrentTime;
+    mPipelineCacheDirty = false;
+    mPipelineCacheSeeded = false;
+
+    // the blob functions are usually not set yet, in which case this is done later
+    seedPipelineCache();
+}
+
+void VulkanPipelineCache::seedPipelineCache() noexcept {
+    if (UTILS_LIKELY(mPipelineCacheSeeded) || mVkPipelineCache == VK_NULL_HANDLE ||
+            !mPlatform || !mPlatform->hasBlobFunc()) {
+        return;
+    }
+    mPipelineCacheSeeded = true;
+
+    PipelineCacheBlobKey const& key = mPipelineCacheBlobKey;
+    std::vector<uint8_t> data;
+    size_t const size = mPlatform->retrieveBlob(&key, sizeof(key), nullptr, 0);
+    if (size > 0) {
+        data.resize(size);
+        mPlatform->retrieveBlob(&key, sizeof(key), data.data(), data.size());
+    }
+
+    // Drivers are supposed to ignore data they didn't create, but not all of them check
+    // the header, so we make sure it matches our device before handing it over.
+    VkPipelineCacheHeaderVersionOne header;
+    if (data.size() < sizeof(header)) {
+        return;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+            header.vendorID != key.vendorID ||
+            header.deviceID != key.deviceID ||
+            memcmp(header.pipelineCacheUUID, key.pipelineCacheUUID, VK_UUID_SIZE)) {
+        return;
+    }
+
+    // Pipelines may have been created already, so the saved data is merged into our cache.
+    VkPipelineCacheCreateInfo const createInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.data(),
+    };
+    VkPipelineCache savedCache = VK_NULL_HANDLE;
+    VkResult error = vkCreatePipelineCache(mDevice, &createInfo, VKALLOC, &savedCache);
+    if (error != VK_SUCCESS) {
+        // the data was rejected by the driver, keep our cache as is
+        utils::slog.w << "vkCreatePipelineCache error " << error << utils::io::endl;
+        return;
+    }
+    error = vkMergePipelineCaches(mDevice, mVkPipelineCache, 1, &savedCache);
+    vkDestroyPipelineCache(mDevice, savedCache, VKALLOC);
+    if (error != VK_SUCCESS) {
+        utils::slog.w << "vkMergePipelineCaches error " << error << utils::io::endl;
+        return;
+    }
+    mPipelineCacheStatistics.loadedSize = uint32_t(data.size());
+}
+
+void VulkanPipelineCache::savePipelineCache(bool force) noexcept {
+    // the pipelines created before the blob functions were set must not replace the saved ones
+    seedPipelineCache();
+    if (!mPipelineCacheDirty || mVkPipelineCache == VK_NULL_HANDLE ||
+            !mPlatform || !mPlatform->hasBlobFunc()) {
+        return;
+    }
+    if (!force && mCurrentTime < mPipelineCacheSavedTime + VK_PIPELINE_CACHE_SAVE_INTERVAL) {
+        return;
+    }
+
+    size_t size = 0;
+    std::vector<uint8_t> data;
+    VkResult error = vkGetPipelineCacheData(mDevice, mVkPipelineCache, &size, nullptr);
+    if (error == VK_SUCCESS && size > 0) {
+        data.resize(size);
+        error = vkGetPipelineCacheData(mDevice, mVkPipelineCache, &size, data.data());
+    }
+    if (error == VK_SUCCESS && size > 0) {
+        mPlatform->insertBlob(&mPipelineCacheBlobKey, sizeof(mPipelineCacheBlobKey),
+                data.data(), size);
+    }
+
+    mPipelineCacheSavedTime = mCurrentTime;
+    mPipelineCacheDirty = false;
+}
+
 void VulkanPipelineCache::destroyCache() noexcept {
     // Symmetric to createLayoutsAndDescriptors.
     destroyLayoutsAndDescriptors();
@@ -646,6 +786,14 @@ void VulkanPipelineCache::destroyCache() noexcept {
         vkDestroyPipeline(mDevice, iter.second.handle, VKALLOC);
     }
     mPipelines.clear();
+    if (mVkPipelineCache != VK_NULL_HANDLE) {
+        PipelineCacheStatistics const& stats = mPipelineCacheStatistics;
+        utils::slog.i << "Vulkan pipeline cache: " << stats.createdCount << " pipelines created, "
+                << stats.hitCount << " hits, " << stats.missCount << " misses, "
+                << stats.loadedSize << " bytes loaded." << utils::io::endl;
+        vkDestroyPipelineCache(mDevice, mVkPipelineCache, VKALLOC);
+        mVkPipelineCache = VK_NULL_HANDLE;
+    }
     mBoundPipeline = {};
     vmaDestroyBuffer(mAllocator, mDummyBuffer, mDummyMemory);
     mDummyBuffer = VK_NULL_HANDLE;
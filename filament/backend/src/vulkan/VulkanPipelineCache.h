@@ -40,6 +40,7 @@ VK_DEFINE_HANDLE(VmaPool)
 
 namespace filament::backend {
 
+class Platform;
 struct VulkanProgram;
 
 // VulkanPipelineCache manages a cache of descriptor sets and pipelines.
@@ -131,6 +132,27 @@ public:
     ~VulkanPipelineCache();
     void setDevice(VkDevice device, VmaAllocator allocator);
 
+    // Statistics of the driver's VkPipelineCache, logged when it's destroyed. Hits and misses are
+    // only known when the VK_EXT_pipeline_creation_feedback extension is supported.
+    struct PipelineCacheStatistics {
+        uint32_t createdCount;      // number of VkPipeline created
+        uint32_t hitCount;          // number of VkPipeline found in the driver's cache
+        uint32_t missCount;         // number of VkPipeline compiled by the driver
+        uint32_t loadedSize;        // size in bytes of the data the cache was seeded with
+    };
+
+    // Creates the driver's VkPipelineCache used for all pipelines. It's seeded with the data last
+    // saved for this device and driver as soon as the platform has blob functions, which are
+    // usually set after the driver is created, but before the first pipeline is.
+    // Must be called after setDevice().
+    void createPipelineCache(Platform& platform, VkPhysicalDeviceProperties const& properties,
+            bool creationFeedbackSupported) noexcept;
+
+    // Saves the content of the driver's VkPipelineCache through the platform's blob functions.
+    // This does nothing if no new pipeline was created since it was last saved. Unless force is
+    // set, this also waits for VK_PIPELINE_CACHE_SAVE_INTERVAL flush events between saves.
+    void savePipelineCache(bool force = false) noexcept;
+
     // Creates new descriptor sets if necessary and binds them using vkCmdBindDescriptorSets.
     // Returns false if descriptor set allocation fails.
     bool bindDescriptors(VkCommandBuffer cmdbuffer) noexcept;
@@ -380,6 +402,35 @@ private:
     PipelineCacheEntry* createPipeline() noexcept;
     PipelineLayoutCacheEntry* getOrCreatePipelineLayout() noexcept;
 
+    // PERSISTENT PIPELINE CACHE
+    // -------------------------
+
+    // Key of the VkPipelineCache data in the platform's blob cache. The data can only be used
+    // with the device and driver that created it, so they're part of the key.
+    struct PipelineCacheBlobKey {
+        char tag[16];
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    };
+
+    static_assert(std::is_trivially_copyable<PipelineCacheBlobKey>::value,
+            "PipelineCacheBlobKey must be a POD, it's used as a key as is.");
+
+    // Merges the data saved through the platform's blob functions into the driver's
+    // VkPipelineCache, once. Does nothing until the platform has blob functions.
+    void seedPipelineCache() noexcept;
+
+    Platform* mPlatform = nullptr;
+    VkPipelineCache mVkPipelineCache = VK_NULL_HANDLE;
+    PipelineCacheBlobKey mPipelineCacheBlobKey = {};
+    PipelineCacheStatistics mPipelineCacheStatistics = {};
+    Timestamp mPipelineCacheSavedTime = 0;
+    bool mPipelineCacheDirty = false;
+    bool mPipelineCacheSeeded = false;
+    bool mCreationFeedbackSupported = false;
+
     // Misc helper methods.
     void destroyLayoutsAndDescriptors() noexcept;
     VkDescriptorPool createDescriptorPool(uint32_t size) const;
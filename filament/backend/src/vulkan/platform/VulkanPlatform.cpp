@@ -176,12 +176,13 @@ ExtensionSet getInstanceExtensions() {
 }
 
 ExtensionSet getDeviceExtensions(VkPhysicalDevice device) {
-    std::array<std::string_view, 5> const TARGET_EXTS = {
+    std::array<std::string_view, 6> const TARGET_EXTS = {
             VK_EXT_DEBUG_MARKER_EXTENSION_NAME,
             VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME,
             VK_KHR_MAINTENANCE1_EXTENSION_NAME,
             VK_KHR_MAINTENANCE2_EXTENSION_NAME,
             VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+            VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME,
     };
     ExtensionSet exts;
     // Identify supported physical device extensions
@@ -599,6 +600,9 @@ Driver* VulkanPlatform::createDriver(void* sharedContext,
         deviceExts = prunedDeviceExts;
     }
 
+    // extensions are only known to be enabled when we create the device ourselves
+    bool const ownsDevice = mImpl->mDevice == VK_NULL_HANDLE;
+
     mImpl->mDevice
             = mImpl->mDevice == VK_NULL_HANDLE ? createLogicalDevice(mImpl->mPhysicalDevice,
                       context.mPhysicalDeviceFeatures, mImpl->mGraphicsQueueFamilyIndex, deviceExts)
@@ -624,6 +628,9 @@ Driver* VulkanPlatform::createDriver(void* sharedContext,
             = deviceExts.find(VK_KHR_MAINTENANCE2_EXTENSION_NAME) != deviceExts.end();
     context.mMaintenanceSupported[2]
             = deviceExts.find(VK_KHR_MAINTENANCE3_EXTENSION_NAME) != deviceExts.end();
+    context.mPipelineCreationFeedbackSupported = ownsDevice
+            && deviceExts.find(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME)
+                    != deviceExts.end();
 
     // Choose a depth format that meets our requirements. Take care not to include stencil formats
     // just yet, since that would require a corollary change to the "aspect" flags for the VkImage.
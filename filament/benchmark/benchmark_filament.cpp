@@ -21,6 +21,7 @@
 
 #include <filament/Box.h>
 #include <filament/Frustum.h>
+#include "AabbTree.h"
 #include "Culler.h"
 
 #include <utils/Allocator.h>
@@ -35,7 +36,7 @@ using namespace utils;
 
 class FilamentFixture : public benchmark::Fixture {
 protected:
-    static constexpr size_t BATCH_SIZE = 512;
+    static constexpr size_t MAX_BATCH_SIZE = 100000;
 
     Frustum frustum{};
     std::vector<float3> boxesCenter;
@@ -50,7 +51,7 @@ public:
         std::default_random_engine gen; // NOLINT
         std::uniform_real_distribution<float> rand(-100.0f, 100.0f);
 
-        const size_t batch = BATCH_SIZE;
+        const size_t batch = Culler::round(MAX_BATCH_SIZE);
         frustum = Frustum{ mat4f::perspective(45.0f, 1.0f, 0.1f, 100.0f) };
 
         boxesCenter.resize(batch);
@@ -78,28 +79,136 @@ public:
     ~FilamentFixture() override {
         utils::aligned_free(visibles);
     }
+
+    // selects the ISA to benchmark, returns false (and skips the benchmark) if it's not supported
+    static bool setupIsa(benchmark::State& state, Culler::Isa* isa) {
+        static const char* const names[] = { "scalar", "sse4", "avx2", "neon" };
+        *isa = Culler::Isa(state.range(0));
+        if (!Culler::isSupported(*isa)) {
+            state.SkipWithError("ISA not supported on this CPU");
+            return false;
+        }
+        state.SetLabel(names[size_t(*isa)]);
+        return true;
+    }
 };
 
-BENCHMARK_F(FilamentFixture, boxCulling)(benchmark::State& state) {
+// arguments are: { isa, object count }
+static void cullingArguments(benchmark::internal::Benchmark* b) {
+    b->ArgNames({ "isa", "count" });
+    for (auto isa : { Culler::Isa::SCALAR, Culler::Isa::SSE4, Culler::Isa::AVX2,
+            Culler::Isa::NEON }) {
+        for (int64_t count : { 1000, 10000, 100000 }) {
+            b->Args({ int64_t(isa), count });
+        }
+    }
+}
+
+BENCHMARK_DEFINE_F(FilamentFixture, boxCulling)(benchmark::State& state) {
+    Culler::Isa isa;
+    if (!setupIsa(state, &isa)) {
+        return;
+    }
+    const size_t count = size_t(state.range(1));
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            Culler::Test::intersects(isa, visibles, frustum,
+                    boxesCenter.data(), boxesExtent.data(), count);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+}
+
+BENCHMARK_DEFINE_F(FilamentFixture, sphereCulling)(benchmark::State& state) {
+    Culler::Isa isa;
+    if (!setupIsa(state, &isa)) {
+        return;
+    }
+    const size_t count = size_t(state.range(1));
     {
         PerformanceCounters pc(state);
         for (auto _ : state) {
-            Culler::Test::intersects(visibles, frustum, boxesCenter.data(), boxesExtent.data(), BATCH_SIZE);
+            Culler::Test::intersects(isa, visibles, frustum, spheres.data(), count);
         }
         benchmark::ClobberMemory();
         pc.stop();
-        state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+        state.SetItemsProcessed(state.iterations() * count);
     }
 }
 
-BENCHMARK_F(FilamentFixture, sphereCulling)(benchmark::State& state) {
+BENCHMARK_REGISTER_F(FilamentFixture, boxCulling)->Apply(cullingArguments);
+BENCHMARK_REGISTER_F(FilamentFixture, sphereCulling)->Apply(cullingArguments);
+
+// Culls the boxes against several frustums, as the ShadowMapManager does for point and spot
+// shadow maps. Arguments are: { frustum count, single pass }. The single pass version records
+// all the results in one bitmask per box, otherwise the boxes are culled once per frustum.
+BENCHMARK_DEFINE_F(FilamentFixture, multiFrustumCulling)(benchmark::State& state) {
+    const size_t frustumCount = size_t(state.range(0));
+    const bool singlePass = state.range(1) != 0;
+    const size_t count = 10000;
+
+    std::vector<Frustum> frustums(frustumCount);
+    for (size_t i = 0; i < frustumCount; i++) {
+        float const angle = float(i) * 2.0f * f::PI / float(frustumCount);
+        mat4f const model = mat4f::lookAt(float3{ 0 },
+                float3{ std::cos(angle), 0.0f, std::sin(angle) }, float3{ 0, 1, 0 });
+        frustums[i] = Frustum{ mat4f::perspective(45.0f, 1.0f, 0.1f, 50.0f) * inverse(model) };
+    }
+    std::vector<uint64_t> masks(Culler::round(count));
     {
         PerformanceCounters pc(state);
         for (auto _ : state) {
-            Culler::Test::intersects(visibles, frustum, spheres.data(), BATCH_SIZE);
+            if (singlePass) {
+                Culler::intersects(masks.data(), frustums.data(), frustumCount,
+                        boxesCenter.data(), boxesExtent.data(), count);
+            } else {
+                for (size_t i = 0; i < frustumCount; i++) {
+                    Culler::intersects(visibles, frustums[i],
+                            boxesCenter.data(), boxesExtent.data(), count, 0);
+                }
+            }
         }
         benchmark::ClobberMemory();
         pc.stop();
-        state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+        state.SetItemsProcessed(state.iterations() * count * frustumCount);
     }
 }
+
+// arguments are: { frustum count, single pass }
+static void multiFrustumCullingArguments(benchmark::internal::Benchmark* b) {
+    b->ArgNames({ "frustums", "singlePass" });
+    for (int64_t frustums : { 6, 24, 60 }) {
+        for (int64_t singlePass : { 0, 1 }) {
+            b->Args({ frustums, singlePass });
+        }
+    }
+}
+
+BENCHMARK_REGISTER_F(FilamentFixture, multiFrustumCulling)->Apply(multiFrustumCullingArguments);
+
+// Culls the same boxes as boxCulling, but through a bounding volume hierarchy, as the Scene
+// does for static renderables. The argument is the object count.
+BENCHMARK_DEFINE_F(FilamentFixture, hierarchicalCulling)(benchmark::State& state) {
+    const size_t count = size_t(state.range(0));
+    AabbTree tree;
+    for (size_t i = 0; i < count; i++) {
+        float3 const c = boxesCenter[i];
+        float3 const e = boxesExtent[i];
+        tree.insert({ c - e, c + e }, uint32_t(i));
+    }
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            tree.cull(visibles, frustum, boxesCenter.data(), boxesExtent.data(), 0);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+}
+
+BENCHMARK_REGISTER_F(FilamentFixture, hierarchicalCulling)
+        ->ArgName("count")->Arg(1000)->Arg(10000)->Arg(100000);
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "ResourceAllocator.h"
+
+#include "fg/FrameGraph.h"
+#include "fg/FrameGraphResources.h"
+
+using namespace filament;
+using namespace backend;
+
+namespace {
+
+// compile() doesn't create any concrete resource, so this is never really used
+class NullResourceAllocator : public ResourceAllocatorInterface {
+public:
+    RenderTargetHandle createRenderTarget(const char*, TargetBufferFlags, uint32_t, uint32_t,
+            uint8_t, MRT, TargetBufferInfo, TargetBufferInfo) noexcept override {
+        return {};
+    }
+    void destroyRenderTarget(RenderTargetHandle) noexcept override {}
+    TextureHandle createTexture(const char*, SamplerType, uint8_t, TextureFormat, uint8_t,
+            uint32_t, uint32_t, uint32_t, std::array<TextureSwizzle, 4>,
+            TextureUsage) noexcept override {
+        return {};
+    }
+    void destroyTexture(TextureHandle) noexcept override {}
+};
+
+struct Data {
+    FrameGraphId<FrameGraphTexture> input;
+    FrameGraphId<FrameGraphTexture> depth;
+    FrameGraphId<FrameGraphTexture> output;
+};
+
+auto const nop = [](FrameGraphResources const&, Data const&, DriverApi&) {};
+
+// A pass sampling one or two textures and rendering into a new one
+FrameGraphId<FrameGraphTexture> addPostProcessPass(FrameGraph& fg, const char* name,
+        FrameGraphTexture::Descriptor const& desc,
+        FrameGraphId<FrameGraphTexture> input,
+        FrameGraphId<FrameGraphTexture> depth = {}) {
+    auto& pass = fg.addPass<Data>(name, [&](FrameGraph::Builder& builder, auto& data) {
+        data.input = builder.sample(input);
+        if (depth) {
+            data.depth = builder.sample(depth);
+        }
+        data.output = builder.create<FrameGraphTexture>(name, desc);
+        data.output = builder.declareRenderPass(data.output);
+    }, nop);
+    return pass->output;
+}
+
+// Declares a graph similar to the one of a View with the default post-processing options:
+// shadows, SSAO, the color pass, TAA, a 6 levels bloom and color grading followed by FXAA.
+void declareDefaultGraph(FrameGraph& fg, Handle<HwRenderTarget> viewRenderTarget) {
+    FrameGraphTexture::Descriptor const desc{ .width = 1920, .height = 1080,
+            .format = TextureFormat::RGBA16F };
+
+    auto& shadows = fg.addPass<Data>("Shadow Pass", [&](FrameGraph::Builder& builder, auto& data) {
+        data.output = builder.create<FrameGraphTexture>("Shadowmap", { .width = 1024,
+                .height = 1024, .depth = 4, .type = SamplerType::SAMPLER_2D_ARRAY,
+                .format = TextureFormat::DEPTH16 });
+        for (uint8_t layer = 0; layer < 4; layer++) {
+            auto output = builder.createSubresource(data.output, "Shadowmap Layer",
+                    { .layer = layer });
+            output = builder.write(output, FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
+            builder.declareRenderPass("Shadow Target",
+                    { .attachments = { .depth = output }});
+        }
+    }, nop);
+
+    auto& structure = fg.addPass<Data>("Structure Pass", [&](FrameGraph::Builder& builder, auto& data) {
+        data.depth = builder.create<FrameGraphTexture>("Structure Buffer", { .width = 960,
+                .height = 540, .format = TextureFormat::DEPTH32F });
+        data.depth = builder.write(data.depth, FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
+        builder.declareRenderPass("Structure Target", { .attachments = { .depth = data.depth }});
+    }, nop);
+
+    auto ssao = addPostProcessPass(fg, "SSAO", { .width = 960, .height = 540 },
+            structure->depth);
+    ssao = addPostProcessPass(fg, "SSAO Blur H", { .width = 960, .height = 540 },
+            ssao, structure->depth);
+    ssao = addPostProcessPass(fg, "SSAO Blur V", { .width = 960, .height = 540 },
+            ssao, structure->depth);
+
+    auto& color = fg.addPass<Data>("Color Pass", [&](FrameGraph::Builder& builder, auto& data) {
+        data.input = builder.sample(ssao);
+        builder.sample(shadows->output);
+        data.output = builder.create<FrameGraphTexture>("Color Buffer", desc);
+        data.depth = builder.create<FrameGraphTexture>("Depth Buffer", { .width = 1920,
+                .height = 1080, .format = TextureFormat::DEPTH32F });
+        data.output = builder.write(data.output, FrameGraphTexture::Usage::COLOR_ATTACHMENT);
+        data.depth = builder.write(data.depth, FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
+        builder.declareRenderPass("Color Target", { .attachments = {
+                .color = { data.output }, .depth = data.depth }});
+    }, nop);
+
+    // never used, so always culled
+    addPostProcessPass(fg, "Debug", desc, color->output);
+
+    auto input = addPostProcessPass(fg, "TAA", desc, color->output, color->depth);
+
+    auto& bloom = fg.addPass<Data>("Bloom Downsample", [&](FrameGraph::Builder& builder, auto& data) {
+        data.input = builder.sample(input);
+        data.output = builder.create<FrameGraphTexture>("Bloom", { .width = 960, .height = 540,
+                .levels = 6, .format = TextureFormat::R11F_G11F_B10F });
+        for (uint8_t level = 0; level < 6; level++) {
+            auto output = builder.createSubresource(data.output, "Bloom Level",
+                    { .level = level });
+            builder.declareRenderPass(output);
+        }
+    }, nop);
+
+    auto& bloomUp = fg.addPass<Data>("Bloom Upsample", [&](FrameGraph::Builder& builder, auto& data) {
+        data.output = builder.sample(bloom->output);
+        for (uint8_t level = 0; level < 5; level++) {
+            auto output = builder.createSubresource(data.output, "Bloom Level",
+                    { .level = level });
+            builder.declareRenderPass(output);
+        }
+    }, nop);
+
+    input = addPostProcessPass(fg, "Color Grading", { .width = 1920, .height = 1080 },
+            input, bloomUp->output);
+    input = addPostProcessPass(fg, "FXAA", { .width = 1920, .height = 1080 }, input);
+
+    auto output = fg.import("View Target", { .attachments = TargetBufferFlags::COLOR0,
+            .viewport = { 0, 0, 1920, 1080 }}, viewRenderTarget);
+    auto& blit = fg.addPass<Data>("Blit", [&](FrameGraph::Builder& builder, auto& data) {
+        data.input = builder.sample(input);
+        data.output = builder.declareRenderPass(output);
+    }, nop);
+
+    fg.present(blit->output);
+}
+
+} // anonymous namespace
+
+// Measures the cost of declaring and compiling the FrameGraph of a View with the default
+// post-processing options. When the argument is set, the FrameGraph::Cache is used, so that
+// only the first compile() does all the work.
+static void compileFrameGraph(benchmark::State& state) {
+    bool const useCache = state.range(0) != 0;
+    NullResourceAllocator resourceAllocator;
+    FrameGraph::Cache cache;
+    Handle<HwRenderTarget> const viewRenderTarget{ 1 };
+    for (auto _ : state) {
+        FrameGraph fg(resourceAllocator, useCache ? &cache : nullptr);
+        declareDefaultGraph(fg, viewRenderTarget);
+        fg.compile();
+    }
+}
+
+BENCHMARK(compileFrameGraph)->ArgName("cache")->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <filament/Engine.h>
+#include <filament/LightManager.h>
+#include <filament/Viewport.h>
+
+#include "Allocators.h"
+#include "Froxelizer.h"
+#include "details/Engine.h"
+#include "details/Scene.h"
+
+#include <utils/EntityManager.h>
+
+#include <random>
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+using namespace utils;
+
+// Measures the cost of froxelizing a frame, i.e. Froxelizer::prepare() followed by
+// froxelizeLights(). Arguments are: { viewport height, light count, zoom }.
+// The viewport has a 16:9 aspect ratio; when zoom is set, the field of view changes every
+// frame, which forces the froxels' planes and bounding spheres to be recomputed. Otherwise the
+// camera and lights are static, so this measures the cost of reusing the previous frame.
+static void froxelizeLights(benchmark::State& state) {
+    uint32_t const height = uint32_t(state.range(0));
+    uint32_t const width = height * 16 / 9;
+    size_t const lightCount = size_t(state.range(1));
+    bool const zoom = state.range(2) != 0;
+
+    FEngine* engine = downcast(Engine::create(Engine::Backend::NOOP));
+    LinearAllocatorArena arena("benchmark: per-frame allocator", 3 * 1024 * 1024);
+
+    // half point lights, half spotlights, all in front of the camera
+    std::default_random_engine gen(lightCount);
+    std::uniform_real_distribution<float> xy(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> z(-50.0f, -1.0f);
+    std::uniform_real_distribution<float> radius(2.0f, 8.0f);
+    std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+
+    std::vector<Entity> entities(lightCount);
+    engine->getEntityManager().create(entities.size(), entities.data());
+
+    FScene::LightSoa lights;
+    lights.setCapacity(lightCount + FScene::DIRECTIONAL_LIGHTS_COUNT);
+    lights.push_back({}, {}, {}, {}, {}, {});   // the directional light is always skipped
+    for (size_t i = 0; i < lightCount; i++) {
+        bool const spot = i & 1;
+        float const r = radius(gen);
+        float3 const axis = normalize(float3{ direction(gen), direction(gen), -1.0f });
+        LightManager::Builder(spot ? LightManager::Type::SPOT : LightManager::Type::POINT)
+                .falloff(r)
+                .direction(axis)
+                .spotLightCone(0.3f, 0.5f)
+                .build(*engine, entities[i]);
+        lights.push_back(float4{ xy(gen), xy(gen), z(gen), r }, axis,
+                engine->getLightManager().getInstance(entities[i]), 1, {}, {});
+    }
+
+    Froxelizer froxelizer(*engine);
+    froxelizer.setOptions(5.0f, 100.0f);
+
+    Viewport const viewport(0, 0, width, height);
+    mat4 const projections[2] = {
+            mat4::perspective(60.0, double(width) / height, 0.1, 100.0),
+            mat4::perspective(61.0, double(width) / height, 0.1, 100.0)
+    };
+
+    size_t frame = 0;
+    for (auto _ : state) {
+        filament::ArenaScope scope(arena);
+        mat4f const projection{ projections[zoom ? (frame++ & 1) : 0] };
+        froxelizer.prepare(engine->getDriverApi(), scope, viewport, projection, 0.1f, 100.0f);
+        froxelizer.froxelizeLights(*engine, {}, lights);
+        froxelizer.commit(engine->getDriverApi());
+
+        // the froxel buffers are allocated from, and sent to the GPU through the command stream
+        state.PauseTiming();
+        engine->flush();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * lightCount));
+
+    froxelizer.terminate(engine->getDriverApi());
+    for (Entity const e : entities) {
+        engine->destroy(e);
+    }
+    engine->getEntityManager().destroy(entities.size(), entities.data());
+    Engine::destroy((Engine**)&engine);
+}
+
+// arguments are: { viewport height, light count, zoom }
+static void froxelizeLightsArguments(benchmark::internal::Benchmark* b) {
+    b->ArgNames({ "height", "lights", "zoom" });
+    for (int64_t height : { 1080, 2160 }) {
+        for (int64_t lights : { 64, 256 }) {
+            for (int64_t zoom : { 0, 1 }) {
+                b->Args({ height, lights, zoom });
+            }
+        }
+    }
+}
+
+BENCHMARK(froxelizeLights)->Apply(froxelizeLightsArguments)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "RenderPass.h"
+
+#include <utils/JobSystem.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace filament;
+using namespace utils;
+
+using Command = RenderPass::Command;
+
+// generates color pass commands with random priorities, z-buckets and materials, half of the
+// commands are sentinels, like for a pass with only opaque objects.
+static std::vector<Command> generateCommands(size_t count) {
+    std::default_random_engine gen(count);
+    std::uniform_int_distribution<uint32_t> priority(0, 7);
+    std::uniform_int_distribution<uint32_t> zBucket(0, 1023);
+    std::uniform_int_distribution<uint32_t> material(0, 255);
+    std::vector<Command> commands(count);
+    for (size_t i = 0; i < count; i++) {
+        if (i & 1) {
+            commands[i].key = uint64_t(RenderPass::Pass::SENTINEL);
+            continue;
+        }
+        RenderPass::CommandKey key = uint64_t(RenderPass::Pass::COLOR);
+        key |= RenderPass::makeField(priority(gen),
+                RenderPass::PRIORITY_MASK, RenderPass::PRIORITY_SHIFT);
+        key |= RenderPass::makeField(zBucket(gen),
+                RenderPass::Z_BUCKET_MASK, RenderPass::Z_BUCKET_SHIFT);
+        key |= RenderPass::makeMaterialSortingKey(material(gen), uint32_t(i) & 0xFFF);
+        commands[i].key = key;
+    }
+    return commands;
+}
+
+// Sorts the commands like RenderPass::sortCommands() did before the radix sort
+static void comparisonSort(benchmark::State& state) {
+    std::vector<Command> const commands = generateCommands(size_t(state.range(0)));
+    std::vector<Command> sorted;
+    for (auto _ : state) {
+        state.PauseTiming();
+        sorted = commands;
+        state.ResumeTiming();
+
+        std::sort(sorted.begin(), sorted.end());
+        benchmark::DoNotOptimize(std::partition_point(sorted.begin(), sorted.end(),
+                [](Command const& c) {
+                    return c.key != uint64_t(RenderPass::Pass::SENTINEL);
+                }));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * commands.size()));
+}
+
+static void radixSort(benchmark::State& state) {
+    JobSystem js;
+    js.adopt();
+    std::vector<Command> const commands = generateCommands(size_t(state.range(0)));
+    std::vector<RenderPass::SortKey> scratch(commands.size() * 2);
+    std::vector<Command> sorted;
+    for (auto _ : state) {
+        state.PauseTiming();
+        sorted = commands;
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(RenderPass::radixSortCommands(js,
+                sorted.data(), sorted.data() + sorted.size(), scratch.data()));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * commands.size()));
+    js.emancipate();
+}
+
+BENCHMARK(comparisonSort)->ArgName("count")->Arg(5000)->Arg(20000)->Arg(100000)
+        ->Unit(benchmark::kMicrosecond);
+BENCHMARK(radixSort)->ArgName("count")->Arg(5000)->Arg(20000)->Arg(100000)
+        ->Unit(benchmark::kMicrosecond);
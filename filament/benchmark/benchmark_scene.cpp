@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <filament/Box.h>
+#include <filament/Engine.h>
+#include <filament/RenderableManager.h>
+#include <filament/Scene.h>
+
+#include "details/Engine.h"
+#include "details/Scene.h"
+
+#include <utils/EntityManager.h>
+#include <utils/JobSystem.h>
+
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+using namespace utils;
+
+// Measures the cost of FScene::prepare() for a scene where only a fraction of the renderables
+// move between frames. Arguments are: { renderable count, percentage of moving renderables }
+static void staticScene(benchmark::State& state) {
+    size_t const count = size_t(state.range(0));
+    size_t const dirtyCount = count * size_t(state.range(1)) / 100;
+
+    FEngine* engine = downcast(Engine::create(Engine::Backend::NOOP));
+    FScene* scene = downcast(engine->createScene());
+    FTransformManager& tcm = engine->getTransformManager();
+    JobSystem& js = engine->getJobSystem();
+    LinearAllocatorArena& arena = engine->getPerRenderPassAllocator();
+
+    std::vector<Entity> entities(count);
+    engine->getEntityManager().create(entities.size(), entities.data());
+    for (size_t i = 0; i < count; i++) {
+        RenderableManager::Builder(1)
+                .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+                .build(*engine, entities[i]);
+        tcm.create(entities[i], {}, mat4f::translation(float3{ float(i), 0, 0 }));
+    }
+    Scene* const publicScene = scene;
+    publicScene->addEntities(entities.data(), entities.size());
+
+    // the first prepare() always computes everything
+    scene->prepare(js, arena, mat4{}, false);
+
+    float y = 0.0f;
+    size_t const stride = dirtyCount ? count / dirtyCount : 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        y += 1.0f;
+        tcm.openLocalTransformTransaction();
+        for (size_t i = 0; i < dirtyCount; i++) {
+            tcm.setTransform(tcm.getInstance(entities[i * stride]),
+                    mat4f::translation(float3{ float(i * stride), y, 0 }));
+        }
+        tcm.commitLocalTransformTransaction();
+        state.ResumeTiming();
+
+        scene->prepare(js, arena, mat4{}, false);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * count));
+
+    for (Entity const e : entities) {
+        engine->destroy(e);
+    }
+    engine->getEntityManager().destroy(entities.size(), entities.data());
+    engine->destroy(scene);
+    Engine::destroy((Engine**)&engine);
+}
+
+// arguments are: { renderable count, dirty percentage }
+static void staticSceneArguments(benchmark::internal::Benchmark* b) {
+    b->ArgNames({ "count", "dirty%" });
+    for (int64_t count : { 10000, 100000 }) {
+        for (int64_t dirty : { 0, 1, 100 }) {
+            b->Args({ count, dirty });
+        }
+    }
+}
+
+BENCHMARK(staticScene)->Apply(staticSceneArguments)->Unit(benchmark::kMicrosecond);
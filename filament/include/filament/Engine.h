@@ -267,6 +267,74 @@ public:
          * This value does not affect the application's memory usage.
          */
         uint32_t perFrameCommandsSizeMB = FILAMENT_PER_FRAME_COMMANDS_SIZE_IN_MB;
+
+        /**
+         * Size in MiB of the cache of textures used internally for rendering (e.g. render
+         * targets), which are kept across frames so they don't need to be recreated.
+         *
+         * When the cache exceeds this size, its least recently used textures are destroyed.
+         * 0 disables the cache, textures are destroyed as soon as they're not used anymore.
+         *
+         * This value affects the application's memory usage.
+         */
+        uint32_t resourceAllocatorCacheSizeMB = 64;
+
+        /**
+         * Number of frames an unused texture is kept in the cache of textures used internally
+         * for rendering, before it's destroyed.
+         *
+         * This value affects the application's memory usage.
+         */
+        uint32_t resourceAllocatorCacheMaxAge = 30;
+
+        /**
+         * When not 0, the width and height of textures used internally only as render targets
+         * (i.e. never sampled) and not multisampled are rounded up to a multiple of this value,
+         * in pixels. This allows these textures to be reused when the size of a View changes
+         * slightly (e.g. during a window resize), at the cost of larger allocations.
+         *
+         * This value affects the application's memory usage.
+         */
+        uint32_t resourceAllocatorDimensionBucket = 0;
+
+        /**
+         * When the backend compiles shaders asynchronously (e.g. OpenGL with
+         * KHR_parallel_shader_compile), draw calls using a material variant that isn't compiled
+         * yet are skipped instead of waiting for the compilation to finish.
+         *
+         * This avoids stalls when a material variant is first used, at the cost of renderables
+         * missing from the frames rendered before it's ready. Material::compile() can be used
+         * to compile variants ahead of time.
+         */
+        bool skipDrawsWithPendingPrograms = false;
+
+        /**
+         * Maximum number of material variants compiled ahead of time per frame, based on the
+         * variants used during previous sessions. 0 disables this feature.
+         *
+         * When enabled, the variants of each Material are recorded in the order of their first
+         * use, and this profile is saved with the Platform's blob cache functions
+         * (see Platform::setBlobFunc) when the Material is destroyed. The next time the same
+         * Material is created, its profiled variants are compiled in that order, at most this
+         * many per frame across all materials, which avoids hitches when a variant (e.g.
+         * shadows, fog or skinning) is first needed. Variants compiled by Material::compile()
+         * are not recorded, and invalid profiles are ignored.
+         *
+         * This has no effect if the Platform doesn't have blob cache functions.
+         */
+        uint32_t variantPrecompilationBudget = 0;
+    };
+
+    /**
+     * Statistics of the cache of textures used internally for rendering.
+     * @see Config::resourceAllocatorCacheSizeMB
+     */
+    struct ResourceAllocatorStatistics {
+        uint64_t hitCount;          //!< number of textures found in the cache
+        uint64_t missCount;         //!< number of textures that had to be created
+        uint64_t evictionCount;     //!< number of textures destroyed by the cache
+        size_t cacheSize;           //!< estimated memory used by the cache in bytes
+        size_t cacheEntryCount;     //!< number of textures in the cache
     };
 
 
@@ -534,6 +602,11 @@ public:
      * that the scene doesn't contain any identical primitives, automatic instancing can have some
      * overhead and it is then best to disable it.
      *
+     * When enabled, opaque primitives that can be instanced (i.e. that don't already use
+     * instancing and are not skinned or morphed) are sorted by geometry rather than
+     * front-to-back, so that identical primitives can be batched regardless of their depth.
+     * This can increase overdraw.
+     *
      * Disabled by default.
      *
      * @param enable true to enable, false to disable automatic instancing.
@@ -759,6 +832,72 @@ public:
       */
     utils::JobSystem& getJobSystem() noexcept;
 
+    /**
+     * Starts capturing the commands sent to the backend into a file, along with the content of
+     * the buffers they reference. The capture can be replayed with the `replay` tool, for
+     * instance to measure the cost of the backend alone or to reproduce a performance problem.
+     *
+     * A capture should start between two frames, commands referencing objects created before
+     * the capture started can't be replayed faithfully by a real backend.
+     * Capturing is expensive, it should not be left enabled in production.
+     *
+     * @param path Path of the capture file to create.
+     * @return true if the capture started, false if the file couldn't be created.
+     *
+     * @see stopCommandCapture()
+     */
+    bool startCommandCapture(const char* path) noexcept;
+
+    /**
+     * Stops capturing commands and closes the capture file.
+     *
+     * @see startCommandCapture()
+     */
+    void stopCommandCapture() noexcept;
+
+    /**
+     * Starts recording a CPU timeline of the engine's threads: its main thread, its job system
+     * threads and its backend thread. Events previously recorded are discarded.
+     *
+     * Events are kept in fixed-size per-thread ring buffers, so only the most recent events
+     * are available once the buffers are full.
+     *
+     * This is only supported on platforms that don't have a system tracer, i.e. not on Android
+     * where Systrace/Perfetto should be used instead.
+     *
+     * @see stopTracing()
+     * @see writeTrace()
+     */
+    void startTracing() noexcept;
+
+    /**
+     * Stops recording the CPU timeline, recorded events are kept until they're written.
+     *
+     * @see startTracing()
+     */
+    void stopTracing() noexcept;
+
+    /**
+     * Writes the recorded CPU timeline as a Chrome trace JSON file, which can be opened
+     * with chrome://tracing or https://ui.perfetto.dev. This can be called while recording.
+     * Once recording is stopped, writing the trace releases the recorded events and the memory
+     * used to record them.
+     *
+     * @param path Path of the JSON file to create.
+     * @return false if tracing is not supported or if the file couldn't be written.
+     *
+     * @see startTracing()
+     */
+    bool writeTrace(const char* path) noexcept;
+
+    /**
+     * Returns statistics of the cache of textures used internally for rendering, which can
+     * be used to choose the Config::resourceAllocatorCacheSizeMB of a given device.
+     *
+     * @return the ResourceAllocatorStatistics since the Engine was created.
+     */
+    ResourceAllocatorStatistics getResourceAllocatorStatistics() const noexcept;
+
 #if defined(__EMSCRIPTEN__)
     /**
       * WebGL only: Tells the driver to reset any internal state tracking if necessary.
@@ -107,6 +107,31 @@ public:
          */
         Builder& package(const void* payload, size_t size);
 
+        /**
+         * Called when the material data given to package() is no longer used, i.e. when the
+         * Material is destroyed.
+         */
+        using PackageReleaseCallback = void(*)(const void* payload, size_t size, void* user);
+
+        /**
+         * Specifies the material data, without copying it. The Material references this memory
+         * until it's destroyed, so that e.g. a memory-mapped file is only paged in on demand.
+         *
+         * Note that the shader dictionary of the material's backend is still copied when the
+         * Material is built: both the text dictionaries and the compressed SPIR-V blobs.
+         *
+         * @param payload Pointer to the material data, must be 8-bytes aligned and must stay
+         *                valid and unchanged until "callback" is called, or until the Material
+         *                is destroyed if "callback" is nullptr.
+         * @param size Size of the material data pointed to by "payload" in bytes.
+         * @param callback Called when the Material is destroyed, can be nullptr. It's not
+         *                 called if build() fails, in which case the caller keeps ownership of
+         *                 the material data.
+         * @param user User data passed to "callback".
+         */
+        Builder& package(const void* payload, size_t size,
+                PackageReleaseCallback callback, void* user = nullptr);
+
         template<typename T>
         using is_supported_constant_parameter_t = typename std::enable_if<
                 std::is_same<int32_t, T>::value ||
@@ -541,6 +541,78 @@ struct SoftShadowOptions {
     float penumbraRatioScale = 1.0f;
 };
 
+/**
+ * View-level options for caching shadow maps across frames, which is useful when most lights
+ * and shadow casters are static.
+ * @see setShadowCacheOptions()
+ * @warning This API is still experimental and subject to change.
+ */
+struct ShadowCacheOptions {
+    /**
+     * Whether shadow maps are cached. When enabled, shadow maps are kept in a texture that
+     * persists across frames, and a shadow map is only rendered again when its light's frustum
+     * changes, or when a shadow caster inside it is added, removed, moved or modified.
+     * Skinned, morphed and instanced renderables are always considered modified.
+     * Updating the content of a VertexBuffer, IndexBuffer or BufferObject modifies the
+     * renderables that use it.
+     * Changes to material parameters are not detected, disabling the cache discards its content.
+     */
+    bool enabled = false;
+
+    /**
+     * When greater than 0, and the cache is enabled, the cascades of the directional light
+     * other than the first one are refreshed on an amortized schedule: at most one of them is
+     * rendered again every distantCascadeUpdateInterval frames, in a round-robin fashion.
+     * In the meantime, they keep the shadow map they were last rendered with. This trades
+     * accuracy of the distant shadows for performance when the camera moves.
+     */
+    uint8_t distantCascadeUpdateInterval = 0;
+};
+
+/**
+ * View-level options to scale the resolution of screen-space effects (ambient occlusion,
+ * screen-space reflections, depth of field and bloom) independently of the View's resolution.
+ * @see setPostProcessResolutionOptions()
+ * @warning This API is still experimental and subject to change.
+ */
+struct PostProcessResolutionOptions {
+    /**
+     * Resolution of the screen-space effects, in each dimension, relative to the View's
+     * resolution after dynamic resolution scaling.
+     */
+    enum class Resolution : uint8_t {
+        FULL,       //!< effects keep the resolution set by their own options
+        HALF,       //!< effects run at most at half resolution
+        QUARTER     //!< effects run at most at quarter resolution
+    };
+
+    /**
+     * Enables or disables the scaling of screen-space effects.
+     */
+    bool enabled = false;
+
+    /**
+     * The maximum resolution of screen-space effects. The effects' own options still apply
+     * when they request a lower resolution (e.g. AmbientOcclusionOptions::resolution).
+     * Ambient occlusion is upsampled with a depth-aware filter when
+     * AmbientOcclusionOptions::upsampling is QualityLevel::HIGH or higher, reflections are
+     * upsampled when their mip chain is generated, and bloom levels are dropped in proportion.
+     */
+    Resolution resolution = Resolution::FULL;
+
+    /**
+     * When set and dynamic resolution is enabled, the dynamic resolution controller lowers the
+     * resolution of screen-space effects, down to minResolution, before it lowers the View's
+     * resolution, and raises it back only once the View is at its maximum scale.
+     */
+    bool dynamic = false;
+
+    /**
+     * The lowest resolution the dynamic resolution controller can select, see dynamic.
+     */
+    Resolution minResolution = Resolution::QUARTER;
+};
+
 } // namespace filament
 
 #endif //TNT_FILAMENT_OPTIONS_H
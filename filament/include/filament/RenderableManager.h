@@ -311,6 +311,20 @@ public:
          */
         Builder& fog(bool enabled = true) noexcept;
 
+        /**
+         * Hints that this renderable doesn't move, false by default.
+         *
+         * When hierarchical culling is enabled on a Scene, static renderables are culled through
+         * a bounding volume hierarchy, which is much cheaper than culling each renderable
+         * individually when most of them don't move. Static renderables can still be moved,
+         * but doing so is more expensive.
+         *
+         * @param enable Whether this renderable is static.
+         * @return A reference to this Builder for chaining calls.
+         * @see Scene::setHierarchicalCullingEnabled()
+         */
+        Builder& staticGeometry(bool enable = true) noexcept;
+
         /**
          * Enables GPU vertex skinning for up to 255 bones, 0 by default.
          *
@@ -557,6 +571,19 @@ public:
      */
     bool getFogEnabled(Instance instance) const noexcept;
 
+    /**
+     * Changes whether this renderable is considered static.
+     * @see Builder::staticGeometry()
+     */
+    void setStaticGeometry(Instance instance, bool enable) noexcept;
+
+    /**
+     * Returns whether this renderable is considered static.
+     * @return True if this renderable is static.
+     * @see Builder::staticGeometry()
+     */
+    bool isStaticGeometry(Instance instance) const noexcept;
+
     /**
      * Enables or disables a light channel.
      * Light channel 0 is enabled by default.
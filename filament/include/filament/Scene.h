@@ -168,6 +168,30 @@ public:
      * @param functor User provided functor called for each entity in the scene
      */
     void forEach(utils::Invocable<void(utils::Entity entity)>&& functor) const noexcept;
+
+    /**
+     * Enables or disables hierarchical culling of static renderables, disabled by default.
+     *
+     * When enabled, the Scene maintains a bounding volume hierarchy over the renderables
+     * flagged as static (see RenderableManager::Builder::staticGeometry()). The hierarchy is
+     * updated incrementally as renderables are added, removed or moved, and lets the camera
+     * and the directional shadow map reject or accept whole groups of static renderables at
+     * once, instead of testing each one of them every frame.
+     *
+     * This is beneficial for scenes made mostly of static objects; dynamic renderables are
+     * always culled individually.
+     *
+     * @param enabled true to enable hierarchical culling, false to disable it.
+     */
+    void setHierarchicalCullingEnabled(bool enabled) noexcept;
+
+    /**
+     * Returns whether hierarchical culling of static renderables is enabled.
+     *
+     * @return true if hierarchical culling is enabled, false otherwise.
+     * @see setHierarchicalCullingEnabled()
+     */
+    bool isHierarchicalCullingEnabled() const noexcept;
 };
 
 } // namespace filament
@@ -142,6 +142,32 @@ public:
      */
     bool isAccurateTranslationsEnabled() const noexcept;
 
+    /**
+     * Enables or disables the level-ordered mode. Disabled by default.
+     *
+     * When the level-ordered mode is active, commitLocalTransformTransaction() keeps the
+     * transform components sorted breadth-first, i.e.: by depth in the hierarchy, and computes
+     * the world transforms of each depth level in parallel using the engine's job system.
+     *
+     * This is useful for large and wide hierarchies (e.g. many skinned characters), where
+     * independent subtrees can be transformed concurrently.
+     * Sorting happens lazily during commitLocalTransformTransaction() after the structure of the
+     * hierarchy has changed, so Instances obtained before a commit can become invalid.
+     *
+     * @param enable true to enable the level-ordered mode, false to disable.
+     *
+     * @see isLevelOrderEnabled
+     * @see commitLocalTransformTransaction
+     */
+    void setLevelOrderEnabled(bool enable) noexcept;
+
+    /**
+     * Returns whether the level-ordered mode is active.
+     * @return true if the level-ordered mode is active, false otherwise
+     * @see setLevelOrderEnabled
+     */
+    bool isLevelOrderEnabled() const noexcept;
+
     /**
      * Creates a transform component and associate it with the given entity.
      * @param entity            An Entity to associate a transform component to.
@@ -299,6 +325,9 @@ public:
      * Commits the currently open local transform transaction. When this returns, calls
      * to getWorldTransform() will return the proper value.
      *
+     * Only the world transforms of the subtrees whose local transform or parent changed
+     * during the transaction are recomputed.
+     *
      * @attention failing to call this method when done updating the local transform will cause
      *            a lot of rendering problems. The system never closes the transaction
      *            automatically.
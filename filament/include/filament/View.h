@@ -83,6 +83,8 @@ public:
     using MultiSampleAntiAliasingOptions = MultiSampleAntiAliasingOptions;
     using VsmShadowOptions = VsmShadowOptions;
     using SoftShadowOptions = SoftShadowOptions;
+    using ShadowCacheOptions = ShadowCacheOptions;
+    using PostProcessResolutionOptions = PostProcessResolutionOptions;
     using ScreenSpaceReflectionsOptions = ScreenSpaceReflectionsOptions;
     using GuardBandOptions = GuardBandOptions;
 
@@ -507,6 +509,27 @@ public:
      */
     DynamicResolutionOptions getDynamicResolutionOptions() const noexcept;
 
+    /**
+     * Sets the resolution options of the screen-space effects of this View (ambient occlusion,
+     * screen-space reflections, depth of field and bloom). When
+     * PostProcessResolutionOptions::dynamic is set, the dynamic resolution controller can lower
+     * the resolution of these effects before lowering the View's.
+     *
+     * @param options Options for the resolution of screen-space effects.
+     *
+     * @see PostProcessResolutionOptions, setDynamicResolutionOptions
+     *
+     * @warning This API is still experimental and subject to change.
+     */
+    void setPostProcessResolutionOptions(PostProcessResolutionOptions const& options) noexcept;
+
+    /**
+     * Returns the screen-space effects resolution options associated with this View.
+     *
+     * @return value set by setPostProcessResolutionOptions().
+     */
+    PostProcessResolutionOptions getPostProcessResolutionOptions() const noexcept;
+
     /**
      * Sets the rendering quality for this view. Refer to RenderQuality for more
      * information about the different settings available.
@@ -602,6 +625,24 @@ public:
      */
     SoftShadowOptions getSoftShadowOptions() const noexcept;
 
+    /**
+     * Sets the shadow map caching options of this View.
+     *
+     * @param options Options for shadow map caching.
+     *
+     * @see ShadowCacheOptions
+     *
+     * @warning This API is still experimental and subject to change.
+     */
+    void setShadowCacheOptions(ShadowCacheOptions const& options) noexcept;
+
+    /**
+     * Returns the shadow map caching options associated with this View.
+     *
+     * @return value set by setShadowCacheOptions().
+     */
+    ShadowCacheOptions getShadowCacheOptions() const noexcept;
+
     /**
      * Enables or disables post processing. Enabled by default.
      *
@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AabbTree.h"
+
+#include <utils/debug.h>
+
+#include <math/fast.h>
+
+#include <algorithm>
+
+using namespace filament::math;
+
+namespace filament {
+
+static inline Aabb merge(Aabb const& a, Aabb const& b) noexcept {
+    return { min(a.min, b.min), max(a.max, b.max) };
+}
+
+// half of the surface area of the box, that's all we need for the SAH
+// This must be evaluated exactly like Culler's scalar kernel, in particular the compiler is not
+// allowed to contract the plane equations into FMAs (which it would do by default on e.g. arm64).
+static bool leafIntersects(float4 const* UTILS_RESTRICT planes,
+        float3 const& center, float3 const& extent) noexcept {
+#if defined(__clang__)
+    #pragma clang fp contract(off)
+#endif
+    int visible = ~0;
+    for (size_t j = 0; j < 6; j++) {
+        const float dot =
+                planes[j].x * center.x - std::abs(planes[j].x) * extent.x +
+                planes[j].y * center.y - std::abs(planes[j].y) * extent.y +
+                planes[j].z * center.z - std::abs(planes[j].z) * extent.z +
+                planes[j].w;
+        visible &= fast::signbit(dot);
+    }
+    return visible & 1;
+}
+
+static inline float halfArea(Aabb const& box) noexcept {
+    float3 const d = box.max - box.min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+AabbTree::AabbTree() noexcept = default;
+
+AabbTree::~AabbTree() noexcept = default;
+
+AabbTree::Id AabbTree::allocateNode() noexcept {
+    Id node;
+    if (mFreeList != NONE) {
+        node = mFreeList;
+        mFreeList = mNodes[node].parent;
+    } else {
+        node = Id(mNodes.size());
+        mNodes.emplace_back();
+    }
+    Node& n = mNodes[node];
+    n.parent = NONE;
+    n.left = NONE;
+    n.right = NONE;
+    n.row = 0;
+    n.height = 0;
+    return node;
+}
+
+void AabbTree::freeNode(Id node) noexcept {
+    Node& n = mNodes[node];
+    n.parent = mFreeList;
+    n.height = -1;
+    mFreeList = node;
+}
+
+AabbTree::Id AabbTree::insert(Aabb const& box, uint32_t row) noexcept {
+    Id const leaf = allocateNode();
+    mNodes[leaf].box = box;
+    mNodes[leaf].row = row;
+    insertLeaf(leaf);
+    mLeafCount++;
+    return leaf;
+}
+
+void AabbTree::remove(Id leaf) noexcept {
+    assert_invariant(leaf < mNodes.size() && mNodes[leaf].isLeaf() && mNodes[leaf].height == 0);
+    removeLeaf(leaf);
+    freeNode(leaf);
+    mLeafCount--;
+}
+
+void AabbTree::update(Id leaf, Aabb const& box) noexcept {
+    assert_invariant(leaf < mNodes.size() && mNodes[leaf].isLeaf() && mNodes[leaf].height == 0);
+    Node& n = mNodes[leaf];
+    if (n.box.min == box.min && n.box.max == box.max) {
+        return;
+    }
+    removeLeaf(leaf);
+    mNodes[leaf].box = box;
+    insertLeaf(leaf);
+}
+
+void AabbTree::clear() noexcept {
+    mNodes.clear();
+    mRoot = NONE;
+    mFreeList = NONE;
+    mLeafCount = 0;
+}
+
+int32_t AabbTree::getHeight() const noexcept {
+    return mRoot == NONE ? -1 : mNodes[mRoot].height;
+}
+
+void AabbTree::replaceChild(Id parent, Id oldChild, Id newChild) noexcept {
+    if (parent == NONE) {
+        mRoot = newChild;
+    } else if (mNodes[parent].left == oldChild) {
+        mNodes[parent].left = newChild;
+    } else {
+        assert_invariant(mNodes[parent].right == oldChild);
+        mNodes[parent].right = newChild;
+    }
+}
+
+void AabbTree::refit(Id node) noexcept {
+    // walk back up the tree, fixing heights and bounds
+    while (node != NONE) {
+        node = balance(node);
+        Node& n = mNodes[node];
+        Node const& l = mNodes[n.left];
+        Node const& r = mNodes[n.right];
+        n.height = 1 + std::max(l.height, r.height);
+        n.box = merge(l.box, r.box);
+        node = n.parent;
+    }
+}
+
+void AabbTree::insertLeaf(Id leaf) noexcept {
+    if (mRoot == NONE) {
+        mRoot = leaf;
+        mNodes[leaf].parent = NONE;
+        return;
+    }
+
+    // find the best sibling for this leaf, using the surface area heuristic
+    Aabb const box = mNodes[leaf].box;
+    Id index = mRoot;
+    while (!mNodes[index].isLeaf()) {
+        Node const& n = mNodes[index];
+        float const area = halfArea(n.box);
+        float const combinedArea = halfArea(merge(n.box, box));
+
+        // cost of creating a new parent for this node and the new leaf
+        float const cost = 2.0f * combinedArea;
+
+        // minimum cost of pushing the leaf further down the tree
+        float const inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](Id child) {
+            Node const& c = mNodes[child];
+            float const newArea = halfArea(merge(box, c.box));
+            return c.isLeaf() ?
+                   newArea + inheritanceCost :
+                   newArea - halfArea(c.box) + inheritanceCost;
+        };
+
+        float const costLeft = descendCost(n.left);
+        float const costRight = descendCost(n.right);
+
+        if (cost < costLeft && cost < costRight) {
+            break;
+        }
+        index = costLeft < costRight ? n.left : n.right;
+    }
+
+    // create a new parent for the sibling and the new leaf
+    Id const sibling = index;
+    Id const oldParent = mNodes[sibling].parent;
+    Id const newParent = allocateNode();    // this can invalidate references
+    Node& p = mNodes[newParent];
+    p.parent = oldParent;
+    p.box = merge(box, mNodes[sibling].box);
+    p.height = mNodes[sibling].height + 1;
+    p.left = sibling;
+    p.right = leaf;
+    replaceChild(oldParent, sibling, newParent);
+    mNodes[sibling].parent = newParent;
+    mNodes[leaf].parent = newParent;
+
+    refit(newParent);
+}
+
+void AabbTree::removeLeaf(Id leaf) noexcept {
+    if (leaf == mRoot) {
+        mRoot = NONE;
+        return;
+    }
+
+    Id const parent = mNodes[leaf].parent;
+    Id const grandParent = mNodes[parent].parent;
+    Id const sibling = mNodes[parent].left == leaf ? mNodes[parent].right : mNodes[parent].left;
+
+    // the sibling takes the place of the parent
+    replaceChild(grandParent, parent, sibling);
+    mNodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    refit(grandParent);
+}
+
+/*
+ * Performs a left or right rotation if node A is imbalanced. Returns the new root of the subtree.
+ */
+AabbTree::Id AabbTree::balance(Id iA) noexcept {
+    Node& A = mNodes[iA];
+    if (A.isLeaf() || A.height < 2) {
+        return iA;
+    }
+
+    Id const iB = A.left;
+    Id const iC = A.right;
+    Node& B = mNodes[iB];
+    Node& C = mNodes[iC];
+
+    int32_t const imbalance = C.height - B.height;
+
+    if (imbalance > 1) {
+        // rotate C up
+        Id const iF = C.left;
+        Id const iG = C.right;
+        Node& F = mNodes[iF];
+        Node& G = mNodes[iG];
+
+        // swap A and C
+        C.left = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+        replaceChild(C.parent, iA, iC);
+
+        if (F.height > G.height) {
+            C.right = iF;
+            A.right = iG;
+            G.parent = iA;
+            A.box = merge(B.box, G.box);
+            C.box = merge(A.box, F.box);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        } else {
+            C.right = iG;
+            A.right = iF;
+            F.parent = iA;
+            A.box = merge(B.box, F.box);
+            C.box = merge(A.box, G.box);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    if (imbalance < -1) {
+        // rotate B up
+        Id const iD = B.left;
+        Id const iE = B.right;
+        Node& D = mNodes[iD];
+        Node& E = mNodes[iE];
+
+        // swap A and B
+        B.left = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+        replaceChild(B.parent, iA, iB);
+
+        if (D.height > E.height) {
+            B.right = iD;
+            A.left = iE;
+            E.parent = iA;
+            A.box = merge(C.box, E.box);
+            B.box = merge(A.box, D.box);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        } else {
+            B.right = iE;
+            A.left = iD;
+            D.parent = iA;
+            A.box = merge(C.box, D.box);
+            B.box = merge(A.box, E.box);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+void AabbTree::markSubtree(Culler::result_type* UTILS_RESTRICT visibleMask, Id node,
+        Culler::result_type clear, Culler::result_type set) const noexcept {
+    Id stack[MAX_DEPTH];
+    size_t count = 0;
+    stack[count++] = node;
+    while (count) {
+        Node const& n = mNodes[stack[--count]];
+        if (n.isLeaf()) {
+            visibleMask[n.row] = (visibleMask[n.row] & clear) | set;
+        } else {
+            assert_invariant(count + 2 <= MAX_DEPTH);
+            stack[count++] = n.right;
+            stack[count++] = n.left;
+        }
+    }
+}
+
+void AabbTree::cull(Culler::result_type* UTILS_RESTRICT visibleMask,
+        Frustum const& frustum,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t bit) const noexcept {
+    if (mRoot == NONE) {
+        return;
+    }
+
+    using Type = Culler::result_type;
+    Type const clear = ~Type(1u << bit);
+    Type const set = Type(1u << bit);
+    float4 const* const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
+
+    // each entry holds a node and the set of planes its parent intersects, planes the parent
+    // is entirely inside of don't need to be tested again.
+    struct Entry {
+        Id node;
+        uint32_t planeMask;
+    };
+    Entry stack[MAX_DEPTH];
+    size_t count = 0;
+    stack[count++] = { mRoot, 0x3F };
+
+    while (count) {
+        Entry const entry = stack[--count];
+        Node const& n = mNodes[entry.node];
+
+        if (n.isLeaf()) {
+            uint32_t const i = n.row;
+            bool const visible = leafIntersects(planes, center[i], extent[i]);
+            visibleMask[i] = (visibleMask[i] & clear) | Type(Type(visible) << bit);
+            continue;
+        }
+
+        float3 const c = n.box.center();
+        float3 const e = n.box.extent();
+        uint32_t planeMask = entry.planeMask;
+        bool outside = false;
+        for (size_t j = 0; j < 6; j++) {
+            if (planeMask & (1u << j)) {
+                float3 const p = planes[j].xyz;
+                float const pc = dot(p, c);
+                float const d = pc + planes[j].w;
+                float const r = dot(abs(p), e);
+                // This isn't evaluated like the leaf test below, and the node's box is rounded
+                // differently from its leaves' boxes, so leaves within rounding error of the
+                // plane must be tested individually.
+                float const margin = (std::abs(pc) + std::abs(planes[j].w) + r) * MARGIN;
+                if (d - r >= margin) {
+                    // the whole node is outside this plane
+                    outside = true;
+                    break;
+                }
+                if (d + r < -margin) {
+                    // the whole node is inside this plane
+                    planeMask &= ~(1u << j);
+                }
+            }
+        }
+
+        if (outside) {
+            markSubtree(visibleMask, entry.node, clear, 0);
+        } else if (!planeMask) {
+            markSubtree(visibleMask, entry.node, clear, set);
+        } else {
+            assert_invariant(count + 2 <= MAX_DEPTH);
+            stack[count++] = { n.right, planeMask };
+            stack[count++] = { n.left, planeMask };
+        }
+    }
+}
+
+} // namespace filament
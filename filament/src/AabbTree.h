@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_AABBTREE_H
+#define TNT_FILAMENT_AABBTREE_H
+
+#include "Culler.h"
+
+#include <filament/Box.h>
+#include <filament/Frustum.h>
+
+#include <utils/compiler.h>
+
+#include <math/vec3.h>
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * A bounding volume hierarchy of axis aligned boxes, used to cull large numbers of static
+ * renderables hierarchically.
+ *
+ * The tree is updated incrementally: leaves can be inserted, removed or moved individually, and
+ * the tree is kept balanced using tree rotations (see "Box2D" b2DynamicTree). Insertion uses the
+ * surface area heuristic to pick the sibling of the new leaf.
+ *
+ * Each leaf stores a "row", which is the index of the object it represents in the caller's
+ * arrays; cull() writes its results at that index.
+ */
+class UTILS_PUBLIC AabbTree {
+public:
+    using Id = uint32_t;
+    static constexpr Id NONE = Id(-1);
+
+    AabbTree() noexcept;
+    ~AabbTree() noexcept;
+
+    AabbTree(AabbTree const& rhs) = delete;
+    AabbTree& operator=(AabbTree const& rhs) = delete;
+
+    // inserts a leaf and returns its id. Ids are stable until the leaf is removed.
+    Id insert(Aabb const& box, uint32_t row) noexcept;
+
+    // removes a leaf
+    void remove(Id leaf) noexcept;
+
+    // changes the bounds of a leaf, this is a no-op if the box didn't change
+    void update(Id leaf, Aabb const& box) noexcept;
+
+    void setRow(Id leaf, uint32_t row) noexcept { mNodes[leaf].row = row; }
+    uint32_t getRow(Id leaf) const noexcept { return mNodes[leaf].row; }
+    Aabb const& getAabb(Id leaf) const noexcept { return mNodes[leaf].box; }
+
+    // removes all leaves
+    void clear() noexcept;
+
+    // number of leaves in the tree
+    size_t size() const noexcept { return mLeafCount; }
+
+    bool empty() const noexcept { return mLeafCount == 0; }
+
+    // height of the tree, a leaf has a height of 0, an empty tree has a height of -1
+    int32_t getHeight() const noexcept;
+
+    /*
+     * Culls all leaves against the frustum and updates the given bit of visibleMask[row] for
+     * each leaf, exactly like Culler::intersects() would.
+     * Whole subtrees entirely inside or outside the frustum are accepted or rejected without
+     * testing their leaves. This uses a small margin, so that leaves close to a plane are always
+     * tested individually against (center, extent)[row], with the same expression as the flat
+     * Culler.
+     */
+    void cull(Culler::result_type* visibleMask,
+            Frustum const& frustum,
+            math::float3 const* center,
+            math::float3 const* extent,
+            size_t bit) const noexcept;
+
+private:
+    struct Node {
+        Aabb box;
+        Id parent;          // parent node, or next free node if this node is free
+        Id left;            // NONE for leaves
+        Id right;           // NONE for leaves
+        uint32_t row;       // leaves only
+        int32_t height;     // 0 for leaves, -1 for free nodes
+
+        bool isLeaf() const noexcept { return left == NONE; }
+    };
+
+    // The maximum depth we support, this is plenty since the tree is balanced.
+    static constexpr size_t MAX_DEPTH = 64;
+
+    // Relative margin used to accept or reject whole subtrees, this is much larger than the
+    // rounding error of the plane equations.
+    static constexpr float MARGIN = 1e-5f;
+
+    Id allocateNode() noexcept;
+    void freeNode(Id node) noexcept;
+    void insertLeaf(Id leaf) noexcept;
+    void removeLeaf(Id leaf) noexcept;
+    void refit(Id node) noexcept;
+    Id balance(Id a) noexcept;
+    void replaceChild(Id parent, Id oldChild, Id newChild) noexcept;
+    void markSubtree(Culler::result_type* visibleMask, Id node,
+            Culler::result_type clear, Culler::result_type set) const noexcept;
+
+    std::vector<Node> mNodes;
+    Id mRoot = NONE;
+    Id mFreeList = NONE;
+    size_t mLeafCount = 0;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_AABBTREE_H
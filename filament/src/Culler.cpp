@@ -18,8 +18,28 @@
 
 #include <filament/Box.h>
 
+#include <utils/debug.h>
+
 #include <math/fast.h>
 
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__))
+#   define FILAMENT_CULLER_X86_KERNELS 1
+#   include <immintrin.h>
+#   define CULLER_TARGET_SSE4 __attribute__((target("sse4.1")))
+#   define CULLER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#   define FILAMENT_CULLER_X86_KERNELS 0
+#endif
+
+#if defined(__ARM_NEON)
+#   define FILAMENT_CULLER_NEON_KERNELS 1
+#   include <arm_neon.h>
+#else
+#   define FILAMENT_CULLER_NEON_KERNELS 0
+#endif
+
 using namespace filament::math;
 
 // use 8 if Culler::result_type is 8-bits, on ARMv8 it allows the compiler to write eight
@@ -31,15 +51,29 @@ namespace filament {
 static_assert(Culler::MODULO % FILAMENT_CULLER_VECTORIZE_HINT == 0,
         "MODULO m=must be a multiple of FILAMENT_CULLER_VECTORIZE_HINT");
 
-void Culler::intersects(
+static_assert(sizeof(Culler::result_type) == 2,
+        "the SIMD kernels below assume 16-bits results");
+
+static_assert(sizeof(float3) == 12 && sizeof(float4) == 16,
+        "the SIMD kernels below assume tightly packed vectors");
+
+using result_type = Culler::result_type;
+
+// ------------------------------------------------------------------------------------------------
+// Scalar kernels -- these are the reference implementation
+//
+// The compiler is not allowed to contract the plane equations into FMAs here (which it would
+// do by default on e.g. arm64), so that they're evaluated like in the SIMD kernels below.
+// ------------------------------------------------------------------------------------------------
+
+static void intersectsScalar(
         result_type* UTILS_RESTRICT results,
-        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT planes,
         float4 const* UTILS_RESTRICT b,
         size_t count) noexcept {
-
-    float4 const * const UTILS_RESTRICT planes = frustum.mPlanes;
-
-    count = round(count);
+#if defined(__clang__)
+    #pragma clang fp contract(off)
+#endif
     #pragma clang loop vectorize_width(FILAMENT_CULLER_VECTORIZE_HINT)
     for (size_t i = 0; i < count; i++) {
         int visible = ~0;
@@ -59,16 +93,15 @@ void Culler::intersects(
     }
 }
 
-void Culler::intersects(
+static void intersectsScalar(
         result_type* UTILS_RESTRICT results,
-        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT planes,
         float3 const* UTILS_RESTRICT center,
         float3 const* UTILS_RESTRICT extent,
         size_t count, size_t bit) noexcept {
-
-    float4 const * UTILS_RESTRICT const planes = frustum.mPlanes;
-
-    count = round(count);
+#if defined(__clang__)
+    #pragma clang fp contract(off)
+#endif
     #pragma clang loop vectorize_width(FILAMENT_CULLER_VECTORIZE_HINT)
     for (size_t i = 0; i < count; i++) {
         int visible = ~0;
@@ -93,6 +126,391 @@ void Culler::intersects(
     }
 }
 
+// ------------------------------------------------------------------------------------------------
+// SSE4 / AVX2 kernels
+//
+// The SIMD kernels evaluate the plane equations in the same order as the scalar kernels and
+// don't use FMA, so that they classify objects like the scalar kernels do.
+// Visibility is computed by and'ing all six dot products together: the sign bit of the result
+// is set only if the object is on the inner side of all planes.
+// ------------------------------------------------------------------------------------------------
+
+#if FILAMENT_CULLER_X86_KERNELS
+
+// de-interleaves four float3 into three registers (only needs SSE)
+static inline void load4(float3 const* UTILS_RESTRICT p,
+        __m128& x, __m128& y, __m128& z) noexcept {
+    float const* const f = &p->x;
+    __m128 const a = _mm_loadu_ps(f + 0);   // x0 y0 z0 x1
+    __m128 const b = _mm_loadu_ps(f + 4);   // y1 z1 x2 y2
+    __m128 const c = _mm_loadu_ps(f + 8);   // z2 x3 y3 z3
+    __m128 const xy = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));   // x2 y2 x3 y3
+    __m128 const yz = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));   // y0 z0 y1 z1
+    x = _mm_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+// transposes four float4 into four registers (only needs SSE)
+static inline void load4(float4 const* UTILS_RESTRICT p,
+        __m128& x, __m128& y, __m128& z, __m128& w) noexcept {
+    x = _mm_loadu_ps(&p[0].x);
+    y = _mm_loadu_ps(&p[1].x);
+    z = _mm_loadu_ps(&p[2].x);
+    w = _mm_loadu_ps(&p[3].x);
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+}
+
+CULLER_TARGET_SSE4
+static void intersectsSse4(
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 x, y, z, w;
+        load4(b + i, x, y, z, w);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            __m128 dot = _mm_mul_ps(_mm_set1_ps(planes[j].x), x);
+            dot = _mm_add_ps(dot, _mm_mul_ps(_mm_set1_ps(planes[j].y), y));
+            dot = _mm_add_ps(dot, _mm_mul_ps(_mm_set1_ps(planes[j].z), z));
+            dot = _mm_add_ps(dot, _mm_set1_ps(planes[j].w));
+            dot = _mm_sub_ps(dot, w);
+            inside = _mm_and_ps(inside, dot);
+        }
+        __m128i visible = _mm_srli_epi32(_mm_castps_si128(inside), 31);
+        visible = _mm_packus_epi32(visible, visible);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(results + i), visible);
+    }
+}
+
+CULLER_TARGET_SSE4
+static void intersectsSse4(
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    __m128i const keep = _mm_set1_epi16(int16_t(~(1u << bit)));
+    __m128i const shift = _mm_cvtsi32_si128(int(bit));
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 cx, cy, cz, ex, ey, ez;
+        load4(center + i, cx, cy, cz);
+        load4(extent + i, ex, ey, ez);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            __m128 const px = _mm_set1_ps(planes[j].x);
+            __m128 const py = _mm_set1_ps(planes[j].y);
+            __m128 const pz = _mm_set1_ps(planes[j].z);
+            __m128 dot = _mm_sub_ps(_mm_mul_ps(px, cx),
+                    _mm_mul_ps(_mm_set1_ps(std::abs(planes[j].x)), ex));
+            dot = _mm_add_ps(dot, _mm_mul_ps(py, cy));
+            dot = _mm_sub_ps(dot, _mm_mul_ps(_mm_set1_ps(std::abs(planes[j].y)), ey));
+            dot = _mm_add_ps(dot, _mm_mul_ps(pz, cz));
+            dot = _mm_sub_ps(dot, _mm_mul_ps(_mm_set1_ps(std::abs(planes[j].z)), ez));
+            dot = _mm_add_ps(dot, _mm_set1_ps(planes[j].w));
+            inside = _mm_and_ps(inside, dot);
+        }
+        __m128i visible = _mm_srli_epi32(_mm_castps_si128(inside), 31);
+        visible = _mm_sll_epi32(visible, shift);
+        visible = _mm_packus_epi32(visible, visible);
+        __m128i r = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(results + i));
+        r = _mm_or_si128(_mm_and_si128(r, keep), visible);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(results + i), r);
+    }
+}
+
+CULLER_TARGET_AVX2
+static inline __m256 combine(__m128 lo, __m128 hi) noexcept {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+CULLER_TARGET_AVX2
+static void intersectsAvx2(
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 x0, y0, z0, w0, x1, y1, z1, w1;
+        load4(b + i, x0, y0, z0, w0);
+        load4(b + i + 4, x1, y1, z1, w1);
+        __m256 const x = combine(x0, x1);
+        __m256 const y = combine(y0, y1);
+        __m256 const z = combine(z0, z1);
+        __m256 const w = combine(w0, w1);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            __m256 dot = _mm256_mul_ps(_mm256_set1_ps(planes[j].x), x);
+            dot = _mm256_add_ps(dot, _mm256_mul_ps(_mm256_set1_ps(planes[j].y), y));
+            dot = _mm256_add_ps(dot, _mm256_mul_ps(_mm256_set1_ps(planes[j].z), z));
+            dot = _mm256_add_ps(dot, _mm256_set1_ps(planes[j].w));
+            dot = _mm256_sub_ps(dot, w);
+            inside = _mm256_and_ps(inside, dot);
+        }
+        __m256i const visible = _mm256_srli_epi32(_mm256_castps_si256(inside), 31);
+        __m128i const r = _mm_packus_epi32(
+                _mm256_castsi256_si128(visible), _mm256_extracti128_si256(visible, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(results + i), r);
+    }
+    if (i < count) {
+        // count is a multiple of 4, there is at most one group of 4 left
+        intersectsSse4(results + i, planes, b + i, count - i);
+    }
+}
+
+CULLER_TARGET_AVX2
+static void intersectsAvx2(
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    __m128i const keep = _mm_set1_epi16(int16_t(~(1u << bit)));
+    __m128i const shift = _mm_cvtsi32_si128(int(bit));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 cx0, cy0, cz0, ex0, ey0, ez0;
+        __m128 cx1, cy1, cz1, ex1, ey1, ez1;
+        load4(center + i, cx0, cy0, cz0);
+        load4(center + i + 4, cx1, cy1, cz1);
+        load4(extent + i, ex0, ey0, ez0);
+        load4(extent + i + 4, ex1, ey1, ez1);
+        __m256 const cx = combine(cx0, cx1);
+        __m256 const cy = combine(cy0, cy1);
+        __m256 const cz = combine(cz0, cz1);
+        __m256 const ex = combine(ex0, ex1);
+        __m256 const ey = combine(ey0, ey1);
+        __m256 const ez = combine(ez0, ez1);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            __m256 const px = _mm256_set1_ps(planes[j].x);
+            __m256 const py = _mm256_set1_ps(planes[j].y);
+            __m256 const pz = _mm256_set1_ps(planes[j].z);
+            __m256 dot = _mm256_sub_ps(_mm256_mul_ps(px, cx),
+                    _mm256_mul_ps(_mm256_set1_ps(std::abs(planes[j].x)), ex));
+            dot = _mm256_add_ps(dot, _mm256_mul_ps(py, cy));
+            dot = _mm256_sub_ps(dot, _mm256_mul_ps(_mm256_set1_ps(std::abs(planes[j].y)), ey));
+            dot = _mm256_add_ps(dot, _mm256_mul_ps(pz, cz));
+            dot = _mm256_sub_ps(dot, _mm256_mul_ps(_mm256_set1_ps(std::abs(planes[j].z)), ez));
+            dot = _mm256_add_ps(dot, _mm256_set1_ps(planes[j].w));
+            inside = _mm256_and_ps(inside, dot);
+        }
+        __m256i visible = _mm256_srli_epi32(_mm256_castps_si256(inside), 31);
+        visible = _mm256_sll_epi32(visible, shift);
+        __m128i const v = _mm_packus_epi32(
+                _mm256_castsi256_si128(visible), _mm256_extracti128_si256(visible, 1));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<__m128i const*>(results + i));
+        r = _mm_or_si128(_mm_and_si128(r, keep), v);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(results + i), r);
+    }
+    if (i < count) {
+        // count is a multiple of 4, there is at most one group of 4 left
+        intersectsSse4(results + i, planes, center + i, extent + i, count - i, bit);
+    }
+}
+
+#endif // FILAMENT_CULLER_X86_KERNELS
+
+// ------------------------------------------------------------------------------------------------
+// NEON kernels
+// ------------------------------------------------------------------------------------------------
+
+#if FILAMENT_CULLER_NEON_KERNELS
+
+static void intersectsNeon(
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    for (size_t i = 0; i < count; i += 4) {
+        float32x4x4_t const s = vld4q_f32(&b[i].x);
+        uint32x4_t inside = vdupq_n_u32(~0u);
+        for (size_t j = 0; j < 6; j++) {
+            float32x4_t dot = vmulq_n_f32(s.val[0], planes[j].x);
+            dot = vaddq_f32(dot, vmulq_n_f32(s.val[1], planes[j].y));
+            dot = vaddq_f32(dot, vmulq_n_f32(s.val[2], planes[j].z));
+            dot = vaddq_f32(dot, vdupq_n_f32(planes[j].w));
+            dot = vsubq_f32(dot, s.val[3]);
+            inside = vandq_u32(inside, vreinterpretq_u32_f32(dot));
+        }
+        vst1_u16(results + i, vmovn_u32(vshrq_n_u32(inside, 31)));
+    }
+}
+
+static void intersectsNeon(
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    uint16x4_t const keep = vdup_n_u16(uint16_t(~(1u << bit)));
+    int16x4_t const shift = vdup_n_s16(int16_t(bit));
+    for (size_t i = 0; i < count; i += 4) {
+        float32x4x3_t const c = vld3q_f32(&center[i].x);
+        float32x4x3_t const e = vld3q_f32(&extent[i].x);
+        uint32x4_t inside = vdupq_n_u32(~0u);
+        for (size_t j = 0; j < 6; j++) {
+            float32x4_t dot = vsubq_f32(vmulq_n_f32(c.val[0], planes[j].x),
+                    vmulq_n_f32(e.val[0], std::abs(planes[j].x)));
+            dot = vaddq_f32(dot, vmulq_n_f32(c.val[1], planes[j].y));
+            dot = vsubq_f32(dot, vmulq_n_f32(e.val[1], std::abs(planes[j].y)));
+            dot = vaddq_f32(dot, vmulq_n_f32(c.val[2], planes[j].z));
+            dot = vsubq_f32(dot, vmulq_n_f32(e.val[2], std::abs(planes[j].z)));
+            dot = vaddq_f32(dot, vdupq_n_f32(planes[j].w));
+            inside = vandq_u32(inside, vreinterpretq_u32_f32(dot));
+        }
+        uint16x4_t const visible = vshl_u16(vmovn_u32(vshrq_n_u32(inside, 31)), shift);
+        uint16x4_t const r = vld1_u16(results + i);
+        vst1_u16(results + i, vorr_u16(vand_u16(r, keep), visible));
+    }
+}
+
+#endif // FILAMENT_CULLER_NEON_KERNELS
+
+// ------------------------------------------------------------------------------------------------
+// Runtime dispatch
+// ------------------------------------------------------------------------------------------------
+
+bool Culler::isSupported(Isa isa) noexcept {
+    switch (isa) {
+        case Isa::SCALAR:
+            return true;
+#if FILAMENT_CULLER_X86_KERNELS
+        case Isa::SSE4:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.1");
+        case Isa::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+#if FILAMENT_CULLER_NEON_KERNELS
+        case Isa::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+static Culler::Isa selectIsa() noexcept {
+    // from the best to the worst
+    constexpr Culler::Isa candidates[] = {
+            Culler::Isa::AVX2, Culler::Isa::SSE4, Culler::Isa::NEON };
+    for (auto isa : candidates) {
+        if (Culler::isSupported(isa)) {
+            return isa;
+        }
+    }
+    return Culler::Isa::SCALAR;
+}
+
+Culler::Isa Culler::getIsa() noexcept {
+    static const Isa sIsa = selectIsa();
+    return sIsa;
+}
+
+static void dispatch(Culler::Isa isa,
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    assert_invariant(Culler::isSupported(isa));
+    switch (isa) {
+#if FILAMENT_CULLER_X86_KERNELS
+        case Culler::Isa::AVX2:
+            intersectsAvx2(results, planes, b, count);
+            break;
+        case Culler::Isa::SSE4:
+            intersectsSse4(results, planes, b, count);
+            break;
+#endif
+#if FILAMENT_CULLER_NEON_KERNELS
+        case Culler::Isa::NEON:
+            intersectsNeon(results, planes, b, count);
+            break;
+#endif
+        default:
+            intersectsScalar(results, planes, b, count);
+            break;
+    }
+}
+
+static void dispatch(Culler::Isa isa,
+        result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    assert_invariant(Culler::isSupported(isa));
+    switch (isa) {
+#if FILAMENT_CULLER_X86_KERNELS
+        case Culler::Isa::AVX2:
+            intersectsAvx2(results, planes, center, extent, count, bit);
+            break;
+        case Culler::Isa::SSE4:
+            intersectsSse4(results, planes, center, extent, count, bit);
+            break;
+#endif
+#if FILAMENT_CULLER_NEON_KERNELS
+        case Culler::Isa::NEON:
+            intersectsNeon(results, planes, center, extent, count, bit);
+            break;
+#endif
+        default:
+            intersectsScalar(results, planes, center, extent, count, bit);
+            break;
+    }
+}
+
+void Culler::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    dispatch(getIsa(), results, frustum.mPlanes, b, round(count));
+}
+
+void Culler::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    dispatch(getIsa(), results, frustum.mPlanes, center, extent, round(count), bit);
+}
+
+void Culler::intersects(
+        uint64_t* UTILS_RESTRICT results,
+        Frustum const* UTILS_RESTRICT frustums, size_t frustumCount,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count) noexcept {
+    assert_invariant(frustumCount <= 64);
+
+    // The AABBs are processed in small batches, so they stay in the cache while they're tested
+    // against all the frustums.
+    constexpr size_t BATCH_SIZE = 64;
+    static_assert(BATCH_SIZE % MODULO == 0);
+
+    Isa const isa = getIsa();
+    result_type visible[BATCH_SIZE] = {};
+    count = round(count);
+    for (size_t first = 0; first < count; first += BATCH_SIZE) {
+        size_t const c = std::min(BATCH_SIZE, count - first);
+        uint64_t* const UTILS_RESTRICT masks = results + first;
+        std::fill_n(masks, c, 0);
+        for (size_t f = 0; f < frustumCount; f++) {
+            dispatch(isa, visible, frustums[f].mPlanes, center + first, extent + first, c, 0);
+            for (size_t i = 0; i < c; i++) {
+                masks[i] |= uint64_t(visible[i] & 1u) << f;
+            }
+        }
+    }
+}
+
 /*
  * returns whether a box intersects with the frustum
  */
@@ -138,4 +556,20 @@ void Culler::Test::intersects(
     Culler::intersects(results, frustum, b, count);
 }
 
+void Culler::Test::intersects(Isa isa,
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT c,
+        float3 const* UTILS_RESTRICT e,
+        size_t count) noexcept {
+    dispatch(isa, results, frustum.getNormalizedPlanes(), c, e, round(count), 0);
+}
+
+void Culler::Test::intersects(Isa isa,
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b, size_t count) noexcept {
+    dispatch(isa, results, frustum.getNormalizedPlanes(), b, round(count));
+}
+
 } // namespace filament
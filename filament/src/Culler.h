@@ -44,6 +44,27 @@ public:
 
     using result_type = uint16_t;
 
+    /*
+     * Instruction sets the culling kernels are implemented for. SCALAR is the portable
+     * reference implementation, the others are selected at runtime when the CPU supports them.
+     */
+    enum class Isa : uint8_t {
+        SCALAR,
+        SSE4,
+        AVX2,
+        NEON
+    };
+
+    /*
+     * returns the instruction set used by intersects() on this CPU
+     */
+    static Isa getIsa() noexcept;
+
+    /*
+     * returns whether the given instruction set can be used on this CPU
+     */
+    static bool isSupported(Isa isa) noexcept;
+
     /*
      * returns whether each AABB in an array intersects with the frustum
      */
@@ -53,6 +74,17 @@ public:
             math::float3 const* extent,
             size_t count, size_t bit) noexcept;
 
+    /*
+     * returns which frustums each AABB in an array intersects with, bit i of results[n] is set
+     * when AABB n intersects frustums[i]. At most 64 frustums are supported.
+     * results must have room for round(count) entries.
+     */
+    static void intersects(uint64_t* results,
+            Frustum const* frustums, size_t frustumCount,
+            math::float3 const* center,
+            math::float3 const* extent,
+            size_t count) noexcept;
+
     /*
      * returns whether each sphere in an array intersects with the frustum
      */
@@ -88,6 +120,18 @@ public:
                 Frustum const& frustum,
                 math::float4 const* b,
                 size_t count) noexcept;
+
+        // same as above, but forces the given instruction set, which must be supported
+        static void intersects(Isa isa, result_type* results,
+                Frustum const& frustum,
+                math::float3 const* c,
+                math::float3 const* e,
+                size_t count) noexcept;
+
+        static void intersects(Isa isa, result_type* results,
+                Frustum const& frustum,
+                math::float4 const* b,
+                size_t count) noexcept;
     };
 };
 
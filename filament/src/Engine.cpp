@@ -16,6 +16,8 @@
 
 #include "details/Engine.h"
 
+#include "ResourceAllocator.h"
+
 #include "details/BufferObject.h"
 #include "details/Camera.h"
 #include "details/Fence.h"
@@ -240,6 +242,30 @@ utils::JobSystem& Engine::getJobSystem() noexcept {
     return downcast(this)->getJobSystem();
 }
 
+bool Engine::startCommandCapture(const char* path) noexcept {
+    return downcast(this)->getDriverApi().startCommandCapture(path);
+}
+
+void Engine::stopCommandCapture() noexcept {
+    downcast(this)->getDriverApi().stopCommandCapture();
+}
+
+void Engine::startTracing() noexcept {
+    downcast(this)->startTracing();
+}
+
+void Engine::stopTracing() noexcept {
+    downcast(this)->stopTracing();
+}
+
+bool Engine::writeTrace(const char* path) noexcept {
+    return downcast(this)->writeTrace(path);
+}
+
+Engine::ResourceAllocatorStatistics Engine::getResourceAllocatorStatistics() const noexcept {
+    return downcast(this)->getResourceAllocator().getStatistics();
+}
+
 DebugRegistry& Engine::getDebugRegistry() noexcept {
     return downcast(this)->getDebugRegistry();
 }
@@ -74,6 +74,8 @@ void FrameInfoManager::update(Config const& config, FrameInfoManager::duration l
     // this is like doing { pop_back(); push_front(); }
     filament::move_backward(history.begin(), history.end() - 1, history.end());
     history[0].frameTime = lastFrameTime;
+    history[0].commandCacheHits = 0;
+    history[0].commandCacheMisses = 0;
 
     mFrameTimeHistorySize = std::min(++mFrameTimeHistorySize, uint32_t(MAX_FRAMETIME_HISTORY));
     if (UTILS_UNLIKELY(mFrameTimeHistorySize < 3)) {
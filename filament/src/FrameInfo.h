@@ -32,6 +32,8 @@ struct FrameInfo {
     using duration = std::chrono::duration<float, std::milli>;
     duration frameTime{};            // frame period
     duration denoisedFrameTime{};    // frame period (median filter)
+    uint32_t commandCacheHits = 0;   // renderables whose commands were reused this frame
+    uint32_t commandCacheMisses = 0; // renderables whose commands were generated this frame
     bool valid = false;
 };
 
@@ -65,6 +67,12 @@ public:
         return getLastFrameInfo().frameTime;
     }
 
+    // accumulates RenderPass::CommandCache statistics into the current frame
+    void addCommandCacheStats(uint32_t hits, uint32_t misses) noexcept {
+        mFrameTimeHistory[0].commandCacheHits += hits;
+        mFrameTimeHistory[0].commandCacheMisses += misses;
+    }
+
 private:
     void update(Config const& config, duration lastFrameTime) noexcept;
     backend::Handle<backend::HwTimerQuery> mQueries[POOL_COUNT];
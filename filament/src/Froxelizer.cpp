@@ -34,6 +34,8 @@
 #include <math/scalar.h>
 
 #include <algorithm>
+#include <atomic>
+#include <limits>
 
 #include <stddef.h>
 
@@ -56,7 +58,10 @@ constexpr size_t RECORD_BUFFER_ENTRY_COUNT  = CONFIG_MINSPEC_UBO_SIZE;    // 16
 constexpr size_t PER_FROXELDATA_ARENA_SIZE = sizeof(float4) *
                                                  (FROXEL_BUFFER_MAX_ENTRY_COUNT +
                                                   FROXEL_BUFFER_MAX_ENTRY_COUNT + 3 +
-                                                  FROXEL_SLICE_COUNT / 4 + 1);
+                                                  FROXEL_SLICE_COUNT / 4 + 1 +
+                                                  // corner directions, (x+1)*(y+1) <= 2*(x*y+1)
+                                                  2 * (FROXEL_BUFFER_MAX_ENTRY_COUNT /
+                                                       FROXEL_SLICE_COUNT + 1));
 
 // number of lights processed by one group (e.g. 32)
 static constexpr size_t LIGHT_PER_GROUP = sizeof(Froxelizer::LightGroupType) * 8;
@@ -83,12 +88,10 @@ struct Froxelizer::FroxelThreadData :
 
 Froxelizer::Froxelizer(FEngine& engine)
         : mArena("froxel", PER_FROXELDATA_ARENA_SIZE),
+          mJobSystem(engine.getJobSystem()),
           mZLightNear(FROXEL_FIRST_SLICE_DEPTH),
           mZLightFar(FROXEL_LAST_SLICE_DISTANCE)
 {
-    static_assert(std::is_same_v<RecordBufferType, uint8_t>,
-            "Record Buffer must use bytes");
-
     if (UTILS_UNLIKELY(engine.getActiveFeatureLevel() == FeatureLevel::FEATURE_LEVEL_0)) {
         return;
     }
@@ -99,11 +102,15 @@ Froxelizer::Froxelizer(FEngine& engine)
             FROXEL_BUFFER_MAX_ENTRY_COUNT,
             engine.getDriverApi().getMaxUniformBufferSize() / 16u);
 
-    mRecordsBuffer = driverApi.createBufferObject(RECORD_BUFFER_ENTRY_COUNT,
+    mRecordsBuffer = driverApi.createBufferObject(
+            RECORD_BUFFER_ENTRY_COUNT,
             BufferObjectBinding::UNIFORM, BufferUsage::DYNAMIC);
 
     mFroxelsBuffer = driverApi.createBufferObject(getFroxelBufferEntryCount() * 16u,
             BufferObjectBinding::UNIFORM, BufferUsage::DYNAMIC);
+
+    mFroxelShardedData = FixedCapacityVector<FroxelThreadData>(GROUP_COUNT);
+    mLightParams = FixedCapacityVector<LightParams>(CONFIG_MAX_LIGHT_COUNT);
 }
 
 Froxelizer::~Froxelizer() {
@@ -115,6 +122,7 @@ void Froxelizer::terminate(DriverApi& driverApi) noexcept {
     mArena.reset();
 
     mBoundingSpheres = nullptr;
+    mCornerDirections = nullptr;
     mPlanesY = nullptr;
     mPlanesX = nullptr;
     mDistancesZ = nullptr;
@@ -183,24 +191,15 @@ bool Froxelizer::prepare(
      * Temporary allocations for processing all froxel data
      */
 
-    // light records per froxel (~256 KiB)
+    // light records per froxel (~256 KiB), fully initialized by froxelizeAssignRecordsCompress()
     mLightRecords = {
             arena.allocate<LightRecord>(getFroxelBufferEntryCount(), CACHELINE_SIZE),
             getFroxelBufferEntryCount() };
 
-    // froxel thread data (~256 KiB)
-    mFroxelShardedData = {
-            arena.allocate<FroxelThreadData>(GROUP_COUNT, CACHELINE_SIZE),
-            uint32_t(GROUP_COUNT)
-    };
-
     assert_invariant(mFroxelBufferUser.begin());
     assert_invariant(mRecordBufferUser.begin());
     assert_invariant(mLightRecords.begin());
-    assert_invariant(mFroxelShardedData.begin());
-
-    // initialize buffers that need to be
-    memset(mLightRecords.data(), 0, mLightRecords.sizeInBytes());
+    assert_invariant(!mFroxelShardedData.empty());
 
     return uniformsNeedUpdating;
 }
@@ -247,8 +246,9 @@ void Froxelizer::computeFroxelLayout(
 }
 
 UTILS_NOINLINE
-void Froxelizer::updateBoundingSpheres(
+void Froxelizer::updateBoundingSpheres(JobSystem& js,
         math::float4* const UTILS_RESTRICT boundingSpheres,
+        math::float3* const UTILS_RESTRICT cornerDirections,
         size_t froxelCountX, size_t froxelCountY, size_t froxelCountZ,
         math::float4 const* UTILS_RESTRICT planesX,
         math::float4 const* UTILS_RESTRICT planesY,
@@ -256,54 +256,59 @@ void Froxelizer::updateBoundingSpheres(
 
     SYSTRACE_CALL();
 
-    // TODO: this could potentially be parallel_for'ized
-
     /*
-     * Now compute the bounding sphere of each froxel, which is needed for spotlights
-     * We intersect 3 planes of the frustum to find each 8 corners.
+     * Now compute the bounding sphere of each froxel, which is needed for spotlights.
+     *
+     * Each of the 8 corners of a froxel is the intersection of a vertical plane, an horizontal
+     * plane and a z-plane. The vertical and horizontal planes go through the origin, so
+     * they intersect along a line through the origin and the corner at distance d is just
+     * d * q, where q is the point of that line at distance 1. We compute q once per
+     * (x, y) pair, after that, each froxel only needs a few multiply-adds, which vectorize.
      */
 
     UTILS_ASSUME(froxelCountX > 0);
     UTILS_ASSUME(froxelCountY > 0);
 
-    for (size_t iz = 0, fi = 0, nz = froxelCountZ; iz < nz; ++iz) {
-        float4 planes[6];
-        planes[4] =  float4{ 0, 0, 1, planesZ[iz + 0] };
-        planes[5] = -float4{ 0, 0, 1, planesZ[iz + 1] };
-        for (size_t iy = 0, ny = froxelCountY; iy < ny; ++iy) {
-            planes[2] =  planesY[iy];
-            planes[3] = -planesY[iy + 1];
+    size_t const strideY = froxelCountX + 1;
+    for (size_t iy = 0, ny = froxelCountY; iy <= ny; ++iy) {
+        for (size_t ix = 0, nx = froxelCountX; ix <= nx; ++ix) {
+            // same as planeIntersection() with a z-plane at distance 1
+            float3 const l = cross(planesX[ix].xyz, planesY[iy].xyz);
+            cornerDirections[iy * strideY + ix] = l * (-1.0f / l.z);
+        }
+    }
+
+    // one row of froxels per iteration, the rows are processed in parallel
+    auto work = [=](uint32_t start, uint32_t count) {
+        for (size_t row = start, end = start + count; row < end; row++) {
+            size_t const iz = row / froxelCountY;
+            size_t const iy = row % froxelCountY;
+            float const dn = planesZ[iz];
+            float const df = planesZ[iz + 1];
+            float const dc = 0.5f * (dn + df);
+            float3 const* const UTILS_RESTRICT q0 = cornerDirections + iy * strideY;
+            float3 const* const UTILS_RESTRICT q1 = q0 + strideY;
+            float4* const UTILS_RESTRICT spheres = boundingSpheres + row * froxelCountX;
             for (size_t ix = 0, nx = froxelCountX; ix < nx; ++ix) {
-                planes[0] =  planesX[ix];
-                planes[1] = -planesX[ix + 1];
-
-                float3 const p0 = planeIntersection(planes[0], planes[2], planes[4]);
-                float3 const p1 = planeIntersection(planes[1], planes[2], planes[4]);
-                float3 const p2 = planeIntersection(planes[0], planes[3], planes[4]);
-                float3 const p3 = planeIntersection(planes[1], planes[3], planes[4]);
-                float3 const p4 = planeIntersection(planes[0], planes[2], planes[5]);
-                float3 const p5 = planeIntersection(planes[1], planes[2], planes[5]);
-                float3 const p6 = planeIntersection(planes[0], planes[3], planes[5]);
-                float3 const p7 = planeIntersection(planes[1], planes[3], planes[5]);
-
-                float3 const c = (p0 + p1 + p2 + p3 + p4 + p5 + p6 + p7) * 0.125f;
-
-                float const d0 = length2(p0 - c);
-                float const d1 = length2(p1 - c);
-                float const d2 = length2(p2 - c);
-                float const d3 = length2(p3 - c);
-                float const d4 = length2(p4 - c);
-                float const d5 = length2(p5 - c);
-                float const d6 = length2(p6 - c);
-                float const d7 = length2(p7 - c);
-
-                float const r = std::sqrt(std::max({ d0, d1, d2, d3, d4, d5, d6, d7 }));
-
-                assert_invariant(getFroxelIndex(ix, iy, iz, froxelCountX, froxelCountY) == fi);
-                boundingSpheres[fi++] = { c, r };
+                float3 const a = q0[ix];
+                float3 const b = q0[ix + 1];
+                float3 const c = q1[ix];
+                float3 const d = q1[ix + 1];
+                float3 const center = (a + b + c + d) * (0.25f * dc);
+                float const r2 = std::max({
+                        length2(a * dn - center), length2(a * df - center),
+                        length2(b * dn - center), length2(b * df - center),
+                        length2(c * dn - center), length2(c * df - center),
+                        length2(d * dn - center), length2(d * df - center) });
+                assert_invariant(getFroxelIndex(ix, iy, iz, froxelCountX, froxelCountY) ==
+                        row * froxelCountX + ix);
+                spheres[ix] = { center, std::sqrt(r2) };
             }
         }
-    }
+    };
+
+    js.runAndWait(jobs::parallel_for(js, nullptr, 0, uint32_t(froxelCountY * froxelCountZ),
+            std::cref(work), jobs::CountSplitter<16, 4>()));
 }
 
 UTILS_NOINLINE
@@ -347,11 +352,13 @@ bool Froxelizer::update() noexcept {
         mPlanesX         = mArena.alloc<float4>(froxelCountX + 1);
         mPlanesY         = mArena.alloc<float4>(froxelCountY + 1);
         mBoundingSpheres = mArena.alloc<float4>(froxelCount);
+        mCornerDirections = mArena.alloc<float3>((froxelCountX + 1) * (froxelCountY + 1));
 
         assert_invariant(mDistancesZ);
         assert_invariant(mPlanesX);
         assert_invariant(mPlanesY);
         assert_invariant(mBoundingSpheres);
+        assert_invariant(mCornerDirections);
 
         mDistancesZ[0] = 0.0f;
         const float zLightNear = mZLightNear;
@@ -408,7 +415,7 @@ bool Froxelizer::update() noexcept {
             planesY[i] = float4{ normalize(p.xyz), 0 };  // p.w is guaranteed to be 0
         }
 
-        updateBoundingSpheres(mBoundingSpheres,
+        updateBoundingSpheres(mJobSystem, mBoundingSpheres, mCornerDirections,
                 mFroxelCountX, mFroxelCountY, mFroxelCountZ,
                 planesX, planesY, mDistancesZ);
 
@@ -438,6 +445,9 @@ bool Froxelizer::update() noexcept {
         uniformsNeedUpdating = true;
     }
     assert_invariant(mZLightNear >= mNear);
+
+    // the froxels changed, so all lights need to be froxelized again
+    mLightParamsValid = false;
     mDirtyFlags = 0;
     return uniformsNeedUpdating;
 }
@@ -487,17 +497,22 @@ std::pair<size_t, size_t> Froxelizer::clipToIndices(float2 const& clip) const no
 
 
 void Froxelizer::commit(backend::DriverApi& driverApi) {
-    // send data to GPU
-    driverApi.updateBufferObject(mFroxelsBuffer,
-            { mFroxelBufferUser.data(), getFroxelBufferEntryCount() * 16u }, 0);
+    // when nothing changed, the buffers still have the data we sent last time
+    if (mFroxelDataDirty) {
+        // send data to GPU
+        driverApi.updateBufferObject(mFroxelsBuffer,
+                { mFroxelBufferUser.data(), getFroxelBufferEntryCount() * 16u }, 0);
 
-    driverApi.updateBufferObject(mRecordsBuffer,
-            { mRecordBufferUser.data(), RECORD_BUFFER_ENTRY_COUNT }, 0);
+        driverApi.updateBufferObject(mRecordsBuffer,
+                { mRecordBufferUser.data(),
+                  RECORD_BUFFER_ENTRY_COUNT }, 0);
+
+        mFroxelDataDirty = false;
+    }
 
 #ifndef NDEBUG
     mFroxelBufferUser.clear();
     mRecordBufferUser.clear();
-    mFroxelShardedData.clear();
 #endif
 }
 
@@ -505,8 +520,17 @@ void Froxelizer::froxelizeLights(FEngine& engine,
         mat4f const& UTILS_RESTRICT viewMatrix,
         const FScene::LightSoa& UTILS_RESTRICT lightData) noexcept {
     // note: this is called asynchronously
-    froxelizeLoop(engine, viewMatrix, lightData);
-    froxelizeAssignRecordsCompress();
+    bool const changed = froxelizeLoop(engine, viewMatrix, lightData);
+    if (!changed && !mFroxelDataDirty) {
+        // the froxels and lights are the same as last frame, and the data we computed then
+        // has been sent to the GPU already.
+        return;
+    }
+
+    // The per-frame buffers are always rebuilt, even if only some light groups changed, or
+    // if the last data we computed was never committed (the buffers are reallocated every frame).
+    froxelizeAssignRecordsCompress(engine.getJobSystem());
+    mFroxelDataDirty = true;
 
 #ifndef NDEBUG
     if (lightData.size()) {
@@ -532,22 +556,44 @@ void Froxelizer::froxelizeLights(FEngine& engine,
 #endif
 }
 
-void Froxelizer::froxelizeLoop(FEngine& engine,
+bool Froxelizer::froxelizeLoop(FEngine& engine,
         const mat4f& UTILS_RESTRICT viewMatrix,
         const FScene::LightSoa& UTILS_RESTRICT lightData) noexcept {
     SYSTRACE_CALL();
 
-    Slice<FroxelThreadData> froxelThreadData = mFroxelShardedData;
-    memset(froxelThreadData.data(), 0, froxelThreadData.sizeInBytes());
+    size_t const lightCount = lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT;
+    assert_invariant(lightCount <= GROUP_COUNT * LIGHT_PER_GROUP);
+    assert_invariant(lightCount <= mLightParams.size());
+
+    /*
+     * A group is froxelized again only if one of its lights changed since the last frame.
+     * Light parameters are compared in view-space, so when the camera moves all groups are
+     * dirty. When the froxels or the number of groups change, lights can't be compared, all
+     * groups are dirty as well.
+     */
+
+    bool dirtyGroups[GROUP_COUNT];
+    bool const reset = !mLightParamsValid;
+    std::fill_n(dirtyGroups, GROUP_COUNT, reset);
+    if (!reset) {
+        // groups that gained or lost lights
+        for (size_t i = std::min(size_t(mLightCount), lightCount),
+                    n = std::max(size_t(mLightCount), lightCount); i < n; i++) {
+            dirtyGroups[i % GROUP_COUNT] = true;
+        }
+    }
+
+    FroxelThreadData* const froxelThreadData = mFroxelShardedData.data();
+    LightParams* const lightParams = mLightParams.data();
 
     auto& lcm = engine.getLightManager();
     auto const* UTILS_RESTRICT spheres      = lightData.data<FScene::POSITION_RADIUS>();
     auto const* UTILS_RESTRICT directions   = lightData.data<FScene::DIRECTION>();
     auto const* UTILS_RESTRICT instances    = lightData.data<FScene::LIGHT_INSTANCE>();
 
-    auto process = [ this, &froxelThreadData,
+    auto process = [ this, froxelThreadData, lightParams, &dirtyGroups, lightCount,
                      spheres, directions, instances, &viewMatrix, &lcm ]
-            (size_t count, size_t offset, size_t stride) {
+            (size_t group) {
 
         SYSTRACE_NAME("FroxelizeLoop Job");
 
@@ -559,7 +605,9 @@ void Froxelizer::froxelizeLoop(FEngine& engine,
         constexpr float maxInvSin = 114.59301f;         // 1 / sin(0.5 degrees)
         constexpr float maxCosSquared = 0.99992385f;    // cos(0.5 degrees)^2
 
-        for (size_t i = offset; i < count; i += stride) {
+        // each group only touches the parameters of its own lights
+        bool dirty = dirtyGroups[group];
+        for (size_t i = group; i < lightCount; i += GROUP_COUNT) {
             const size_t j = i + FScene::DIRECTIONAL_LIGHTS_COUNT;
             FLightManager::Instance const li = instances[j];
             LightParams light = {
@@ -573,74 +621,102 @@ void Froxelizer::froxelizeLoop(FEngine& engine,
             if (light.invSin != std::numeric_limits<float>::infinity()) {
                 light.invSin = std::min(maxInvSin, light.invSin);
             }
+            if (!dirty && lightParams[i] != light) {
+                dirty = true;
+            }
+            lightParams[i] = light;
+        }
 
-            const size_t group = i % GROUP_COUNT;
-            const size_t bit   = i / GROUP_COUNT;
-            assert_invariant(bit < LIGHT_PER_GROUP);
+        dirtyGroups[group] = dirty;
+        if (!dirty) {
+            // this group's froxels are still valid
+            return;
+        }
 
-            FroxelThreadData& threadData = froxelThreadData[group];
-            froxelizePointAndSpotLight(threadData, bit, projection, light);
+        FroxelThreadData& threadData = froxelThreadData[group];
+        memset(threadData.data(), 0, sizeof(FroxelThreadData));
+        for (size_t i = group; i < lightCount; i += GROUP_COUNT) {
+            const size_t bit = i / GROUP_COUNT;
+            assert_invariant(bit < LIGHT_PER_GROUP);
+            froxelizePointAndSpotLight(threadData, bit, projection, lightParams[i]);
         }
     };
 
-    // we do 64 lights per job
+    // we do one group of lights per job
     JobSystem& js = engine.getJobSystem();
 
     constexpr bool SINGLE_THREADED = false;
     if (!SINGLE_THREADED) {
         auto *parent = js.createJob();
         for (size_t i = 0; i < GROUP_COUNT; i++) {
-            js.run(jobs::createJob(js, parent, std::cref(process),
-                    lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT, i, GROUP_COUNT));
+            js.run(jobs::createJob(js, parent, std::cref(process), i));
         }
         js.runAndWait(parent);
     } else {
-        js.runAndWait(jobs::createJob(js, nullptr, std::cref(process),
-                lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT, 0, 1)
-        );
+        for (size_t i = 0; i < GROUP_COUNT; i++) {
+            process(i);
+        }
     }
+
+    mLightCount = uint32_t(lightCount);
+    mLightParamsValid = true;
+
+    return std::any_of(dirtyGroups, dirtyGroups + GROUP_COUNT, [](bool dirty) { return dirty; });
 }
 
-void Froxelizer::froxelizeAssignRecordsCompress() noexcept {
+void Froxelizer::froxelizeAssignRecordsCompress(JobSystem& js) noexcept {
 
     SYSTRACE_CALL();
 
-    Slice<FroxelThreadData> const froxelThreadData = mFroxelShardedData;
+    FroxelThreadData const* const froxelThreadData = mFroxelShardedData.data();
 
     // convert froxel data from N groups of M bits to LightRecord::bitset, so we can
-    // easily compare adjacent froxels, for compaction. The conversion loops below get
-    // inlined and vectorized in release builds.
-
-    // this gets very well vectorized...
-
-    utils::Slice<LightRecord> records(mLightRecords);
-    for (size_t j = 0, jc = getFroxelBufferEntryCount(); j < jc; j++) {
-        for (size_t i = 0; i < LightRecord::bitset::WORLD_COUNT; i++) {
-            using container_type = LightRecord::bitset::container_type;
-            constexpr size_t r = sizeof(container_type) / sizeof(LightGroupType);
-            container_type b = froxelThreadData[i * r][j];
+    // easily compare adjacent froxels, for compaction.
+    // Froxels are converted in parallel, the inner loops go through contiguous froxels so they
+    // get inlined and vectorized in release builds.
+
+    using container_type = LightRecord::bitset::container_type;
+    constexpr size_t WORD_COUNT = LightRecord::bitset::WORLD_COUNT;
+    constexpr size_t r = sizeof(container_type) / sizeof(LightGroupType);
+    static_assert(WORD_COUNT * r == GROUP_COUNT);
+
+    // lights that touch at least one froxel
+    std::atomic<container_type> allLightsBits[WORD_COUNT] = {};
+
+    LightRecord* const UTILS_RESTRICT records = mLightRecords.data();
+    auto convert = [records, froxelThreadData, &allLightsBits](uint32_t start, uint32_t count) {
+        size_t const end = start + count;
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            for (size_t j = start; j < end; j++) {
+                records[j].lights.getBitsAt(i) = 0;
+            }
+            container_type any = 0;
             for (size_t k = 0; k < r; k++) {
-                b |= (container_type(froxelThreadData[i * r + k][j]) << (LIGHT_PER_GROUP * k));
+                LightGroupType const* const UTILS_RESTRICT bits = froxelThreadData[i * r + k].data();
+                for (size_t j = start; j < end; j++) {
+                    container_type const b = container_type(bits[j]) << (LIGHT_PER_GROUP * k);
+                    records[j].lights.getBitsAt(i) |= b;
+                    any |= b;
+                }
             }
-            records[j].lights.getBitsAt(i) = b;
+            allLightsBits[i].fetch_or(any, std::memory_order_relaxed);
         }
-    }
+    };
+
+    js.runAndWait(jobs::parallel_for(js, nullptr, 0, mFroxelCount,
+            std::cref(convert), jobs::CountSplitter<512, 4>()));
 
     LightRecord::bitset allLights{};
-    for (size_t j = 0, jc = getFroxelBufferEntryCount(); j < jc; j++) {
-        allLights |= records[j].lights;
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+        allLights.getBitsAt(i) = allLightsBits[i].load(std::memory_order_relaxed);
     }
 
-    uint16_t offset = 0;
     FroxelEntry* const UTILS_RESTRICT froxels = mFroxelBufferUser.data();
-
-    const size_t froxelCountX = mFroxelCountX;
     RecordBufferType* const UTILS_RESTRICT froxelRecords = mRecordBufferUser.data();
 
     // initialize the first record with all lights in the scene -- this will be used only if
     // we run out of record space.
     const uint8_t allLightsCount = (uint8_t)std::min(size_t(255), allLights.count());
-    offset += allLightsCount;
     allLights.forEachSetBit([point = froxelRecords, froxelRecords](size_t l) mutable {
         // make sure to keep this code branch-less
         const size_t word = l / LIGHT_PER_GROUP;
@@ -652,73 +728,124 @@ void Froxelizer::froxelizeAssignRecordsCompress() noexcept {
         point += (point - froxelRecords < 255) ? 1 : 0;
     });
 
-    // how many froxel record entries were reused (for debugging)
-    UTILS_UNUSED size_t reused = 0;
+    /*
+     * Each z-slice is compressed independently, so slices can be processed in parallel.
+     * We first count how many records each slice needs, which gives each slice its offset in the
+     * record buffer, then the slices write their records.
+     * Slices that don't fit in the record buffer use the record with all lights.
+     */
+
+    size_t const sliceSize = size_t(mFroxelCountX) * mFroxelCountY;
+    size_t const sliceCount = mFroxelCountZ;
+    assert_invariant(sliceCount <= FROXEL_SLICE_COUNT);
+
+    constexpr size_t OUT_OF_SPACE = std::numeric_limits<size_t>::max();
+    size_t sliceOffsets[FROXEL_SLICE_COUNT];
+
+    auto countRecords = [this, &sliceOffsets, sliceSize](uint32_t start, uint32_t count) {
+        for (size_t z = start, end = start + count; z < end; z++) {
+            sliceOffsets[z] = compressRecords<false>(
+                    z * sliceSize, (z + 1) * sliceSize, 0);
+        }
+    };
+    js.runAndWait(jobs::parallel_for(js, nullptr, 0, uint32_t(sliceCount),
+            std::cref(countRecords), jobs::CountSplitter<1, 4>()));
+
+    size_t offset = allLightsCount;
+    for (size_t z = 0; z < sliceCount; z++) {
+        size_t const recordCount = sliceOffsets[z];
+        if (UTILS_LIKELY(offset + recordCount < RECORD_BUFFER_ENTRY_COUNT)) {
+            sliceOffsets[z] = offset;
+            offset += recordCount;
+        } else {
+#ifndef NDEBUG
+            slog.d << "out of space: slice " << z << ", at " << offset << io::endl;
+#endif
+            // note: instead of dropping slices we could look for similar records we've already
+            // filed up.
+            sliceOffsets[z] = OUT_OF_SPACE;
+        }
+    }
+
+    auto writeRecords = [this, &sliceOffsets, sliceSize, froxels, allLightsCount]
+            (uint32_t start, uint32_t count) {
+        for (size_t z = start, end = start + count; z < end; z++) {
+            size_t const begin = z * sliceSize;
+            if (UTILS_LIKELY(sliceOffsets[z] != OUT_OF_SPACE)) {
+                compressRecords<true>(begin, begin + sliceSize, sliceOffsets[z]);
+            } else {
+                LightRecord const* const UTILS_RESTRICT records = mLightRecords.data();
+                for (size_t i = begin, e = begin + sliceSize; i < e; i++) {
+                    froxels[i] = { 0u, records[i].lights.none() ? uint8_t(0) : allLightsCount };
+                }
+            }
+        }
+    };
+    js.runAndWait(jobs::parallel_for(js, nullptr, 0, uint32_t(sliceCount),
+            std::cref(writeRecords), jobs::CountSplitter<1, 4>()));
+
+    // FIXME: on big-endian systems we need to change the endianness of the record buffer
+}
+
+template<bool WRITE>
+size_t Froxelizer::compressRecords(size_t begin, size_t end, size_t offset) noexcept {
+    LightRecord const* const UTILS_RESTRICT records = mLightRecords.data();
+    FroxelEntry* const UTILS_RESTRICT froxels = mFroxelBufferUser.data();
+    RecordBufferType* const UTILS_RESTRICT froxelRecords = mRecordBufferUser.data();
+    size_t const froxelCountX = mFroxelCountX;
 
-    for (size_t i = 0, c = mFroxelCount; i < c;) {
+    for (size_t i = begin; i < end;) {
         LightRecord b = records[i];
         if (b.lights.none()) {
-            froxels[i++].u32 = 0;
+            if constexpr (WRITE) {
+                froxels[i].u32 = 0;
+            }
+            i++;
             continue;
         }
 
         // We have a limitation of 255 spot + 255 point lights per froxel.
         // note: initializer list for union cannot have more than one element
-        FroxelEntry entry{ offset, uint8_t(std::min(size_t(255), b.lights.count())) };
+        FroxelEntry entry{ uint16_t(offset), uint8_t(std::min(size_t(255), b.lights.count())) };
         const size_t lightCount = entry.count();
 
-        if (UTILS_UNLIKELY(offset + lightCount >= RECORD_BUFFER_ENTRY_COUNT)) {
-#ifndef NDEBUG
-            slog.d << "out of space: " << i << ", at " << offset << io::endl;
-#endif
-            // note: instead of dropping froxels we could look for similar records we've already
-            // filed up.
-            do {
-                froxels[i] = { 0u, allLightsCount };
-                if (records[i].lights.none()) {
-                    froxels[i].u32 = 0;
-                }
-            } while(++i < c);
-            goto out_of_memory;
+        if constexpr (WRITE) {
+            assert_invariant(offset + lightCount < RECORD_BUFFER_ENTRY_COUNT);
+            // iterate the bitfield
+            auto * const beginPoint = froxelRecords + offset;
+            b.lights.forEachSetBit([point = beginPoint, beginPoint](size_t l) mutable {
+                // make sure to keep this code branch-less
+                const size_t word = l / LIGHT_PER_GROUP;
+                const size_t bit  = l % LIGHT_PER_GROUP;
+                l = (bit * GROUP_COUNT) | (word % GROUP_COUNT);
+                *point = (RecordBufferType)l;
+                // we need to "cancel" the write operation if we have more than 255 spot or point
+                // lights (this is a limitation of the data type used to store the light counts
+                // per froxel)
+                point += (point - beginPoint < 255) ? 1 : 0;
+            });
         }
 
-        // iterate the bitfield
-        auto * const beginPoint = froxelRecords + offset;
-        b.lights.forEachSetBit([point = beginPoint, beginPoint](size_t l) mutable {
-            // make sure to keep this code branch-less
-            const size_t word = l / LIGHT_PER_GROUP;
-            const size_t bit  = l % LIGHT_PER_GROUP;
-            l = (bit * GROUP_COUNT) | (word % GROUP_COUNT);
-            *point = (RecordBufferType)l;
-            // we need to "cancel" the write operation if we have more than 255 spot or point lights
-            // (this is a limitation of the data type used to store the light counts per froxel)
-            point += (point - beginPoint < 255) ? 1 : 0;
-        });
-
         offset += lightCount;
 
-#ifndef NDEBUG
-        if (lightCount) { reused--; }
-#endif
         do {
-#ifndef NDEBUG
-            if (lightCount) { reused++; }
-#endif
-            froxels[i++].u32 = entry.u32;
-            if (i >= c) break;
+            if constexpr (WRITE) {
+                froxels[i].u32 = entry.u32;
+            }
+            if (++i >= end) break;
 
-            if (records[i].lights != b.lights && i >= froxelCountX) {
+            if (records[i].lights != b.lights && i >= begin + froxelCountX) {
                 // if this froxel record doesn't match the previous one on its left,
                 // we re-try with the record above it, which saves many froxel records
                 // (north of 10% in practice).
                 b = records[i - froxelCountX];
-                entry.u32 = froxels[i - froxelCountX].u32;
+                if constexpr (WRITE) {
+                    entry.u32 = froxels[i - froxelCountX].u32;
+                }
             }
         } while(records[i].lights == b.lights);
     }
-out_of_memory:
-    // FIXME: on big-endian systems we need to change the endianness of the record buffer
-    ;
+    return offset;
 }
 
 static inline float2 project(mat4f const& p, float3 const& v) noexcept {
@@ -28,11 +28,13 @@
 
 #include <utils/compiler.h>
 #include <utils/bitset.h>
+#include <utils/FixedCapacityVector.h>
 #include <utils/Slice.h>
 
 #include <math/mat4.h>
 #include <math/vec4.h>
 
+
 namespace filament {
 
 // Max number of froxels limited by:
@@ -76,7 +78,7 @@ public:
 //  |....|                                          h = num froxels
 //  |....|
 //  +----+
-// 256 lights max
+// CONFIG_MAX_LIGHT_COUNT lights max
 //
 
 class Froxelizer {
@@ -122,6 +124,8 @@ public:
     float getLightFar() const noexcept { return mZLightFar; }
 
     // update Records and Froxels texture with lights data. this is thread-safe.
+    // Only the light groups whose lights changed since the previous call are froxelized again,
+    // and nothing at all is done if neither the lights nor the camera changed.
     void froxelizeLights(FEngine& engine, math::mat4f const& viewMatrix,
             const FScene::LightSoa& lightData) noexcept;
 
@@ -131,9 +135,12 @@ public:
         s.froxelCountXY = math::float2{ mViewport.width, mViewport.height } / mFroxelDimension;
     }
 
-    // send froxel data to GPU
+    // send froxel data to GPU, this is a no-op if it didn't change since the last commit()
     void commit(backend::DriverApi& driverApi);
 
+    // whether froxelizeLights() produced data that commit() hasn't sent to the GPU yet
+    bool needsCommit() const noexcept { return mFroxelDataDirty; }
+
 
     /*
      * Only for testing/debugging...
@@ -175,6 +182,11 @@ private:
         float invSin = std::numeric_limits<float>::infinity();
         // radius is not used in the hot loop, so leave it at the end
         float radius;
+
+        bool operator!=(LightParams const& rhs) const noexcept {
+            return position != rhs.position || cosSqr != rhs.cosSqr || axis != rhs.axis ||
+                   invSin != rhs.invSin || radius != rhs.radius;
+        }
     };
 
     struct LightTreeNode {
@@ -195,10 +207,16 @@ private:
     inline void setProjection(const math::mat4f& projection, float near, float far) noexcept;
     bool update() noexcept;
 
-    void froxelizeLoop(FEngine& engine,
+    // returns false if none of the light groups needed to be froxelized again
+    bool froxelizeLoop(FEngine& engine,
             math::mat4f const& viewMatrix, const FScene::LightSoa& lightData) noexcept;
 
-    void froxelizeAssignRecordsCompress() noexcept;
+    void froxelizeAssignRecordsCompress(utils::JobSystem& js) noexcept;
+
+    // compresses the records of froxels [begin, end) starting at offset in the record buffer,
+    // returns the offset past the last record. Nothing is written if WRITE is false.
+    template<bool WRITE>
+    size_t compressRecords(size_t begin, size_t end, size_t offset) noexcept;
 
     void froxelizePointAndSpotLight(FroxelThreadData& froxelThread, size_t bit,
             math::mat4f const& projection, const LightParams& light) const noexcept;
@@ -207,8 +225,9 @@ private:
             utils::Slice<RecordBufferType> const& lightList,
             const FScene::LightSoa& lightData, size_t lightRecordsOffset) noexcept;
 
-    static void updateBoundingSpheres(
+    static void updateBoundingSpheres(utils::JobSystem& js,
             math::float4* UTILS_RESTRICT boundingSpheres,
+            math::float3* UTILS_RESTRICT cornerDirections,
             size_t froxelCountX, size_t froxelCountY, size_t froxelCountZ,
             math::float4 const* UTILS_RESTRICT planesX,
             math::float4 const* UTILS_RESTRICT planesY,
@@ -234,6 +253,8 @@ private:
     // internal state dependent on the viewport and needed for froxelizing
     LinearAllocatorArena mArena;                        // ~256 KiB
 
+    utils::JobSystem& mJobSystem;
+
     // 4096 froxels fits in a 16KiB buffer, the minimum guaranteed in GLES 3.x and Vulkan 1.1
     size_t mFroxelBufferEntryCount = 4096;
 
@@ -242,13 +263,19 @@ private:
     math::float4* mPlanesX = nullptr;
     math::float4* mPlanesY = nullptr;
     math::float4* mBoundingSpheres = nullptr;           // 128 KiB w/ 8192 froxels
+    math::float3* mCornerDirections = nullptr;          //  12 KiB w/ 8192 froxels
+
+    // kept across frames, so that light groups that didn't change are not froxelized again
+    utils::FixedCapacityVector<FroxelThreadData> mFroxelShardedData;    // 256 KiB w/ 256 lights
+    utils::FixedCapacityVector<LightParams> mLightParams;  // view-space lights of the last frame
+    uint32_t mLightCount = 0;       // light count of the last frame
+    bool mLightParamsValid = false; // whether mLightParams can be compared to this frame's
 
     // allocations in the per frame arena
-    utils::Slice<FroxelThreadData> mFroxelShardedData;  // 256 KiB w/  256 lights and 8192 froxels
-    utils::Slice<FroxelEntry> mFroxelBufferUser;        //  32 KiB w/ 8192 froxels
     utils::Slice<LightRecord> mLightRecords;            // 256 KiB w/  256 lights
 
     // allocations in the command stream
+    utils::Slice<FroxelEntry> mFroxelBufferUser;        //  32 KiB w/ 8192 froxels
     utils::Slice<RecordBufferType> mRecordBufferUser;   //  16 KiB
 
     uint16_t mFroxelCountX = 0;
@@ -272,6 +299,9 @@ private:
     float mZLightNear;
     float mZLightFar;
 
+    // set when the froxel and record buffers need to be sent to the GPU
+    bool mFroxelDataDirty = false;
+
     // track if we need to update our internal state before froxelizing
     uint8_t mDirtyFlags = 0;
     enum {
@@ -44,8 +44,9 @@ namespace filament {
 
 // ------------------------------------------------------------------------------------------------
 
-MaterialParser::MaterialParserDetails::MaterialParserDetails(Backend backend, const void* data, size_t size)
-        : mManagedBuffer(data, size),
+MaterialParser::MaterialParserDetails::MaterialParserDetails(Backend backend,
+        const void* data, size_t size, bool copy)
+        : mManagedBuffer(data, size, copy),
           mChunkContainer(mManagedBuffer.data(), mManagedBuffer.size()),
           mMaterialChunk(mChunkContainer) {
     switch (backend) {
@@ -84,8 +85,8 @@ bool MaterialParser::MaterialParserDetails::getFromSimpleChunk(
 
 // ------------------------------------------------------------------------------------------------
 
-MaterialParser::MaterialParser(Backend backend, const void* data, size_t size)
-        : mImpl(backend, data, size) {
+MaterialParser::MaterialParser(Backend backend, const void* data, size_t size, bool copy)
+        : mImpl(backend, data, size, copy) {
 }
 
 ChunkContainer& MaterialParser::getChunkContainer() noexcept {
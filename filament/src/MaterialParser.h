@@ -48,7 +48,8 @@ struct MaterialConstant;
 
 class MaterialParser {
 public:
-    MaterialParser(backend::Backend backend, const void* data, size_t size);
+    // When "copy" is false, the data is used in place and must outlive the MaterialParser.
+    MaterialParser(backend::Backend backend, const void* data, size_t size, bool copy = true);
 
     MaterialParser(MaterialParser const& rhs) noexcept = delete;
     MaterialParser& operator=(MaterialParser const& rhs) noexcept = delete;
@@ -121,7 +122,8 @@ public:
 
 private:
     struct MaterialParserDetails {
-        MaterialParserDetails(backend::Backend backend, const void* data, size_t size);
+        MaterialParserDetails(backend::Backend backend, const void* data, size_t size,
+                bool copy);
 
         template<typename T>
         bool getFromSimpleChunk(filamat::ChunkType type, T* value) const noexcept;
@@ -132,12 +134,20 @@ private:
         class ManagedBuffer {
             void* mStart = nullptr;
             size_t mSize = 0;
+            bool mOwned = true;
         public:
-            explicit ManagedBuffer(const void* start, size_t size)
-                    : mStart(malloc(size)), mSize(size) {
-                memcpy(mStart, start, size);
+            ManagedBuffer(const void* start, size_t size, bool copy)
+                    : mStart(copy ? malloc(size) : const_cast<void*>(start)), mSize(size),
+                      mOwned(copy) {
+                if (copy) {
+                    memcpy(mStart, start, size);
+                }
+            }
+            ~ManagedBuffer() noexcept {
+                if (mOwned) {
+                    free(mStart);
+                }
             }
-            ~ManagedBuffer() noexcept { free(mStart); }
             ManagedBuffer(ManagedBuffer const& rhs) = delete;
             ManagedBuffer& operator=(ManagedBuffer const& rhs) = delete;
             void* data() const noexcept { return mStart; }
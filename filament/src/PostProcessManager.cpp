@@ -568,11 +568,15 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::ssr(FrameGraph& fg,
 FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(FrameGraph& fg,
         filament::Viewport const&, const CameraInfo& cameraInfo,
         FrameGraphId<FrameGraphTexture> depth,
-        AmbientOcclusionOptions const& options) noexcept {
+        AmbientOcclusionOptions const& options, float scale) noexcept {
     assert_invariant(depth);
 
     const size_t levelCount = fg.getDescriptor(depth).levels;
 
+    // The SSAO buffer can have a lower resolution than the structure buffer, in which case it
+    // needs a depth attachment of its own size, the structure buffer is still sampled.
+    const bool downscaled = scale < 1.0f;
+
     // With q the standard deviation,
     // A gaussian filter requires 6q-1 values to keep its gaussian nature
     // (see en.wikipedia.org/wiki/Gaussian_filter)
@@ -649,8 +653,8 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(
 
     const bool computeBentNormals = options.bentNormals;
 
-    const bool highQualityUpsampling =
-            options.upsampling >= QualityLevel::HIGH && options.resolution < 1.0f;
+    const bool highQualityUpsampling = options.upsampling >= QualityLevel::HIGH &&
+            (options.resolution < 1.0f || downscaled);
 
     const bool lowPassFilterEnabled = options.lowPassFilter != QualityLevel::LOW;
 
@@ -660,7 +664,7 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(
      * Vulkan. The Metal situation is unclear.
      * In this case, we need to duplicate the depth texture to use it as an attachment.
      * The pass below that does this is automatically culled if not needed, which is decided by
-     * each backend.
+     * each backend. It's also used to downscale the depth attachment.
      */
 
     struct DuplicateDepthPassData {
@@ -675,6 +679,8 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(
                         FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
                 auto desc = builder.getDescriptor(data.input);
                 desc.levels = 1; // only copy the base level
+                desc.width = std::max(1u, uint32_t(float(desc.width) * scale));
+                desc.height = std::max(1u, uint32_t(float(desc.height) * scale));
                 // create a new buffer for the copy
                 data.output = builder.createTexture("Depth Texture Copy", desc);
                 data.output = builder.write(data.output,
@@ -691,14 +697,15 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(
                         { resources.getTexture(data.input) }, {});
                 driver.blit(TargetBufferFlags::DEPTH,
                         out.target, out.params.viewport,
-                        inTarget, out.params.viewport,
+                        inTarget, { 0, 0, desc.width, desc.height },
                         SamplerMagFilter::NEAREST);
                 driver.destroyRenderTarget(inTarget);
             });
 
     auto& SSAOPass = fg.addPass<SSAOPassData>("SSAO Pass",
             [&](FrameGraph::Builder& builder, auto& data) {
-                auto const& desc = builder.getDescriptor(depth);
+                auto const& desc = builder.getDescriptor(downscaled ?
+                        duplicateDepthPass->output : depth);
 
                 data.depth = builder.sample(depth);
                 data.ssao = builder.createTexture("SSAO Buffer", {
@@ -726,7 +733,7 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(
                 // The bilateral filter in the blur pass will ignore pixels at infinity.
 
                 auto depthAttachment = data.depth;
-                if (!mWorkaroundAllowReadOnlyAncillaryFeedbackLoop) {
+                if (!mWorkaroundAllowReadOnlyAncillaryFeedbackLoop || downscaled) {
                     depthAttachment = duplicateDepthPass->output;
                 }
 
@@ -742,7 +749,8 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(
                     auto const& data, DriverApi& driver) {
                 auto depth = resources.getTexture(data.depth);
                 auto ssao = resources.getRenderPassInfo();
-                auto const& desc = resources.getDescriptor(data.depth);
+                // the effect is computed in pixels of the SSAO buffer
+                auto const& desc = resources.getDescriptor(data.ssao);
 
                 // estimate of the size in pixel of a 1m tall/wide object viewed from 1m away (i.e. at z=-1)
                 const float projectionScale = std::min(
@@ -829,12 +837,16 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(
      */
 
     if (lowPassFilterEnabled) {
-        ssao = bilateralBlurPass(fg, ssao, depth, { config.scale, 0 },
+        // the blur passes only use the depth as an attachment
+        FrameGraphId<FrameGraphTexture> const blurDepth =
+                downscaled ? duplicateDepthPass->output : depth;
+
+        ssao = bilateralBlurPass(fg, ssao, blurDepth, { config.scale, 0 },
                 cameraInfo.zf,
                 TextureFormat::RGB8,
                 config);
 
-        ssao = bilateralBlurPass(fg, ssao, depth, { 0, config.scale },
+        ssao = bilateralBlurPass(fg, ssao, blurDepth, { 0, config.scale },
                 cameraInfo.zf,
                 (highQualityUpsampling || computeBentNormals) ? TextureFormat::RGB8
                                                               : TextureFormat::R8,
@@ -107,11 +107,11 @@ public:
             ScreenSpaceReflectionsOptions const& options,
             FrameGraphTexture::Descriptor const& desc) noexcept;
 
-    // SSAO
+    // SSAO, scale is the resolution of the SSAO buffer relative to the structure buffer
     FrameGraphId<FrameGraphTexture> screenSpaceAmbientOcclusion(FrameGraph& fg,
             filament::Viewport const& svp, const CameraInfo& cameraInfo,
             FrameGraphId<FrameGraphTexture> structure,
-            AmbientOcclusionOptions const& options) noexcept;
+            AmbientOcclusionOptions const& options, float scale) noexcept;
 
     // Gaussian mipmap
     FrameGraphId<FrameGraphTexture> generateGaussianMipmap(FrameGraph& fg,
@@ -25,11 +25,16 @@
 
 #include <private/filament/UibStructs.h>
 
+#include <utils/FixedCapacityVector.h>
 #include <utils/JobSystem.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
+#include <limits>
 #include <utility>
 
+#include <string.h>
+
 using namespace utils;
 using namespace filament::math;
 
@@ -37,6 +42,13 @@ namespace filament {
 
 using namespace backend;
 
+// Returns a 10-bits hash of a primitive's geometry, used in place of the Z-bucket for draws that
+// can be instanced automatically.
+static inline uint32_t getGeometryBucket(Handle<HwRenderPrimitive> primitiveHandle) noexcept {
+    // fibonacci hashing, keep the 10 most significant bits
+    return (uint32_t(primitiveHandle.getId()) * 0x9E3779B1u) >> 22u;
+}
+
 RenderPass::RenderPass(FEngine& engine,
         RenderPass::Arena& arena) noexcept
         : mCommandArena(arena),
@@ -94,15 +106,23 @@ void RenderPass::appendCommands(FEngine& engine, CommandTypeFlags const commandT
     utils::Range<uint32_t> const vr = mVisibleRenderables;
     // trace the number of visible renderables
     SYSTRACE_VALUE32("visibleRenderables", vr.size());
-    if (UTILS_UNLIKELY(vr.empty())) {
-        return;
-    }
 
     JobSystem& js = engine.getJobSystem();
-    const RenderFlags renderFlags = mFlags;
+    const RenderFlags renderFlags = mFlags |
+            (engine.isAutomaticInstancingEnabled() ? HAS_AUTOMATIC_INSTANCING : 0);
     const Variant variant = mVariant;
     const FScene::VisibleMaskType visibilityMask = mVisibilityMask;
 
+    // this also resets the cache statistics, so do it even if there is nothing to draw
+    CommandCache* const cache = mCommandCache;
+    if (cache) {
+        cache->prepare(engine, commandTypeFlags, variant, renderFlags, visibilityMask);
+    }
+
+    if (UTILS_UNLIKELY(vr.empty())) {
+        return;
+    }
+
     // up-to-date summed primitive counts needed for generateCommands()
     FScene::RenderableSoa const& soa = *mRenderableSoa;
     updateSummedPrimitiveCounts(const_cast<FScene::RenderableSoa&>(soa), vr);
@@ -119,11 +139,11 @@ void RenderPass::appendCommands(FEngine& engine, CommandTypeFlags const commandT
     const float3 cameraPosition(mCameraPosition);
     const float3 cameraForwardVector(mCameraForwardVector);
     auto work = [commandTypeFlags, curr, &soa, variant, renderFlags, visibilityMask, cameraPosition,
-                 cameraForwardVector]
+                 cameraForwardVector, cache]
             (uint32_t startIndex, uint32_t indexCount) {
         RenderPass::generateCommands(commandTypeFlags, curr,
                 soa, { startIndex, startIndex + indexCount }, variant, renderFlags, visibilityMask,
-                cameraPosition, cameraForwardVector);
+                cameraPosition, cameraForwardVector, cache);
     };
 
     if (vr.size() <= JOBS_PARALLEL_FOR_COMMANDS_COUNT) {
@@ -172,21 +192,211 @@ void RenderPass::appendCustomCommand(uint8_t channel, Pass pass, CustomCommand c
 void RenderPass::sortCommands(FEngine& engine) noexcept {
     SYSTRACE_NAME("sort and trim commands");
 
-    std::sort(mCommandBegin, mCommandEnd);
+    size_t const count = size_t(mCommandEnd - mCommandBegin);
+
+    // The radix sort needs a scratch buffer, we take it from the command arena right after the
+    // commands, it is released by resize() below.
+    SortKey* scratch = nullptr;
+    if (count >= RADIX_SORT_MIN_COMMANDS_COUNT) {
+        size_t const scratchSize = count * 2 * sizeof(SortKey);
+        if (mCommandArena.getAllocator().available() >= scratchSize + CACHELINE_SIZE) {
+            scratch = mCommandArena.alloc<SortKey>(count * 2, CACHELINE_SIZE);
+        }
+    }
 
-    // find the last command
-    Command const* const last = std::partition_point(mCommandBegin, mCommandEnd,
-            [](Command const& c) {
-                return c.key != uint64_t(Pass::SENTINEL);
-            });
+    if (scratch) {
+        resize(radixSortCommands(engine.getJobSystem(), mCommandBegin, mCommandEnd, scratch));
+    } else {
+        std::sort(mCommandBegin, mCommandEnd);
 
-    resize(uint32_t(last - mCommandBegin));
+        // find the last command
+        Command const* const last = std::partition_point(mCommandBegin, mCommandEnd,
+                [](Command const& c) {
+                    return c.key != uint64_t(Pass::SENTINEL);
+                });
+
+        resize(uint32_t(last - mCommandBegin));
+    }
 
     if (engine.isAutomaticInstancingEnabled()) {
         instanceify(engine);
     }
 }
 
+size_t RenderPass::radixSortCommands(JobSystem& js,
+        Command* const first, Command* const last, SortKey* const scratch) noexcept {
+    SYSTRACE_CALL();
+
+    /*
+     * This is a least-significant-digit radix sort with 8-bits digits, specialized for our
+     * command keys:
+     * - sentinels are dropped, their slots are simply overwritten by the permutation.
+     * - digits that are the same for all keys are skipped. Because many fields of the key
+     *   are unused by most passes (e.g. the reserved bits, the channel, the priority, or the
+     *   z-bucket of a depth pass), we usually need far fewer than 8 passes.
+     * - if all keys are equal, we still do one pass, which compacts the output.
+     * Each pass is split in up to RADIX_SORT_MAX_JOBS blocks, each block computes a histogram
+     * of its digits in parallel, then all histograms are turned into output offsets and each
+     * block scatters its keys in parallel. Finally, the commands are permuted in place.
+     */
+
+    constexpr size_t RADIX_BITS = 8;
+    constexpr size_t RADIX = 1u << RADIX_BITS;
+    constexpr size_t DIGIT_COUNT = sizeof(CommandKey) * 8 / RADIX_BITS;
+
+    struct Block {
+        uint32_t begin;
+        uint32_t count;
+        CommandKey keyOr;
+        CommandKey keyAnd;
+    };
+
+    size_t const count = size_t(last - first);
+    // no point in having more blocks than threads, the calling thread participates too
+    size_t const blockCount = std::clamp(
+            std::min(count / RADIX_SORT_JOB_SIZE, js.getThreadCount() + 1),
+            size_t(1), RADIX_SORT_MAX_JOBS);
+    size_t const blockSize = (count + blockCount - 1) / blockCount;
+
+    Block blocks[RADIX_SORT_MAX_JOBS];
+    alignas(CACHELINE_SIZE) uint32_t histograms[RADIX_SORT_MAX_JOBS][RADIX];
+
+    SortKey* src = scratch;
+    SortKey* dst = scratch + count;
+
+    // runs work(b) for all blocks, in parallel when we have more than one.
+    auto forEachBlock = [&js, blockCount](auto const& work) {
+        auto jobWork = [&work](uint32_t start, uint32_t n) {
+            for (uint32_t b = start, e = start + n; b < e; b++) {
+                work(b);
+            }
+        };
+        if (blockCount == 1) {
+            jobWork(0, 1);
+        } else {
+            // 4 levels of splits give up to 16 jobs, i.e. one job per block
+            static_assert(RADIX_SORT_MAX_JOBS <= 16);
+            js.runAndWait(jobs::parallel_for(js, nullptr, 0, uint32_t(blockCount),
+                    std::cref(jobWork), jobs::CountSplitter<1, 4>()));
+        }
+    };
+
+    // Generate the SortKeys, each block writes its non-sentinel keys at the start of its
+    // range, so the first pass reads non-contiguous blocks.
+    forEachBlock([=, &blocks](uint32_t b) {
+        uint32_t const begin = uint32_t(std::min(b * blockSize, count));
+        uint32_t const end = uint32_t(std::min(begin + blockSize, count));
+        SortKey* const UTILS_RESTRICT out = src + begin;
+        CommandKey keyOr = 0;
+        CommandKey keyAnd = std::numeric_limits<CommandKey>::max();
+        uint32_t n = 0;
+        for (uint32_t i = begin; i < end; i++) {
+            CommandKey const key = first[i].key;
+            bool const isCommand = key != uint64_t(Pass::SENTINEL);
+            out[n] = { key, i, 0 };
+            n += isCommand;
+            keyOr |= select(isCommand, key);
+            keyAnd &= key | select(!isCommand);
+        }
+        blocks[b] = { begin, n, keyOr, keyAnd };
+    });
+
+    CommandKey keyOr = 0;
+    CommandKey keyAnd = std::numeric_limits<CommandKey>::max();
+    size_t commandCount = 0;
+    for (size_t b = 0; b < blockCount; b++) {
+        keyOr |= blocks[b].keyOr;
+        keyAnd &= blocks[b].keyAnd;
+        commandCount += blocks[b].count;
+    }
+
+    if (UTILS_UNLIKELY(commandCount == 0)) {
+        return 0;
+    }
+
+    // bits that are not the same in all keys
+    CommandKey const varying = keyOr ^ keyAnd;
+
+    for (size_t digit = 0; digit < DIGIT_COUNT; digit++) {
+        unsigned const shift = digit * RADIX_BITS;
+        bool const compactOnly = !varying && digit == DIGIT_COUNT - 1;
+        if (!((varying >> shift) & (RADIX - 1)) && !compactOnly) {
+            continue;
+        }
+
+        // histogram of this digit in each block
+        forEachBlock([=, &blocks, &histograms](uint32_t b) {
+            uint32_t* const UTILS_RESTRICT histogram = histograms[b];
+            std::fill_n(histogram, RADIX, 0);
+            SortKey const* const UTILS_RESTRICT in = src + blocks[b].begin;
+            for (size_t i = 0, c = blocks[b].count; i < c; i++) {
+                histogram[(in[i].key >> shift) & (RADIX - 1)]++;
+            }
+        });
+
+        // turn the histograms into output offsets, for a given digit, blocks are written in
+        // order, which keeps the sort stable.
+        uint32_t offset = 0;
+        for (size_t d = 0; d < RADIX; d++) {
+            for (size_t b = 0; b < blockCount; b++) {
+                uint32_t const c = histograms[b][d];
+                histograms[b][d] = offset;
+                offset += c;
+            }
+        }
+        assert_invariant(offset == commandCount);
+
+        // scatter each block's keys to their destination
+        forEachBlock([=, &blocks, &histograms](uint32_t b) {
+            uint32_t* const UTILS_RESTRICT offsets = histograms[b];
+            SortKey const* const UTILS_RESTRICT in = src + blocks[b].begin;
+            SortKey* const UTILS_RESTRICT out = dst;
+            for (size_t i = 0, c = blocks[b].count; i < c; i++) {
+                out[offsets[(in[i].key >> shift) & (RADIX - 1)]++] = in[i];
+            }
+        });
+
+        std::swap(src, dst);
+
+        // the next passes read the compacted output in equal sized blocks
+        size_t const size = (commandCount + blockCount - 1) / blockCount;
+        for (size_t b = 0; b < blockCount; b++) {
+            size_t const begin = std::min(b * size, commandCount);
+            blocks[b].begin = uint32_t(begin);
+            blocks[b].count = uint32_t(std::min(begin + size, commandCount) - begin);
+        }
+    }
+
+    // Permute the commands in place. We first compute the destination of each command
+    // (sentinels have none), then follow the chains of moves. A chain ends when it reaches a
+    // slot whose command has already been moved, or that holds a sentinel.
+    constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    uint32_t* const UTILS_RESTRICT destination = reinterpret_cast<uint32_t*>(dst);
+    std::fill_n(destination, count, NONE);
+    for (size_t i = 0; i < commandCount; i++) {
+        destination[src[i].index] = uint32_t(i);
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (destination[i] == NONE) {
+            continue;
+        }
+        Command temp = first[i];
+        uint32_t curr = uint32_t(i);
+        while (true) {
+            uint32_t const next = destination[curr];
+            destination[curr] = NONE;
+            if (destination[next] == NONE) {
+                first[next] = temp;
+                break;
+            }
+            std::swap(temp, first[next]);
+            curr = next;
+        }
+    }
+
+    return commandCount;
+}
+
 void RenderPass::execute(FEngine& engine, const char* name,
         backend::Handle<backend::HwRenderTarget> renderTarget,
         backend::RenderPassParams params) const noexcept {
@@ -203,45 +413,47 @@ void RenderPass::execute(FEngine& engine, const char* name,
     driver.endRenderPass();
 }
 
-void RenderPass::instanceify(FEngine& engine) noexcept {
-    SYSTRACE_NAME("instanceify");
-
+uint32_t RenderPass::instanceifyCommands(Command* const first, Command* const last,
+        uint32_t* const instances) noexcept {
     // instanceify works by scanning the **sorted** command stream, looking for repeat draw
     // commands. When one is found, it is replaced by an instanced command.
     // A "repeat" draw is one that ends-up using the same draw parameters and state.
-    // Currently, this relies somewhat on luck that "repeat draws" are found consecutively,
-    // we could improve this by including some or all of these "repeat" parameters in the
-    // sorting key (e.g. raster state, primitive handle, etc...), the key could even use a small
-    // hash of those parameters.
-
-    UTILS_UNUSED uint32_t drawCallsSavedCount = 0;
+    // "Repeat draws" are found consecutively because, when automatic instancing is enabled,
+    // the sorting key of draws that can be instanced holds a hash of their geometry
+    // instead of their Z-bucket (see generateCommandsImpl()). Raster state is not part of the
+    // key, but it is almost always the same for a given material instance.
 
-    Command* curr = mCommandBegin;
-    Command* const last = mCommandEnd;
-
-    Command* firstSentinel = nullptr;
-    PerRenderableData const* uboData = nullptr;
-    PerRenderableData* stagingBuffer = nullptr;
-    uint32_t stagingBufferSize = 0;
-    uint32_t instancedPrimitiveOffset = 0;
+    Command* curr = first;
+    uint32_t instanceOffset = 0;
 
     // TODO: for the case of instancing we could actually use 128 instead of 64 instances
     constexpr size_t maxInstanceCount = CONFIG_MAX_INSTANCES;
 
     while (curr != last) {
 
+        // custom commands and draws that already use instancing can't be instanced
+        bool const instanceable =
+                (curr->key & CUSTOM_MASK) == uint64_t(CustomCommand::PASS) &&
+                curr->primitive.instanceCount == (1u | PrimitiveInfo::USER_INSTANCE_MASK) &&
+                !curr->primitive.instanceBufferHandle;
+
         // we can't have nice things! No more than maxInstanceCount due to UBO size limits
-        Command const* const e = std::find_if_not(curr, std::min(last, curr + maxInstanceCount),
+        Command const* const e = !instanceable ? curr + 1 :
+                std::find_if_not(curr, std::min(last, curr + maxInstanceCount),
                 [lhs = *curr](Command const& rhs) {
             // primitives must be identical to be instanced. Currently, instancing doesn't support
             // skinning/morphing.
-            return  lhs.primitive.mi                == rhs.primitive.mi                 &&
-                    lhs.primitive.primitiveHandle   == rhs.primitive.primitiveHandle    &&
-                    lhs.primitive.rasterState       == rhs.primitive.rasterState        &&
-                    lhs.primitive.skinningHandle    == rhs.primitive.skinningHandle     &&
-                    lhs.primitive.skinningOffset    == rhs.primitive.skinningOffset     &&
-                    lhs.primitive.morphWeightBuffer == rhs.primitive.morphWeightBuffer  &&
-                    lhs.primitive.morphTargetBuffer == rhs.primitive.morphTargetBuffer;
+            return  (rhs.key & CUSTOM_MASK) == uint64_t(CustomCommand::PASS) &&
+                    lhs.primitive.instanceCount        == rhs.primitive.instanceCount        &&
+                    lhs.primitive.instanceBufferHandle == rhs.primitive.instanceBufferHandle &&
+                    lhs.primitive.materialVariant      == rhs.primitive.materialVariant      &&
+                    lhs.primitive.mi                   == rhs.primitive.mi                   &&
+                    lhs.primitive.primitiveHandle      == rhs.primitive.primitiveHandle      &&
+                    lhs.primitive.rasterState          == rhs.primitive.rasterState          &&
+                    lhs.primitive.skinningHandle       == rhs.primitive.skinningHandle       &&
+                    lhs.primitive.skinningOffset       == rhs.primitive.skinningOffset       &&
+                    lhs.primitive.morphWeightBuffer    == rhs.primitive.morphWeightBuffer    &&
+                    lhs.primitive.morphTargetBuffer    == rhs.primitive.morphTargetBuffer;
         });
 
         uint32_t const instanceCount = e - curr;
@@ -249,32 +461,17 @@ void RenderPass::instanceify(FEngine& engine) noexcept {
         assert_invariant(instanceCount <= CONFIG_MAX_INSTANCES);
 
         if (UTILS_UNLIKELY(instanceCount > 1)) {
-            drawCallsSavedCount += instanceCount - 1;
-
-            // allocate our staging buffer only if needed
-            if (UTILS_UNLIKELY(!stagingBuffer)) {
-                // TODO: use stream inline buffer for small sizes
-                // TODO: use a pool for larger heap buffers
-                // buffer large enough for all instances data
-                stagingBufferSize = sizeof(PerRenderableData) * (last - curr);
-                stagingBuffer = (PerRenderableData*)::malloc(stagingBufferSize);
-                uboData = mRenderableSoa->data<FScene::UBO>();
-            }
-
-            // copy the ubo data to a staging buffer
-            assert_invariant(instancedPrimitiveOffset + instanceCount
-                             <= stagingBufferSize / sizeof(PerRenderableData));
+            // remember where the data of each instance comes from
             for (uint32_t i = 0; i < instanceCount; i++) {
-                stagingBuffer[instancedPrimitiveOffset + i] = uboData[curr[i].primitive.index];
+                instances[instanceOffset + i] = curr[i].primitive.index;
             }
 
             // make the first command instanced
             curr[0].primitive.instanceCount = instanceCount;
-            curr[0].primitive.index = instancedPrimitiveOffset;
-            instancedPrimitiveOffset += instanceCount;
+            curr[0].primitive.index = instanceOffset;
+            instanceOffset += instanceCount;
 
             // cancel commands that are now instances
-            firstSentinel = !firstSentinel ? curr : firstSentinel;
             for (uint32_t i = 1; i < instanceCount; i++) {
                 curr[i].key = uint64_t(Pass::SENTINEL);
             }
@@ -283,38 +480,70 @@ void RenderPass::instanceify(FEngine& engine) noexcept {
         curr = const_cast<Command*>(e);
     }
 
-    if (UTILS_UNLIKELY(firstSentinel)) {
-        //slog.d << "auto-instancing, saving " << drawCallsSavedCount << " draw calls, out of "
-        //       << mCommandEnd - mCommandBegin << io::endl;
+    return instanceOffset;
+}
+
+void RenderPass::instanceify(FEngine& engine) noexcept {
+    SYSTRACE_NAME("instanceify");
 
+    size_t const count = size_t(mCommandEnd - mCommandBegin);
+    if (count < 2) {
+        return;
+    }
+
+    // The instances' indices are allocated from the command arena right after the commands if
+    // there is room, they're released by resize() below.
+    uint32_t* instances = nullptr;
+    bool const heapAllocated =
+            mCommandArena.getAllocator().available() < count * sizeof(uint32_t) + CACHELINE_SIZE;
+    if (UTILS_UNLIKELY(heapAllocated)) {
+        instances = (uint32_t*)::malloc(count * sizeof(uint32_t));
+    } else {
+        instances = mCommandArena.alloc<uint32_t>(count, CACHELINE_SIZE);
+    }
+
+    uint32_t const instanceCount = instanceifyCommands(mCommandBegin, mCommandEnd, instances);
+
+    if (UTILS_UNLIKELY(instanceCount)) {
         // we have instanced primitives
         DriverApi& driver = engine.getDriverApi();
 
+        // TODO: use stream inline buffer for small sizes
+        // TODO: use a pool for larger heap buffers
+        PerRenderableData* const stagingBuffer =
+                (PerRenderableData*)::malloc(sizeof(PerRenderableData) * instanceCount);
+        PerRenderableData const* const uboData = mRenderableSoa->data<FScene::UBO>();
+        for (uint32_t i = 0; i < instanceCount; i++) {
+            stagingBuffer[i] = uboData[instances[i]];
+        }
+
         // TODO: maybe use a pool? so we can reuse the buffer.
         // create a ubo to hold the instanced primitive data
         mInstancedUboHandle = driver.createBufferObject(
-                sizeof(PerRenderableData) * instancedPrimitiveOffset + sizeof(PerRenderableUib),
+                sizeof(PerRenderableData) * instanceCount + sizeof(PerRenderableUib),
                 BufferObjectBinding::UNIFORM, backend::BufferUsage::STATIC);
 
         // copy our instanced ubo data
         driver.updateBufferObjectUnsynchronized(mInstancedUboHandle, {
-                stagingBuffer, sizeof(PerRenderableData) * instancedPrimitiveOffset,
+                stagingBuffer, sizeof(PerRenderableData) * instanceCount,
                 +[](void* buffer, size_t, void*) {
                     ::free(buffer);
                 }
         }, 0);
+    }
 
-        stagingBuffer = nullptr;
+    if (UTILS_UNLIKELY(heapAllocated)) {
+        ::free(instances);
+    }
 
-        // remove all the canceled commands
-        auto lastCommand = std::remove_if(firstSentinel, mCommandEnd, [](auto const& command) {
+    // remove all the canceled commands, this also releases the instances' indices
+    auto lastCommand = mCommandEnd;
+    if (UTILS_UNLIKELY(instanceCount)) {
+        lastCommand = std::remove_if(mCommandBegin, mCommandEnd, [](auto const& command) {
             return command.key == uint64_t(Pass::SENTINEL);
         });
-
-        resize(uint32_t(lastCommand - mCommandBegin));
     }
-
-    assert_invariant(stagingBuffer == nullptr);
+    resize(uint32_t(lastCommand - mCommandBegin));
 }
 
 
@@ -374,7 +603,7 @@ void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const comm
         FScene::RenderableSoa const& soa, Range<uint32_t> range,
         Variant variant, RenderFlags renderFlags,
         FScene::VisibleMaskType visibilityMask,
-        float3 cameraPosition, float3 cameraForward) noexcept {
+        float3 cameraPosition, float3 cameraForward, CommandCache* cache) noexcept {
 
     SYSTRACE_CALL();
 
@@ -405,11 +634,13 @@ void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const comm
     switch (commandTypeFlags & (CommandTypeFlags::COLOR | CommandTypeFlags::DEPTH)) {
         case CommandTypeFlags::COLOR:
             curr = generateCommandsImpl<CommandTypeFlags::COLOR>(commandTypeFlags, curr,
-                    soa, range, variant, renderFlags, visibilityMask, cameraPosition, cameraForward);
+                    soa, range, variant, renderFlags, visibilityMask, cameraPosition, cameraForward,
+                    cache);
             break;
         case CommandTypeFlags::DEPTH:
             curr = generateCommandsImpl<CommandTypeFlags::DEPTH>(commandTypeFlags, curr,
-                    soa, range, variant, renderFlags, visibilityMask, cameraPosition, cameraForward);
+                    soa, range, variant, renderFlags, visibilityMask, cameraPosition, cameraForward,
+                    cache);
             break;
         default:
             // we should never end-up here
@@ -432,7 +663,7 @@ RenderPass::Command* RenderPass::generateCommandsImpl(uint32_t extraFlags,
         Command* UTILS_RESTRICT curr,
         FScene::RenderableSoa const& UTILS_RESTRICT soa, Range<uint32_t> range,
         Variant const variant, RenderFlags renderFlags, FScene::VisibleMaskType visibilityMask,
-        float3 cameraPosition, float3 cameraForward) noexcept {
+        float3 cameraPosition, float3 cameraForward, CommandCache* cache) noexcept {
 
     // generateCommands() writes both the draw and depth commands simultaneously such that
     // we go throw the list of renderables just once.
@@ -455,9 +686,11 @@ RenderPass::Command* RenderPass::generateCommandsImpl(uint32_t extraFlags,
     auto const* const UTILS_RESTRICT soaMorphing            = soa.data<FScene::MORPHING_BUFFER>();
     auto const* const UTILS_RESTRICT soaVisibilityMask      = soa.data<FScene::VISIBLE_MASK>();
     auto const* const UTILS_RESTRICT soaInstanceInfo        = soa.data<FScene::INSTANCES>();
+    auto const* const UTILS_RESTRICT soaRenderableInstance  = soa.data<FScene::RENDERABLE_INSTANCE>();
 
     const bool hasShadowing = renderFlags & HAS_SHADOWING;
     const bool viewInverseFrontFaces = renderFlags & HAS_INVERSE_FRONT_FACES;
+    const bool hasAutomaticInstancing = renderFlags & HAS_AUTOMATIC_INSTANCING;
 
     Command cmdColor;
 
@@ -473,6 +706,9 @@ RenderPass::Command* RenderPass::generateCommandsImpl(uint32_t extraFlags,
 
     const float cameraPositionDotCameraForward = dot(cameraPosition, cameraForward);
 
+    uint32_t cacheHitCount = 0;
+    uint32_t cacheMissCount = 0;
+
     for (uint32_t i = range.first; i < range.last; ++i) {
         // Check if this renderable passes the visibilityMask.
         if (UTILS_UNLIKELY(!(soaVisibilityMask[i] & visibilityMask))) {
@@ -510,11 +746,29 @@ RenderPass::Command* RenderPass::generateCommandsImpl(uint32_t extraFlags,
         distance = -distance;
         const uint32_t distanceBits = reinterpret_cast<uint32_t&>(distance);
 
+        // reuse the commands from the previous frames if this renderable didn't change
+        CommandCache::Entry* const cacheEntry =
+                cache ? cache->get(soaRenderableInstance[i]) : nullptr;
+        if (cacheEntry && cache->isValid(*cacheEntry, soaRenderableInstance[i],
+                soaVisibility[i], soaPrimitives[i])) {
+            curr = CommandCache::restore(*cacheEntry, curr, i, distanceBits);
+            cacheHitCount++;
+            continue;
+        }
+        Command const* const first = curr;
+
         // calculate the per-primitive face winding order inversion
         const bool inverseFrontFaces = viewInverseFrontFaces ^ soaVisibility[i].reversedWindingOrder;
         const bool hasMorphing = soaVisibility[i].morphing;
         const bool hasSkinningOrMorphing = soaVisibility[i].skinning || hasMorphing;
 
+        // Only draws that don't use instancing already and aren't skinned or morphed can be
+        // instanced automatically. For those, we sort by geometry instead of by depth, so that
+        // identical draws are consecutive.
+        const bool instanceable = hasAutomaticInstancing && !hasSkinningOrMorphing &&
+                soaInstanceInfo[i].count == 1 && !soaInstanceInfo[i].handle;
+        const uint32_t depthBucket = distanceBits >> 22u;
+
         cmdColor.key = makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
         cmdColor.key |= makeField(soaVisibility[i].channel, CHANNEL_MASK, CHANNEL_SHIFT);
         cmdColor.primitive.index = (uint16_t)i;
@@ -534,7 +788,6 @@ RenderPass::Command* RenderPass::generateCommandsImpl(uint32_t extraFlags,
             cmdDepth.key |= uint64_t(CustomCommand::PASS);
             cmdDepth.key |= makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
             cmdDepth.key |= makeField(soaVisibility[i].channel, CHANNEL_MASK, CHANNEL_SHIFT);
-            cmdDepth.key |= makeField(distanceBits >> 22u, Z_BUCKET_MASK, Z_BUCKET_SHIFT);
             cmdDepth.primitive.index = (uint16_t)i;
             cmdDepth.primitive.instanceCount =
                     soaInstanceInfo[i].count | PrimitiveInfo::USER_INSTANCE_MASK;
@@ -591,6 +844,8 @@ RenderPass::Command* RenderPass::generateCommandsImpl(uint32_t extraFlags,
                     // write blend order
                     cmdColor.key |= makeField(primitive.getBlendOrder(),
                             BLEND_ORDER_MASK, BLEND_ORDER_SHIFT);
+                    cmdColor.distanceMask = select(!primitive.isGlobalBlendOrderEnabled(),
+                            BLEND_DISTANCE_MASK);
 
 
                     const TransparencyMode mode = mi->getTransparencyMode();
@@ -646,7 +901,10 @@ RenderPass::Command* RenderPass::generateCommandsImpl(uint32_t extraFlags,
                     // in each buckets. We use the top 10 bits of the distance, which
                     // bucketizes the depth by its log2 and in 4 linear chunks in each bucket.
                     cmdColor.key &= ~Z_BUCKET_MASK;
-                    cmdColor.key |= makeField(distanceBits >> 22u, Z_BUCKET_MASK, Z_BUCKET_SHIFT);
+                    cmdColor.key |= makeField(instanceable ?
+                            getGeometryBucket(cmdColor.primitive.primitiveHandle) : depthBucket,
+                            Z_BUCKET_MASK, Z_BUCKET_SHIFT);
+                    cmdColor.distanceMask = select(!instanceable, Z_BUCKET_MASK);
                 }
 
                 *curr = cmdColor;
@@ -664,10 +922,15 @@ RenderPass::Command* RenderPass::generateCommandsImpl(uint32_t extraFlags,
                 const bool translucent = (blendingMode != BlendingMode::OPAQUE
                         && blendingMode != BlendingMode::MASKED);
 
-                cmdDepth.key |= mi->getSortingKey(); // already all set-up for direct or'ing
-
                 // unconditionally write the command
                 cmdDepth.primitive.primitiveHandle = primitive.getHwHandle();
+
+                cmdDepth.key &= ~(Z_BUCKET_MASK | MATERIAL_MASK);
+                cmdDepth.key |= mi->getSortingKey(); // already all set-up for direct or'ing
+                cmdDepth.key |= makeField(instanceable ?
+                        getGeometryBucket(cmdDepth.primitive.primitiveHandle) : depthBucket,
+                        Z_BUCKET_MASK, Z_BUCKET_SHIFT);
+                cmdDepth.distanceMask = select(!instanceable, Z_BUCKET_MASK);
                 cmdDepth.primitive.mi = mi;
                 cmdDepth.primitive.rasterState.culling = mi->getCullingMode();
 
@@ -691,6 +954,17 @@ RenderPass::Command* RenderPass::generateCommandsImpl(uint32_t extraFlags,
                 ++curr;
             }
         }
+
+        if (cacheEntry) {
+            cache->store(*cacheEntry, soaRenderableInstance[i],
+                    soaVisibility[i], soaPrimitives[i], first, curr);
+            cacheMissCount++;
+        }
+    }
+
+    if (cache) {
+        cache->mHitCount.fetch_add(cacheHitCount, std::memory_order_relaxed);
+        cache->mMissCount.fetch_add(cacheMissCount, std::memory_order_relaxed);
     }
     return curr;
 }
@@ -710,6 +984,97 @@ void RenderPass::updateSummedPrimitiveCounts(
 
 // ------------------------------------------------------------------------------------------------
 
+static uint16_t toBits(FRenderableManager::Visibility visibility) noexcept {
+    uint16_t bits;
+    static_assert(sizeof(bits) == sizeof(visibility));
+    memcpy(&bits, &visibility, sizeof(bits));
+    return bits;
+}
+
+RenderPass::CommandCache::CommandCache() noexcept = default;
+
+RenderPass::CommandCache::~CommandCache() noexcept = default;
+
+void RenderPass::CommandCache::clear() noexcept {
+    mEntries.clear();
+    mEntries.shrink_to_fit();
+}
+
+void RenderPass::CommandCache::prepare(FEngine& engine, uint32_t commandTypeFlags,
+        Variant variant, RenderFlags renderFlags,
+        FScene::VisibleMaskType visibilityMask) noexcept {
+    uint32_t const materialInstanceStateGeneration = engine.getMaterialInstanceStateGeneration();
+    if (commandTypeFlags != mCommandTypeFlags || variant != mVariant ||
+            renderFlags != mRenderFlags || visibilityMask != mVisibilityMask ||
+            materialInstanceStateGeneration != mMaterialInstanceStateGeneration) {
+        // the cached commands were built for a different configuration, we just need to
+        // invalidate the entries, not to free their commands.
+        for (Entry& entry : mEntries) {
+            entry.generation = 0;
+        }
+        mCommandTypeFlags = commandTypeFlags;
+        mVariant = variant;
+        mRenderFlags = renderFlags;
+        mVisibilityMask = visibilityMask;
+        mMaterialInstanceStateGeneration = materialInstanceStateGeneration;
+    }
+
+    // we need an entry for each possible renderable instance, instance 0 is never used.
+    FRenderableManager const& rcm = engine.getRenderableManager();
+    mRenderableManager = &rcm;
+    mEntries.resize(rcm.getComponentCount() + 1);
+
+    mHitCount.store(0, std::memory_order_relaxed);
+    mMissCount.store(0, std::memory_order_relaxed);
+}
+
+bool RenderPass::CommandCache::isValid(Entry const& entry, FRenderableManager::Instance ri,
+        FRenderableManager::Visibility visibility,
+        Slice<FRenderPrimitive> const& primitives) const noexcept {
+    // Generations are unique, so this also catches instances reused by another renderable.
+    // The visibility is checked because some of its fields are computed by the scene
+    // (e.g. the winding order depends on the transform).
+    return entry.generation == mRenderableManager->getGeneration(ri) &&
+           entry.primitives == primitives.data() &&
+           entry.primitiveCount == primitives.size() &&
+           entry.visibility == toBits(visibility);
+}
+
+RenderPass::Command* RenderPass::CommandCache::restore(Entry const& entry,
+        Command* UTILS_RESTRICT curr, uint32_t index, uint32_t distanceBits) noexcept {
+    // these must match generateCommandsImpl()
+    CommandKey const zBucket = makeField(distanceBits >> 22u, Z_BUCKET_MASK, Z_BUCKET_SHIFT);
+    CommandKey const blendDistance = makeField(~distanceBits,
+            BLEND_DISTANCE_MASK, BLEND_DISTANCE_SHIFT);
+    for (Command const& command : entry.commands) {
+        *curr = command;
+        curr->key |= (command.distanceMask == BLEND_DISTANCE_MASK ? blendDistance : zBucket) &
+                command.distanceMask;
+        curr->primitive.index = (uint16_t)index;
+        ++curr;
+    }
+    return curr;
+}
+
+void RenderPass::CommandCache::store(Entry& entry, FRenderableManager::Instance ri,
+        FRenderableManager::Visibility visibility,
+        Slice<FRenderPrimitive> const& primitives,
+        Command const* first, Command const* last) const noexcept {
+    entry.generation = mRenderableManager->getGeneration(ri);
+    entry.primitives = primitives.data();
+    entry.primitiveCount = uint32_t(primitives.size());
+    entry.visibility = toBits(visibility);
+    entry.commands.assign(first, last);
+    for (Command& command : entry.commands) {
+        // remove the distance from the cached keys, but leave canceled commands alone
+        if (command.key != uint64_t(Pass::SENTINEL)) {
+            command.key &= ~command.distanceMask;
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+
 void RenderPass::Executor::overridePolygonOffset(backend::PolygonOffset const* polygonOffset) noexcept {
     if ((mPolygonOffsetOverride = (polygonOffset != nullptr))) {
         mPolygonOffset = *polygonOffset;
@@ -728,7 +1093,7 @@ void RenderPass::Executor::overrideScissor(backend::Viewport const& scissor) noe
 }
 
 void RenderPass::Executor::execute(FEngine& engine, const char*) const noexcept {
-    execute(engine.getDriverApi(), mCommands.begin(), mCommands.end());
+    execute(engine.getJobSystem(), engine.getDriverApi(), mCommands.begin(), mCommands.end());
 }
 
 UTILS_NOINLINE // no need to be inlined
@@ -736,10 +1101,89 @@ void RenderPass::Executor::execute(backend::DriverApi& driver,
         const Command* first, const Command* last) const noexcept {
     SYSTRACE_CALL();
     SYSTRACE_CONTEXT();
+    SYSTRACE_VALUE32("commandCount", last - first);
 
-    if (first != last) {
-        SYSTRACE_VALUE32("commandCount", last - first);
+    recordCommands(driver, first, last);
+
+    if (mInstancedUboHandle) {
+        driver.destroyBufferObject(mInstancedUboHandle);
+    }
+}
+
+UTILS_NOINLINE // no need to be inlined
+void RenderPass::Executor::execute(JobSystem& js, backend::DriverApi& driver,
+        const Command* first, const Command* last) const noexcept {
+    // Sub-streams are not captured, so commands must be recorded serially while capturing.
+    // Debug commands call into the driver (e.g. to log or trace) as they're recorded, which
+    // isn't thread-safe, so they're recorded serially as well.
+    constexpr bool debugCommands = FILAMENT_DEBUG_COMMANDS > FILAMENT_DEBUG_COMMANDS_NONE;
+    if (debugCommands || size_t(last - first) < RECORDING_MIN_COMMANDS_COUNT ||
+            !js.getThreadCount() || driver.isCapturingCommands()) {
+        execute(driver, first, last);
+        return;
+    }
+
+    SYSTRACE_CALL();
+    SYSTRACE_CONTEXT();
+    SYSTRACE_VALUE32("commandCount", last - first);
+
+    while (first != last) {
+        // custom commands are recorded by this thread, between the parallel parts, because
+        // they use the engine's DriverApi directly.
+        Command const* custom = std::find_if(first, last, [](Command const& command) {
+            return (command.key & CUSTOM_MASK) != uint64_t(CustomCommand::PASS);
+        });
+        recordCommandsParallel(js, driver, first, custom);
+        if (custom != last) {
+            recordCommands(driver, custom, custom + 1);
+            ++custom;
+        }
+        first = custom;
+    }
+
+    if (mInstancedUboHandle) {
+        driver.destroyBufferObject(mInstancedUboHandle);
+    }
+}
+
+void RenderPass::Executor::recordCommandsParallel(JobSystem& js, backend::DriverApi& driver,
+        const Command* first, const Command* last) const noexcept {
+    size_t const count = last - first;
+    size_t const jobCount = std::min({ count / RECORDING_JOB_SIZE,
+            size_t(js.getThreadCount() + 1), RECORDING_MAX_JOBS });
+    if (count < RECORDING_MIN_COMMANDS_COUNT || jobCount <= 1) {
+        recordCommands(driver, first, last);
+        return;
+    }
 
+    SYSTRACE_CALL();
+
+    // each job records its commands in its own sub-stream, which are then stitched together
+    // in order. Sub-streams are large (they have a copy of the Dispatcher), so they're not on
+    // the stack.
+    driver.fork();
+    auto subStreams = FixedCapacityVector<backend::DriverApi>::with_capacity(jobCount);
+    backend::DriverApi* subStreamPointers[RECORDING_MAX_JOBS];
+    for (size_t i = 0; i < jobCount; i++) {
+        subStreamPointers[i] = &subStreams.emplace_back(&driver);
+    }
+
+    JobSystem::Job* parent = js.createJob();
+    for (size_t i = 0; i < jobCount; i++) {
+        Command const* const b = first + count * i / jobCount;
+        Command const* const e = first + count * (i + 1) / jobCount;
+        js.run(jobs::createJob(js, parent, [this, subStream = subStreamPointers[i], b, e]() {
+            recordCommands(*subStream, b, e);
+        }));
+    }
+    js.runAndWait(parent);
+
+    driver.join(subStreamPointers, jobCount);
+}
+
+void RenderPass::Executor::recordCommands(backend::DriverApi& driver,
+        const Command* first, const Command* last) const noexcept {
+    if (first != last) {
         PipelineState pipeline{
                 .polygonOffset = mPolygonOffset,
                 .scissor = mScissor
@@ -871,11 +1315,6 @@ void RenderPass::Executor::execute(backend::DriverApi& driver,
             driver.draw(pipeline, info.primitiveHandle, instanceCount);
         }
     }
-
-    if (mInstancedUboHandle) {
-        driver.destroyBufferObject(mInstancedUboHandle);
-    }
-
 }
 
 // ------------------------------------------------------------------------------------------------
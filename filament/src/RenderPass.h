@@ -35,10 +35,15 @@
 #include <utils/compiler.h>
 #include <utils/debug.h>
 
+#include <atomic>
 #include <functional>
 #include <limits>
 #include <vector>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 
 class FMaterialInstance;
@@ -57,8 +62,9 @@ public:
      *   0     = reserved, must be zero
      *
      *
-     * TODO: we need to add a "primitive id" in the low-bits of material-id, so that
-     *       auto-instancing can work better
+     * When automatic instancing is enabled, the Z-bucket of DEPTH and COLOR commands that can
+     * be instanced is replaced by a hash of their geometry, so that identical draws end-up
+     * next to each other after sorting.
      *
      *   DEPTH command (b00)
      *   |  |  | 2| 2| 2|1| 3 | 2|  6   |   10     |               32               |
@@ -249,7 +255,7 @@ public:
     struct alignas(8) Command {     // 64 bytes
         CommandKey key = 0;         //  8 bytes
         PrimitiveInfo primitive;    // 48 bytes
-        uint64_t reserved[1] = {};  //  8 bytes
+        CommandKey distanceMask = 0;//  8 bytes, key bits that depend on the camera distance
         bool operator < (Command const& rhs) const noexcept { return key < rhs.key; }
         // placement new declared as "throw" to avoid the compiler's null-check
         inline void* operator new (std::size_t, void* ptr) {
@@ -261,9 +267,19 @@ public:
     static_assert(std::is_trivially_destructible_v<Command>,
             "Command isn't trivially destructible");
 
+    // Sorting proxy for a Command, this allows to sort the keys without moving the payload
+    struct alignas(8) SortKey {     // 16 bytes
+        CommandKey key;             //  8 bytes
+        uint32_t index;             //  4 bytes
+        uint32_t reserved;          //  4 bytes
+    };
+    static_assert(sizeof(SortKey) == 16);
+
     using RenderFlags = uint8_t;
     static constexpr RenderFlags HAS_SHADOWING           = 0x01;
     static constexpr RenderFlags HAS_INVERSE_FRONT_FACES = 0x02;
+    // set internally when the Engine has automatic instancing enabled
+    static constexpr RenderFlags HAS_AUTOMATIC_INSTANCING = 0x04;
 
     // Arena used for commands
     using Arena = utils::Arena<
@@ -272,6 +288,82 @@ public:
             utils::TrackingPolicy::HighWatermark,
             utils::AreaPolicy::StaticArea>;
 
+    /*
+     * Cache of the commands generated for each renderable, kept across frames.
+     * Commands of renderables that didn't change since they were cached are copied from the
+     * cache, only the fields that depend on the distance to the camera are updated.
+     * A renderable's cached commands are invalidated when the renderable changes (its
+     * primitives, material instances, visibility, etc...), and the whole cache is cleared when
+     * it's used with a different configuration (variant, flags) or when a MaterialInstance
+     * state baked into the commands changes (e.g. culling mode).
+     * A CommandCache is meant to be used by a single RenderPass each frame.
+     */
+    class CommandCache {
+    public:
+        struct Stats {
+            uint32_t hits = 0;      // renderables whose commands came from the cache
+            uint32_t misses = 0;    // renderables whose commands had to be generated
+        };
+
+        CommandCache() noexcept;
+        CommandCache(CommandCache const& rhs) = delete;
+        CommandCache& operator=(CommandCache const& rhs) = delete;
+        ~CommandCache() noexcept;
+
+        // drops all cached commands and frees the memory used by the cache
+        void clear() noexcept;
+
+        // statistics of the last RenderPass::appendCommands() that used this cache
+        Stats getStats() const noexcept {
+            return { mHitCount.load(std::memory_order_relaxed),
+                     mMissCount.load(std::memory_order_relaxed) };
+        }
+
+    private:
+        friend class RenderPass;
+
+        struct Entry {
+            uint64_t generation = 0;    // RenderableManager generation when the entry was built
+            FRenderPrimitive const* primitives = nullptr;  // level-of-detail'ed primitives
+            uint32_t primitiveCount = 0;
+            uint16_t visibility = 0;    // FRenderableManager::Visibility
+            std::vector<Command> commands;
+        };
+
+        // must be called before generating commands, clears the cache if needed
+        void prepare(FEngine& engine, uint32_t commandTypeFlags, Variant variant,
+                RenderFlags renderFlags, FScene::VisibleMaskType visibilityMask) noexcept;
+
+        // returns the cache entry of a renderable
+        Entry* get(FRenderableManager::Instance ri) noexcept {
+            return &mEntries[ri.asValue()];
+        }
+
+        bool isValid(Entry const& entry, FRenderableManager::Instance ri,
+                FRenderableManager::Visibility visibility,
+                utils::Slice<FRenderPrimitive> const& primitives) const noexcept;
+
+        // writes the cached commands of a renderable to curr, returns the new curr
+        static Command* restore(Entry const& entry, Command* curr,
+                uint32_t index, uint32_t distanceBits) noexcept;
+
+        // stores the commands [first, last) of a renderable
+        void store(Entry& entry, FRenderableManager::Instance ri,
+                FRenderableManager::Visibility visibility,
+                utils::Slice<FRenderPrimitive> const& primitives,
+                Command const* first, Command const* last) const noexcept;
+
+        FRenderableManager const* mRenderableManager = nullptr;
+        std::vector<Entry> mEntries;    // indexed by RenderableManager instance
+        uint32_t mCommandTypeFlags = 0;
+        Variant mVariant{};
+        RenderFlags mRenderFlags = 0;
+        FScene::VisibleMaskType mVisibilityMask = 0;
+        uint32_t mMaterialInstanceStateGeneration = 0;
+        std::atomic<uint32_t> mHitCount{};
+        std::atomic<uint32_t> mMissCount{};
+    };
+
     /*
      * Create a RenderPass.
      * The Arena is used to allocate commands which are then owned by the Arena.
@@ -307,6 +399,10 @@ public:
     // Defaults to all 1's, which means all renderables in this render pass will be rendered.
     void setVisibilityMask(FScene::VisibleMaskType mask) noexcept { mVisibilityMask = mask; }
 
+    // Sets a cache used by appendCommands() to reuse the commands of renderables that didn't
+    // change since the last frame. The cache must outlive this RenderPass.
+    void setCommandCache(CommandCache* cache) noexcept { mCommandCache = cache; }
+
     Command const* begin() const noexcept { return mCommandBegin; }
     Command const* end() const noexcept { return mCommandEnd; }
     bool empty() const noexcept { return begin() == end(); }
@@ -318,6 +414,27 @@ public:
     // sorts and instanceify commands then trims sentinels
     void sortCommands(FEngine& engine) noexcept;
 
+    /*
+     * Sorts the commands in [first, last) by key using a parallel LSD radix sort on SortKey
+     * proxies, and moves each command only once, to its final position.
+     * On return, the non-sentinel commands are sorted at the beginning of the range, the content
+     * of the rest of the range is undefined. Returns the number of non-sentinel commands.
+     * scratch must have room for 2 * (last - first) SortKeys.
+     */
+    static size_t radixSortCommands(utils::JobSystem& js,
+            Command* first, Command* last, SortKey* scratch) noexcept;
+
+    /*
+     * Finds runs of identical draw commands in the sorted range [first, last), that can be
+     * replaced by a single instanced draw. The first command of each run becomes an
+     * automatically instanced draw, whose primitive.index is the offset of its first instance;
+     * the other commands of the run become sentinels.
+     * The primitive.index of each instance is written to instances, which must have room for
+     * (last - first) entries. Returns the number of instances, 0 if nothing was instanced.
+     */
+    static uint32_t instanceifyCommands(Command* first, Command* last,
+            uint32_t* instances) noexcept;
+
     // Helper to execute all the commands generated by this RenderPass
     void execute(FEngine& engine, const char* name,
             backend::Handle<backend::HwRenderTarget> renderTarget,
@@ -342,11 +459,29 @@ public:
         bool mPolygonOffsetOverride : 1;         // whether to override the polygon offset setting
         bool mScissorOverride : 1;               // whether to override the polygon offset setting
 
+        // Commands are recorded from several threads when there are at least this many
+        // consecutive draw commands, each job records at least RECORDING_JOB_SIZE of them.
+        // They are always recorded serially when FILAMENT_DEBUG_COMMANDS is enabled.
+        static constexpr size_t RECORDING_MIN_COMMANDS_COUNT = 1024;
+        static constexpr size_t RECORDING_JOB_SIZE = 256;
+        static constexpr size_t RECORDING_MAX_JOBS = 8;
+
         Executor(RenderPass const* pass, Command const* b, Command const* e) noexcept;
 
         void execute(backend::DriverApi& driver,
                 const Command* first, const Command* last) const noexcept;
 
+        void execute(utils::JobSystem& js, backend::DriverApi& driver,
+                const Command* first, const Command* last) const noexcept;
+
+        // records the commands without the final cleanup
+        void recordCommands(backend::DriverApi& driver,
+                const Command* first, const Command* last) const noexcept;
+
+        // records draw commands (no custom commands) using several threads
+        void recordCommandsParallel(utils::JobSystem& js, backend::DriverApi& driver,
+                const Command* first, const Command* last) const noexcept;
+
     public:
         Executor() = default;
         Executor(Executor const& rhs);
@@ -402,17 +537,28 @@ private:
     static_assert(JOBS_PARALLEL_FOR_COMMANDS_SIZE % utils::CACHELINE_SIZE == 0,
             "Size of Commands jobs must be multiple of a cache-line size");
 
+    // below this many commands, a comparison sort of the commands themselves is cheaper than
+    // the radix sort, which also needs to permute the commands afterwards.
+    static constexpr size_t RADIX_SORT_MIN_COMMANDS_COUNT = 2048;
+
+    // each radix sort job processes at least this many SortKeys, using at most
+    // RADIX_SORT_MAX_JOBS jobs.
+    static constexpr size_t RADIX_SORT_JOB_SIZE = 4096;
+    static constexpr size_t RADIX_SORT_MAX_JOBS = 16;
+
     static inline void generateCommands(uint32_t commandTypeFlags, Command* commands,
             FScene::RenderableSoa const& soa, utils::Range<uint32_t> range,
             Variant variant, RenderFlags renderFlags,
             FScene::VisibleMaskType visibilityMask,
-            math::float3 cameraPosition, math::float3 cameraForward) noexcept;
+            math::float3 cameraPosition, math::float3 cameraForward,
+            CommandCache* cache) noexcept;
 
     template<uint32_t commandTypeFlags>
     static inline Command* generateCommandsImpl(uint32_t extraFlags, Command* curr,
             FScene::RenderableSoa const& soa, utils::Range<uint32_t> range,
             Variant variant, RenderFlags renderFlags, FScene::VisibleMaskType visibilityMask,
-            math::float3 cameraPosition, math::float3 cameraForward) noexcept;
+            math::float3 cameraPosition, math::float3 cameraForward,
+            CommandCache* cache) noexcept;
 
     static void setupColorCommand(Command& cmdDraw, Variant variant,
             FMaterialInstance const* mi, bool inverseFrontFaces) noexcept;
@@ -454,6 +600,9 @@ private:
     // Additional visibility mask
     FScene::VisibleMaskType mVisibilityMask = std::numeric_limits<FScene::VisibleMaskType>::max();
 
+    // Optional cache of the generated commands
+    CommandCache* mCommandCache = nullptr;
+
     backend::Viewport mScissorViewport{ 0, 0,
             std::numeric_limits<int32_t>::max(),
             std::numeric_limits<int32_t>::max() };
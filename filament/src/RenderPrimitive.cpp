@@ -45,6 +45,8 @@ void FRenderPrimitive::init(HwRenderPrimitiveFactory& factory, backend::DriverAp
         mHandle = factory.create(driver, ebh, ibh, entry.type, (uint32_t)entry.offset,
                 (uint32_t)entry.minIndex, (uint32_t)entry.maxIndex, (uint32_t)entry.count);
 
+        mVertexBuffer = vertexBuffer;
+        mIndexBuffer = indexBuffer;
         mPrimitiveType = entry.type;
         mEnabledAttributes = enabledAttributes;
     }
@@ -73,8 +75,17 @@ void FRenderPrimitive::set(HwRenderPrimitiveFactory& factory, backend::DriverApi
     mHandle = factory.create(driver, ebh, ibh, type,
             (uint32_t)offset, (uint32_t)minIndex, (uint32_t)maxIndex, (uint32_t)count);
 
+    mVertexBuffer = vertices;
+    mIndexBuffer = indices;
     mPrimitiveType = type;
     mEnabledAttributes = enabledAttributes;
 }
 
+uint32_t FRenderPrimitive::getGeometryGeneration() const noexcept {
+    if (!mVertexBuffer || !mIndexBuffer) {
+        return 0;
+    }
+    return mVertexBuffer->getGeneration() * 31u + mIndexBuffer->getGeneration();
+}
+
 } // namespace filament
@@ -55,6 +55,9 @@ public:
     uint16_t getBlendOrder() const noexcept { return mBlendOrder; }
     bool isGlobalBlendOrderEnabled() const noexcept { return mGlobalBlendOrderEnabled; }
 
+    // changes each time the content of the primitive's vertex or index buffer is updated
+    uint32_t getGeometryGeneration() const noexcept;
+
     void setMaterialInstance(FMaterialInstance const* mi) noexcept { mMaterialInstance = mi; }
 
     void setBlendOrder(uint16_t order) noexcept {
@@ -67,6 +70,8 @@ public:
 
 private:
     FMaterialInstance const* mMaterialInstance = nullptr;
+    FVertexBuffer const* mVertexBuffer = nullptr;
+    FIndexBuffer const* mIndexBuffer = nullptr;
     backend::Handle<backend::HwRenderPrimitive> mHandle = {};
     AttributeBitset mEnabledAttributes = {};
     uint16_t mBlendOrder = 0;
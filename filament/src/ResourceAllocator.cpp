@@ -94,8 +94,11 @@ size_t ResourceAllocator::TextureKey::getSize() const noexcept {
     return size;
 }
 
-ResourceAllocator::ResourceAllocator(DriverApi& driverApi) noexcept
-        : mBackend(driverApi) {
+ResourceAllocator::ResourceAllocator(Engine::Config const& config, DriverApi& driverApi) noexcept
+        : mCacheCapacity(size_t(config.resourceAllocatorCacheSizeMB) << 20u),
+          mCacheMaxAge(config.resourceAllocatorCacheMaxAge),
+          mDimensionBucket(config.resourceAllocatorDimensionBucket),
+          mBackend(driverApi) {
 }
 
 ResourceAllocator::~ResourceAllocator() noexcept {
@@ -137,6 +140,14 @@ backend::TextureHandle ResourceAllocator::createTexture(const char* name,
     constexpr const auto defaultSwizzle = std::array<backend::TextureSwizzle, 4>{
         TS::CHANNEL_0, TS::CHANNEL_1, TS::CHANNEL_2, TS::CHANNEL_3};
 
+    // textures that are only used as attachments can be larger than requested, which lets us
+    // reuse them when the requested size changes slightly.
+    if (mDimensionBucket > 1 && canUseLargerTexture(target, levels, samples, usage)) {
+        uint32_t const bucket = mDimensionBucket;
+        width  = ((width  + bucket - 1) / bucket) * bucket;
+        height = ((height + bucket - 1) / bucket) * bucket;
+    }
+
     // do we have a suitable texture in the cache?
     TextureHandle handle;
     if constexpr (mEnabled) {
@@ -148,8 +159,10 @@ backend::TextureHandle ResourceAllocator::createTexture(const char* name,
             handle = it->second.handle;
             mCacheSize -= it->second.size;
             textureCache.erase(it);
+            mHitCount++;
         } else {
             // we don't, allocate a new texture and populate the in-use list
+            mMissCount++;
             if (swizzle == defaultSwizzle) {
                 handle = mBackend.createTexture(
                         target, levels, format, samples, width, height, depth, usage);
@@ -179,6 +192,13 @@ void ResourceAllocator::destroyTexture(TextureHandle h) noexcept {
         auto it = mInUseTextures.find(h);
         assert_invariant(it != mInUseTextures.end());
 
+        if (UTILS_UNLIKELY(!mCacheCapacity)) {
+            // caching is disabled
+            mBackend.destroyTexture(h);
+            mInUseTextures.erase(it);
+            return;
+        }
+
         // move it to the cache
         const TextureKey key = it->second;
         uint32_t size = key.getSize();
@@ -208,9 +228,9 @@ void ResourceAllocator::gc() noexcept {
     auto& textureCache = mTextureCache;
     for (auto it = textureCache.begin(); it != textureCache.end();) {
         const size_t ageDiff = age - it->second.age;
-        if (ageDiff >= CACHE_MAX_AGE) {
+        if (ageDiff >= mCacheMaxAge) {
             it = purge(it);
-            if (mCacheSize < CACHE_CAPACITY) {
+            if (mCacheSize < mCacheCapacity) {
                 // if we're not at capacity, only purge a single entry per gc, trying to
                 // avoid a burst of work.
                 break;
@@ -220,7 +240,7 @@ void ResourceAllocator::gc() noexcept {
         }
     }
 
-    if (UTILS_UNLIKELY(mCacheSize >= CACHE_CAPACITY)) {
+    if (UTILS_UNLIKELY(mCacheSize >= mCacheCapacity)) {
         // make a copy of our CacheContainer to a vector
         using Vector = FixedCapacityVector<std::pair<TextureKey, TextureCachePayload>>;
         auto cache = Vector::with_capacity(textureCache.size());
@@ -233,18 +253,20 @@ void ResourceAllocator::gc() noexcept {
 
         // now remove entries until we're at capacity
         auto curr = cache.begin();
-        while (mCacheSize >= CACHE_CAPACITY) {
+        while (curr != cache.end() && mCacheSize >= mCacheCapacity) {
             // by construction this entry must exist
             purge(textureCache.find(curr->first));
             ++curr;
         }
 
         // Since we're sorted already, reset the oldestAge of the whole system
-        size_t oldestAge = cache.front().second.age;
-        for (auto& it : textureCache) {
-            it.second.age -= oldestAge;
+        if (!cache.empty()) {
+            size_t oldestAge = cache.front().second.age;
+            for (auto& it : textureCache) {
+                it.second.age -= oldestAge;
+            }
+            mAge -= oldestAge;
         }
-        mAge -= oldestAge;
     }
     //if (mAge % 60 == 0) dump();
 }
@@ -269,7 +291,31 @@ ResourceAllocator::CacheContainer::iterator ResourceAllocator::purge(
     //slog.d << "purging " << pos->second.handle.getId() << ", age=" << pos->second.age << io::endl;
     mBackend.destroyTexture(pos->second.handle);
     mCacheSize -= pos->second.size;
+    mEvictionCount++;
     return mTextureCache.erase(pos);
 }
 
+bool ResourceAllocator::canUseLargerTexture(SamplerType target, uint8_t levels,
+        uint8_t samples, TextureUsage usage) noexcept {
+    // Sampling or uploading addresses the whole texture, so only textures that are never used
+    // for anything but rendering into a (sub) viewport can be larger than needed.
+    // Multisampled attachments are excluded because they're resolved into a texture of their
+    // own size, which some backends require to match exactly; single-sampled attachments of
+    // different sizes can share a render target, which is sized by its viewport.
+    constexpr TextureUsage ATTACHMENTS = TextureUsage::COLOR_ATTACHMENT |
+            TextureUsage::DEPTH_ATTACHMENT | TextureUsage::STENCIL_ATTACHMENT;
+    return target == SamplerType::SAMPLER_2D && levels == 1 && samples <= 1 &&
+            any(usage & ATTACHMENTS) && none(usage & ~ATTACHMENTS);
+}
+
+ResourceAllocator::Statistics ResourceAllocator::getStatistics() const noexcept {
+    return {
+            .hitCount = mHitCount,
+            .missCount = mMissCount,
+            .evictionCount = mEvictionCount,
+            .cacheSize = mCacheSize,
+            .cacheEntryCount = mTextureCache.size()
+    };
+}
+
 } // namespace filament
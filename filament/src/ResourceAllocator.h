@@ -23,6 +23,8 @@
 
 #include "backend/DriverApiForward.h"
 
+#include <filament/Engine.h>
+
 #include <utils/Hash.h>
 
 #include <array>
@@ -62,7 +64,9 @@ protected:
 
 class ResourceAllocator final : public ResourceAllocatorInterface {
 public:
-    explicit ResourceAllocator(backend::DriverApi& driverApi) noexcept;
+    using Statistics = Engine::ResourceAllocatorStatistics;
+
+    ResourceAllocator(Engine::Config const& config, backend::DriverApi& driverApi) noexcept;
     ~ResourceAllocator() noexcept override;
 
     void terminate() noexcept;
@@ -88,10 +92,14 @@ public:
 
     void gc() noexcept;
 
+    Statistics getStatistics() const noexcept;
+
+    // Whether a texture can be larger than requested, i.e. rounded up to the dimension bucket.
+    // This is public for testing.
+    static bool canUseLargerTexture(backend::SamplerType target, uint8_t levels,
+            uint8_t samples, backend::TextureUsage usage) noexcept;
+
 private:
-    // TODO: these should be settings of the engine
-    static constexpr size_t CACHE_CAPACITY = 64u << 20u;   // 64 MiB
-    static constexpr size_t CACHE_MAX_AGE  = 30u;
 
     struct TextureKey {
         const char* name; // doesn't participate in the hash
@@ -192,11 +200,17 @@ private:
 
     CacheContainer::iterator purge(CacheContainer::iterator const& pos);
 
+    const size_t mCacheCapacity;
+    const size_t mCacheMaxAge;
+    const uint32_t mDimensionBucket;
     backend::DriverApi& mBackend;
     CacheContainer mTextureCache;
     InUseContainer mInUseTextures;
     size_t mAge = 0;
     uint32_t mCacheSize = 0;
+    uint64_t mHitCount = 0;
+    uint64_t mMissCount = 0;
+    uint64_t mEvictionCount = 0;
     static constexpr bool mEnabled = true;
 };
 
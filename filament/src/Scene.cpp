@@ -71,4 +71,12 @@ void Scene::forEach(Invocable<void(utils::Entity)>&& functor) const noexcept {
     downcast(this)->forEach(std::move(functor));
 }
 
+void Scene::setHierarchicalCullingEnabled(bool enabled) noexcept {
+    downcast(this)->setHierarchicalCullingEnabled(enabled);
+}
+
+bool Scene::isHierarchicalCullingEnabled() const noexcept {
+    return downcast(this)->isHierarchicalCullingEnabled();
+}
+
 } // namespace filament
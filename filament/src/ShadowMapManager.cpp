@@ -17,6 +17,7 @@
 #include "ShadowMapManager.h"
 
 #include "RenderPass.h"
+#include "RenderPrimitive.h"
 #include "ShadowMap.h"
 
 #include "details/Texture.h"
@@ -24,14 +25,30 @@
 
 #include <fg/FrameGraph.h>
 
+#include <utils/algorithm.h>
 #include <utils/debug.h>
 #include <utils/FixedCapacityVector.h>
+#include <utils/Hash.h>
+#include <utils/JobSystem.h>
+#include <utils/Systrace.h>
+
+#include <algorithm>
 
 namespace filament {
 
 using namespace backend;
 using namespace math;
 
+namespace {
+
+template<typename T>
+uint32_t hashShadowState(uint32_t seed, T const& value) noexcept {
+    static_assert(sizeof(T) % 4 == 0);
+    return utils::hash::murmur3(reinterpret_cast<uint32_t const*>(&value), sizeof(T) / 4, seed);
+}
+
+} // anonymous namespace
+
 ShadowMapManager::ShadowMapManager(FEngine& engine)
         : mEngine(engine) {
     // initialize our ShadowMap array in-place
@@ -65,16 +82,43 @@ void ShadowMapManager::terminate(FEngine& engine) {
     for (auto& entry : mShadowMapCache) {
         std::launder(reinterpret_cast<ShadowMap*>(&entry))->terminate(engine);
     }
+    invalidateShadowCache(engine);
+}
+
+void ShadowMapManager::invalidateShadowCache(FEngine& engine) noexcept {
+    if (mShadowAtlas) {
+        engine.getDriverApi().destroyTexture(mShadowAtlas);
+        mShadowAtlas.clear();
+    }
+    mShadowMapKeys.fill(0);
+    mShadowCasterKeys.clear();
 }
 
 
 ShadowMapManager::ShadowTechnique ShadowMapManager::update(FEngine& engine, FView& view,
         CameraInfo const& cameraInfo,
         FScene::RenderableSoa& renderableData, FScene::LightSoa const& lightData) noexcept {
+    SYSTRACE_CALL();
+
+    mShadowCacheOptions = view.getShadowCacheOptions();
+    mCachedShadowMaps.reset();
+    mFrameCount++;
+
     ShadowTechnique shadowTechnique = {};
 
     calculateTextureRequirements(engine, view, lightData);
 
+    // cached shadow maps only exist in the texture they were rendered into
+    if (!mShadowCacheOptions.enabled || mShadowAtlasRequirements != mTextureAtlasRequirements) {
+        invalidateShadowCache(engine);
+    }
+
+    if (mShadowCacheOptions.enabled) {
+        mShadowCasterKeys.resize(renderableData.size());
+        computeShadowCasterKeys(engine.getRenderableManager(), renderableData,
+                view.getVisibleLayers(), mShadowCasterKeys.data());
+    }
+
     // Compute scene-dependent values shared across all shadow maps
     ShadowMap::SceneInfo const info{ *view.getScene(), view.getVisibleLayers(), cameraInfo.view };
 
@@ -84,6 +128,13 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::update(FEngine& engine, FVie
     shadowTechnique |= updateSpotShadowMaps(
             engine, lightData);
 
+    if (!mSpotShadowMaps.empty()) {
+        cullSpotShadowMaps(engine, renderableData, lightData);
+        if (mShadowCacheOptions.enabled) {
+            updateSpotShadowMapCache(engine, renderableData, lightData);
+        }
+    }
+
     mSceneInfo = info;
 
     return shadowTechnique;
@@ -131,6 +182,7 @@ void ShadowMapManager::addShadowMap(size_t lightIndex, bool spotlight,
 FrameGraphId<FrameGraphTexture> ShadowMapManager::render(FEngine& engine, FrameGraph& fg,
         RenderPass const& pass, FView& view, CameraInfo const& mainCameraInfo,
         float4 const& userTime) noexcept {
+    SYSTRACE_CALL();
 
     const float moment2 = std::numeric_limits<half>::max();
     const float moment1 = std::sqrt(moment2);
@@ -165,13 +217,29 @@ FrameGraphId<FrameGraphTexture> ShadowMapManager::render(FEngine& engine, FrameG
     auto& prepareShadowPass = fg.addPass<PrepareShadowPassData>("Prepare Shadow Pass",
             [&](FrameGraph::Builder& builder, auto& data) {
                 data.passList.reserve(CONFIG_MAX_SHADOWMAPS);
-                data.shadows = builder.createTexture("Shadowmap", {
+                FrameGraphTexture::Descriptor const desc{
                         .width = textureRequirements.size, .height = textureRequirements.size,
                         .depth = textureRequirements.layers,
                         .levels = textureRequirements.levels,
                         .type = SamplerType::SAMPLER_2D_ARRAY,
                         .format = textureRequirements.format
-                });
+                };
+                if (mShadowCacheOptions.enabled) {
+                    // the shadow maps must survive this frame, so they live in our own texture
+                    FrameGraphTexture::Usage const usage = FrameGraphTexture::Usage::SAMPLEABLE |
+                            (view.hasVSM() ? FrameGraphTexture::Usage::COLOR_ATTACHMENT
+                                           : FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
+                    if (!mShadowAtlas) {
+                        mShadowAtlas = engine.getDriverApi().createTexture(desc.type,
+                                desc.levels, desc.format, 1,
+                                desc.width, desc.height, desc.depth, usage);
+                        mShadowAtlasRequirements = textureRequirements;
+                    }
+                    data.shadows = fg.import("Shadowmap", desc, usage,
+                            FrameGraphTexture{ .handle = mShadowAtlas });
+                } else {
+                    data.shadows = builder.createTexture("Shadowmap", desc);
+                }
 
                 // these loops create a list of the shadow maps that might need to be rendered
                 auto& passList = data.passList;
@@ -181,7 +249,7 @@ FrameGraphId<FrameGraphTexture> ShadowMapManager::render(FEngine& engine, FrameG
                 if (!directionalShadowCastersRange.empty()) {
                     for (auto* pShadowMap : mCascadeShadowMaps) {
                         // for the directional light, we already know if it has visible shadows.
-                        if (pShadowMap->hasVisibleShadows()) {
+                        if (pShadowMap->hasVisibleShadows() && !isShadowMapCached(*pShadowMap)) {
                             passList.push_back({
                                     {}, pShadowMap, directionalShadowCastersRange,
                                     VISIBLE_DIR_SHADOW_RENDERABLE });
@@ -194,9 +262,23 @@ FrameGraphId<FrameGraphTexture> ShadowMapManager::render(FEngine& engine, FrameG
                 if (!spotShadowCastersRange.empty()) {
                     for (auto* pShadowMap : mSpotShadowMaps) {
                         assert_invariant(!pShadowMap->isDirectionalShadow());
-                        passList.push_back({
-                                {}, pShadowMap, spotShadowCastersRange,
-                                VISIBLE_DYN_SHADOW_RENDERABLE });
+                        if (!isShadowMapCached(*pShadowMap)) {
+                            passList.push_back({
+                                    {}, pShadowMap, spotShadowCastersRange,
+                                    VISIBLE_DYN_SHADOW_RENDERABLE });
+                        }
+                    }
+                }
+
+                // shadow maps that don't get rendered this frame can't be reused later
+                if (directionalShadowCastersRange.empty()) {
+                    for (auto const* pShadowMap : mCascadeShadowMaps) {
+                        mShadowMapKeys[pShadowMap->getShadowIndex()] = 0;
+                    }
+                }
+                if (spotShadowCastersRange.empty()) {
+                    for (auto const* pShadowMap : mSpotShadowMaps) {
+                        mShadowMapKeys[pShadowMap->getShadowIndex()] = 0;
                     }
                 }
 
@@ -476,7 +558,7 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(FEng
 
         if (hasVisibleShadows) {
             Frustum const& frustum = shadowMap.getCamera().getCullingFrustum();
-            FView::cullRenderables(engine.getJobSystem(), renderableData, frustum,
+            FView::cullRenderables(engine.getJobSystem(), *scene, frustum,
                     VISIBLE_DIR_SHADOW_RENDERABLE_BIT);
         }
     }
@@ -534,6 +616,30 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(FEng
         // note: normalBias is set to zero for VSM
         const float normalBias = shadowMapInfo.vsm ? 0.0f : 0.5f * lcm.getShadowNormalBias(0);
 
+        uint32_t castersKey = 0;
+        if (mShadowCacheOptions.enabled) {
+            castersKey = hashDirectionalShadowCasters(0,
+                    mShadowCasterKeys.data(), renderableData.data<FScene::VISIBILITY_STATE>(),
+                    renderableData.data<FScene::VISIBLE_MASK>(), VISIBLE_DIR_SHADOW_RENDERABLE,
+                    renderableData.size());
+        }
+        if (castersKey) {
+            castersKey = hashShadowState(castersKey, directionalLight);
+            castersKey = hashShadowState(castersKey, normalBias);
+            castersKey = hashShadowState(castersKey, mSoftShadowOptions);
+            castersKey = hashShadowState(castersKey, options.polygonOffsetConstant);
+            castersKey = hashShadowState(castersKey, options.polygonOffsetSlope);
+            castersKey = hashShadowState(castersKey, uint32_t(options.vsm.elvsm));
+            castersKey = hashShadowState(castersKey, options.vsm.blurWidth);
+            castersKey = hashShadowState(castersKey, options.shadowBulbRadius);
+        }
+
+        // The distant cascades can be updated in turn, one every N frames, when their content
+        // changed. The first cascade is always up-to-date.
+        const uint8_t interval = mShadowCacheOptions.distantCascadeUpdateInterval;
+        const size_t distantCascadeToUpdate =
+                getDistantCascadeToUpdate(mFrameCount, interval, cascadeCount);
+
         for (size_t i = 0, c = mCascadeShadowMaps.size(); i < c; i++) {
             assert_invariant(mCascadeShadowMaps[i]);
 
@@ -550,6 +656,24 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(FEng
                 const size_t shadowIndex = shadowMap.getShadowIndex();
                 assert_invariant(shadowIndex == i);
 
+                shadowTechnique |= ShadowTechnique::SHADOW_MAP;
+                cascadeHasVisibleShadows |= 0x1u << i;
+
+                if (mShadowCacheOptions.enabled) {
+                    uint32_t key = 0;
+                    if (castersKey) {
+                        key = hashShadowState(castersKey, shaderParameters.lightSpace);
+                        key = hashShadowState(key, shaderParameters.scissorNormalized);
+                        key = hashShadowState(key, uint32_t(shadowMap.getLayer()));
+                        key |= 1u;
+                    }
+                    const bool canBeStale = i > 0 && interval && i != distantCascadeToUpdate;
+                    if (useCachedShadowMap(shadowMap, key, canBeStale)) {
+                        // the shadow map and its uniforms are unchanged since it was rendered
+                        continue;
+                    }
+                }
+
                 // Texel size is constant for directional light (although that's not true when LISPSM
                 // is used, but in that case we're pretending it is).
                 const float wsTexelSize = shaderParameters.texelSizeAtOneMeterWs;
@@ -563,9 +687,8 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(FEng
                 s.shadows[shadowIndex].elvsm = options.vsm.elvsm;
                 s.shadows[shadowIndex].bulbRadiusLs =
                         mSoftShadowOptions.penumbraScale * options.shadowBulbRadius / wsTexelSize;
-
-                shadowTechnique |= ShadowTechnique::SHADOW_MAP;
-                cascadeHasVisibleShadows |= 0x1u << i;
+            } else {
+                mShadowMapKeys[shadowMap.getShadowIndex()] = 0;
             }
         }
     }
@@ -599,18 +722,19 @@ void ShadowMapManager::updateSpotVisibilityMasks(
         uint8_t visibleLayers,
         uint8_t const* UTILS_RESTRICT layers,
         FRenderableManager::Visibility const* UTILS_RESTRICT visibility,
+        uint64_t const* UTILS_RESTRICT spotShadowMask, size_t spotShadowBit,
         Culler::result_type* UTILS_RESTRICT visibleMask, size_t count) {
     // __restrict__ seems to only be taken into account as function parameters. This is very
     // important here, otherwise, this loop doesn't get vectorized.
     // This is vectorized 16x.
     count = (count + 0xFu) & ~0xFu; // capacity guaranteed to be multiple of 16
     for (size_t i = 0; i < count; ++i) {
-        const Culler::result_type mask = visibleMask[i];
+        const bool inFrustum = (spotShadowMask[i] >> spotShadowBit) & 1u;
         const FRenderableManager::Visibility v = visibility[i];
         const bool inVisibleLayer = layers[i] & visibleLayers;
 
         const bool visSpotShadowRenderable = v.castShadows && inVisibleLayer &&
-                (!v.culling || (mask & VISIBLE_DYN_SHADOW_RENDERABLE));
+                (!v.culling || inFrustum);
 
         using Type = Culler::result_type;
 
@@ -623,45 +747,21 @@ void ShadowMapManager::prepareSpotShadowMap(ShadowMap& shadowMap,
         FEngine& engine, FView& view, CameraInfo const& mainCameraInfo,
         FScene::RenderableSoa& renderableData, utils::Range<uint32_t> range,
         FScene::LightSoa& lightData, ShadowMap::SceneInfo const& sceneInfo) noexcept {
-    auto& lcm = engine.getLightManager();
-
     const size_t lightIndex = shadowMap.getLightIndex();
-    const FLightManager::Instance li = lightData.elementAt<FScene::LIGHT_INSTANCE>(lightIndex);
     FLightManager::ShadowOptions const* const options = shadowMap.getShadowOptions();
 
-    // compute the frustum for this light
-    // for spotlights, we cull shadow casters first because we already know the frustum,
-    // this will help us find better near/far plane later
-    const auto position = lightData.elementAt<FScene::POSITION_RADIUS>(lightIndex).xyz;
-    const auto direction = lightData.elementAt<FScene::DIRECTION>(lightIndex);
-    const auto radius = lightData.elementAt<FScene::POSITION_RADIUS>(lightIndex).w;
-    const auto outerConeAngle = lcm.getSpotLightOuterCone(li);
-
-    // compute shadow map frustum for culling
-    const mat4f Mv = ShadowMap::getDirectionalLightViewMatrix(direction, position);
-    const mat4f Mp = mat4f::perspective(outerConeAngle * f::RAD_TO_DEG * 2.0f, 1.0f, 0.01f, radius);
-    const mat4f MpMv = math::highPrecisionMultiply(Mp, Mv);
-    const Frustum frustum(MpMv);
-
-    // Cull shadow casters
-    float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
-    float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    // update the visibility mask of the shadow casters, they were culled against the frustum
+    // of this light in cullSpotShadowMaps().
     FScene::VisibleMaskType* visibleArray = renderableData.data<FScene::VISIBLE_MASK>();
-    Culler::intersects(
-            visibleArray + range.first,
-            frustum,
-            worldAABBCenter + range.first,
-            worldAABBExtent + range.first,
-            range.size(),
-            VISIBLE_DYN_SHADOW_RENDERABLE_BIT);
-
-    // update their visibility mask
+    uint64_t const* spotShadowMask = renderableData.data<FScene::SPOT_SHADOW_MASK>();
     uint8_t const* layers = renderableData.data<FScene::LAYERS>();
     auto const* visibility = renderableData.data<FScene::VISIBILITY_STATE>();
     updateSpotVisibilityMasks(
             view.getVisibleLayers(),
             layers + range.first,
             visibility + range.first,
+            spotShadowMask + range.first,
+            getSpotShadowBit(shadowMap),
             visibleArray + range.first,
             range.size());
 
@@ -713,36 +813,18 @@ void ShadowMapManager::preparePointShadowMap(ShadowMap& shadowMap,
     const size_t lightIndex = shadowMap.getLightIndex();
     FLightManager::ShadowOptions const* const options = shadowMap.getShadowOptions();
 
-    // compute the frustum for this light
-    // for spotlights, we cull shadow casters first because we already know the frustum,
-    // this will help us find better near/far plane later
-    const auto position = lightData.elementAt<FScene::POSITION_RADIUS>(lightIndex).xyz;
-    const auto radius = lightData.elementAt<FScene::POSITION_RADIUS>(lightIndex).w;
-
-    // compute shadow map frustum for culling
-    const mat4f Mv = ShadowMap::getPointLightViewMatrix(TextureCubemapFace(face), position);
-    const mat4f Mp = mat4f::perspective(90.0f, 1.0f, 0.01f, radius);
-    const Frustum frustum{ math::highPrecisionMultiply(Mp, Mv) };
-
-    // Cull shadow casters
-    float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
-    float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    // update the visibility mask of the shadow casters, they were culled against the frustum
+    // of this face in cullSpotShadowMaps().
     FScene::VisibleMaskType* visibleArray = renderableData.data<FScene::VISIBLE_MASK>();
-    Culler::intersects(
-            visibleArray + range.first,
-            frustum,
-            worldAABBCenter + range.first,
-            worldAABBExtent + range.first,
-            range.size(),
-            VISIBLE_DYN_SHADOW_RENDERABLE_BIT);
-
-    // update their visibility mask
+    uint64_t const* spotShadowMask = renderableData.data<FScene::SPOT_SHADOW_MASK>();
     uint8_t const* layers = renderableData.data<FScene::LAYERS>();
     auto const* visibility = renderableData.data<FScene::VISIBILITY_STATE>();
     updateSpotVisibilityMasks(
             view.getVisibleLayers(),
             layers + range.first,
             visibility + range.first,
+            spotShadowMask + range.first,
+            getSpotShadowBit(shadowMap),
             visibleArray + range.first,
             range.size());
 
@@ -824,6 +906,204 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateSpotShadowMaps(FEngine
     return shadowTechnique;
 }
 
+void ShadowMapManager::updateSpotShadowMapCache(FEngine& engine,
+        FScene::RenderableSoa const& renderableData,
+        FScene::LightSoa const& lightData) noexcept {
+    auto& lcm = engine.getLightManager();
+
+    std::array<uint32_t, CONFIG_MAX_SHADOWMAPS - CONFIG_MAX_SHADOW_CASCADES> castersKeys;
+    hashSpotShadowCasters(0,
+            mShadowCasterKeys.data(), renderableData.data<FScene::VISIBILITY_STATE>(),
+            renderableData.data<FScene::SPOT_SHADOW_MASK>(), renderableData.size(),
+            castersKeys.data(), mSpotShadowMaps.size());
+
+    for (auto const* pShadowMap : mSpotShadowMaps) {
+        ShadowMap const& shadowMap = *pShadowMap;
+        uint32_t key = castersKeys[getSpotShadowBit(shadowMap)];
+        if (key) {
+            const size_t lightIndex = shadowMap.getLightIndex();
+            const FLightManager::Instance li =
+                    lightData.elementAt<FScene::LIGHT_INSTANCE>(lightIndex);
+            FLightManager::ShadowOptions const* const options = shadowMap.getShadowOptions();
+            key = hashShadowState(key, li);
+            key = hashShadowState(key, lightData.elementAt<FScene::POSITION_RADIUS>(lightIndex));
+            key = hashShadowState(key, lightData.elementAt<FScene::DIRECTION>(lightIndex));
+            key = hashShadowState(key, lcm.getSpotLightOuterCone(li));
+            key = hashShadowState(key, uint32_t(shadowMap.getFace()));
+            key = hashShadowState(key, uint32_t(shadowMap.getLayer()));
+            key = hashShadowState(key, mSoftShadowOptions);
+            key = hashShadowState(key, options->mapSize);
+            key = hashShadowState(key, options->normalBias);
+            key = hashShadowState(key, options->polygonOffsetConstant);
+            key = hashShadowState(key, options->polygonOffsetSlope);
+            key = hashShadowState(key, uint32_t(options->vsm.elvsm));
+            key = hashShadowState(key, options->vsm.blurWidth);
+            key = hashShadowState(key, options->shadowBulbRadius);
+            key |= 1u;
+        }
+        useCachedShadowMap(shadowMap, key, false);
+    }
+}
+
+void ShadowMapManager::computeShadowCasterKeys(FRenderableManager const& rcm,
+        FScene::RenderableSoa const& renderableData, uint8_t visibleLayers,
+        uint32_t* UTILS_RESTRICT casterKeys) noexcept {
+    auto const* instances = renderableData.data<FScene::RENDERABLE_INSTANCE>();
+    auto const* transforms = renderableData.data<FScene::WORLD_TRANSFORM>();
+    auto const* visibility = renderableData.data<FScene::VISIBILITY_STATE>();
+    auto const* layers = renderableData.data<FScene::LAYERS>();
+    auto const* skinning = renderableData.data<FScene::SKINNING_BUFFER>();
+    auto const* morphing = renderableData.data<FScene::MORPHING_BUFFER>();
+    auto const* instancing = renderableData.data<FScene::INSTANCES>();
+
+    for (size_t i = 0, c = renderableData.size(); i < c; i++) {
+        uint32_t key = NO_SHADOW_CASTER_KEY;
+        if (visibility[i].castShadows && (layers[i] & visibleLayers)) {
+            if (skinning[i].handle || morphing[i].handle || instancing[i].buffer) {
+                key = VOLATILE_SHADOW_CASTER_KEY;
+            } else {
+                key = hashShadowState(0, instances[i]);
+                key = hashShadowState(key, rcm.getGeneration(instances[i]));
+                key = hashShadowState(key, transforms[i]);
+                // PRIMITIVES is only set for visible renderables, shadow casters may not be.
+                // Like FView::updatePrimitivesLod(), this uses the first level of detail.
+                for (FRenderPrimitive const& primitive : rcm.getRenderPrimitives(instances[i], 0)) {
+                    key = hashShadowState(key, primitive.getGeometryGeneration());
+                }
+                key = std::max(key, VOLATILE_SHADOW_CASTER_KEY + 1);
+            }
+        }
+        casterKeys[i] = key;
+    }
+}
+
+uint32_t ShadowMapManager::hashDirectionalShadowCasters(uint32_t seed,
+        uint32_t const* UTILS_RESTRICT casterKeys,
+        FRenderableManager::Visibility const* UTILS_RESTRICT visibility,
+        Culler::result_type const* UTILS_RESTRICT visibleMask,
+        Culler::result_type visibleBit, size_t count) noexcept {
+    uint32_t h = seed;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t const key = casterKeys[i];
+        if (key == NO_SHADOW_CASTER_KEY ||
+                (visibility[i].culling && !(visibleMask[i] & visibleBit))) {
+            continue;
+        }
+        if (key == VOLATILE_SHADOW_CASTER_KEY) {
+            return 0;
+        }
+        h = hashShadowState(h, key);
+    }
+    return h | 1u;
+}
+
+void ShadowMapManager::hashSpotShadowCasters(uint32_t seed,
+        uint32_t const* UTILS_RESTRICT casterKeys,
+        FRenderableManager::Visibility const* UTILS_RESTRICT visibility,
+        uint64_t const* UTILS_RESTRICT spotShadowMask, size_t count,
+        uint32_t* keys, size_t shadowMapCount) noexcept {
+    assert_invariant(shadowMapCount <= 64);
+    uint64_t const allShadowMaps =
+            shadowMapCount < 64 ? (uint64_t(1) << shadowMapCount) - 1u : ~uint64_t(0);
+    uint64_t volatileShadowMaps = 0;
+    std::fill_n(keys, shadowMapCount, seed);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t const key = casterKeys[i];
+        if (key == NO_SHADOW_CASTER_KEY) {
+            continue;
+        }
+        uint64_t mask = visibility[i].culling ? spotShadowMask[i] & allShadowMaps : allShadowMaps;
+        if (key == VOLATILE_SHADOW_CASTER_KEY) {
+            volatileShadowMaps |= mask;
+            continue;
+        }
+        mask &= ~volatileShadowMaps;
+        while (mask) {
+            size_t const bit = utils::ctz(mask);
+            keys[bit] = hashShadowState(keys[bit], key);
+            mask &= mask - 1u;
+        }
+    }
+    for (size_t i = 0; i < shadowMapCount; i++) {
+        keys[i] = ((volatileShadowMaps >> i) & 1u) ? 0u : (keys[i] | 1u);
+    }
+}
+
+size_t ShadowMapManager::getDistantCascadeToUpdate(uint32_t frame, uint8_t interval,
+        size_t cascadeCount) noexcept {
+    if (!interval || cascadeCount < 2 || frame % interval) {
+        return 0;
+    }
+    return 1 + (frame / interval) % (cascadeCount - 1);
+}
+
+void ShadowMapManager::cullSpotShadowMaps(FEngine& engine,
+        FScene::RenderableSoa& renderableData, FScene::LightSoa const& lightData) noexcept {
+    SYSTRACE_CALL();
+
+    auto& lcm = engine.getLightManager();
+
+    // compute the frustum of each point and spot shadow map
+    std::array<Frustum, CONFIG_MAX_SHADOWMAPS - CONFIG_MAX_SHADOW_CASCADES> frustums;
+    const size_t frustumCount = mSpotShadowMaps.size();
+    for (size_t i = 0; i < frustumCount; i++) {
+        ShadowMap const& shadowMap = *mSpotShadowMaps[i];
+        assert_invariant(getSpotShadowBit(shadowMap) == i);
+        const size_t lightIndex = shadowMap.getLightIndex();
+        const float3 position = lightData.elementAt<FScene::POSITION_RADIUS>(lightIndex).xyz;
+        const float radius = lightData.elementAt<FScene::POSITION_RADIUS>(lightIndex).w;
+        mat4f Mv, Mp;
+        if (shadowMap.getShadowType() == ShadowType::SPOT) {
+            const FLightManager::Instance li =
+                    lightData.elementAt<FScene::LIGHT_INSTANCE>(lightIndex);
+            const float3 direction = lightData.elementAt<FScene::DIRECTION>(lightIndex);
+            const float outerConeAngle = lcm.getSpotLightOuterCone(li);
+            Mv = ShadowMap::getDirectionalLightViewMatrix(direction, position);
+            Mp = mat4f::perspective(outerConeAngle * f::RAD_TO_DEG * 2.0f, 1.0f, 0.01f, radius);
+        } else {
+            Mv = ShadowMap::getPointLightViewMatrix(
+                    TextureCubemapFace(shadowMap.getFace()), position);
+            Mp = mat4f::perspective(90.0f, 1.0f, 0.01f, radius);
+        }
+        frustums[i] = Frustum{ math::highPrecisionMultiply(Mp, Mv) };
+    }
+
+    // Then cull all renderables against all frustums in a single pass, which records in
+    // SPOT_SHADOW_MASK the shadow maps each renderable intersects. This happens before the
+    // renderables are partitioned, so we don't know yet which ones are shadow casters.
+    float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    uint64_t* spotShadowMask = renderableData.data<FScene::SPOT_SHADOW_MASK>();
+    const uint32_t count = uint32_t(renderableData.size());
+
+    // jobs process whole batches, whose size must be a multiple of Culler::MODULO
+    constexpr uint32_t BATCH_SIZE = 256;
+    static_assert(BATCH_SIZE % Culler::MODULO == 0);
+    auto work = [&](uint32_t batch, uint32_t batchCount) {
+        const uint32_t first = batch * BATCH_SIZE;
+        const uint32_t last = std::min(count, (batch + batchCount) * BATCH_SIZE);
+        Culler::intersects(spotShadowMask + first, frustums.data(), frustumCount,
+                worldAABBCenter + first, worldAABBExtent + first, last - first);
+    };
+
+    utils::JobSystem& js = engine.getJobSystem();
+    js.runAndWait(utils::jobs::parallel_for(js, nullptr,
+            0, (count + BATCH_SIZE - 1) / BATCH_SIZE,
+            std::cref(work), utils::jobs::CountSplitter<1, 8>()));
+}
+
+bool ShadowMapManager::useCachedShadowMap(ShadowMap const& shadowMap, uint32_t key,
+        bool canBeStale) noexcept {
+    const size_t shadowIndex = shadowMap.getShadowIndex();
+    uint32_t& cachedKey = mShadowMapKeys[shadowIndex];
+    const bool cached = key && cachedKey && (cachedKey == key || canBeStale);
+    if (!cached) {
+        cachedKey = key;
+    }
+    mCachedShadowMaps.set(shadowIndex, cached);
+    return cached;
+}
+
 void ShadowMapManager::calculateTextureRequirements(FEngine&, FView& view,
         FScene::LightSoa const&) noexcept {
 
@@ -17,6 +17,7 @@
 #ifndef TNT_FILAMENT_DETAILS_SHADOWMAPMANAGER_H
 #define TNT_FILAMENT_DETAILS_SHADOWMAPMANAGER_H
 
+#include <filament/Options.h>
 #include <filament/Viewport.h>
 
 #include "ShadowMap.h"
@@ -31,12 +32,14 @@
 #include <backend/DriverEnums.h>
 #include <backend/Handle.h>
 
+#include <utils/bitset.h>
 #include <utils/FixedCapacityVector.h>
 
 #include <math/vec3.h>
 
 #include <array>
 #include <memory>
+#include <vector>
 
 namespace filament {
 
@@ -107,6 +110,47 @@ public:
 
     bool hasSpotShadows() const { return !mSpotShadowMaps.empty(); }
 
+    /*
+     * Shadow map caching helpers, see ShadowCacheOptions. These are public for testing.
+     */
+
+    // key of a renderable that can't cast shadows in this View
+    static constexpr uint32_t NO_SHADOW_CASTER_KEY = 0;
+
+    // Key of a renderable that can change without the RenderableManager knowing about it, i.e.
+    // skinned, morphed or instanced renderables, whose buffers are updated directly. Shadow maps
+    // it casts shadows into are always rendered.
+    static constexpr uint32_t VOLATILE_SHADOW_CASTER_KEY = 1;
+
+    // Computes the key of each renderable, which changes when the renderable is modified, moves,
+    // or when the content of the buffers of its primitives is updated.
+    // This is done once per frame, and shared by all shadow maps.
+    static void computeShadowCasterKeys(FRenderableManager const& rcm,
+            FScene::RenderableSoa const& renderableData, uint8_t visibleLayers,
+            uint32_t* UTILS_RESTRICT casterKeys) noexcept;
+
+    // Combines the keys of the directional shadow casters, i.e. the renderables that have
+    // visibleBit set in their VISIBLE_MASK or that are not subject to culling, starting from
+    // seed. Returns 0 if the shadow maps must be rendered.
+    static uint32_t hashDirectionalShadowCasters(uint32_t seed,
+            uint32_t const* UTILS_RESTRICT casterKeys,
+            FRenderableManager::Visibility const* UTILS_RESTRICT visibility,
+            Culler::result_type const* UTILS_RESTRICT visibleMask,
+            Culler::result_type visibleBit, size_t count) noexcept;
+
+    // Same as above for all the point and spot shadow maps at once, whose casters are given by
+    // SPOT_SHADOW_MASK. keys[i] receives the key of the shadow map using bit i.
+    static void hashSpotShadowCasters(uint32_t seed,
+            uint32_t const* UTILS_RESTRICT casterKeys,
+            FRenderableManager::Visibility const* UTILS_RESTRICT visibility,
+            uint64_t const* UTILS_RESTRICT spotShadowMask, size_t count,
+            uint32_t* keys, size_t shadowMapCount) noexcept;
+
+    // Returns which of the distant cascades (i.e. > 0) can be refreshed at a given frame when
+    // they're updated in turn every `interval` frames, or 0 if none.
+    static size_t getDistantCascadeToUpdate(uint32_t frame, uint8_t interval,
+            size_t cascadeCount) noexcept;
+
 private:
     ShadowMapManager::ShadowTechnique updateCascadeShadowMaps(FEngine& engine,
             FView& view, CameraInfo const& cameraInfo, FScene::RenderableSoa& renderableData,
@@ -129,10 +173,36 @@ private:
             FScene::LightSoa& lightData,
             ShadowMap::SceneInfo const& sceneInfo) noexcept;
 
+    // Culls the renderables against all point and spot shadow maps, see SPOT_SHADOW_MASK.
+    void cullSpotShadowMaps(FEngine& engine, FScene::RenderableSoa& renderableData,
+            FScene::LightSoa const& lightData) noexcept;
+
+    // bit of SPOT_SHADOW_MASK corresponding to a point or spot shadow map
+    static size_t getSpotShadowBit(ShadowMap const& shadowMap) noexcept {
+        assert_invariant(!shadowMap.isDirectionalShadow());
+        return shadowMap.getShadowIndex() - CONFIG_MAX_SHADOW_CASCADES;
+    }
+
+    void updateSpotShadowMapCache(FEngine& engine,
+            FScene::RenderableSoa const& renderableData,
+            FScene::LightSoa const& lightData) noexcept;
+
+    // Returns true if the content rendered in a previous frame can be used for this shadow map.
+    // `key` identifies what the shadow map would contain, 0 means it must be rendered. When
+    // `canBeStale` is set, the previous content is used even if the key changed.
+    bool useCachedShadowMap(ShadowMap const& shadowMap, uint32_t key, bool canBeStale) noexcept;
+
+    bool isShadowMapCached(ShadowMap const& shadowMap) const noexcept {
+        return mCachedShadowMaps[shadowMap.getShadowIndex()];
+    }
+
+    void invalidateShadowCache(FEngine& engine) noexcept;
+
     static void updateSpotVisibilityMasks(
             uint8_t visibleLayers,
             uint8_t const* UTILS_RESTRICT layers,
             FRenderableManager::Visibility const* UTILS_RESTRICT visibility,
+            uint64_t const* UTILS_RESTRICT spotShadowMask, size_t spotShadowBit,
             Culler::result_type* UTILS_RESTRICT visibleMask, size_t count);
 
     class CascadeSplits {
@@ -182,8 +252,23 @@ private:
         uint8_t levels = 0;
         uint8_t msaaSamples = 1;
         backend::TextureFormat format = backend::TextureFormat::DEPTH16;
+
+        bool operator!=(TextureAtlasRequirements const& rhs) const noexcept {
+            return size != rhs.size || layers != rhs.layers || levels != rhs.levels ||
+                   msaaSamples != rhs.msaaSamples || format != rhs.format;
+        }
     } mTextureAtlasRequirements;
 
+    // Shadow map caching, see ShadowCacheOptions. When enabled, the shadow maps are rendered
+    // into a texture that persists across frames and only re-rendered when their key changes.
+    ShadowCacheOptions mShadowCacheOptions;
+    backend::Handle<backend::HwTexture> mShadowAtlas;
+    TextureAtlasRequirements mShadowAtlasRequirements;
+    std::array<uint32_t, CONFIG_MAX_SHADOWMAPS> mShadowMapKeys{}; // by shadow index
+    std::vector<uint32_t> mShadowCasterKeys;                        // by renderable
+    utils::bitset64 mCachedShadowMaps;                              // valid after update()
+    uint32_t mFrameCount = 0;
+
     SoftShadowOptions mSoftShadowOptions;
 
     CascadeSplits::Params mCascadeSplitParams;
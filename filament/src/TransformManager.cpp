@@ -113,4 +113,12 @@ bool TransformManager::isAccurateTranslationsEnabled() const noexcept {
     return downcast(this)->isAccurateTranslationsEnabled();;
 }
 
+void TransformManager::setLevelOrderEnabled(bool enable) noexcept {
+    downcast(this)->setLevelOrderEnabled(enable);
+}
+
+bool TransformManager::isLevelOrderEnabled() const noexcept {
+    return downcast(this)->isLevelOrderEnabled();
+}
+
 } // namespace filament
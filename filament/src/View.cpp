@@ -155,6 +155,14 @@ View::DynamicResolutionOptions View::getDynamicResolutionOptions() const noexcep
     return downcast(this)->getDynamicResolutionOptions();
 }
 
+void View::setPostProcessResolutionOptions(PostProcessResolutionOptions const& options) noexcept {
+    downcast(this)->setPostProcessResolutionOptions(options);
+}
+
+PostProcessResolutionOptions View::getPostProcessResolutionOptions() const noexcept {
+    return downcast(this)->getPostProcessResolutionOptions();
+}
+
 void View::setRenderQuality(const RenderQuality& renderQuality) noexcept {
     downcast(this)->setRenderQuality(renderQuality);
 }
@@ -203,6 +211,14 @@ SoftShadowOptions View::getSoftShadowOptions() const noexcept {
     return downcast(this)->getSoftShadowOptions();
 }
 
+void View::setShadowCacheOptions(ShadowCacheOptions const& options) noexcept {
+    downcast(this)->setShadowCacheOptions(options);
+}
+
+ShadowCacheOptions View::getShadowCacheOptions() const noexcept {
+    return downcast(this)->getShadowCacheOptions();
+}
+
 void View::setAmbientOcclusion(View::AmbientOcclusion ambientOcclusion) noexcept {
     downcast(this)->setAmbientOcclusion(ambientOcclusion);
 }
@@ -61,6 +61,7 @@ struct RenderableManager::BuilderDetails {
     bool mScreenSpaceContactShadows : 1;
     bool mSkinningBufferMode : 1;
     bool mFogEnabled : 1;
+    bool mStaticGeometry : 1;
     size_t mSkinningBoneCount = 0;
     size_t mMorphTargetCount = 0;
     Bone const* mUserBones = nullptr;
@@ -71,7 +72,8 @@ struct RenderableManager::BuilderDetails {
 
     explicit BuilderDetails(size_t count)
             : mEntries(count), mCulling(true), mCastShadows(false), mReceiveShadows(true),
-              mScreenSpaceContactShadows(false), mSkinningBufferMode(false), mFogEnabled(true) {
+              mScreenSpaceContactShadows(false), mSkinningBufferMode(false), mFogEnabled(true),
+              mStaticGeometry(false) {
     }
     // this is only needed for the explicit instantiation below
     BuilderDetails() = default;
@@ -210,6 +212,11 @@ RenderableManager::Builder& RenderableManager::Builder::fog(bool enabled) noexce
     return *this;
 }
 
+RenderableManager::Builder& RenderableManager::Builder::staticGeometry(bool enable) noexcept {
+    mImpl->mStaticGeometry = enable;
+    return *this;
+}
+
 RenderableManager::Builder& RenderableManager::Builder::morphing(size_t targetCount) noexcept {
     mImpl->mMorphTargetCount = targetCount;
     return *this;
@@ -380,7 +387,9 @@ void FRenderableManager::create(
         setSkinning(ci, false);
         setMorphing(ci, builder->mMorphTargetCount);
         setFogEnabled(ci, builder->mFogEnabled);
+        setStaticGeometry(ci, builder->mStaticGeometry);
         mManager[ci].channels = builder->mLightChannels;
+        markChanged(ci);
 
         InstancesInfo& instances = manager[ci].instances;
         instances.count = builder->mInstanceCount;
@@ -592,6 +601,7 @@ void FRenderableManager::setMaterialInstanceAt(Instance instance, uint8_t level,
                        << "] missing required attributes ("
                        << required << "), declared=" << declared << io::endl;
             }
+            markChanged(instance);
         }
     }
 }
@@ -615,6 +625,7 @@ void FRenderableManager::setBlendOrderAt(Instance instance, uint8_t level,
         Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].setBlendOrder(order);
+            markChanged(instance);
         }
     }
 }
@@ -625,6 +636,7 @@ void FRenderableManager::setGlobalBlendOrderEnabledAt(Instance instance, uint8_t
         Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].setGlobalBlendOrderEnabled(enabled);
+            markChanged(instance);
         }
     }
 }
@@ -648,6 +660,7 @@ void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].set(mHwRenderPrimitiveFactory, mEngine.getDriverApi(),
                     type, vertices, indices, offset, 0, vertices->getVertexCount() - 1, count);
+            markChanged(instance);
         }
     }
 }
@@ -714,6 +727,7 @@ void FRenderableManager::setSkinningBuffer(FRenderableManager::Instance ci,
     bones.handle = skinningBuffer->getHwHandle();
     bones.count = uint16_t(count);
     bones.offset = uint16_t(offset);
+    markChanged(ci);
 }
 
 static void updateMorphWeights(FEngine& engine, backend::Handle<backend::HwBufferObject> handle,
@@ -756,6 +770,7 @@ void FRenderableManager::setMorphTargetBufferAt(Instance instance, uint8_t level
         if (primitiveIndex < morphTargets.size()) {
             morphTargets[primitiveIndex] = { morphTargetBuffer, (uint32_t)offset,
                                              (uint32_t)count };
+            markChanged(instance);
         }
     }
 }
@@ -785,6 +800,7 @@ void FRenderableManager::setLightChannel(Instance ci, unsigned int channel, bool
             const uint8_t mask = 1u << channel;
             mManager[ci].channels &= ~mask;
             mManager[ci].channels |= enable ? mask : 0u;
+            markChanged(ci);
         }
     }
 }
@@ -65,6 +65,7 @@ public:
         bool screenSpaceContactShadows  : 1;
         bool reversedWindingOrder       : 1;
         bool fog                        : 1;
+        bool staticGeometry             : 1;
     };
 
     static_assert(sizeof(Visibility) == sizeof(uint16_t), "Visibility should be 16 bits");
@@ -117,6 +118,8 @@ public:
     inline void setCulling(Instance instance, bool enable) noexcept;
     inline void setFogEnabled(Instance instance, bool enable) noexcept;
     inline bool getFogEnabled(Instance instance) const noexcept;
+    inline void setStaticGeometry(Instance instance, bool enable) noexcept;
+    inline bool isStaticGeometry(Instance instance) const noexcept;
 
     inline void setPrimitives(Instance instance, utils::Slice<FRenderPrimitive> const& primitives) noexcept;
 
@@ -179,6 +182,22 @@ public:
         return mManager.getEntity(instance);
     }
 
+    // The generation is incremented each time a component is created or modified, and each
+    // component records the generation at which it last changed. This allows clients to find
+    // which components changed since they last looked.
+    uint64_t getGeneration() const noexcept {
+        return mGeneration;
+    }
+
+    uint64_t getGeneration(Instance instance) const noexcept {
+        return mManager[instance].generation;
+    }
+
+    // instances are in the [1, getComponentCount()] range
+    size_t getComponentCount() const noexcept {
+        return mManager.getComponentCount();
+    }
+
     inline size_t getLevelCount(Instance) const noexcept { return 1u; }
     size_t getPrimitiveCount(Instance instance, uint8_t level) const noexcept;
     void setMaterialInstanceAt(Instance instance, uint8_t level,
@@ -196,6 +215,10 @@ public:
     inline utils::Slice<MorphTargets>& getMorphTargets(Instance instance, uint8_t level) noexcept;
 
 private:
+    void markChanged(Instance instance) noexcept {
+        mManager[instance].generation = ++mGeneration;
+    }
+
     void destroyComponent(Instance ci) noexcept;
     static void destroyComponentPrimitives(
             HwRenderPrimitiveFactory& factory, backend::DriverApi& driver,
@@ -226,7 +249,8 @@ private:
         VISIBILITY,             // user data
         PRIMITIVES,             // user data
         BONES,                  // filament data, UBO storing a pointer to the bones information
-        MORPH_TARGETS
+        MORPH_TARGETS,
+        GENERATION              // filament data, generation at which the component last changed
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -238,7 +262,8 @@ private:
             Visibility,                      // VISIBILITY
             utils::Slice<FRenderPrimitive>,  // PRIMITIVES
             Bones,                           // BONES
-            utils::Slice<MorphTargets>       // MORPH_TARGETS
+            utils::Slice<MorphTargets>,      // MORPH_TARGETS
+            uint64_t                         // GENERATION
     >;
 
     struct Sim : public Base {
@@ -262,6 +287,7 @@ private:
                 Field<PRIMITIVES>           primitives;
                 Field<BONES>                bones;
                 Field<MORPH_TARGETS>        morphTargets;
+                Field<GENERATION>           generation;
             };
         };
 
@@ -274,6 +300,7 @@ private:
     };
 
     Sim mManager;
+    uint64_t mGeneration = 0;
     FEngine& mEngine;
     HwRenderPrimitiveFactory mHwRenderPrimitiveFactory;
 };
@@ -283,6 +310,7 @@ FILAMENT_DOWNCAST(RenderableManager)
 void FRenderableManager::setAxisAlignedBoundingBox(Instance instance, const Box& aabb) noexcept {
     if (instance) {
         mManager[instance].aabb = aabb;
+        markChanged(instance);
     }
 }
 
@@ -291,12 +319,14 @@ void FRenderableManager::setLayerMask(Instance instance,
     if (instance) {
         uint8_t& layers = mManager[instance].layers;
         layers = (layers & ~select) | (values & select);
+        markChanged(instance);
     }
 }
 
 void FRenderableManager::setLayerMask(Instance instance, uint8_t layerMask) noexcept {
     if (instance) {
         mManager[instance].layers = layerMask;
+        markChanged(instance);
     }
 }
 
@@ -304,6 +334,7 @@ void FRenderableManager::setPriority(Instance instance, uint8_t priority) noexce
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.priority = std::min(priority, uint8_t(0x7));
+        markChanged(instance);
     }
 }
 
@@ -311,6 +342,7 @@ void FRenderableManager::setChannel(Instance instance, uint8_t channel) noexcept
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.channel = std::min(channel, uint8_t(0x3));
+        markChanged(instance);
     }
 }
 
@@ -318,6 +350,7 @@ void FRenderableManager::setCastShadows(Instance instance, bool enable) noexcept
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.castShadows = enable;
+        markChanged(instance);
     }
 }
 
@@ -325,6 +358,7 @@ void FRenderableManager::setReceiveShadows(Instance instance, bool enable) noexc
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.receiveShadows = enable;
+        markChanged(instance);
     }
 }
 
@@ -332,6 +366,7 @@ void FRenderableManager::setScreenSpaceContactShadows(Instance instance, bool en
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.screenSpaceContactShadows = enable;
+        markChanged(instance);
     }
 }
 
@@ -339,6 +374,7 @@ void FRenderableManager::setCulling(Instance instance, bool enable) noexcept {
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.culling = enable;
+        markChanged(instance);
     }
 }
 
@@ -346,6 +382,7 @@ void FRenderableManager::setFogEnabled(Instance instance, bool enable) noexcept
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.fog = enable;
+        markChanged(instance);
     }
 }
 
@@ -353,10 +390,23 @@ bool FRenderableManager::getFogEnabled(RenderableManager::Instance instance) con
     return getVisibility(instance).fog;
 }
 
+void FRenderableManager::setStaticGeometry(Instance instance, bool enable) noexcept {
+    if (instance) {
+        Visibility& visibility = mManager[instance].visibility;
+        visibility.staticGeometry = enable;
+        markChanged(instance);
+    }
+}
+
+bool FRenderableManager::isStaticGeometry(RenderableManager::Instance instance) const noexcept {
+    return getVisibility(instance).staticGeometry;
+}
+
 void FRenderableManager::setSkinning(Instance instance, bool enable) noexcept {
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.skinning = enable;
+        markChanged(instance);
     }
 }
 
@@ -364,6 +414,7 @@ void FRenderableManager::setMorphing(Instance instance, bool enable) noexcept {
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
         visibility.morphing = enable;
+        markChanged(instance);
     }
 }
 
@@ -371,6 +422,7 @@ void FRenderableManager::setPrimitives(Instance instance,
         utils::Slice<FRenderPrimitive> const& primitives) noexcept {
     if (instance) {
         mManager[instance].primitives = primitives;
+        markChanged(instance);
     }
 }
 
@@ -19,14 +19,22 @@
 #include <math/mat4.h>
 
 #include <utils/debug.h>
+#include <utils/JobSystem.h>
 #include <filament/TransformManager.h>
 
+#include <algorithm>
+#include <functional>
+#include <vector>
+
 
 using namespace utils;
 using namespace filament::math;
 
 namespace filament {
 
+// minimum number of nodes of a level processed by a single job in level-order mode
+static constexpr size_t LEVEL_JOB_SIZE = 256;
+
 FTransformManager::FTransformManager() noexcept = default;
 
 FTransformManager::~FTransformManager() noexcept = default;
@@ -38,12 +46,25 @@ void FTransformManager::setAccurateTranslationsEnabled(bool enable) noexcept {
     if (enable != mAccurateTranslations) {
         mAccurateTranslations = enable;
         // when enabling accurate translations, we have to recompute all world transforms
-        if (enable && !mLocalTransformTransactionOpen) {
-            computeAllWorldTransforms();
+        if (enable) {
+            if (mLocalTransformTransactionOpen) {
+                // the commit only recomputes the dirty nodes
+                markAllDirty();
+            } else {
+                computeAllWorldTransforms();
+            }
         }
     }
 }
 
+void FTransformManager::setLevelOrderEnabled(bool enable) noexcept {
+    if (enable != mLevelOrderEnabled) {
+        mLevelOrderEnabled = enable;
+        // the components will be sorted during the next commit
+        mLevelOrderValid = false;
+    }
+}
+
 void FTransformManager::create(Entity entity) {
     create(entity, 0, mat4f{});
 }
@@ -65,6 +86,9 @@ void FTransformManager::create(Entity entity, Instance parent, const mat4f& loca
         manager[i].next = 0;
         manager[i].prev = 0;
         manager[i].firstChild = 0;
+        manager[i].dirty = false;
+        manager[i].generation = ++mGeneration;
+        mLevelOrderValid = false;
         insertNode(i, parent);
         setTransform(i, localTransform);
     }
@@ -87,6 +111,9 @@ void FTransformManager::create(Entity entity, Instance parent, const mat4& local
         manager[i].next = 0;
         manager[i].prev = 0;
         manager[i].firstChild = 0;
+        manager[i].dirty = false;
+        manager[i].generation = ++mGeneration;
+        mLevelOrderValid = false;
         insertNode(i, parent);
         setTransform(i, localTransform);
     }
@@ -101,6 +128,7 @@ void FTransformManager::setParent(Instance i, Instance parent) noexcept {
             // TODO: on debug builds, ensure that the new parent isn't one of our descendant
             removeNode(i);
             insertNode(i, parent);
+            mLevelOrderValid = false;
             updateNodeTransform(i);
             // Note: setParent() doesn't reorder the child after the parent in the array,
             // but that's not a problem because TransformManager doesn't rely on that.
@@ -150,12 +178,15 @@ void FTransformManager::destroy(Entity e) noexcept {
         // 1) remove the entry from the linked lists
         removeNode(i);
 
-        // our children don't have parents anymore
+        // our children don't have parents anymore, their world transform will be updated
+        // during the next commit.
         Instance child = manager[i].firstChild;
         while (child) {
             manager[child].parent = 0;
+            markDirty(child);
             child = manager[child].next;
         }
+        mLevelOrderValid = false;
 
         // 2) remove the component
         Instance const moved = manager.removeComponent(e);
@@ -191,6 +222,8 @@ void FTransformManager::setTransform(Instance ci, const mat4& model) noexcept {
 
 void FTransformManager::updateNodeTransform(Instance i) noexcept {
     if (UTILS_UNLIKELY(mLocalTransformTransactionOpen)) {
+        // the world transform of this node and its descendants is computed during the commit
+        markDirty(i);
         return;
     }
 
@@ -206,6 +239,7 @@ void FTransformManager::updateNodeTransform(Instance i) noexcept {
             manager[parent].world, manager[i].local,
             manager[parent].worldTranslationLo, manager[i].localTranslationLo,
             mAccurateTranslations);
+    manager[i].generation = ++mGeneration;
 
     // update our children's world transforms
     Instance const child = manager[i].firstChild;
@@ -221,15 +255,41 @@ void FTransformManager::openLocalTransformTransaction() noexcept {
 void FTransformManager::commitLocalTransformTransaction() noexcept {
     if (mLocalTransformTransactionOpen) {
         mLocalTransformTransactionOpen = false;
-        computeAllWorldTransforms();
+        computeDirtyWorldTransforms();
     }
 }
 
+void FTransformManager::markDirty(Instance i) noexcept {
+    mManager[i].dirty = true;
+    mHasDirtyNodes = true;
+}
+
+void FTransformManager::markAllDirty() noexcept {
+    auto& manager = mManager;
+    std::fill(manager.begin<DIRTY>(), manager.end<DIRTY>(), true);
+    mHasDirtyNodes = true;
+}
+
 void FTransformManager::computeAllWorldTransforms() noexcept {
+    markAllDirty();
+    computeDirtyWorldTransforms();
+}
+
+void FTransformManager::computeDirtyWorldTransforms() noexcept {
+    if (!mHasDirtyNodes) {
+        return;
+    }
+
+    if (mLevelOrderEnabled) {
+        computeDirtyWorldTransformsByLevel();
+        return;
+    }
+
     auto& manager = mManager;
 
     // swapNode() below needs some temporary storage which we provide here
     const bool accurate = mAccurateTranslations;
+    const uint64_t generation = ++mGeneration;
     auto& soa = manager.getSoA();
     soa.ensureCapacity(soa.size() + 1);
 
@@ -241,12 +301,114 @@ void FTransformManager::computeAllWorldTransforms() noexcept {
         Instance const parent = manager[i].parent;
         assert_invariant(parent < i);
 
-        FTransformManager::computeWorldTransform(
-                manager[i].world, manager[i].worldTranslationLo,
-                manager[parent].world, manager[i].local,
-                manager[parent].worldTranslationLo, manager[i].localTranslationLo,
-                accurate);
+        // Parents are always processed before their children, so the dirty flag propagates
+        // down the whole subtree. Note: the node at index 0 (no parent) is never dirty.
+        if (manager[i].dirty || manager[parent].dirty) {
+            manager[i].dirty = true;
+            manager[i].generation = generation;
+            FTransformManager::computeWorldTransform(
+                    manager[i].world, manager[i].worldTranslationLo,
+                    manager[parent].world, manager[i].local,
+                    manager[parent].worldTranslationLo, manager[i].localTranslationLo,
+                    accurate);
+        }
+    }
+
+    std::fill(manager.begin<DIRTY>(), manager.end<DIRTY>(), false);
+    mHasDirtyNodes = false;
+}
+
+void FTransformManager::computeDirtyWorldTransformsByLevel() noexcept {
+    if (!mLevelOrderValid) {
+        sortByLevel();
+    }
+
+    auto& manager = mManager;
+    const bool accurate = mAccurateTranslations;
+    const uint64_t generation = ++mGeneration;
+
+    // All nodes of a level only depend on the previous level, so each level can be processed in
+    // parallel. The dirty flag of a node is only written by the job that owns it.
+    auto work = [&manager, accurate, generation](uint32_t start, uint32_t count) {
+        for (Instance i = start, e = start + count; i != e; ++i) {
+            Instance const parent = manager[i].parent;
+            assert_invariant(parent < i);
+            if (manager[i].dirty || manager[parent].dirty) {
+                manager[i].dirty = true;
+                manager[i].generation = generation;
+                FTransformManager::computeWorldTransform(
+                        manager[i].world, manager[i].worldTranslationLo,
+                        manager[parent].world, manager[i].local,
+                        manager[parent].worldTranslationLo, manager[i].localTranslationLo,
+                        accurate);
+            }
+        }
+    };
+
+    JobSystem* const js = mJobSystem;
+    for (size_t l = 0, c = mLevels.size() - 1; l < c; l++) {
+        uint32_t const start = mLevels[l];
+        uint32_t const count = mLevels[l + 1] - start;
+        if (js && count >= LEVEL_JOB_SIZE * 2) {
+            js->runAndWait(jobs::parallel_for(*js, nullptr, start, count,
+                    std::cref(work), jobs::CountSplitter<LEVEL_JOB_SIZE, 8>()));
+        } else {
+            work(start, count);
+        }
+    }
+
+    std::fill(manager.begin<DIRTY>(), manager.end<DIRTY>(), false);
+    mHasDirtyNodes = false;
+}
+
+void FTransformManager::sortByLevel() noexcept {
+    auto& manager = mManager;
+    size_t const count = manager.getComponentCount();
+
+    // Visit the hierarchy breadth-first starting from all the roots, this gives us the new order
+    // of the nodes as well as the boundaries of each level.
+    std::vector<Instance> order;
+    order.reserve(count);
+    for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
+        if (!Instance(manager[i].parent)) {
+            order.push_back(i);
+        }
     }
+
+    mLevels.clear();
+    for (size_t first = 0; first < order.size();) {
+        size_t const last = order.size();
+        mLevels.push_back(Instance(manager.begin() + first));
+        for (size_t k = first; k < last; k++) {
+            for (Instance c = manager[order[k]].firstChild; c; c = manager[c].next) {
+                order.push_back(c);
+            }
+        }
+        first = last;
+    }
+    mLevels.push_back(manager.end());
+    assert_invariant(order.size() == count);
+
+    // destination[i] is where the node currently at index i must move to
+    std::vector<Instance> destination(size_t(manager.end()));
+    for (size_t k = 0; k < count; k++) {
+        destination[order[k]] = Instance(manager.begin() + k);
+    }
+
+    // swapNode() below needs some temporary storage which we provide here
+    auto& soa = manager.getSoA();
+    soa.ensureCapacity(soa.size() + 1);
+
+    // apply the permutation, one cycle at a time
+    for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
+        while (destination[i] != i) {
+            Instance const j = destination[i];
+            swapNode(i, j);
+            std::swap(destination[i], destination[j]);
+        }
+    }
+
+    mLevelOrderValid = true;
 }
 
 // Inserts a parentless node in the hierarchy
@@ -285,6 +447,8 @@ void FTransformManager::swapNode(Instance i, Instance j) noexcept {
     std::swap(manager.elementAt<LOCAL_LO>(i), manager.elementAt<LOCAL_LO>(j));
     std::swap(manager.elementAt<WORLD>(i),    manager.elementAt<WORLD>(j));
     std::swap(manager.elementAt<WORLD_LO>(i), manager.elementAt<WORLD_LO>(j));
+    std::swap(manager.elementAt<DIRTY>(i),    manager.elementAt<DIRTY>(j));
+    std::swap(manager.elementAt<GENERATION>(i), manager.elementAt<GENERATION>(j));
     manager.swap(i, j); // this swaps the data relative to SingleInstanceComponentManager
 
     // now swap the linked-list references, to do that correctly we must use a temporary
@@ -373,6 +537,7 @@ void FTransformManager::updateNode(Instance i) noexcept {
 
 void FTransformManager::transformChildren(Sim& manager, Instance i) noexcept {
     const bool accurate = mAccurateTranslations;
+    const uint64_t generation = mGeneration;
     while (i) {
         // update child's world transform
         Instance const parent = manager[i].parent;
@@ -381,6 +546,7 @@ void FTransformManager::transformChildren(Sim& manager, Instance i) noexcept {
                 manager[parent].world, manager[i].local,
                 manager[parent].worldTranslationLo, manager[i].localTranslationLo,
                 accurate);
+        manager[i].generation = generation;
 
         // assume we don't have a deep hierarchy
         Instance const child = manager[i].firstChild;
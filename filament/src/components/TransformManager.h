@@ -28,6 +28,12 @@
 
 #include <math/mat4.h>
 
+#include <vector>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 
 class UTILS_PRIVATE FTransformManager : public TransformManager {
@@ -59,6 +65,18 @@ public:
         return mAccurateTranslations;
     }
 
+    void setLevelOrderEnabled(bool enable) noexcept;
+
+    bool isLevelOrderEnabled() const noexcept {
+        return mLevelOrderEnabled;
+    }
+
+    // The job system used to compute world transforms in parallel in level-order mode. If not set
+    // (e.g. in unit tests), all levels are computed on the calling thread.
+    void setJobSystem(utils::JobSystem* js) noexcept {
+        mJobSystem = js;
+    }
+
     void create(utils::Entity entity);
 
     void create(utils::Entity entity, Instance parent, const math::mat4f& localTransform);
@@ -101,6 +119,17 @@ public:
         return mManager[ci].world;
     }
 
+    // The generation is incremented each time world transforms are updated, and each component
+    // records the generation at which its world transform last changed. This allows clients
+    // to find which transforms changed since they last looked.
+    uint64_t getGeneration() const noexcept {
+        return mGeneration;
+    }
+
+    uint64_t getGeneration(Instance ci) const noexcept {
+        return mManager[ci].generation;
+    }
+
     math::mat4 getTransformAccurate(Instance ci) const noexcept {
         math::mat4f const& local = mManager[ci].local;
         math::float3 localTranslationLo = mManager[ci].localTranslationLo;
@@ -128,7 +157,12 @@ private:
     void swapNode(Instance i, Instance j) noexcept;
     void transformChildren(Sim& manager, Instance firstChild) noexcept;
 
+    void markDirty(Instance i) noexcept;
+    void markAllDirty() noexcept;
+    void sortByLevel() noexcept;
     void computeAllWorldTransforms() noexcept;
+    void computeDirtyWorldTransforms() noexcept;
+    void computeDirtyWorldTransformsByLevel() noexcept;
 
     static void computeWorldTransform(math::mat4f& outWorld, math::float3& inoutWorldTranslationLo,
             math::mat4f const& pt, math::mat4f const& local,
@@ -146,6 +180,8 @@ private:
         FIRST_CHILD,    // instance to our first child
         NEXT,           // instance to our next sibling
         PREV,           // instance to our previous sibling
+        DIRTY,          // world transform needs to be recomputed
+        GENERATION,     // generation at which the world transform last changed
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -156,7 +192,9 @@ private:
             Instance,       // parent
             Instance,       // firstChild
             Instance,       // next
-            Instance        // prev
+            Instance,       // prev
+            bool,           // dirty
+            uint64_t        // generation
     >;
 
     struct Sim : public Base {
@@ -181,6 +219,8 @@ private:
                 Field<FIRST_CHILD>  firstChild;
                 Field<NEXT>         next;
                 Field<PREV>         prev;
+                Field<DIRTY>        dirty;
+                Field<GENERATION>   generation;
             };
         };
 
@@ -193,8 +233,18 @@ private:
     };
 
     Sim mManager;
+    utils::JobSystem* mJobSystem = nullptr;
+    uint64_t mGeneration = 0;
+
+    // In level-order mode, the components are sorted by depth and level i spans the instances
+    // [mLevels[i], mLevels[i + 1]).
+    std::vector<Instance> mLevels;
+
     bool mLocalTransformTransactionOpen = false;
     bool mAccurateTranslations = false;
+    bool mLevelOrderEnabled = false;
+    bool mLevelOrderValid = false;
+    bool mHasDirtyNodes = false;
 };
 
 FILAMENT_DOWNCAST(TransformManager)
@@ -65,6 +65,7 @@ void FBufferObject::terminate(FEngine& engine) {
 
 void FBufferObject::setBuffer(FEngine& engine, BufferDescriptor&& buffer, uint32_t byteOffset) {
     engine.getDriverApi().updateBufferObject(mHandle, std::move(buffer), byteOffset);
+    mGeneration++;
 }
 
 } // namespace filament
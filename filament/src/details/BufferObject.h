@@ -42,11 +42,15 @@ public:
 
     BindingType getBindingType() const noexcept { return mBindingType; }
 
+    // incremented each time the content of the buffer is updated
+    uint32_t getGeneration() const noexcept { return mGeneration; }
+
 private:
     friend class BufferObject;
     void setBuffer(FEngine& engine, BufferDescriptor&& buffer, uint32_t byteOffset = 0);
     backend::Handle<backend::HwBufferObject> mHandle;
     uint32_t mByteCount;
+    uint32_t mGeneration = 0;
     BindingType mBindingType;
 };
 
@@ -97,7 +97,8 @@ Engine* FEngine::create(Engine::Builder const& builder) {
             return nullptr;
         }
         DriverConfig const driverConfig{
-            .handleArenaSize = instance->getRequestedDriverHandleArenaSize() };
+            .handleArenaSize = instance->getRequestedDriverHandleArenaSize(),
+            .skipDrawsWithPendingPrograms = instance->mConfig.skipDrawsWithPendingPrograms };
         instance->mDriver = platform->createDriver(sharedContext, driverConfig);
 
     } else {
@@ -210,6 +211,8 @@ FEngine::FEngine(Engine::Builder const& builder) :
     // (it may not be the case)
     mJobSystem.adopt();
 
+    mTransformManager.setJobSystem(&mJobSystem);
+
     slog.i << "FEngine (" << sizeof(void*) * 8 << " bits) created at " << this << " "
            << "(threading is " << (UTILS_HAS_THREADING ? "enabled)" : "disabled)") << io::endl;
 }
@@ -242,7 +245,7 @@ void FEngine::init() {
     slog.i << "FEngine feature level: " << int(mActiveFeatureLevel) << io::endl;
 
 
-    mResourceAllocator = new ResourceAllocator(driverApi);
+    mResourceAllocator = new ResourceAllocator(mConfig, driverApi);
 
     mFullScreenTriangleVb = downcast(VertexBuffer::Builder()
             .vertexCount(3)
@@ -503,6 +506,17 @@ void FEngine::prepare() {
 #endif
         material->getDefaultInstance()->commit(driver);
     });
+
+    // Compile a few of the variants used by previous sessions each frame, so that the driver
+    // thread keeps up. Each material compiles its variants in the order of their first use.
+    size_t budget = mConfig.variantPrecompilationBudget;
+    if (UTILS_UNLIKELY(budget)) {
+        mMaterials.forEach([&budget](FMaterial* material) {
+            if (budget && material->hasProfiledVariantsToPrecompile()) {
+                budget -= material->precompileProfiledVariants(budget);
+            }
+        });
+    }
 }
 
 void FEngine::gc() {
@@ -519,6 +533,18 @@ void FEngine::flush() {
     flushCommandBuffer(mCommandBufferQueue);
 }
 
+void FEngine::startTracing() noexcept {
+    SYSTRACE_START_RECORDING();
+}
+
+void FEngine::stopTracing() noexcept {
+    SYSTRACE_STOP_RECORDING();
+}
+
+bool FEngine::writeTrace(const char* path) noexcept {
+    return SYSTRACE_WRITE_TRACE(path);
+}
+
 void FEngine::flushAndWait() {
 
 #if defined(__ANDROID__)
@@ -607,7 +633,9 @@ int FEngine::loop() {
     JobSystem::setThreadName("FEngine::loop");
     JobSystem::setThreadPriority(JobSystem::Priority::DISPLAY);
 
-    DriverConfig const driverConfig { .handleArenaSize = getRequestedDriverHandleArenaSize() };
+    DriverConfig const driverConfig {
+            .handleArenaSize = getRequestedDriverHandleArenaSize(),
+            .skipDrawsWithPendingPrograms = mConfig.skipDrawsWithPendingPrograms };
     mDriver = mPlatform->createDriver(mSharedGLContext, driverConfig);
 
     mDriverBarrier.latch();
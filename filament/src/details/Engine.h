@@ -223,6 +223,11 @@ public:
         return *mResourceAllocator;
     }
 
+    ResourceAllocator const& getResourceAllocator() const noexcept {
+        assert_invariant(mResourceAllocator);
+        return *mResourceAllocator;
+    }
+
     void* streamAlloc(size_t size, size_t alignment) noexcept;
 
     Epoch getEngineEpoch() const { return mEngineEpoch; }
@@ -293,6 +298,10 @@ public:
 
     void flushAndWait();
 
+    void startTracing() noexcept;
+    void stopTracing() noexcept;
+    bool writeTrace(const char* path) noexcept;
+
     // flush the current buffer
     void flush();
 
@@ -357,6 +366,16 @@ public:
         return mAutomaticInstancingEnabled;
     }
 
+    // Incremented each time a MaterialInstance state that is baked into RenderPass commands
+    // changes (e.g. its culling mode). This invalidates the RenderPass::CommandCache.
+    void markMaterialInstanceStateChanged() noexcept {
+        mMaterialInstanceStateGeneration++;
+    }
+
+    uint32_t getMaterialInstanceStateGeneration() const noexcept {
+        return mMaterialInstanceStateGeneration;
+    }
+
     backend::Handle<backend::HwTexture> getOneTexture() const { return mDummyOneTexture; }
     backend::Handle<backend::HwTexture> getZeroTexture() const { return mDummyZeroTexture; }
     backend::Handle<backend::HwTexture> getOneTextureArray() const { return mDummyOneTextureArray; }
@@ -408,6 +427,7 @@ private:
     Platform* mPlatform = nullptr;
     bool mOwnPlatform = false;
     bool mAutomaticInstancingEnabled = false;
+    uint32_t mMaterialInstanceStateGeneration = 0;
     void* mSharedGLContext = nullptr;
     backend::Handle<backend::HwRenderPrimitive> mFullScreenTriangleRph;
     FVertexBuffer* mFullScreenTriangleVb = nullptr;
@@ -518,6 +538,7 @@ public:
             // capture to file. At the moment, only supported by the Metal backend.
             bool doFrameCapture = false;
             bool disable_buffer_padding = false;
+            bool disable_framegraph_cache = false;
         } renderer;
         matdbg::DebugServer* server = nullptr;
     } debug;
@@ -67,6 +67,7 @@ void FIndexBuffer::terminate(FEngine& engine) {
 
 void FIndexBuffer::setBuffer(FEngine& engine, BufferDescriptor&& buffer, uint32_t byteOffset) {
     engine.getDriverApi().updateIndexBuffer(mHandle, std::move(buffer), byteOffset);
+    mGeneration++;
 }
 
 } // namespace filament
@@ -42,10 +42,14 @@ public:
 
     void setBuffer(FEngine& engine, BufferDescriptor&& buffer, uint32_t byteOffset = 0);
 
+    // incremented each time the content of the buffer is updated
+    uint32_t getGeneration() const noexcept { return mGeneration; }
+
 private:
     friend class IndexBuffer;
     backend::Handle<backend::HwIndexBuffer> mHandle;
     uint32_t mIndexCount;
+    uint32_t mGeneration = 0;
 };
 
 FILAMENT_DOWNCAST(IndexBuffer)
@@ -30,6 +30,7 @@
 #include <private/filament/BufferInterfaceBlock.h>
 
 #include <backend/DriverEnums.h>
+#include <backend/Platform.h>
 #include <backend/Program.h>
 
 #include <utils/CString.h>
@@ -45,9 +46,10 @@ using namespace backend;
 using namespace filaflat;
 using namespace utils;
 
-static MaterialParser* createParser(Backend backend, const void* data, size_t size) {
+static MaterialParser* createParser(Backend backend, const void* data, size_t size,
+        bool copy = true) {
     // unique_ptr so we don't leak MaterialParser on failures below
-    auto materialParser = std::make_unique<MaterialParser>(backend, data, size);
+    auto materialParser = std::make_unique<MaterialParser>(backend, data, size, copy);
 
     MaterialParser::ParseResult const materialResult = materialParser->parse();
 
@@ -74,6 +76,9 @@ static MaterialParser* createParser(Backend backend, const void* data, size_t si
 struct Material::BuilderDetails {
     const void* mPayload = nullptr;
     size_t mSize = 0;
+    bool mCopyPackage = true;
+    Material::Builder::PackageReleaseCallback mPackageReleaseCallback = nullptr;
+    void* mPackageReleaseUser = nullptr;
     MaterialParser* mMaterialParser = nullptr;
     bool mDefaultMaterial = false;
     std::unordered_map<std::string, std::variant<int32_t, float, bool>> mConstantSpecializations;
@@ -94,6 +99,21 @@ BuilderType::Builder& BuilderType::Builder::operator=(BuilderType::Builder&& rhs
 Material::Builder& Material::Builder::package(const void* payload, size_t size) {
     mImpl->mPayload = payload;
     mImpl->mSize = size;
+    mImpl->mCopyPackage = true;
+    mImpl->mPackageReleaseCallback = nullptr;
+    mImpl->mPackageReleaseUser = nullptr;
+    return *this;
+}
+
+Material::Builder& Material::Builder::package(const void* payload, size_t size,
+        PackageReleaseCallback callback, void* user) {
+    // the material package is laid out assuming it's loaded at an 8-bytes aligned address
+    ASSERT_PRECONDITION(uintptr_t(payload) % 8 == 0, "payload must be 8-bytes aligned");
+    mImpl->mPayload = payload;
+    mImpl->mSize = size;
+    mImpl->mCopyPackage = false;
+    mImpl->mPackageReleaseCallback = callback;
+    mImpl->mPackageReleaseUser = user;
     return *this;
 }
 
@@ -109,8 +129,8 @@ template Material::Builder& Material::Builder::constant<float>(const char*, size
 template Material::Builder& Material::Builder::constant<bool>(const char*, size_t, bool);
 
 Material* Material::Builder::build(Engine& engine) {
-    std::unique_ptr<MaterialParser> materialParser{ createParser(
-            downcast(engine).getBackend(), mImpl->mPayload, mImpl->mSize) };
+    std::unique_ptr<MaterialParser> materialParser{ createParser(downcast(engine).getBackend(),
+            mImpl->mPayload, mImpl->mSize, mImpl->mCopyPackage) };
 
     if (materialParser == nullptr) {
         return nullptr;
@@ -151,6 +171,13 @@ FMaterial::FMaterial(FEngine& engine, const Material::Builder& builder)
     MaterialParser* parser = builder->mMaterialParser;
     mMaterialParser = parser;
 
+    if (!builder->mCopyPackage) {
+        mPackage = builder->mPayload;
+        mPackageSize = builder->mSize;
+        mPackageReleaseCallback = builder->mPackageReleaseCallback;
+        mPackageReleaseUser = builder->mPackageReleaseUser;
+    }
+
     UTILS_UNUSED_IN_RELEASE bool const nameOk = parser->getName(&mName);
     assert_invariant(nameOk);
 
@@ -445,12 +472,18 @@ FMaterial::FMaterial(FEngine& engine, const Material::Builder& builder)
         parser->getSpecularAntiAliasingThreshold(&mSpecularAntiAliasingThreshold);
     }
 
+    loadVariantProfile();
+
     // we can only initialize the default instance once we're initialized ourselves
     mDefaultInstance.initDefaultInstance(engine, this);
 }
 
 FMaterial::~FMaterial() noexcept {
     delete mMaterialParser;
+    // the parser may have been referencing the package memory until now
+    if (mPackageReleaseCallback) {
+        mPackageReleaseCallback(mPackage, mPackageSize, mPackageReleaseUser);
+    }
 }
 
 void FMaterial::terminate(FEngine& engine) {
@@ -463,6 +496,7 @@ void FMaterial::terminate(FEngine& engine) {
     }
 #endif
 
+    saveVariantProfile();
     destroyPrograms(engine);
     mDefaultInstance.terminate(engine);
 }
@@ -470,6 +504,7 @@ void FMaterial::terminate(FEngine& engine) {
 void FMaterial::compile(backend::CallbackHandler* handler,
         utils::Invocable<void(Material*)>&& callback,
         UserVariantFilterMask variantFilter) noexcept {
+    mIsCompiling = true;
     auto const& variants = isVariantLit() ?
             VariantUtils::getLitVariants() : VariantUtils::getUnlitVariants();
     for (auto const variant : variants) {
@@ -479,6 +514,7 @@ void FMaterial::compile(backend::CallbackHandler* handler,
             }
         }
     }
+    mIsCompiling = false;
 
     struct Callback {
         Invocable<void(Material*)> f;
@@ -494,6 +530,27 @@ void FMaterial::compile(backend::CallbackHandler* handler,
     mEngine.getDriverApi().compilePrograms(handler, &Callback::func, static_cast<void*>(user));
 }
 
+size_t FMaterial::precompileProfiledVariants(size_t budget) noexcept {
+    size_t count = 0;
+    while (count < budget && mPrecompiledVariantCount < mProfiledVariantCount) {
+        Variant const variant{ mVariantProfile[mPrecompiledVariantCount++] };
+        // the profile was validated by loadVariantProfile(), but it could be stale, so make sure
+        // this variant still makes sense for this material before anything else
+        if (getMaterialDomain() == MaterialDomain::SURFACE &&
+                variant != Variant::filterVariant(variant, isVariantLit())) {
+            continue;
+        }
+        if (isCached(variant)) {
+            continue;
+        }
+        if (hasVariant(variant)) {
+            prepareProgram(variant);
+            count++;
+        }
+    }
+    return count;
+}
+
 FMaterialInstance* FMaterial::createInstance(const char* name) const noexcept {
     return FMaterialInstance::duplicate(&mDefaultInstance, name);
 }
@@ -540,6 +597,10 @@ bool FMaterial::hasVariant(Variant variant) const noexcept {
 
 void FMaterial::prepareProgramSlow(Variant variant) const noexcept {
     assert_invariant(mEngine.hasFeatureLevel(mFeatureLevel));
+    if (mVariantProfile.capacity() && !mIsCompiling && !mVariantProfileSet[variant.key]) {
+        mVariantProfileSet.set(variant.key);
+        mVariantProfile.push_back(variant.key);
+    }
     switch (getMaterialDomain()) {
         case MaterialDomain::SURFACE:
             getSurfaceProgramSlow(variant);
@@ -660,6 +721,53 @@ void FMaterial::createAndCacheProgram(Program&& p, Variant variant) const noexce
     mCachedPrograms[variant.key] = program;
 }
 
+FMaterial::VariantProfileBlobKey FMaterial::getVariantProfileBlobKey() const noexcept {
+    VariantProfileBlobKey key{ .tag = "variantprofile", .cacheId = mCacheId };
+    return key;
+}
+
+void FMaterial::loadVariantProfile() noexcept {
+    Platform* const platform = mEngine.getPlatform();
+    if (!mEngine.getConfig().variantPrecompilationBudget || !platform->hasBlobFunc()) {
+        return;
+    }
+
+    // a non-zero capacity enables the recording of the variants in prepareProgramSlow()
+    mVariantProfile = FixedCapacityVector<Variant::type_t>::with_capacity(VARIANT_COUNT);
+
+    // the profile is simply the list of variant keys, in the order of their first use
+    VariantProfileBlobKey const key = getVariantProfileBlobKey();
+    size_t const size = platform->retrieveBlob(&key, sizeof(key), nullptr, 0);
+    if (size == 0 || size > VARIANT_COUNT) {
+        return;
+    }
+    mVariantProfile.resize(size);
+    if (platform->retrieveBlob(&key, sizeof(key), mVariantProfile.data(), size) != size) {
+        mVariantProfile.clear();
+        return;
+    }
+    // the blob cache can't be trusted, if any entry is invalid the whole profile is ignored
+    for (Variant::type_t const k : mVariantProfile) {
+        if (UTILS_UNLIKELY(k >= VARIANT_COUNT || Variant::isReserved(Variant{ k }) ||
+                mVariantProfileSet[k])) {
+            mVariantProfile.clear();
+            mVariantProfileSet.reset();
+            return;
+        }
+        mVariantProfileSet.set(k);
+    }
+    mProfiledVariantCount = uint32_t(size);
+}
+
+void FMaterial::saveVariantProfile() const noexcept {
+    // only save the profile if variants were used for the first time during this session
+    if (mVariantProfile.size() > mProfiledVariantCount) {
+        VariantProfileBlobKey const key = getVariantProfileBlobKey();
+        mEngine.getPlatform()->insertBlob(&key, sizeof(key),
+                mVariantProfile.data(), mVariantProfile.size());
+    }
+}
+
 size_t FMaterial::getParameters(ParameterInfo* parameters, size_t count) const noexcept {
     count = std::min(count, getParameterCount());
 
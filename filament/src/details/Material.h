@@ -33,6 +33,7 @@
 #include <utils/Mutex.h>
 
 #include <atomic>
+#include <type_traits>
 
 namespace filament {
 
@@ -67,6 +68,15 @@ public:
             utils::Invocable<void(Material*)>&& callback,
             UserVariantFilterMask variantFilter) noexcept;
 
+    // Compiles at most "budget" of the variants recorded by the profile of a previous session,
+    // in the order of their first use. Returns the number of variants compiled.
+    // See Engine::Config::variantPrecompilationBudget.
+    size_t precompileProfiledVariants(size_t budget) noexcept;
+
+    bool hasProfiledVariantsToPrecompile() const noexcept {
+        return mPrecompiledVariantCount < mProfiledVariantCount;
+    }
+
     // Create an instance of this material
     FMaterialInstance* createInstance(const char* name) const noexcept;
 
@@ -201,9 +211,32 @@ private:
     void createAndCacheProgram(backend::Program&& p,
             Variant variant) const noexcept;
 
+    // Key of the variant profile in the platform's blob cache.
+    struct VariantProfileBlobKey {
+        char tag[16];
+        uint64_t cacheId;
+    };
+
+    static_assert(std::is_trivially_copyable<VariantProfileBlobKey>::value,
+            "VariantProfileBlobKey must be a POD, it's used as a key as is.");
+
+    VariantProfileBlobKey getVariantProfileBlobKey() const noexcept;
+    void loadVariantProfile() noexcept;
+    void saveVariantProfile() const noexcept;
+
     // try to order by frequency of use
     mutable std::array<backend::Handle<backend::HwProgram>, VARIANT_COUNT> mCachedPrograms;
 
+    // Variants in the order of their first use. Only the first mProfiledVariantCount entries were
+    // loaded from the profile of a previous session, mPrecompiledVariantCount of which have been
+    // processed by precompileProfiledVariants() so far. Empty with no capacity when disabled.
+    mutable utils::FixedCapacityVector<Variant::type_t> mVariantProfile;
+    mutable VariantList mVariantProfileSet;
+    uint32_t mProfiledVariantCount = 0;
+    uint32_t mPrecompiledVariantCount = 0;
+    // variants compiled by compile() aren't necessarily used, so they're not recorded
+    bool mIsCompiling = false;
+
     backend::RasterState mRasterState;
     BlendingMode mRenderBlendingMode = BlendingMode::OPAQUE;
     TransparencyMode mTransparencyMode = TransparencyMode::DEFAULT;
@@ -266,6 +299,12 @@ private:
     uint64_t mCacheId = 0;
     mutable uint32_t mMaterialInstanceId = 0;
     MaterialParser* mMaterialParser = nullptr;
+
+    // only set when the package is used in place, see Material::Builder::package()
+    const void* mPackage = nullptr;
+    size_t mPackageSize = 0;
+    Material::Builder::PackageReleaseCallback mPackageReleaseCallback = nullptr;
+    void* mPackageReleaseUser = nullptr;
 };
 
 
@@ -243,7 +243,10 @@ void FMaterialInstance::setDoubleSided(bool doubleSided) noexcept {
     if (doubleSided) {
         setCullingMode(CullingMode::NONE);
     }
-    mIsDoubleSided = doubleSided;
+    if (mIsDoubleSided != doubleSided) {
+        mIsDoubleSided = doubleSided;
+        markCommandStateChanged();
+    }
 }
 
 bool FMaterialInstance::isDoubleSided() const noexcept {
@@ -251,11 +254,26 @@ bool FMaterialInstance::isDoubleSided() const noexcept {
 }
 
 void FMaterialInstance::setTransparencyMode(TransparencyMode mode) noexcept {
-    mTransparencyMode = mode;
+    if (mTransparencyMode != mode) {
+        mTransparencyMode = mode;
+        markCommandStateChanged();
+    }
 }
 
 void FMaterialInstance::setDepthCulling(bool enable) noexcept {
-    mDepthFunc = enable ? RasterState::DepthFunc::GE : RasterState::DepthFunc::A;
+    RasterState::DepthFunc const depthFunc =
+            enable ? RasterState::DepthFunc::GE : RasterState::DepthFunc::A;
+    if (mDepthFunc != depthFunc) {
+        mDepthFunc = depthFunc;
+        markCommandStateChanged();
+    }
+}
+
+void FMaterialInstance::markCommandStateChanged() const noexcept {
+    // this can be called before the instance is fully initialized
+    if (mMaterial) {
+        mMaterial->getEngine().markMaterialInstanceStateChanged();
+    }
 }
 
 bool FMaterialInstance::isDepthCullingEnabled() const noexcept {
@@ -126,11 +126,26 @@ public:
 
     void setTransparencyMode(TransparencyMode mode) noexcept;
 
-    void setCullingMode(CullingMode culling) noexcept { mCulling = culling; }
+    void setCullingMode(CullingMode culling) noexcept {
+        if (mCulling != culling) {
+            mCulling = culling;
+            markCommandStateChanged();
+        }
+    }
 
-    void setColorWrite(bool enable) noexcept { mColorWrite = enable; }
+    void setColorWrite(bool enable) noexcept {
+        if (mColorWrite != enable) {
+            mColorWrite = enable;
+            markCommandStateChanged();
+        }
+    }
 
-    void setDepthWrite(bool enable) noexcept { mDepthWrite = enable; }
+    void setDepthWrite(bool enable) noexcept {
+        if (mDepthWrite != enable) {
+            mDepthWrite = enable;
+            markCommandStateChanged();
+        }
+    }
 
     void setStencilWrite(bool enable) noexcept { mStencilState.stencilWrite = enable; }
 
@@ -232,6 +247,10 @@ private:
 
     void commitSlow(FEngine::DriverApi& driver) const;
 
+    // The culling mode, color/depth write, depth func and transparency mode are baked into the
+    // commands cached by RenderPass::CommandCache, which must be invalidated when they change.
+    void markCommandStateChanged() const noexcept;
+
     // keep these grouped, they're accessed together in the render-loop
     FMaterial const* mMaterial = nullptr;
 
@@ -43,6 +43,8 @@
 #include <utils/vector.h>
 #include <utils/debug.h>
 
+#include <algorithm>
+
 // this helps visualize what dynamic-scaling is doing
 #define DEBUG_DYNAMIC_SCALING false
 
@@ -70,6 +72,8 @@ FRenderer::FRenderer(FEngine& engine) :
             &engine.debug.renderer.doFrameCapture);
     debugRegistry.registerProperty("d.renderer.disable_buffer_padding",
             &engine.debug.renderer.disable_buffer_padding);
+    debugRegistry.registerProperty("d.renderer.disable_framegraph_cache",
+            &engine.debug.renderer.disable_framegraph_cache);
 
     DriverApi& driver = engine.getDriverApi();
 
@@ -492,6 +496,22 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
         scale = 1.0f;
     }
 
+    // Screen-space effects can run at a lower resolution than the View, see
+    // PostProcessResolutionOptions. This is 1, 0.5 or 0.25.
+    float const postProcessScale = view.getPostProcessScale();
+    // The SSAO buffer is scaled relative to the structure pass, which keeps the resolution set
+    // by aoOptions because picking and SSR use it too.
+    float const ssaoScale = std::min(1.0f, postProcessScale / aoOptions.resolution);
+    if (postProcessScale < 1.0f) {
+        // DoF only has a native and a half resolution mode
+        dofOptions.nativeResolution = false;
+        // Drop a bloom level each time the resolution is halved, which keeps the blur's spread.
+        uint8_t const droppedLevels = postProcessScale < 0.5f ? 2u : 1u;
+        bloomOptions.levels = uint8_t(std::max(3, bloomOptions.levels - droppedLevels));
+        bloomOptions.resolution = std::max(1u << bloomOptions.levels,
+                uint32_t(float(bloomOptions.resolution) * postProcessScale));
+    }
+
     const bool blendModeTranslucent = view.getBlendMode() == BlendMode::TRANSLUCENT;
     // If the swap-chain is transparent or if we blend into it, we need to allocate our intermediate
     // buffers with an alpha channel.
@@ -640,7 +660,8 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
      * Frame graph
      */
 
-    FrameGraph fg(engine.getResourceAllocator());
+    FrameGraph fg(engine.getResourceAllocator(), engine.debug.renderer.disable_framegraph_cache ?
+            nullptr : &view.getFrameGraphCache());
     auto& blackboard = fg.getBlackboard();
 
     /*
@@ -826,7 +847,8 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
 
     if (aoOptions.enabled) {
         // we could rely on FrameGraph culling, but this creates unnecessary CPU work
-        auto ssao = ppm.screenSpaceAmbientOcclusion(fg, svp, cameraInfo, structure, aoOptions);
+        auto ssao = ppm.screenSpaceAmbientOcclusion(fg, svp, cameraInfo, structure, aoOptions,
+                ssaoScale);
         blackboard["ssao"] = ssao;
     }
 
@@ -849,7 +871,8 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
                 view.getPerViewUniforms(),
                 structure,
                 ssReflectionsOptions,
-                { .width = svp.width, .height = svp.height });
+                { .width = std::max(1u, uint32_t(float(svp.width) * postProcessScale)),
+                  .height = std::max(1u, uint32_t(float(svp.height) * postProcessScale)) });
 
         // generate the mipchain
         PostProcessManager::generateMipmapSSR(ppm, fg,
@@ -862,7 +885,14 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     // This one doesn't need to be a FrameGraph pass because it always happens by construction
     // (i.e. it won't be culled, unless everything is culled), so no need to complexify things.
     pass.setVariant(variant);
+    pass.setCommandCache(&view.getCommandCache());
     pass.appendCommands(engine, RenderPass::COLOR);
+    pass.setCommandCache(nullptr);
+    RenderPass::CommandCache::Stats const commandCacheStats = view.getCommandCache().getStats();
+    mFrameInfoManager.addCommandCacheStats(commandCacheStats.hits, commandCacheStats.misses);
+    SYSTRACE_CONTEXT();
+    SYSTRACE_VALUE32("commandCacheHits", commandCacheStats.hits);
+    SYSTRACE_VALUE32("commandCacheMisses", commandCacheStats.misses);
 
     // color-grading as subpass is done either by the color pass or the TAA pass if any
     auto colorGradingConfigForColor = colorGradingConfig;
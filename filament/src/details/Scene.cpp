@@ -54,9 +54,6 @@ void FScene::prepare(utils::JobSystem& js,
         LinearAllocatorArena& allocator,
         const mat4& worldOriginTransform,
         bool shadowReceiversAreCasters) noexcept {
-    // TODO: can we skip this in most cases? Since we rely on indices staying the same,
-    //       we could only skip, if nothing changed in the RCM.
-
     SYSTRACE_CALL();
 
     SYSTRACE_CONTEXT();
@@ -74,7 +71,7 @@ void FScene::prepare(utils::JobSystem& js,
     auto& lightData = mLightData;
     auto const& entities = mEntities;
 
-    using RenderableContainerData = std::pair<RenderableManager::Instance, TransformManager::Instance>;
+    using RenderableContainerData = RenderableKey;
     using RenderableInstanceContainer = FixedCapacityVector<RenderableContainerData,
             utils::STLAllocator< RenderableContainerData, LinearAllocatorArena >, false>;
 
@@ -117,13 +114,29 @@ void FScene::prepare(utils::JobSystem& js,
                 }
             }
             if (ri) {
-                renderableInstances.emplace_back(ri, ti);
+                renderableInstances.push_back({ e, ri, ti });
             }
         }
     }
 
     SYSTRACE_NAME_END();
 
+    /*
+     * With hierarchical culling, static renderables are stored first, so that the
+     * dynamic ones can be culled individually without touching the static ones.
+     */
+
+    uint32_t staticRenderableCount = 0;
+    if (mHierarchicalCullingEnabled) {
+        auto const pivot = std::partition(
+                renderableInstances.begin(), renderableInstances.end(),
+                [&rcm](RenderableContainerData const& data) {
+                    return rcm.isStaticGeometry(data.ri);
+                });
+        staticRenderableCount = uint32_t(std::distance(renderableInstances.begin(), pivot));
+    }
+    mStaticRenderableCount = staticRenderableCount;
+
     /*
      * Evaluate the capacity needed for the renderable and light SoAs
      */
@@ -131,6 +144,11 @@ void FScene::prepare(utils::JobSystem& js,
     // we need the capacity to be multiple of 16 for SIMD loops
     // we need 1 extra entry at the end for the summed primitive count
     size_t renderableDataCapacity = entities.size();
+    if (mHierarchicalCullingEnabled) {
+        // dynamic renderables don't necessarily start on a multiple of Culler::MODULO,
+        // culling them can touch up to MODULO - 1 entries past the rounded-up size.
+        renderableDataCapacity += Culler::MODULO - 1;
+    }
     renderableDataCapacity = (renderableDataCapacity + 0xFu) & ~0xFu;
     renderableDataCapacity = renderableDataCapacity + 1;
 
@@ -146,7 +164,8 @@ void FScene::prepare(utils::JobSystem& js,
 
     // TODO: the resize below could happen in a job
 
-    if (sceneData.size() != renderableInstances.size()) {
+    if (sceneData.size() != renderableInstances.size() ||
+            sceneData.capacity() < renderableDataCapacity) {
         sceneData.clear();
         if (sceneData.capacity() < renderableDataCapacity) {
             sceneData.setCapacity(renderableDataCapacity);
@@ -164,16 +183,50 @@ void FScene::prepare(utils::JobSystem& js,
         lightData.resize(lightInstances.size() + DIRECTIONAL_LIGHTS_COUNT);
     }
 
+    /*
+     * The renderable cache must be recomputed entirely if the world origin or the shadow
+     * settings changed. Rows past its previous size are default-initialized, and will never
+     * match a renderable.
+     */
+
+    auto& cache = mRenderableCache;
+    // note: fuzzyEqual() returns true when the matrices differ
+    if (mat4::fuzzyEqual(mCachedWorldOriginTransform, worldOriginTransform) ||
+            mCachedShadowReceiversAreCasters != shadowReceiversAreCasters) {
+        cache.clear();
+        mCachedWorldOriginTransform = worldOriginTransform;
+        mCachedShadowReceiversAreCasters = shadowReceiversAreCasters;
+    }
+    cache.resize(renderableInstances.size());
+
     /*
      * Fill the SoA with the JobSystem
      */
 
     auto renderableWork = [first = renderableInstances.data(), &rcm, &tcm, &worldOriginTransform,
-                 &sceneData, shadowReceiversAreCasters](auto* p, auto c) {
+                 &sceneData, &cache, shadowReceiversAreCasters,
+                 renderableGeneration = mRenderableGeneration,
+                 transformGeneration = mTransformGeneration](auto* p, auto c) {
         SYSTRACE_NAME("renderableWork");
 
+        size_t const start = std::distance(first, p);
+
         for (size_t i = 0; i < c; i++) {
-            auto [ri, ti] = p[i];
+            auto const& [e, ri, ti] = p[i];
+            size_t const index = start + i;
+            assert_invariant(index < cache.size());
+
+            // skip this row if it was computed from the same components, and they didn't
+            // change since.
+            RenderableKey& key = cache.elementAt<CACHE_KEY>(index);
+            bool const changed = !(key.entity == e && key.ri == ri && key.ti == ti &&
+                    rcm.getGeneration(ri) <= renderableGeneration &&
+                    tcm.getGeneration(ti) <= transformGeneration);
+            cache.elementAt<CACHE_CHANGED>(index) = changed;
+            if (!changed) {
+                continue;
+            }
+            key = p[i];
 
             // this is where we go from double to float for our transforms
             const mat4f worldTransform{
@@ -195,25 +248,47 @@ void FScene::prepare(utils::JobSystem& js,
             float const scale = (length(transform[0].xyz) + length(transform[1].xyz) +
                                  length(transform[2].xyz)) / 3.0f;
 
-            size_t const index = std::distance(first, p) + i;
-            assert_invariant(index < sceneData.size());
-
-            sceneData.elementAt<RENDERABLE_INSTANCE>(index) = ri;
-            sceneData.elementAt<WORLD_TRANSFORM>(index)     = worldTransform;
-            sceneData.elementAt<VISIBILITY_STATE>(index)    = visibility;
-            sceneData.elementAt<SKINNING_BUFFER>(index)     = rcm.getSkinningBufferInfo(ri);
-            sceneData.elementAt<MORPHING_BUFFER>(index)     = rcm.getMorphingBufferInfo(ri);
-            sceneData.elementAt<INSTANCES>(index)           = rcm.getInstancesInfo(ri);
-            sceneData.elementAt<WORLD_AABB_CENTER>(index)   = worldAABB.center;
-            sceneData.elementAt<VISIBLE_MASK>(index)        = 0;
-            sceneData.elementAt<CHANNELS>(index)            = rcm.getChannels(ri);
-            sceneData.elementAt<LAYERS>(index)              = rcm.getLayerMask(ri);
-            sceneData.elementAt<WORLD_AABB_EXTENT>(index)   = worldAABB.halfExtent;
-            //sceneData.elementAt<PRIMITIVES>(index)          = {}; // already initialized, Slice<>
-            sceneData.elementAt<SUMMED_PRIMITIVE_COUNT>(index) = 0;
-            //sceneData.elementAt<UBO>(index)                 = {}; // not needed here
-            sceneData.elementAt<USER_DATA>(index)           = scale;
+            cache.elementAt<CACHE_WORLD_TRANSFORM>(index)   = worldTransform;
+            cache.elementAt<CACHE_VISIBILITY_STATE>(index)  = visibility;
+            cache.elementAt<CACHE_SKINNING_BUFFER>(index)   = rcm.getSkinningBufferInfo(ri);
+            cache.elementAt<CACHE_MORPHING_BUFFER>(index)   = rcm.getMorphingBufferInfo(ri);
+            cache.elementAt<CACHE_INSTANCES>(index)         = rcm.getInstancesInfo(ri);
+            cache.elementAt<CACHE_WORLD_AABB_CENTER>(index) = worldAABB.center;
+            cache.elementAt<CACHE_CHANNELS>(index)          = rcm.getChannels(ri);
+            cache.elementAt<CACHE_LAYERS>(index)            = rcm.getLayerMask(ri);
+            cache.elementAt<CACHE_WORLD_AABB_EXTENT>(index) = worldAABB.halfExtent;
+            cache.elementAt<CACHE_USER_DATA>(index)         = scale;
+        }
+
+        // now copy this range of the cache into the SoA
+        assert_invariant(start + c <= sceneData.size());
+        for (size_t i = 0; i < c; i++) {
+            sceneData.elementAt<RENDERABLE_INSTANCE>(start + i) = p[i].ri;
         }
+        std::copy_n(cache.data<CACHE_WORLD_TRANSFORM>() + start, c,
+                sceneData.data<WORLD_TRANSFORM>() + start);
+        std::copy_n(cache.data<CACHE_VISIBILITY_STATE>() + start, c,
+                sceneData.data<VISIBILITY_STATE>() + start);
+        std::copy_n(cache.data<CACHE_SKINNING_BUFFER>() + start, c,
+                sceneData.data<SKINNING_BUFFER>() + start);
+        std::copy_n(cache.data<CACHE_MORPHING_BUFFER>() + start, c,
+                sceneData.data<MORPHING_BUFFER>() + start);
+        std::copy_n(cache.data<CACHE_INSTANCES>() + start, c,
+                sceneData.data<INSTANCES>() + start);
+        std::copy_n(cache.data<CACHE_WORLD_AABB_CENTER>() + start, c,
+                sceneData.data<WORLD_AABB_CENTER>() + start);
+        std::fill_n(sceneData.data<VISIBLE_MASK>() + start, c, 0);
+        std::copy_n(cache.data<CACHE_CHANNELS>() + start, c,
+                sceneData.data<CHANNELS>() + start);
+        std::copy_n(cache.data<CACHE_LAYERS>() + start, c,
+                sceneData.data<LAYERS>() + start);
+        std::copy_n(cache.data<CACHE_WORLD_AABB_EXTENT>() + start, c,
+                sceneData.data<WORLD_AABB_EXTENT>() + start);
+        // PRIMITIVES is already initialized, Slice<>
+        std::fill_n(sceneData.data<SUMMED_PRIMITIVE_COUNT>() + start, c, 0);
+        // UBO is not needed here
+        std::copy_n(cache.data<CACHE_USER_DATA>() + start, c,
+                sceneData.data<USER_DATA>() + start);
     };
 
     auto lightWork = [first = lightInstances.data(), &lcm, &tcm, &worldOriginTransform,
@@ -294,6 +369,69 @@ void FScene::prepare(utils::JobSystem& js,
     js.runAndWait(rootJob);
 
     SYSTRACE_NAME_END();
+
+    mRenderableGeneration = rcm.getGeneration();
+    mTransformGeneration = tcm.getGeneration();
+
+    if (mHierarchicalCullingEnabled) {
+        updateStaticRenderables();
+    }
+}
+
+void FScene::updateStaticRenderables() noexcept {
+    SYSTRACE_CALL();
+    FRenderableManager const& rcm = mEngine.getRenderableManager();
+    RenderableSoa const& sceneData = mRenderableData;
+    RenderableCache const& cache = mRenderableCache;
+    AabbTree& tree = mStaticTree;
+    auto& leaves = mStaticLeaves;
+
+    // Insert the new static renderables, and update the ones that moved (e.g. because the
+    // world origin changed) or that are now in a different row. Other rows hold the same
+    // renderable as in the previous prepare(), with the same bounds, so their leaf is up to date.
+    bool const* const changed = cache.data<CACHE_CHANGED>();
+    for (uint32_t i = 0; i < mStaticRenderableCount; i++) {
+        if (!changed[i]) {
+            continue;
+        }
+        Entity const e = cache.elementAt<CACHE_KEY>(i).entity;
+        float3 const center = sceneData.elementAt<WORLD_AABB_CENTER>(i);
+        float3 const extent = sceneData.elementAt<WORLD_AABB_EXTENT>(i);
+        Aabb const box{ center - extent, center + extent };
+        auto const pos = leaves.find(e);
+        if (UTILS_UNLIKELY(pos == leaves.end())) {
+            leaves.insert({ e, tree.insert(box, i) });
+        } else {
+            tree.update(pos->second, box);
+            tree.setRow(pos->second, i);
+        }
+    }
+
+    // Remove the leaves of the renderables that were destroyed without being removed from the
+    // scene, or that are not static anymore. Those are the leaves whose row didn't get updated
+    // above, i.e. that point to another renderable.
+    if (UTILS_UNLIKELY(leaves.size() != mStaticRenderableCount)) {
+        for (auto it = leaves.begin(); it != leaves.end();) {
+            uint32_t const row = tree.getRow(it->second);
+            if (row >= mStaticRenderableCount ||
+                    rcm.getEntity(sceneData.elementAt<RENDERABLE_INSTANCE>(row)) != it->first) {
+                tree.remove(it->second);
+                it = leaves.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    assert_invariant(tree.size() == mStaticRenderableCount);
+}
+
+void FScene::cullStaticRenderables(Frustum const& frustum, size_t bit) noexcept {
+    SYSTRACE_CALL();
+    assert_invariant(mHierarchicalCullingEnabled);
+    mStaticTree.cull(mRenderableData.data<VISIBLE_MASK>(), frustum,
+            mRenderableData.data<WORLD_AABB_CENTER>(),
+            mRenderableData.data<WORLD_AABB_EXTENT>(),
+            bit);
 }
 
 void FScene::prepareVisibleRenderables(Range<uint32_t> visibleRenderables) noexcept {
@@ -517,6 +655,10 @@ void FScene::addEntities(const Entity* entities, size_t count) {
 UTILS_NOINLINE
 void FScene::remove(Entity entity) {
     mEntities.erase(entity);
+    if (auto pos = mStaticLeaves.find(entity); UTILS_UNLIKELY(pos != mStaticLeaves.end())) {
+        mStaticTree.remove(pos->second);
+        mStaticLeaves.erase(pos);
+    }
 }
 
 UTILS_NOINLINE
@@ -592,6 +734,18 @@ bool FScene::hasContactShadows() const noexcept {
     return false;
 }
 
+void FScene::setHierarchicalCullingEnabled(bool enabled) noexcept {
+    if (mHierarchicalCullingEnabled != enabled) {
+        mHierarchicalCullingEnabled = enabled;
+        // the hierarchy is rebuilt incrementally by the next prepare(), which must see all
+        // static renderables as changed
+        mStaticTree.clear();
+        mStaticLeaves.clear();
+        mStaticRenderableCount = 0;
+        mRenderableCache.clear();
+    }
+}
+
 UTILS_NOINLINE
 void FScene::forEach(Invocable<void(Entity)>&& functor) const noexcept {
     std::for_each(mEntities.begin(), mEntities.end(), std::move(functor));
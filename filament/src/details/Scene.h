@@ -19,6 +19,7 @@
 
 #include "downcast.h"
 
+#include "AabbTree.h"
 #include "Allocators.h"
 #include "Culler.h"
 
@@ -40,6 +41,7 @@
 
 #include <stddef.h>
 
+#include <tsl/robin_map.h>
 #include <tsl/robin_set.h>
 
 #include <memory>
@@ -98,6 +100,7 @@ public:
         WORLD_AABB_CENTER,      //  12 | world-space bounding box center of the renderable
         VISIBLE_MASK,           //   2 | each bit represents a visibility in a pass
         CHANNELS,               //   1 | currently light channels only
+        SPOT_SHADOW_MASK,       //   8 | each bit is the visibility in a point/spot shadow map
 
         // These are not needed anymore after culling
         LAYERS,                 //   1 | layers
@@ -122,6 +125,7 @@ public:
             math::float3,                               // WORLD_AABB_CENTER
             VisibleMaskType,                            // VISIBLE_MASK
             uint8_t,                                    // CHANNELS
+            uint64_t,                                   // SPOT_SHADOW_MASK
             uint8_t,                                    // LAYERS
             math::float3,                               // WORLD_AABB_EXTENT
             utils::Slice<FRenderPrimitive>,             // PRIMITIVES
@@ -185,6 +189,19 @@ public:
 
     bool hasContactShadows() const noexcept;
 
+    /*
+     * Hierarchical culling of static renderables
+     */
+
+    bool isHierarchicalCullingEnabled() const noexcept { return mHierarchicalCullingEnabled; }
+
+    // Number of static renderables. When hierarchical culling is enabled, they're stored first
+    // in the RenderableSoa, until the View partitions it. This is 0 when disabled.
+    uint32_t getStaticRenderableCount() const noexcept { return mStaticRenderableCount; }
+
+    // Updates the given VISIBLE_MASK bit of all static renderables.
+    void cullStaticRenderables(Frustum const& frustum, size_t bit) noexcept;
+
 private:
     friend class Scene;
     void setSkybox(FSkybox* skybox) noexcept;
@@ -197,6 +214,46 @@ private:
     size_t getLightCount() const noexcept;
     bool hasEntity(utils::Entity entity) const noexcept;
     void forEach(utils::Invocable<void(utils::Entity)>&& functor) const noexcept;
+    void setHierarchicalCullingEnabled(bool enabled) noexcept;
+    void updateStaticRenderables() noexcept;
+
+    // identifies the components a renderable's data was computed from
+    struct RenderableKey {
+        utils::Entity entity;
+        RenderableManager::Instance ri;
+        TransformManager::Instance ti;
+    };
+
+    enum {
+        CACHE_KEY,
+        CACHE_WORLD_TRANSFORM,
+        CACHE_VISIBILITY_STATE,
+        CACHE_SKINNING_BUFFER,
+        CACHE_MORPHING_BUFFER,
+        CACHE_INSTANCES,
+        CACHE_WORLD_AABB_CENTER,
+        CACHE_CHANNELS,
+        CACHE_LAYERS,
+        CACHE_WORLD_AABB_EXTENT,
+        CACHE_USER_DATA,
+        CACHE_CHANGED,
+    };
+
+    // the subset of RenderableSoa that only depends on the renderable and transform components
+    using RenderableCache = utils::StructureOfArrays<
+            RenderableKey,                              // CACHE_KEY
+            math::mat4f,                                // CACHE_WORLD_TRANSFORM
+            FRenderableManager::Visibility,             // CACHE_VISIBILITY_STATE
+            FRenderableManager::SkinningBindingInfo,    // CACHE_SKINNING_BUFFER
+            FRenderableManager::MorphingBindingInfo,    // CACHE_MORPHING_BUFFER
+            FRenderableManager::InstancesInfo,          // CACHE_INSTANCES
+            math::float3,                               // CACHE_WORLD_AABB_CENTER
+            uint8_t,                                    // CACHE_CHANNELS
+            uint8_t,                                    // CACHE_LAYERS
+            math::float3,                               // CACHE_WORLD_AABB_EXTENT
+            float,                                      // CACHE_USER_DATA
+            bool                                        // CACHE_CHANGED
+    >;
 
     static inline void computeLightRanges(math::float2* zrange,
             CameraInfo const& camera, const math::float4* spheres, size_t count) noexcept;
@@ -221,9 +278,33 @@ private:
      */
     RenderableSoa mRenderableData;
     LightSoa mLightData;
+
+    /*
+     * mRenderableData is rebuilt by prepare() every time, because the View reorders it. However,
+     * most of its content is copied from this cache, which is kept in the order renderables are
+     * gathered. A row of the cache is only recomputed when it now holds a different renderable,
+     * or when its components changed since the last prepare(), in which case CACHE_CHANGED is set
+     * until the next prepare().
+     */
+    RenderableCache mRenderableCache;
+    uint64_t mRenderableGeneration = 0;
+    uint64_t mTransformGeneration = 0;
+    math::mat4 mCachedWorldOriginTransform;
+    bool mCachedShadowReceiversAreCasters = false;
+
     backend::Handle<backend::HwBufferObject> mRenderableViewUbh; // This is actually owned by the view.
     bool mHasContactShadows = false;
 
+    /*
+     * Bounding volume hierarchy of the static renderables. Leaves are added when a static
+     * renderable is first seen in prepare(), and removed along with their entity. Each leaf's
+     * row is its index in mRenderableData, which is updated in prepare().
+     */
+    bool mHierarchicalCullingEnabled = false;
+    uint32_t mStaticRenderableCount = 0;
+    AabbTree mStaticTree;
+    tsl::robin_map<utils::Entity, AabbTree::Id, utils::Entity::Hasher> mStaticLeaves;
+
     // State shared between Scene and driver callbacks.
     struct SharedState {
         BufferPoolAllocator<3> mBufferPoolAllocator = {};
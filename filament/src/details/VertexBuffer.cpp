@@ -220,6 +220,7 @@ void FVertexBuffer::setBufferAt(FEngine& engine, uint8_t bufferIndex,
         assert_invariant(mBufferObjects[bufferIndex]);
         engine.getDriverApi().updateBufferObject(mBufferObjects[bufferIndex],
                std::move(buffer), byteOffset);
+        mGeneration++;
     } else {
         ASSERT_PRECONDITION(bufferIndex < mBufferCount, "bufferIndex must be < bufferCount");
     }
@@ -233,9 +234,24 @@ void FVertexBuffer::setBufferObjectAt(FEngine& engine, uint8_t bufferIndex,
     if (bufferIndex < mBufferCount) {
         auto hwBufferObject = bufferObject->getHwHandle();
         engine.getDriverApi().setVertexBufferObject(mHandle, bufferIndex, hwBufferObject);
+        mUserBufferObjects[bufferIndex] = bufferObject;
+        mGeneration++;
     } else {
         ASSERT_PRECONDITION(bufferIndex < mBufferCount, "bufferIndex must be < bufferCount");
     }
 }
 
+uint32_t FVertexBuffer::getGeneration() const noexcept {
+    uint32_t generation = mGeneration;
+    if (mBufferObjectsEnabled) {
+        // buffer objects are updated directly, without going through the vertex buffer
+        for (size_t i = 0; i < mBufferCount; i++) {
+            if (mUserBufferObjects[i]) {
+                generation = generation * 31u + mUserBufferObjects[i]->getGeneration();
+            }
+        }
+    }
+    return generation;
+}
+
 } // namespace filament
@@ -60,6 +60,10 @@ public:
     void setBufferObjectAt(FEngine& engine, uint8_t bufferIndex,
             FBufferObject const * bufferObject);
 
+    // changes each time the content of the buffers is updated, including the content of the
+    // buffer objects set with setBufferObjectAt()
+    uint32_t getGeneration() const noexcept;
+
 private:
     friend class VertexBuffer;
 
@@ -70,8 +74,10 @@ private:
     VertexBufferHandle mHandle;
     std::array<AttributeData, backend::MAX_VERTEX_ATTRIBUTE_COUNT> mAttributes;
     std::array<BufferObjectHandle, backend::MAX_VERTEX_BUFFER_COUNT> mBufferObjects;
+    std::array<FBufferObject const*, backend::MAX_VERTEX_BUFFER_COUNT> mUserBufferObjects{};
     AttributeBitset mDeclaredAttributes;
     uint32_t mVertexCount = 0;
+    uint32_t mGeneration = 0;
     uint8_t mBufferCount = 0;
     bool mBufferObjectsEnabled = false;
 };
@@ -43,6 +43,7 @@
 #include <math/scalar.h>
 #include <math/fast.h>
 
+#include <algorithm>
 #include <memory>
 
 using namespace utils;
@@ -54,6 +55,9 @@ using namespace math;
 
 static constexpr float PID_CONTROLLER_Ki = 0.002f;
 static constexpr float PID_CONTROLLER_Kd = 0.0f;
+// number of frames the dynamic resolution controller waits after changing the resolution of
+// screen-space effects, so that the denoised frame time reflects the change.
+static constexpr uint8_t POST_PROCESS_LEVEL_COOLDOWN = 15;
 
 FView::FView(FEngine& engine)
         : mFroxelizer(engine),
@@ -149,6 +153,31 @@ void FView::setDynamicResolutionOptions(DynamicResolutionOptions const& options)
     }
 }
 
+void FView::setPostProcessResolutionOptions(PostProcessResolutionOptions const& options) noexcept {
+    PostProcessResolutionOptions& postProcessResolution = mPostProcessResolution;
+    postProcessResolution = options;
+
+    // minResolution cannot be higher than resolution
+    postProcessResolution.minResolution = std::max(
+            postProcessResolution.minResolution, postProcessResolution.resolution);
+
+    mPostProcessLevel = std::clamp(mPostProcessLevel,
+            uint8_t(postProcessResolution.resolution),
+            uint8_t(postProcessResolution.minResolution));
+}
+
+float FView::getPostProcessScale() const noexcept {
+    PostProcessResolutionOptions const& options = mPostProcessResolution;
+    if (!options.enabled) {
+        return 1.0f;
+    }
+    uint8_t level = uint8_t(options.resolution);
+    if (options.dynamic && mDynamicResolution.enabled) {
+        level = std::max(level, mPostProcessLevel);
+    }
+    return 1.0f / float(1u << level);
+}
+
 void FView::setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept {
     mFroxelizer.setOptions(zLightNear, zLightFar);
 }
@@ -186,7 +215,32 @@ float2 FView::updateScale(FEngine& engine,
         float const out = mPidController.update(measured / targetWithHeadroom, 1.0f, dt);
 
         // maps pid command to a scale (absolute or relative, see below)
-         const float command = out < 0.0f ? (1.0f / (1.0f - out)) : (1.0f + out);
+        float command = out < 0.0f ? (1.0f / (1.0f - out)) : (1.0f + out);
+
+        PostProcessResolutionOptions const& postProcessOptions = mPostProcessResolution;
+        if (postProcessOptions.enabled && postProcessOptions.dynamic) {
+            /*
+             * The resolution of screen-space effects is traded before the View's: it's lowered
+             * first when we're over budget, and raised last, once the View is at its maximum
+             * scale. Each step has a large effect on the frame time, so the View's scale is held
+             * while the denoised frame time settles.
+             */
+            if (mPostProcessLevelCooldown) {
+                mPostProcessLevelCooldown--;
+                command = 1.0f;
+            } else if (command < 1.0f &&
+                    mPostProcessLevel < uint8_t(postProcessOptions.minResolution)) {
+                mPostProcessLevel++;
+                mPostProcessLevelCooldown = POST_PROCESS_LEVEL_COOLDOWN;
+                command = 1.0f;
+            } else if (command > 1.0f &&
+                    mPostProcessLevel > uint8_t(postProcessOptions.resolution) &&
+                    mScale.x >= options.maxScale.x && mScale.y >= options.maxScale.y) {
+                mPostProcessLevel--;
+                mPostProcessLevelCooldown = POST_PROCESS_LEVEL_COOLDOWN;
+                command = 1.0f;
+            }
+        }
 
         /*
          * There is two ways we can control the scale factor, either by having the PID controller
@@ -233,8 +287,9 @@ float2 FView::updateScale(FEngine& engine,
 
         // disable the integration term when we're outside the controllable range
         // (i.e. we clamped). This help not to have to wait too long for the Integral term
-        // to kick in after a clamping event.
-        mPidController.setIntegralInhibitionEnabled(mScale != s);
+        // to kick in after a clamping event. Same while the scale is held after a change of
+        // the screen-space effects' resolution, the error is expected then.
+        mPidController.setIntegralInhibitionEnabled(mScale != s || mPostProcessLevelCooldown);
     } else {
         mScale = 1.0f;
     }
@@ -471,10 +526,10 @@ void FView::prepare(FEngine& engine, DriverApi& driver, ArenaScope& arena,
         // note: this job updates LightData (non const)
         prepareVisibleLightsJob = js.runAndRetain(js.createJob(nullptr,
                 [&engine, &arena, &viewMatrix = cameraInfo.view, &cullingFrustum,
-                 &lightData = scene->getLightData()]
+                 lightFar = mFroxelizer.getLightFar(), &lightData = scene->getLightData()]
                         (JobSystem&, JobSystem::Job*) {
                     FView::prepareVisibleLights(engine.getLightManager(), arena,
-                            viewMatrix, cullingFrustum, lightData);
+                            viewMatrix, cullingFrustum, lightFar, lightData);
                 }));
     }
 
@@ -494,7 +549,7 @@ void FView::prepare(FEngine& engine, DriverApi& driver, ArenaScope& arena,
          * (this will set the VISIBLE_RENDERABLE bit)
          */
 
-        prepareVisibleRenderables(js, cullingFrustum, renderableData);
+        prepareVisibleRenderables(js, cullingFrustum, *scene);
 
 
         /*
@@ -739,7 +794,10 @@ void FView::prepareViewport(
 }
 
 void FView::prepareSSAO(Handle<HwTexture> ssao) const noexcept {
-    mPerViewUniforms.prepareSSAO(ssao, mAmbientOcclusionOptions);
+    // the SSAO buffer can have a lower resolution than requested, see FRenderer::renderJob()
+    AmbientOcclusionOptions options = mAmbientOcclusionOptions;
+    options.resolution = std::min(options.resolution, getPostProcessScale());
+    mPerViewUniforms.prepareSSAO(ssao, options);
 }
 
 void FView::prepareSSR(Handle<HwTexture> ssr, float refractionLodOffset,
@@ -790,10 +848,11 @@ void FView::commitFroxels(DriverApi& driverApi) const noexcept {
 
 UTILS_NOINLINE
 void FView::prepareVisibleRenderables(JobSystem& js,
-        Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept {
+        Frustum const& frustum, FScene& scene) const noexcept {
     SYSTRACE_CALL();
+    FScene::RenderableSoa& renderableData = scene.getRenderableData();
     if (UTILS_LIKELY(isFrustumCullingEnabled())) {
-        FView::cullRenderables(js, renderableData, frustum, VISIBLE_RENDERABLE_BIT);
+        FView::cullRenderables(js, scene, frustum, VISIBLE_RENDERABLE_BIT);
     } else {
         std::uninitialized_fill(renderableData.begin<FScene::VISIBLE_MASK>(),
                   renderableData.end<FScene::VISIBLE_MASK>(), VISIBLE_RENDERABLE);
@@ -801,9 +860,11 @@ void FView::prepareVisibleRenderables(JobSystem& js,
 }
 
 void FView::cullRenderables(JobSystem&,
-        FScene::RenderableSoa& renderableData, Frustum const& frustum, size_t bit) noexcept {
+        FScene& scene, Frustum const& frustum, size_t bit) noexcept {
     SYSTRACE_CALL();
 
+    FScene::RenderableSoa& renderableData = scene.getRenderableData();
+
     float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
     float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
     FScene::VisibleMaskType* visibleArray = renderableData.data<FScene::VISIBLE_MASK>();
@@ -823,11 +884,18 @@ void FView::cullRenderables(JobSystem&,
     // Moreover, even with a large number of primitives, the overhead of the JobSystem is too
     // large compared to the run time of Culler::intersects, e.g.: ~100us for 4000 primitives
     // on Pixel4.
-    functor(0, renderableData.size());
+
+    // Static renderables, if any, are stored first and culled hierarchically, only the
+    // remaining ones are culled individually.
+    uint32_t const staticCount = scene.getStaticRenderableCount();
+    if (staticCount) {
+        scene.cullStaticRenderables(frustum, bit);
+    }
+    functor(staticCount, renderableData.size() - staticCount);
 }
 
 void FView::prepareVisibleLights(FLightManager const& lcm, ArenaScope& rootArena,
-        mat4f const& viewMatrix, Frustum const& frustum,
+        mat4f const& viewMatrix, Frustum const& frustum, float lightFar,
         FScene::LightSoa& lightData) noexcept {
     SYSTRACE_CALL();
     assert_invariant(lightData.size() > FScene::DIRECTIONAL_LIGHTS_COUNT);
@@ -854,6 +922,13 @@ void FView::prepareVisibleLights(FLightManager const& lcm, ArenaScope& rootArena
                 visibleArray[i] = 0;
                 continue;
             }
+            // cull lights entirely behind the light-far plane, they're never froxelized so they
+            // can't light anything. This keeps them from taking a slot in the light buffer.
+            const float z = (viewMatrix * float4{ sphereArray[i].xyz, 1 }).z;
+            if (z + sphereArray[i].w < -lightFar) { // z values are negative
+                visibleArray[i] = 0;
+                continue;
+            }
             // cull spotlights that cannot possibly intersect the view frustum
             if (lcm.isSpotLight(li)) {
                 const float3 position = sphereArray[i].xyz;
@@ -910,8 +985,19 @@ void FView::prepareVisibleLights(FLightManager const& lcm, ArenaScope& rootArena
 
         // skip directional light
         Zip2Iterator<FScene::LightSoa::iterator, float*> b = { lightData.begin(), distances };
-        std::sort(b + FScene::DIRECTIONAL_LIGHTS_COUNT, b + size,
-                [](auto const& lhs, auto const& rhs) { return lhs.second < rhs.second; });
+        auto const closer = [](auto const& lhs, auto const& rhs) {
+            return lhs.second < rhs.second;
+        };
+        auto const first = b + FScene::DIRECTIONAL_LIGHTS_COUNT;
+        auto last = b + size;
+        if (UTILS_UNLIKELY(positionalLightCount > CONFIG_MAX_LIGHT_COUNT)) {
+            // only the closest lights are kept, so there is no need to sort the ones we drop,
+            // this keeps the cost proportional to the number of lights we keep.
+            auto const end = first + CONFIG_MAX_LIGHT_COUNT;
+            std::nth_element(first, end, last, closer);
+            last = end;
+        }
+        std::sort(first, last, closer);
     }
 
     // drop excess lights
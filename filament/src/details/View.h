@@ -29,10 +29,13 @@
 #include "Froxelizer.h"
 #include "PerViewUniforms.h"
 #include "PIDController.h"
+#include "RenderPass.h"
 #include "ShadowMap.h"
 #include "ShadowMapManager.h"
 #include "TypedUniformBuffer.h"
 
+#include "fg/FrameGraph.h"
+
 #include "details/Camera.h"
 #include "details/ColorGrading.h"
 #include "details/RenderTarget.h"
@@ -157,6 +160,8 @@ public:
     void commitUniforms(backend::DriverApi& driver) const noexcept;
     void commitFroxels(backend::DriverApi& driverApi) const noexcept;
 
+    RenderPass::CommandCache& getCommandCache() noexcept { return mCommandCache; }
+
     utils::JobSystem::Job* getFroxelizerSync() const noexcept { return mFroxelizerSync; }
     void setFroxelizerSync(utils::JobSystem::Job* sync) noexcept { mFroxelizerSync = sync; }
 
@@ -279,6 +284,16 @@ public:
         return mDynamicResolution;
     }
 
+    void setPostProcessResolutionOptions(PostProcessResolutionOptions const& options) noexcept;
+
+    PostProcessResolutionOptions getPostProcessResolutionOptions() const noexcept {
+        return mPostProcessResolution;
+    }
+
+    // Scale of the screen-space effects relative to the View's resolution (1, 0.5 or 0.25),
+    // as set by the PostProcessResolutionOptions and the dynamic resolution controller.
+    float getPostProcessScale() const noexcept;
+
     void setRenderQuality(RenderQuality const& renderQuality) noexcept {
         mRenderQuality = renderQuality;
     }
@@ -323,6 +338,14 @@ public:
         return mSoftShadowOptions;
     }
 
+    void setShadowCacheOptions(ShadowCacheOptions options) noexcept {
+        mShadowCacheOptions = options;
+    }
+
+    ShadowCacheOptions getShadowCacheOptions() const noexcept {
+        return mShadowCacheOptions;
+    }
+
     AmbientOcclusionOptions const& getAmbientOcclusionOptions() const noexcept {
         return mAmbientOcclusionOptions;
     }
@@ -388,7 +411,9 @@ public:
         }
     }
 
-    static void cullRenderables(utils::JobSystem& js, FScene::RenderableSoa& renderableData,
+    // Culls all renderables of the scene, this must be called before the RenderableSoa is
+    // partitioned, because static renderables are expected to be stored first.
+    static void cullRenderables(utils::JobSystem& js, FScene& scene,
             Frustum const& frustum, size_t bit) noexcept;
 
     PerViewUniforms const& getPerViewUniforms() const noexcept { return mPerViewUniforms; }
@@ -399,6 +424,9 @@ public:
     FrameHistory& getFrameHistory() noexcept { return mFrameHistory; }
     FrameHistory const& getFrameHistory() const noexcept { return mFrameHistory; }
 
+    // Returns the cache of this View's compiled FrameGraph, which is usually the same every frame.
+    FrameGraph::Cache& getFrameGraphCache() noexcept { return mFrameGraphCache; }
+
     // Clean-up the oldest frame and save the current frame information.
     // This is typically called after all operations for this View's rendering are complete.
     // (e.g.: after the FrameGraph execution).
@@ -448,10 +476,10 @@ private:
     };
 
     void prepareVisibleRenderables(utils::JobSystem& js,
-            Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept;
+            Frustum const& frustum, FScene& scene) const noexcept;
 
     static void prepareVisibleLights(FLightManager const& lcm, ArenaScope& rootArena,
-            math::mat4f const& viewMatrix, Frustum const& frustum,
+            math::mat4f const& viewMatrix, Frustum const& frustum, float lightFar,
             FScene::LightSoa& lightData) noexcept;
 
     static inline void computeLightCameraDistances(float* distances,
@@ -485,6 +513,7 @@ private:
     FCamera* mViewingCamera = nullptr;
 
     mutable Froxelizer mFroxelizer;
+    RenderPass::CommandCache mCommandCache;
     utils::JobSystem::Job* mFroxelizerSync = nullptr;
 
     Viewport mViewport;
@@ -504,6 +533,7 @@ private:
     ShadowType mShadowType = ShadowType::PCF;
     VsmShadowOptions mVsmShadowOptions; // FIXME: this should probably be per-light
     SoftShadowOptions mSoftShadowOptions;
+    ShadowCacheOptions mShadowCacheOptions;
     BloomOptions mBloomOptions;
     FogOptions mFogOptions;
     DepthOfFieldOptions mDepthOfFieldOptions;
@@ -521,6 +551,10 @@ private:
     DynamicResolutionOptions mDynamicResolution;
     math::float2 mScale = 1.0f;
     bool mIsDynamicResolutionSupported = false;
+    PostProcessResolutionOptions mPostProcessResolution;
+    // resolution level of screen-space effects selected by the dynamic resolution controller
+    uint8_t mPostProcessLevel = 0;
+    uint8_t mPostProcessLevelCooldown = 0;
 
     RenderQuality mRenderQuality;
 
@@ -544,6 +578,8 @@ private:
 
     ShadowMapManager mShadowMapManager;
 
+    FrameGraph::Cache mFrameGraphCache;
+
     std::array<math::float4, 4> mMaterialGlobals = {{
                                                             { 0, 0, 0, 1 },
                                                             { 0, 0, 0, 1 },
@@ -134,6 +134,18 @@ void DependencyGraph::cull() noexcept {
     }
 }
 
+void DependencyGraph::cull(uint32_t const* refCounts) noexcept {
+    for (Node* const pNode : mNodes) {
+        pNode->mRefCount = refCounts[pNode->getId()];
+    }
+}
+
+void DependencyGraph::getRefCounts(uint32_t* refCounts) const noexcept {
+    for (Node const* const pNode : mNodes) {
+        refCounts[pNode->getId()] = pNode->mRefCount;
+    }
+}
+
 void DependencyGraph::clear() noexcept {
     mEdges.clear();
     mNodes.clear();
@@ -20,6 +20,7 @@
 #include "fg/details/DependencyGraph.h"
 
 #include "details/Engine.h"
+#include "details/Texture.h"
 
 #include <backend/DriverEnums.h>
 #include <backend/Handle.h>
@@ -27,6 +28,8 @@
 #include <utils/Panic.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
+
 namespace filament {
 
 inline FrameGraph::Builder::Builder(FrameGraph& fg, PassNode* passNode) noexcept
@@ -34,9 +37,15 @@ inline FrameGraph::Builder::Builder(FrameGraph& fg, PassNode* passNode) noexcept
 }
 
 void FrameGraph::Builder::sideEffect() noexcept {
+    mFrameGraph.hashStructure('S', mPassNode->getId());
     mPassNode->makeTarget();
 }
 
+void FrameGraph::Builder::setQueueHint(QueueHint hint) noexcept {
+    mFrameGraph.hashStructure('Q', mPassNode->getId(), hint);
+    mPassNode->queueHint = hint;
+}
+
 const char* FrameGraph::Builder::getName(FrameGraphHandle handle) const noexcept {
     return mFrameGraph.getResource(handle)->name;
 }
@@ -59,13 +68,27 @@ FrameGraphId<FrameGraphTexture> FrameGraph::Builder::declareRenderPass(
 
 // ------------------------------------------------------------------------------------------------
 
-FrameGraph::FrameGraph(ResourceAllocatorInterface& resourceAllocator)
+FrameGraph::Cache::Cache() noexcept = default;
+
+FrameGraph::Cache::~Cache() noexcept = default;
+
+bool FrameGraph::Cache::matches(FrameGraph const& fg) const noexcept {
+    // the counts guard against hash collisions
+    return mValid && mHash == fg.mStructureHash &&
+            mNodeCount == fg.mGraph.getNodes().size() &&
+            mEdgeCount == fg.mGraph.getEdges().size() &&
+            mResourceCount == fg.mResources.size() &&
+            mPassCount == fg.mPassNodes.size();
+}
+
+FrameGraph::FrameGraph(ResourceAllocatorInterface& resourceAllocator, Cache* cache)
         : mResourceAllocator(resourceAllocator),
           mArena("FrameGraph Arena", 131072),
           mResourceSlots(mArena),
           mResources(mArena),
           mResourceNodes(mArena),
-          mPassNodes(mArena)
+          mPassNodes(mArena),
+          mCache(cache)
 {
     mResourceSlots.reserve(256);
     mResources.reserve(256);
@@ -98,6 +121,7 @@ void FrameGraph::reset() noexcept {
     mResourceNodes.clear();
     mResources.clear();
     mResourceSlots.clear();
+    mStructureHash = 0;
 }
 
 FrameGraph& FrameGraph::compile() noexcept {
@@ -106,8 +130,31 @@ FrameGraph& FrameGraph::compile() noexcept {
 
     DependencyGraph& dependencyGraph = mGraph;
 
+    // if the graph is the same as the last one compiled with our cache, we can skip all the
+    // work that depends only on its structure: culling, resources lifetime and usage.
+    Cache* const cache = mCache;
+    bool const cached = cache && cache->matches(*this);
+    if (cache) {
+        if (cached) {
+            cache->mHitCount++;
+        } else {
+            cache->mMissCount++;
+        }
+    }
+
     // first we cull unreachable nodes
-    dependencyGraph.cull();
+    if (cached) {
+        dependencyGraph.cull(cache->mRefCounts.data());
+    } else {
+        dependencyGraph.cull();
+        if (cache) {
+            cache->mValid = false;
+            cache->mRefCounts.resize(dependencyGraph.getNodes().size());
+            dependencyGraph.getRefCounts(cache->mRefCounts.data());
+            cache->mPassResources.clear();
+            cache->mPassResourceCounts.clear();
+        }
+    }
 
     /*
      * update the reference counter of the resource themselves and
@@ -119,13 +166,33 @@ FrameGraph& FrameGraph::compile() noexcept {
         return !pPassNode->isCulled();
     });
 
+    // then we reorder the active passes according to their QueueHint
+    if (cached) {
+        if (!cache->mSchedule.empty()) {
+            reorderActivePasses(cache->mSchedule.data());
+        }
+    } else {
+        schedulePasses(cache ? &cache->mSchedule : nullptr);
+    }
+
     auto first = mPassNodes.begin();
     const auto activePassNodesEnd = mActivePassNodesEnd;
+    FrameGraphHandle const* cachedResources = cached ? cache->mPassResources.data() : nullptr;
+    uint32_t const* cachedResourceCounts = cached ? cache->mPassResourceCounts.data() : nullptr;
     while (first != activePassNodesEnd) {
         PassNode* const passNode = *first;
         first++;
         assert_invariant(!passNode->isCulled());
 
+        if (cached) {
+            for (size_t i = 0, c = *cachedResourceCounts++; i < c; i++) {
+                passNode->registerResource(*cachedResources++);
+            }
+            passNode->resolve();
+            continue;
+        }
+
+        size_t const resourceCount = cache ? cache->mPassResources.size() : 0;
 
         auto const& reads = dependencyGraph.getIncomingEdges(passNode);
         for (auto const& edge : reads) {
@@ -133,6 +200,9 @@ FrameGraph& FrameGraph::compile() noexcept {
             assert_invariant(dependencyGraph.isEdgeValid(edge));
             auto pNode = static_cast<ResourceNode*>(dependencyGraph.getNode(edge->from));
             passNode->registerResource(pNode->resourceHandle);
+            if (cache) {
+                cache->mPassResources.push_back(pNode->resourceHandle);
+            }
         }
 
         auto const& writes = dependencyGraph.getOutgoingEdges(passNode);
@@ -142,6 +212,13 @@ FrameGraph& FrameGraph::compile() noexcept {
             // the resource we are writing to.
             auto pNode = static_cast<ResourceNode*>(dependencyGraph.getNode(edge->to));
             passNode->registerResource(pNode->resourceHandle);
+            if (cache) {
+                cache->mPassResources.push_back(pNode->resourceHandle);
+            }
+        }
+
+        if (cache) {
+            cache->mPassResourceCounts.push_back(cache->mPassResources.size() - resourceCount);
         }
 
         passNode->resolve();
@@ -166,17 +243,223 @@ FrameGraph& FrameGraph::compile() noexcept {
     /*
      * Resolve Usage bits
      */
-    for (auto& pNode : mResourceNodes) {
-        // we can't use isCulled() here because some culled resource are still active
-        // we could use "getResource(pNode->resourceHandle)->refcount" but that's expensive.
-        // We also can't remove or reorder this array, as handles are indices to it.
-        // We might need to build an array of indices to active resources.
-        pNode->resolveResourceUsage(dependencyGraph);
+    if (cached) {
+        for (size_t i = 0, c = mResources.size(); i < c; i++) {
+            // the FrameGraph only handles textures
+            static_cast<Resource<FrameGraphTexture>*>(mResources[i])->usage = cache->mUsages[i];
+        }
+    } else {
+        for (auto& pNode : mResourceNodes) {
+            // we can't use isCulled() here because some culled resource are still active
+            // we could use "getResource(pNode->resourceHandle)->refcount" but that's expensive.
+            // We also can't remove or reorder this array, as handles are indices to it.
+            // We might need to build an array of indices to active resources.
+            pNode->resolveResourceUsage(dependencyGraph);
+        }
+        if (cache) {
+            cache->mUsages.clear();
+            for (VirtualResource const* pResource : mResources) {
+                cache->mUsages.push_back(
+                        static_cast<Resource<FrameGraphTexture> const*>(pResource)->usage);
+            }
+            cache->mHash = mStructureHash;
+            cache->mNodeCount = dependencyGraph.getNodes().size();
+            cache->mEdgeCount = dependencyGraph.getEdges().size();
+            cache->mResourceCount = mResources.size();
+            cache->mPassCount = mPassNodes.size();
+            cache->mValid = true;
+        }
     }
 
+    aliasTransientResources();
+
+    SYSTRACE_CONTEXT();
+    SYSTRACE_VALUE64("fg.transientMemory", mStatistics.transientMemory);
+    SYSTRACE_VALUE64("fg.aliasedTransientMemory", mStatistics.aliasedTransientMemory);
+
     return *this;
 }
 
+void FrameGraph::schedulePasses(std::vector<uint32_t>* schedule) noexcept {
+    if (schedule) {
+        schedule->clear();
+    }
+
+    auto const begin = mPassNodes.begin();
+    auto const end = mActivePassNodesEnd;
+    bool const hasAsyncPasses = std::any_of(begin, end, [](PassNode const* pPassNode) {
+        return pPassNode->queueHint == QueueHint::ASYNC;
+    });
+    if (!hasAsyncPasses) {
+        return;
+    }
+
+    // gather the resources accessed by each active pass, subresources are accounted for as
+    // their parent, since they share the same concrete resource.
+    struct Access {
+        VirtualResource const* resource;
+        bool write;
+    };
+    uint32_t const count = uint32_t(end - begin);
+    Vector<Access> accesses(mArena);
+    Vector<uint32_t> offsets(mArena);
+    offsets.reserve(count + 1);
+    DependencyGraph& dependencyGraph = mGraph;
+    for (auto it = begin; it != end; ++it) {
+        offsets.push_back(uint32_t(accesses.size()));
+        for (auto const& edge : dependencyGraph.getIncomingEdges(*it)) {
+            auto pNode = static_cast<ResourceNode*>(dependencyGraph.getNode(edge->from));
+            accesses.push_back({ getResource(pNode->resourceHandle)->getResource(), false });
+        }
+        for (auto const& edge : dependencyGraph.getOutgoingEdges(*it)) {
+            auto pNode = static_cast<ResourceNode*>(dependencyGraph.getNode(edge->to));
+            accesses.push_back({ getResource(pNode->resourceHandle)->getResource(), true });
+        }
+    }
+    offsets.push_back(uint32_t(accesses.size()));
+
+    // two passes depend on each other if they access the same resource and one writes it
+    auto const dependsOn = [&accesses, &offsets](uint32_t lhs, uint32_t rhs) {
+        for (uint32_t i = offsets[lhs]; i < offsets[lhs + 1]; i++) {
+            for (uint32_t j = offsets[rhs]; j < offsets[rhs + 1]; j++) {
+                if (accesses[i].resource == accesses[j].resource &&
+                        (accesses[i].write || accesses[j].write)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    // GRAPHICS passes keep their order, and each ASYNC pass is moved right after the last pass
+    // it depends on, but not before an earlier ASYNC pass, so they also keep their order.
+    Vector<uint32_t> order(mArena);
+    order.reserve(count);
+    size_t asyncEnd = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (begin[i]->queueHint != QueueHint::ASYNC) {
+            order.push_back(i);
+            continue;
+        }
+        size_t pos = order.size();
+        while (pos > asyncEnd && !dependsOn(i, order[pos - 1])) {
+            pos--;
+        }
+        order.insert(order.begin() + ptrdiff_t(pos), i);
+        asyncEnd = pos + 1;
+    }
+
+    if (std::is_sorted(order.begin(), order.end())) {
+        return;
+    }
+
+    reorderActivePasses(order.data());
+    if (schedule) {
+        schedule->assign(order.begin(), order.end());
+    }
+}
+
+void FrameGraph::reorderActivePasses(uint32_t const* order) noexcept {
+    Vector<PassNode*> const passNodes(mPassNodes.begin(), mActivePassNodesEnd, mArena);
+    for (size_t i = 0, c = passNodes.size(); i < c; i++) {
+        mPassNodes[i] = passNodes[order[i]];
+    }
+}
+
+namespace {
+
+size_t getMemorySize(FrameGraphTexture::Descriptor const& desc) noexcept {
+    // this matches the estimate used by ResourceAllocator's cache
+    size_t size = size_t(desc.width) * desc.height * desc.depth *
+            FTexture::getFormatSize(desc.format);
+    if (desc.samples > 1) {
+        size *= desc.samples;
+    }
+    if (desc.levels > 1) {
+        size += size / 3;
+    }
+    return size;
+}
+
+bool canAlias(Resource<FrameGraphTexture> const& lhs,
+        Resource<FrameGraphTexture> const& rhs) noexcept {
+    auto const& l = lhs.descriptor;
+    auto const& r = rhs.descriptor;
+    bool const sameDescriptor =
+            l.width == r.width && l.height == r.height && l.depth == r.depth &&
+            l.levels == r.levels && l.samples == r.samples &&
+            l.type == r.type && l.format == r.format &&
+            std::equal(std::begin(l.swizzle.channels), std::end(l.swizzle.channels),
+                    std::begin(r.swizzle.channels));
+    // multisampled textures can't always be sampled, so we don't merge their usages
+    return sameDescriptor && (l.samples <= 1 || lhs.usage == rhs.usage);
+}
+
+} // anonymous namespace
+
+void FrameGraph::aliasTransientResources() noexcept {
+    // The backend doesn't expose memory heaps, so aliasing is done at the texture level: a
+    // transient texture created after another one was destroyed takes it over if they have the
+    // same descriptor, in which case both get the union of their usages.
+    Statistics stats;
+    size_t liveMemory = 0;
+    Vector<Resource<FrameGraphTexture>*> available(mArena);
+
+    auto const isTransient = [](VirtualResource const* resource) {
+        return !resource->isImported() && !resource->isSubResource();
+    };
+
+    for (auto it = mPassNodes.begin(); it != mActivePassNodesEnd; ++it) {
+        PassNode const* const node = *it;
+
+        for (VirtualResource* pResource : node->devirtualize) {
+            if (!isTransient(pResource)) {
+                continue;
+            }
+            // the FrameGraph only handles textures
+            auto* const resource = static_cast<Resource<FrameGraphTexture>*>(pResource);
+            size_t const size = getMemorySize(resource->descriptor);
+            stats.transientTextureCount++;
+            stats.transientMemory += size;
+            liveMemory += size;
+            stats.peakLiveMemory = std::max(stats.peakLiveMemory, liveMemory);
+
+            auto const pos = std::find_if(available.begin(), available.end(),
+                    [resource](Resource<FrameGraphTexture> const* candidate) {
+                        return canAlias(*candidate, *resource);
+                    });
+
+            if (pos == available.end()) {
+                stats.aliasedTransientMemory += size;
+                continue;
+            }
+
+            Resource<FrameGraphTexture>* const previous = *pos;
+            available.erase(pos);
+            previous->aliasNext = resource;
+            resource->aliasPrevious = previous;
+            stats.aliasedTextureCount++;
+
+            // the concrete texture is created by the head of the chain, with all usages
+            FrameGraphTexture::Usage const usage = previous->usage | resource->usage;
+            for (VirtualResource* p = resource; p; p = p->aliasPrevious) {
+                static_cast<Resource<FrameGraphTexture>*>(p)->usage = usage;
+            }
+        }
+
+        for (VirtualResource* pResource : node->destroy) {
+            if (!isTransient(pResource)) {
+                continue;
+            }
+            auto* const resource = static_cast<Resource<FrameGraphTexture>*>(pResource);
+            liveMemory -= getMemorySize(resource->descriptor);
+            available.push_back(resource);
+        }
+    }
+
+    mStatistics = stats;
+}
+
 void FrameGraph::execute(backend::DriverApi& driver) noexcept {
 
     SYSTRACE_CALL();
@@ -219,6 +502,7 @@ void FrameGraph::execute(backend::DriverApi& driver) noexcept {
 }
 
 void FrameGraph::addPresentPass(const std::function<void(FrameGraph::Builder&)>& setup) noexcept {
+    hashStructure('X');
     PresentPassNode* node = mArena.make<PresentPassNode>(*this);
     mPassNodes.push_back(node);
     Builder builder(*this, node);
@@ -227,6 +511,7 @@ void FrameGraph::addPresentPass(const std::function<void(FrameGraph::Builder&)>&
 }
 
 FrameGraph::Builder FrameGraph::addPassInternal(char const* name, FrameGraphPassBase* base) noexcept {
+    hashStructure('P');
     // record in our pass list and create the builder
     PassNode* node = mArena.make<RenderPassNode>(*this, name, base);
     base->setNode(node);
@@ -266,6 +551,7 @@ FrameGraphHandle FrameGraph::addResourceInternal(VirtualResource* resource) noex
 
 FrameGraphHandle FrameGraph::addSubResourceInternal(FrameGraphHandle parent,
         VirtualResource* resource) noexcept {
+    hashStructure('C', parent.index);
     FrameGraphHandle const handle(mResourceSlots.size());
     ResourceSlot& slot = mResourceSlots.emplace_back();
     slot.rid = (ResourceSlot::Index)mResources.size();
@@ -386,6 +672,8 @@ FrameGraphHandle FrameGraph::writeInternal(FrameGraphHandle handle, PassNode* pa
 FrameGraphHandle FrameGraph::forwardResourceInternal(FrameGraphHandle resourceHandle,
         FrameGraphHandle replaceResourceHandle) {
 
+    hashStructure('F', resourceHandle.index, replaceResourceHandle.index);
+
     assertValid(resourceHandle);
 
     assertValid(replaceResourceHandle);
@@ -425,6 +713,7 @@ FrameGraphHandle FrameGraph::forwardResourceInternal(FrameGraphHandle resourceHa
 FrameGraphId<FrameGraphTexture> FrameGraph::import(char const* name,
         FrameGraphRenderPass::ImportDescriptor const& desc,
         backend::Handle<backend::HwRenderTarget> target) {
+    hashStructure('T', desc.attachments);
     // create a resource that represents the imported render target
     VirtualResource* vresource =
             mArena.make<ImportedRenderTarget>(name,
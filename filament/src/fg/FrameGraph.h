@@ -35,6 +35,7 @@
 #include <backend/Handle.h>
 
 #include <functional>
+#include <vector>
 
 namespace filament {
 
@@ -48,6 +49,19 @@ class VirtualResource;
 class FrameGraph {
 public:
 
+    /**
+     * Hint about the queue a pass would ideally execute on.
+     *
+     * There is a single command stream, so this only affects the order in which the passes are
+     * executed: compile() moves ASYNC passes as early as their dependencies allow, so they
+     * overlap with as much of the GRAPHICS work as possible. GRAPHICS passes always execute in
+     * the order they're declared.
+     */
+    enum class QueueHint : uint8_t {
+        GRAPHICS,   //!< the pass executes in declaration order (default)
+        ASYNC       //!< the pass executes as soon as the resources it uses are available
+    };
+
     class Builder {
     public:
         Builder(Builder const&) = delete;
@@ -154,6 +168,14 @@ public:
          */
         void sideEffect() noexcept;
 
+        /**
+         * Sets the queue the current pass would ideally execute on. Only resources declared
+         * with read() and write() are taken into account to reorder an ASYNC pass, so it must
+         * not depend on commands issued by other passes in any other way (e.g. uniforms).
+         * @param hint QueueHint for the current pass, GRAPHICS by default.
+         */
+        void setQueueHint(QueueHint hint) noexcept;
+
         /**
          * Retrieves the descriptor associated to a resource
          * @tparam RESOURCE Type of the resource
@@ -218,7 +240,48 @@ public:
 
     // --------------------------------------------------------------------------------------------
 
-    explicit FrameGraph(ResourceAllocatorInterface& resourceAllocator);
+    /**
+     * Keeps the result of compile() across frames. When a FrameGraph declares the same passes,
+     * resources and dependencies as the last one compiled with the same Cache, the culling,
+     * the lifetimes and the usage of its resources are restored instead of being recomputed.
+     * Render passes are always resolved, since their descriptors can change.
+     */
+    class Cache {
+    public:
+        Cache() noexcept;
+        ~Cache() noexcept;
+        Cache(Cache const&) = delete;
+        Cache& operator=(Cache const&) = delete;
+
+        /** number of compile() calls that reused this Cache */
+        uint32_t getHitCount() const noexcept { return mHitCount; }
+
+        /** number of compile() calls that had to (re)populate this Cache */
+        uint32_t getMissCount() const noexcept { return mMissCount; }
+
+    private:
+        friend class FrameGraph;
+        bool matches(FrameGraph const& fg) const noexcept;
+        size_t mHash = 0;
+        size_t mNodeCount = 0;
+        size_t mEdgeCount = 0;
+        size_t mResourceCount = 0;
+        size_t mPassCount = 0;
+        std::vector<uint32_t> mRefCounts;                   // reference count of each node
+        std::vector<FrameGraphHandle> mPassResources;       // resources needed by each pass
+        std::vector<uint32_t> mPassResourceCounts;          // # of resources of each active pass
+        std::vector<FrameGraphTexture::Usage> mUsages;      // resolved usage of each resource
+        std::vector<uint32_t> mSchedule;                    // order of the active passes
+        uint32_t mHitCount = 0;
+        uint32_t mMissCount = 0;
+        bool mValid = false;
+    };
+
+    /**
+     * @param resourceAllocator allocator of the concrete resources
+     * @param cache             optional Cache used by compile(), it must outlive the FrameGraph
+     */
+    explicit FrameGraph(ResourceAllocatorInterface& resourceAllocator, Cache* cache = nullptr);
     FrameGraph(FrameGraph const&) = delete;
     FrameGraph& operator=(FrameGraph const&) = delete;
     ~FrameGraph() noexcept;
@@ -285,6 +348,25 @@ public:
      */
     FrameGraph& compile() noexcept;
 
+    /**
+     * Statistics about the transient textures, i.e. the ones created by the FrameGraph.
+     * Transient textures whose lifetimes don't overlap share the same concrete texture when
+     * their descriptors are compatible.
+     */
+    struct Statistics {
+        uint32_t transientTextureCount = 0; //!< number of active transient textures
+        uint32_t aliasedTextureCount = 0;   //!< number of them reusing an earlier one's texture
+        size_t transientMemory = 0;         //!< memory needed without aliasing, in bytes
+        size_t aliasedTransientMemory = 0;  //!< memory needed with aliasing, in bytes
+        size_t peakLiveMemory = 0;          //!< memory of the textures alive at the same time
+    };
+
+    /**
+     * Returns statistics about the transient textures, only valid after compile().
+     * @return a reference to this FrameGraph's Statistics
+     */
+    Statistics const& getStatistics() const noexcept { return mStatistics; }
+
     /**
      * Execute all referenced passes
      *
@@ -512,6 +594,28 @@ private:
     }
 
     void destroyInternal() noexcept;
+    void aliasTransientResources() noexcept;
+    void schedulePasses(std::vector<uint32_t>* schedule) noexcept;
+    void reorderActivePasses(uint32_t const* order) noexcept;
+
+    // the structure hash identifies the graph for the Cache, it's updated by every declaration
+    template<typename ... ARGS>
+    void hashStructure(ARGS... args) noexcept {
+        // same as boost::hash_combine()
+        ((mStructureHash ^= size_t(args) + 0x9e3779b9u +
+                (mStructureHash << 6u) + (mStructureHash >> 2u)), ...);
+    }
+
+    // The width and height of a resource don't contribute to the structure hash: they change
+    // with the View's size (e.g. dynamic resolution), and neither culling nor resource usage
+    // depend on them.
+    void hashDescriptor(FrameGraphTexture::Descriptor const& desc) noexcept {
+        hashStructure('D', desc.depth, desc.levels, desc.samples, desc.type, desc.format);
+    }
+
+    void hashDescriptor(FrameGraphTexture::SubResourceDescriptor const& desc) noexcept {
+        hashStructure('D', desc.level, desc.layer);
+    }
 
     Blackboard mBlackboard;
     ResourceAllocatorInterface& mResourceAllocator;
@@ -523,6 +627,9 @@ private:
     Vector<ResourceNode*> mResourceNodes;
     Vector<PassNode*> mPassNodes;
     Vector<PassNode*>::iterator mActivePassNodesEnd;
+    Statistics mStatistics;
+    Cache* const mCache;
+    size_t mStructureHash = 0;
 };
 
 template<typename Data, typename Setup, typename Execute>
@@ -568,6 +675,7 @@ void FrameGraph::present(FrameGraphId<RESOURCE> input) {
 template<typename RESOURCE>
 FrameGraphId<RESOURCE> FrameGraph::create(char const* name,
         typename RESOURCE::Descriptor const& desc) noexcept {
+    hashDescriptor(desc);
     VirtualResource* vresource(mArena.make<Resource<RESOURCE>>(name, desc));
     return FrameGraphId<RESOURCE>(addResourceInternal(vresource));
 }
@@ -575,6 +683,7 @@ FrameGraphId<RESOURCE> FrameGraph::create(char const* name,
 template<typename RESOURCE>
 FrameGraphId<RESOURCE> FrameGraph::createSubresource(FrameGraphId<RESOURCE> parent,
         char const* name, typename RESOURCE::SubResourceDescriptor const& desc) noexcept {
+    hashDescriptor(desc);
     auto* parentResource = static_cast<Resource<RESOURCE>*>(getResource(parent));
     VirtualResource* vresource(mArena.make<Resource<RESOURCE>>(parentResource, name, desc));
     return FrameGraphId<RESOURCE>(addSubResourceInternal(parent, vresource));
@@ -585,6 +694,8 @@ FrameGraphId<RESOURCE> FrameGraph::import(char const* name,
         typename RESOURCE::Descriptor const& desc,
         typename RESOURCE::Usage usage,
         RESOURCE const& resource) noexcept {
+    hashStructure('I', usage);
+    hashDescriptor(desc);
     VirtualResource* vresource(mArena.make<ImportedResource<RESOURCE>>(name, desc, usage, resource));
     return FrameGraphId<RESOURCE>(addResourceInternal(vresource));
 }
@@ -592,6 +703,7 @@ FrameGraphId<RESOURCE> FrameGraph::import(char const* name,
 template<typename RESOURCE>
 FrameGraphId<RESOURCE> FrameGraph::read(PassNode* passNode, FrameGraphId<RESOURCE> input,
         typename RESOURCE::Usage usage) {
+    hashStructure('R', input.index, input.version, usage);
     FrameGraphId<RESOURCE> result(readInternal(input, passNode,
             [this, passNode, usage](ResourceNode* node, VirtualResource* vrsrc) {
                 Resource<RESOURCE>* resource = static_cast<Resource<RESOURCE>*>(vrsrc);
@@ -603,6 +715,7 @@ FrameGraphId<RESOURCE> FrameGraph::read(PassNode* passNode, FrameGraphId<RESOURC
 template<typename RESOURCE>
 FrameGraphId<RESOURCE> FrameGraph::write(PassNode* passNode, FrameGraphId<RESOURCE> input,
         typename RESOURCE::Usage usage) {
+    hashStructure('W', input.index, input.version, usage);
     FrameGraphId<RESOURCE> result(writeInternal(input, passNode,
             [this, passNode, usage](ResourceNode* node, VirtualResource* vrsrc) {
                 Resource<RESOURCE>* resource = static_cast<Resource<RESOURCE>*>(vrsrc);
@@ -163,6 +163,19 @@ public:
     //! cull unreferenced nodes. Links ARE NOT removed, only reference counts are updated.
     void cull() noexcept;
 
+    /**
+     * Same as cull(), but using the reference counts computed by cull() for an identical graph
+     * instead of computing them.
+     * @param refCounts reference counts returned by getRefCounts(), one per node.
+     */
+    void cull(uint32_t const* refCounts) noexcept;
+
+    /**
+     * Retrieves the reference counts of all nodes. Valid only after cull() is called.
+     * @param refCounts array receiving the reference counts, one per node.
+     */
+    void getRefCounts(uint32_t* refCounts) const noexcept;
+
     /**
      * Return whether an edge is valid, that is if both ends are connected to nodes
      * that are not culled. Valid only after cull() is called.
@@ -60,6 +60,7 @@ public:
 
     Vector<VirtualResource*> devirtualize;         // resources we need to create before executing
     Vector<VirtualResource*> destroy;              // resources we need to destroy after executing
+    FrameGraph::QueueHint queueHint = FrameGraph::QueueHint::GRAPHICS;
 };
 
 class RenderPassNode : public PassNode {
@@ -56,6 +56,11 @@ public:
     PassNode* first = nullptr;  // pass that needs to instantiate the resource
     PassNode* last = nullptr;   // pass that can destroy the resource
 
+    // computed during compile(), transient resources with disjoint lifetimes that share
+    // the same concrete resource, which is handed over from one to the next.
+    VirtualResource* aliasPrevious = nullptr;
+    VirtualResource* aliasNext = nullptr;
+
     explicit VirtualResource(const char* name) noexcept : parent(this), name(name) { }
     VirtualResource(VirtualResource* parent, const char* name) noexcept : parent(parent), name(name) { }
     VirtualResource(VirtualResource const& rhs) noexcept = delete;
@@ -135,6 +140,9 @@ public:
     // weather the resource was detached
     bool detached = false;
 
+    // whether the concrete resource was handed over by aliasPrevious
+    bool inherited = false;
+
     // An Edge with added data from this resource
     class UTILS_PUBLIC ResourceEdge : public ResourceEdgeBase {
     public:
@@ -231,7 +239,9 @@ protected:
 
     void devirtualize(ResourceAllocatorInterface& resourceAllocator) noexcept override {
         if (!isSubResource()) {
-            resource.create(resourceAllocator, name, descriptor, usage);
+            if (!inherited) {
+                resource.create(resourceAllocator, name, descriptor, usage);
+            }
         } else {
             // resource is guaranteed to be initialized before we are by construction
             resource = static_cast<Resource const*>(parent)->resource;
@@ -242,6 +252,14 @@ protected:
         if (detached || isSubResource()) {
             return;
         }
+        if (aliasNext) {
+            // the next resource aliasing us takes over our concrete resource, it's guaranteed
+            // to be devirtualized after we're destroyed by construction.
+            Resource* const next = static_cast<Resource*>(aliasNext);
+            next->resource = resource;
+            next->inherited = true;
+            return;
+        }
         resource.destroy(resourceAllocator);
     }
 
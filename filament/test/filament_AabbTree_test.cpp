@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "AabbTree.h"
+#include "Culler.h"
+
+#include <math/mat4.h>
+
+#include <random>
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+
+static Aabb boxFrom(float3 center, float3 extent) {
+    return { center - extent, center + extent };
+}
+
+TEST(AabbTree, InsertRemove) {
+    AabbTree tree;
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(tree.getHeight(), -1);
+
+    auto a = tree.insert(boxFrom({ 0, 0, 0 }, 1), 0);
+    auto b = tree.insert(boxFrom({ 10, 0, 0 }, 1), 1);
+    auto c = tree.insert(boxFrom({ 20, 0, 0 }, 1), 2);
+    EXPECT_EQ(tree.size(), 3);
+    EXPECT_EQ(tree.getHeight(), 2);
+    EXPECT_EQ(tree.getRow(b), 1);
+
+    tree.remove(b);
+    EXPECT_EQ(tree.size(), 2);
+    EXPECT_EQ(tree.getHeight(), 1);
+    EXPECT_EQ(tree.getRow(a), 0);
+    EXPECT_EQ(tree.getRow(c), 2);
+
+    tree.remove(a);
+    tree.remove(c);
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(tree.getHeight(), -1);
+}
+
+TEST(AabbTree, StaysBalanced) {
+    // inserting boxes in order is the worst case for an unbalanced tree
+    AabbTree tree;
+    for (size_t i = 0; i < 1024; i++) {
+        tree.insert(boxFrom({ float(i), 0, 0 }, 0.5f), uint32_t(i));
+    }
+    EXPECT_EQ(tree.size(), 1024);
+    EXPECT_LE(tree.getHeight(), 20);
+}
+
+TEST(AabbTree, CullMatchesCuller) {
+    constexpr size_t COUNT = 4096;
+    std::default_random_engine gen; // NOLINT
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> size(0.1f, 5.0f);
+
+    std::vector<float3> centers(COUNT);
+    std::vector<float3> extents(COUNT);
+    std::vector<AabbTree::Id> leaves(COUNT);
+    AabbTree tree;
+    for (size_t i = 0; i < COUNT; i++) {
+        centers[i] = { position(gen), position(gen) * 0.1f, position(gen) };
+        extents[i] = { size(gen), size(gen), size(gen) };
+        leaves[i] = tree.insert(boxFrom(centers[i], extents[i]), uint32_t(i));
+    }
+
+    // move and remove/re-insert some of the boxes
+    for (size_t i = 0; i < COUNT; i += 7) {
+        centers[i].y += 10.0f;
+        tree.update(leaves[i], boxFrom(centers[i], extents[i]));
+    }
+    for (size_t i = 0; i < COUNT; i += 3) {
+        tree.remove(leaves[i]);
+    }
+    for (size_t i = 0; i < COUNT; i += 3) {
+        leaves[i] = tree.insert(boxFrom(centers[i], extents[i]), uint32_t(i));
+    }
+
+    Frustum frustum(mat4f::perspective(45.0f, 1.0f, 0.1f, 100.0f));
+
+    // bits other than the one we cull must be preserved
+    std::vector<Culler::result_type> expected(COUNT, 0xAAAA);
+    std::vector<Culler::result_type> results(COUNT, 0xAAAA);
+    Culler::Test::intersects(Culler::Isa::SCALAR,
+            expected.data(), frustum, centers.data(), extents.data(), COUNT);
+    tree.cull(results.data(), frustum, centers.data(), extents.data(), 0);
+    EXPECT_EQ(expected, results);
+}
@@ -29,6 +29,9 @@
 
 #include "details/Texture.h"
 
+#include <string>
+#include <vector>
+
 using namespace filament;
 using namespace backend;
 
@@ -942,3 +945,234 @@ TEST_F(FrameGraphTest, WriteResourceReadAsAttachment) {
 
     fg.execute(driverApi);
 }
+
+TEST_F(FrameGraphTest, AliasTransientTextures) {
+
+    // "first" is destroyed after the "Middle" pass, so "last", which has the same descriptor
+    // and is only needed by the "Last" pass, should reuse its texture. "middle" and "other"
+    // can't, they're respectively alive at the same time as "first", or a different size.
+
+    FrameGraphTexture::Descriptor const desc{ .width = 16, .height = 16 };
+    Handle<HwTexture> textures[3];
+    Handle<HwTexture>* const pTextures = textures;
+
+    struct PassData {
+        FrameGraphId<FrameGraphTexture> input;
+        FrameGraphId<FrameGraphTexture> output;
+        FrameGraphId<FrameGraphTexture> other;
+    };
+
+    auto& firstPass = fg.addPass<PassData>("First", [&](FrameGraph::Builder& builder, auto& data) {
+                data.output = builder.create<FrameGraphTexture>("first", desc);
+                data.output = builder.write(data.output);
+            },
+            [=](FrameGraphResources const& resources, auto const& data, backend::DriverApi&) {
+                pTextures[0] = resources.get(data.output).handle;
+            });
+
+    auto& middlePass = fg.addPass<PassData>("Middle", [&](FrameGraph::Builder& builder, auto& data) {
+                data.input = builder.sample(firstPass->output);
+                data.output = builder.create<FrameGraphTexture>("middle", desc);
+                data.output = builder.write(data.output);
+            },
+            [=](FrameGraphResources const& resources, auto const& data, backend::DriverApi&) {
+                pTextures[1] = resources.get(data.output).handle;
+            });
+
+    fg.addPass<PassData>("Last", [&](FrameGraph::Builder& builder, auto& data) {
+                data.input = builder.sample(middlePass->output);
+                data.output = builder.create<FrameGraphTexture>("last", desc);
+                data.output = builder.write(data.output);
+                data.other = builder.create<FrameGraphTexture>("other",
+                        { .width = 32, .height = 32 });
+                data.other = builder.write(data.other);
+                builder.sideEffect();
+            },
+            [=](FrameGraphResources const& resources, auto const& data, backend::DriverApi&) {
+                pTextures[2] = resources.get(data.output).handle;
+                EXPECT_NE(resources.get(data.other).handle, pTextures[0]);
+                EXPECT_EQ(resources.getUsage(data.output),
+                        TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE);
+            });
+
+    EXPECT_TRUE(fg.isAcyclic());
+
+    fg.compile();
+
+    FrameGraph::Statistics const& stats = fg.getStatistics();
+    size_t const size = 16 * 16 * 4;
+    EXPECT_EQ(stats.transientTextureCount, 4);
+    EXPECT_EQ(stats.aliasedTextureCount, 1);
+    EXPECT_EQ(stats.transientMemory, 3 * size + 32 * 32 * 4);
+    EXPECT_EQ(stats.aliasedTransientMemory, 2 * size + 32 * 32 * 4);
+    EXPECT_EQ(stats.peakLiveMemory, 2 * size + 32 * 32 * 4);
+
+    fg.execute(driverApi);
+
+    EXPECT_TRUE(textures[0]);
+    EXPECT_NE(textures[0], textures[1]);
+    EXPECT_EQ(textures[0], textures[2]);
+}
+
+TEST_F(FrameGraphTest, CompiledGraphCache) {
+
+    struct PassData {
+        FrameGraphId<FrameGraphTexture> color;
+        FrameGraphId<FrameGraphTexture> depth;
+        FrameGraphId<FrameGraphTexture> output;
+    };
+
+    FrameGraph::Cache cache;
+
+    // declares and runs the same graph as Renderer would every frame, the "Debug" pass is
+    // always culled. When sampleDepth is set, the "Post" pass has an additional dependency.
+    auto frame = [&](bool sampleDepth, uint32_t width = 16,
+            TextureFormat outputFormat = TextureFormat::RGBA8) {
+        FrameGraph fg(resourceAllocator, &cache);
+
+        auto& renderPass = fg.addPass<PassData>("Render",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.color = builder.create<FrameGraphTexture>("color", { .width = width });
+                    data.depth = builder.create<FrameGraphTexture>("depth", { .width = width,
+                            .format = TextureFormat::DEPTH32F });
+                    data.color = builder.write(data.color, FrameGraphTexture::Usage::COLOR_ATTACHMENT);
+                    data.depth = builder.write(data.depth, FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
+                },
+                [](FrameGraphResources const&, auto const&, backend::DriverApi&) {});
+
+        auto& debugPass = fg.addPass<PassData>("Debug",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.color = builder.sample(renderPass->color);
+                    data.output = builder.create<FrameGraphTexture>("debug", { .width = 16 });
+                    data.output = builder.write(data.output);
+                },
+                [](FrameGraphResources const&, auto const&, backend::DriverApi&) {});
+
+        auto& postPass = fg.addPass<PassData>("Post",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.color = builder.sample(renderPass->color);
+                    if (sampleDepth) {
+                        data.depth = builder.sample(renderPass->depth);
+                    }
+                    data.output = builder.create<FrameGraphTexture>("output", { .width = width,
+                            .format = outputFormat });
+                    data.output = builder.write(data.output);
+                    builder.sideEffect();
+                },
+                [=](FrameGraphResources const& resources, auto const& data, backend::DriverApi&) {
+                    EXPECT_TRUE(resources.get(data.color).handle);
+                    EXPECT_EQ(resources.getUsage(data.color),
+                            TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE);
+                    if (sampleDepth) {
+                        EXPECT_TRUE(resources.get(data.depth).handle);
+                    }
+                });
+
+        fg.compile();
+
+        EXPECT_FALSE(fg.isCulled(renderPass));
+        EXPECT_TRUE(fg.isCulled(debugPass));
+        EXPECT_FALSE(fg.isCulled(postPass));
+
+        fg.execute(driverApi);
+    };
+
+    frame(false);
+    EXPECT_EQ(cache.getHitCount(), 0);
+    EXPECT_EQ(cache.getMissCount(), 1);
+
+    frame(false);
+    frame(false);
+    EXPECT_EQ(cache.getHitCount(), 2);
+    EXPECT_EQ(cache.getMissCount(), 1);
+
+    frame(true);
+    EXPECT_EQ(cache.getHitCount(), 2);
+    EXPECT_EQ(cache.getMissCount(), 2);
+
+    frame(true);
+    EXPECT_EQ(cache.getHitCount(), 3);
+    EXPECT_EQ(cache.getMissCount(), 2);
+
+    // resizing doesn't change the structure, changing a format does
+    frame(true, 32);
+    EXPECT_EQ(cache.getHitCount(), 4);
+    EXPECT_EQ(cache.getMissCount(), 2);
+
+    frame(true, 32, TextureFormat::RGBA16F);
+    EXPECT_EQ(cache.getHitCount(), 4);
+    EXPECT_EQ(cache.getMissCount(), 3);
+}
+
+TEST_F(FrameGraphTest, AsyncPassScheduling) {
+
+    // "SSAO" only depends on "Structure", so it's moved before "Color". "Depth Update" writes
+    // the depth buffer which "Color" and "SSAO" read, so it can't move.
+
+    struct PassData {
+        FrameGraphId<FrameGraphTexture> input;
+        FrameGraphId<FrameGraphTexture> output;
+    };
+
+    std::vector<std::string> executed;
+    std::vector<std::string>* const pExecuted = &executed;
+    auto record = [pExecuted](const char* name) {
+        return [pExecuted, name](FrameGraphResources const&, auto const&, backend::DriverApi&) {
+            pExecuted->emplace_back(name);
+        };
+    };
+
+    auto& shadowPass = fg.addPass<PassData>("Shadows",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.output = builder.create<FrameGraphTexture>("shadows");
+                data.output = builder.write(data.output);
+            }, record("Shadows"));
+
+    auto& structurePass = fg.addPass<PassData>("Structure",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.output = builder.create<FrameGraphTexture>("depth");
+                data.output = builder.write(data.output);
+            }, record("Structure"));
+
+    auto& colorPass = fg.addPass<PassData>("Color",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                builder.sample(shadowPass->output);
+                data.input = builder.sample(structurePass->output);
+                data.output = builder.create<FrameGraphTexture>("color");
+                data.output = builder.write(data.output);
+            }, record("Color"));
+
+    auto& ssaoPass = fg.addPass<PassData>("SSAO",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.input = builder.sample(structurePass->output);
+                data.output = builder.create<FrameGraphTexture>("ssao");
+                data.output = builder.write(data.output);
+                builder.setQueueHint(FrameGraph::QueueHint::ASYNC);
+            }, record("SSAO"));
+
+    auto& depthPass = fg.addPass<PassData>("Depth Update",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.output = builder.write(structurePass->output);
+                builder.setQueueHint(FrameGraph::QueueHint::ASYNC);
+            }, record("Depth Update"));
+
+    fg.addPass<PassData>("Resolve",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                builder.sample(colorPass->output);
+                builder.sample(ssaoPass->output);
+                builder.sample(depthPass->output);
+                data.output = builder.create<FrameGraphTexture>("output");
+                data.output = builder.write(data.output);
+                builder.sideEffect();
+            }, record("Resolve"));
+
+    EXPECT_TRUE(fg.isAcyclic());
+
+    fg.compile();
+
+    fg.execute(driverApi);
+
+    std::vector<std::string> const expected{
+            "Shadows", "Structure", "SSAO", "Color", "Depth Update", "Resolve" };
+    EXPECT_EQ(executed, expected);
+}
@@ -14,8 +14,15 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -31,20 +38,40 @@
 #include <filament/Frustum.h>
 #include <filament/Material.h>
 #include <filament/Engine.h>
+#include <filament/IndexBuffer.h>
+#include <filament/VertexBuffer.h>
 
 #include <private/filament/BufferInterfaceBlock.h>
+#include <private/filament/Variant.h>
 #include <private/filament/UibStructs.h>
 #include <private/backend/BackendUtils.h>
+#include <private/backend/CommandCapture.h>
+
+#include <utils/FixedCapacityVector.h>
+#include <utils/JobSystem.h>
+#include <utils/Systrace.h>
 
 #include "Allocators.h"
+#include "Culler.h"
 #include "details/Material.h"
 #include "details/Camera.h"
 #include "Froxelizer.h"
+#include "RenderPass.h"
+#include "RenderPrimitive.h"
+#include "ResourceAllocator.h"
+#include "ShadowMap.h"
+#include "ShadowMapManager.h"
 #include "details/Engine.h"
+#include "details/IndexBuffer.h"
+#include "details/Scene.h"
+#include "details/VertexBuffer.h"
+#include "details/View.h"
 #include "components/RenderableManager.h"
 #include "components/TransformManager.h"
 #include "UniformBuffer.h"
 
+#include "generated/resources/materials.h"
+
 using namespace filament;
 using namespace filament::math;
 using namespace utils;
@@ -283,6 +310,122 @@ TEST(FilamentTest, TransformManager) {
     EXPECT_EQ(c, tcm.getChildCount(newParent));
 }
 
+TEST(FilamentTest, TransformManagerAccurateTranslationsInTransaction) {
+    filament::FTransformManager tcm;
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 3> entities;
+    em.create(entities.size(), entities.data());
+
+    auto const t = mat4::translation(double3(1.0 / 3.0));
+    tcm.create(entities[0]);
+    tcm.create(entities[1], tcm.getInstance(entities[0]), mat4f{});
+    tcm.create(entities[2]);
+    tcm.setTransform(tcm.getInstance(entities[0]), t);
+
+    // enabling accurate translations during a transaction recomputes all world transforms at
+    // the commit, not only the ones of the nodes modified during the transaction
+    tcm.openLocalTransformTransaction();
+    tcm.setAccurateTranslationsEnabled(true);
+    tcm.setTransform(tcm.getInstance(entities[2]), mat4f{ float4{ 2 }});
+    tcm.commitLocalTransformTransaction();
+
+    const mat4 PRECISION_KILLER_5BITS = mat4::translation(double3(16.0));
+    EXPECT_EQ(tcm.getWorldTransformAccurate(tcm.getInstance(entities[0])) + PRECISION_KILLER_5BITS,
+            t + PRECISION_KILLER_5BITS);
+    EXPECT_EQ(tcm.getWorldTransformAccurate(tcm.getInstance(entities[1])) + PRECISION_KILLER_5BITS,
+            t + PRECISION_KILLER_5BITS);
+
+    em.destroy(entities.size(), entities.data());
+}
+
+TEST(FilamentTest, TransformManagerLevelOrder) {
+    JobSystem js;
+    js.adopt();
+
+    // the same hierarchy is built in both managers, only the second one uses level-order
+    filament::FTransformManager reference;
+    filament::FTransformManager tcm;
+    tcm.setLevelOrderEnabled(true);
+    tcm.setJobSystem(&js);
+    EXPECT_TRUE(tcm.isLevelOrderEnabled());
+
+    EntityManager& em = EntityManager::get();
+    std::vector<Entity> entities(4096);
+    em.create(entities.size(), entities.data());
+
+    std::default_random_engine gen;
+    auto randomTransform = [&gen]() {
+        std::uniform_real_distribution<float> rnd(-1.0f, 1.0f);
+        return mat4f::translation(float3{ rnd(gen), rnd(gen), rnd(gen) }) *
+               mat4f::rotation(rnd(gen), normalize(float3{ rnd(gen), rnd(gen), 1.0f }));
+    };
+
+    auto checkWorldTransforms = [&]() {
+        for (Entity e : entities) {
+            EXPECT_EQ(tcm.getWorldTransform(tcm.getInstance(e)),
+                    reference.getWorldTransform(reference.getInstance(e)));
+        }
+    };
+
+    reference.openLocalTransformTransaction();
+    tcm.openLocalTransformTransaction();
+    for (size_t i = 0; i < entities.size(); i++) {
+        mat4f const local = randomTransform();
+        // a few roots with wide and shallow subtrees, the last few nodes are roots too
+        bool const root = i < 8 || i >= entities.size() - 16;
+        Entity const parent = root ? Entity{} : entities[gen() % i];
+        reference.create(entities[i], reference.getInstance(parent), local);
+        tcm.create(entities[i], tcm.getInstance(parent), local);
+    }
+    // and a few nodes parented out-of-order to the last roots
+    for (size_t i = 0; i < 16; i++) {
+        Entity const child = entities[8 + i];
+        Entity const parent = entities[entities.size() - 1 - i];
+        reference.setParent(reference.getInstance(child), reference.getInstance(parent));
+        tcm.setParent(tcm.getInstance(child), tcm.getInstance(parent));
+    }
+    reference.commitLocalTransformTransaction();
+    tcm.commitLocalTransformTransaction();
+    checkWorldTransforms();
+
+    // components are now sorted by depth
+    for (Entity e : entities) {
+        TransformManager::Instance const i = tcm.getInstance(e);
+        Entity const parent = tcm.getParent(i);
+        if (parent) {
+            EXPECT_LT(tcm.getInstance(parent), i);
+        }
+    }
+
+    // only update a few subtrees
+    reference.openLocalTransformTransaction();
+    tcm.openLocalTransformTransaction();
+    for (size_t i = 0; i < 32; i++) {
+        Entity const e = entities[gen() % entities.size()];
+        mat4f const local = randomTransform();
+        reference.setTransform(reference.getInstance(e), local);
+        tcm.setTransform(tcm.getInstance(e), local);
+    }
+    reference.commitLocalTransformTransaction();
+    tcm.commitLocalTransformTransaction();
+    checkWorldTransforms();
+
+    // destroying a node turns its children into roots
+    reference.openLocalTransformTransaction();
+    tcm.openLocalTransformTransaction();
+    Entity const removed = entities.front();
+    reference.destroy(removed);
+    tcm.destroy(removed);
+    entities.erase(entities.begin());
+    reference.commitLocalTransformTransaction();
+    tcm.commitLocalTransformTransaction();
+    checkWorldTransforms();
+
+    em.destroy(removed);
+    em.destroy(entities.size(), entities.data());
+    js.emancipate();
+}
+
 TEST(FilamentTest, UniformInterfaceBlock) {
 
     BufferInterfaceBlock::Builder b;
@@ -595,6 +738,85 @@ TEST(FilamentTest, SphereCulling) {
     EXPECT_TRUE(frustum.intersects({ 0, 200 }));
 }
 
+TEST(FilamentTest, CullerIsaMatchesScalar) {
+    constexpr size_t COUNT = 1024;
+    Frustum frustum(mat4f::perspective(45.0f, 1.0f, 0.1f, 100.0f));
+
+    std::default_random_engine gen; // NOLINT
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 25.0f);
+
+    std::vector<float3> centers(COUNT);
+    std::vector<float3> extents(COUNT);
+    std::vector<float4> spheres(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        centers[i] = { position(gen), position(gen), position(gen) };
+        extents[i] = { size(gen), size(gen), size(gen) };
+        spheres[i] = { centers[i], size(gen) };
+    }
+
+    std::vector<Culler::result_type> boxReference(COUNT, 0xAAAA);
+    std::vector<Culler::result_type> sphereReference(COUNT);
+    Culler::Test::intersects(Culler::Isa::SCALAR,
+            boxReference.data(), frustum, centers.data(), extents.data(), COUNT);
+    Culler::Test::intersects(Culler::Isa::SCALAR,
+            sphereReference.data(), frustum, spheres.data(), COUNT);
+
+    // the scalar kernels are compiled without FP contraction, so the plane equations are
+    // evaluated with the same operations by all kernels
+    for (auto isa : { Culler::Isa::SSE4, Culler::Isa::AVX2, Culler::Isa::NEON }) {
+        if (!Culler::isSupported(isa)) {
+            continue;
+        }
+        // the untouched bits must be preserved
+        std::vector<Culler::result_type> boxResults(COUNT, 0xAAAA);
+        std::vector<Culler::result_type> sphereResults(COUNT);
+        Culler::Test::intersects(isa,
+                boxResults.data(), frustum, centers.data(), extents.data(), COUNT);
+        Culler::Test::intersects(isa,
+                sphereResults.data(), frustum, spheres.data(), COUNT);
+        EXPECT_EQ(boxReference, boxResults);
+        EXPECT_EQ(sphereReference, sphereResults);
+    }
+}
+
+TEST(FilamentTest, CullerMultipleFrustums) {
+    constexpr size_t COUNT = 1021;  // not a multiple of Culler::MODULO
+    constexpr size_t FRUSTUM_COUNT = 64;
+
+    std::default_random_engine gen; // NOLINT
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 25.0f);
+
+    std::vector<Frustum> frustums(FRUSTUM_COUNT);
+    for (size_t i = 0; i < FRUSTUM_COUNT; i++) {
+        mat4f const model = mat4f::lookAt(float3{ position(gen), position(gen), position(gen) },
+                float3{ 0 }, float3{ 0, 1, 0 });
+        frustums[i] = Frustum{ mat4f::perspective(45.0f, 1.0f, 0.1f, 100.0f) * inverse(model) };
+    }
+
+    std::vector<float3> centers(Culler::round(COUNT));
+    std::vector<float3> extents(Culler::round(COUNT));
+    for (size_t i = 0; i < COUNT; i++) {
+        centers[i] = { position(gen), position(gen), position(gen) };
+        extents[i] = { size(gen), size(gen), size(gen) };
+    }
+
+    std::vector<uint64_t> masks(Culler::round(COUNT), ~uint64_t(0));
+    Culler::intersects(masks.data(), frustums.data(), FRUSTUM_COUNT,
+            centers.data(), extents.data(), COUNT);
+
+    // each bit must match culling against that frustum alone
+    std::vector<Culler::result_type> results(Culler::round(COUNT));
+    for (size_t f = 0; f < FRUSTUM_COUNT; f++) {
+        Culler::Test::intersects(results.data(), frustums[f],
+                centers.data(), extents.data(), COUNT);
+        for (size_t i = 0; i < COUNT; i++) {
+            EXPECT_EQ(bool(results[i] & 1u), bool((masks[i] >> f) & 1u));
+        }
+    }
+}
+
 TEST(FilamentTest, ColorConversion) {
     // Linear to Gamma
     // 0.0 stays 0.0
@@ -741,6 +963,1206 @@ TEST(FilamentTest, FroxelData) {
     Engine::destroy((Engine **)&engine);
 }
 
+TEST(FilamentTest, FroxelizeManyLights) {
+    using namespace filament;
+
+    FEngine* engine = downcast(Engine::create());
+
+    LinearAllocatorArena arena("FRenderer: per-frame allocator", 3 * 1024 * 1024);
+    utils::ArenaScope<LinearAllocatorArena> scope(arena);
+
+    Viewport vp(0, 0, 1280, 640);
+    mat4f p = mat4f::perspective(90, 1.0f, 0.1, 100, mat4f::Fov::HORIZONTAL);
+
+    Froxelizer froxelData(*engine);
+    froxelData.setOptions(5, 100);
+    froxelData.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+
+    Entity e = engine->getEntityManager().create();
+    LightManager::Builder(LightManager::Type::POINT).build(*engine, e);
+    LightManager::Instance instance = engine->getLightManager().getInstance(e);
+
+    // more lights than fit in a single group, all in front of the camera
+    constexpr size_t lightCount = 100;
+    FScene::LightSoa lights;
+    lights.setCapacity(lightCount + 1);
+    lights.push_back({}, {}, {}, {}, {}, {});   // first one is always skipped
+    for (size_t i = 0; i < lightCount; i++) {
+        float const x = -9.0f + 18.0f * float(i) / float(lightCount - 1);
+        lights.push_back(float4{ x, 0, -10, 0.5f }, {}, instance, 1, {}, {});
+    }
+
+    froxelData.froxelizeLights(*engine, {}, lights);
+
+    // every light must be referenced by at least one froxel, with its own index
+    auto const& froxelBuffer = froxelData.getFroxelBufferUser();
+    auto const& recordBuffer = froxelData.getRecordBufferUser();
+    std::vector<bool> found(lightCount);
+    for (size_t i = 0, c = froxelData.getFroxelCount(); i < c; i++) {
+        auto const& entry = froxelBuffer[i];
+        for (size_t j = 0; j < entry.count(); j++) {
+            size_t const lightIndex = recordBuffer[entry.offset() + j];
+            ASSERT_LT(lightIndex, lightCount);
+            found[lightIndex] = true;
+        }
+    }
+    EXPECT_EQ(size_t(std::count(found.begin(), found.end(), true)), lightCount);
+
+    froxelData.terminate(engine->getDriverApi());
+    engine->destroy(e);
+
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, FroxelizeReuse) {
+    using namespace filament;
+
+    FEngine* engine = downcast(Engine::create());
+
+    LinearAllocatorArena arena("FRenderer: per-frame allocator", 3 * 1024 * 1024);
+    utils::ArenaScope<LinearAllocatorArena> scope(arena);
+
+    Viewport vp(0, 0, 1280, 640);
+    mat4f p = mat4f::perspective(90, 1.0f, 0.1, 100, mat4f::Fov::HORIZONTAL);
+
+    Entity e = engine->getEntityManager().create();
+    LightManager::Builder(LightManager::Type::POINT).build(*engine, e);
+    LightManager::Instance instance = engine->getLightManager().getInstance(e);
+
+    constexpr size_t lightCount = 100;
+    FScene::LightSoa lights;
+    lights.setCapacity(lightCount + 1);
+    lights.push_back({}, {}, {}, {}, {}, {});   // first one is always skipped
+    for (size_t i = 0; i < lightCount; i++) {
+        float const x = -9.0f + 18.0f * float(i) / float(lightCount - 1);
+        lights.push_back(float4{ x, 0, -10, 0.5f }, {}, instance, 1, {}, {});
+    }
+
+    // the list of lights of each froxel
+    auto getFroxelLights = [](Froxelizer const& froxelizer) {
+        auto const& froxelBuffer = froxelizer.getFroxelBufferUser();
+        auto const& recordBuffer = froxelizer.getRecordBufferUser();
+        std::vector<std::vector<size_t>> result(froxelizer.getFroxelCount());
+        for (size_t i = 0, c = froxelizer.getFroxelCount(); i < c; i++) {
+            auto const& entry = froxelBuffer[i];
+            for (size_t j = 0; j < entry.count(); j++) {
+                result[i].push_back(recordBuffer[entry.offset() + j]);
+            }
+        }
+        return result;
+    };
+
+    Froxelizer froxelData(*engine);
+    froxelData.setOptions(5, 100);
+
+    froxelData.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+    froxelData.froxelizeLights(*engine, {}, lights);
+    EXPECT_TRUE(froxelData.needsCommit());
+    froxelData.commit(engine->getDriverApi());
+    EXPECT_FALSE(froxelData.needsCommit());
+
+    // nothing changed, the froxels sent to the GPU are still valid
+    froxelData.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+    froxelData.froxelizeLights(*engine, {}, lights);
+    EXPECT_FALSE(froxelData.needsCommit());
+
+    // a single light moved, only its group is froxelized again, but the result must match
+    // froxelizing all lights from scratch
+    lights.elementAt<FScene::POSITION_RADIUS>(1) = float4{ 0, 5, -20, 2.0f };
+    froxelData.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+    froxelData.froxelizeLights(*engine, {}, lights);
+    EXPECT_TRUE(froxelData.needsCommit());
+
+    Froxelizer reference(*engine);
+    reference.setOptions(5, 100);
+    reference.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+    reference.froxelizeLights(*engine, {}, lights);
+    EXPECT_EQ(getFroxelLights(froxelData), getFroxelLights(reference));
+    froxelData.commit(engine->getDriverApi());
+
+    // the camera moved, all lights are froxelized again
+    mat4f const viewMatrix = mat4f::translation(float3{ 1, 0, 0 });
+    froxelData.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+    froxelData.froxelizeLights(*engine, viewMatrix, lights);
+    EXPECT_TRUE(froxelData.needsCommit());
+    froxelData.commit(engine->getDriverApi());
+
+    // the projection changed
+    mat4f const zoomed = mat4f::perspective(60, 1.0f, 0.1, 100, mat4f::Fov::HORIZONTAL);
+    froxelData.prepare(engine->getDriverApi(), scope, vp, zoomed, 0.1, 100);
+    froxelData.froxelizeLights(*engine, viewMatrix, lights);
+    EXPECT_TRUE(froxelData.needsCommit());
+    froxelData.commit(engine->getDriverApi());
+
+    reference.terminate(engine->getDriverApi());
+    froxelData.terminate(engine->getDriverApi());
+    engine->destroy(e);
+
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, SceneIncrementalPrepare) {
+    FEngine* engine = downcast(Engine::create());
+    Scene* publicScene = engine->createScene();
+    FScene* scene = downcast(publicScene);
+    LinearAllocatorArena& arena = engine->getPerRenderPassAllocator();
+    JobSystem& js = engine->getJobSystem();
+    FRenderableManager& rcm = engine->getRenderableManager();
+    FTransformManager& tcm = engine->getTransformManager();
+
+    std::vector<Entity> entities(64);
+    engine->getEntityManager().create(entities.size(), entities.data());
+    for (size_t i = 0; i < entities.size(); i++) {
+        RenderableManager::Builder(1)
+                .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+                .build(*engine, entities[i]);
+        tcm.create(entities[i], {}, mat4f::translation(float3{ float(i), 0, 0 }));
+        publicScene->addEntity(entities[i]);
+    }
+
+    // checks that the SoA matches the components, regardless of how it's ordered
+    auto check = [&](mat4 const& worldOrigin) {
+        FScene::RenderableSoa const& soa = scene->getRenderableData();
+        ASSERT_EQ(soa.size(), publicScene->getRenderableCount());
+        for (size_t i = 0; i < soa.size(); i++) {
+            auto const ri = soa.elementAt<FScene::RENDERABLE_INSTANCE>(i);
+            auto const ti = tcm.getInstance(rcm.getEntity(ri));
+            mat4f const world{ worldOrigin * tcm.getWorldTransformAccurate(ti) };
+            EXPECT_EQ(soa.elementAt<FScene::WORLD_TRANSFORM>(i), world);
+            EXPECT_EQ(soa.elementAt<FScene::WORLD_AABB_CENTER>(i), world[3].xyz);
+            EXPECT_EQ(soa.elementAt<FScene::LAYERS>(i), rcm.getLayerMask(ri));
+            EXPECT_EQ(soa.elementAt<FScene::VISIBLE_MASK>(i), 0);
+        }
+    };
+
+    scene->prepare(js, arena, mat4{}, false);
+    check(mat4{});
+
+    // nothing changed, but the View could have reordered the SoA or written the visibility
+    std::reverse(scene->getRenderableData().begin(), scene->getRenderableData().end());
+    std::fill_n(scene->getRenderableData().data<FScene::VISIBLE_MASK>(),
+            scene->getRenderableData().size(), 1);
+    scene->prepare(js, arena, mat4{}, false);
+    check(mat4{});
+
+    // a few components change
+    tcm.setTransform(tcm.getInstance(entities[3]), mat4f::translation(float3{ 0, 5, 0 }));
+    rcm.setLayerMask(rcm.getInstance(entities[7]), 0x2);
+    scene->prepare(js, arena, mat4{}, false);
+    check(mat4{});
+
+    // same, in a transaction
+    tcm.openLocalTransformTransaction();
+    tcm.setTransform(tcm.getInstance(entities[5]), mat4f::translation(float3{ 0, 0, 5 }));
+    tcm.commitLocalTransformTransaction();
+    scene->prepare(js, arena, mat4{}, false);
+    check(mat4{});
+
+    // renderables are removed and added
+    publicScene->remove(entities[0]);
+    engine->destroy(entities[1]);
+    scene->prepare(js, arena, mat4{}, false);
+    check(mat4{});
+    publicScene->addEntity(entities[0]);
+    scene->prepare(js, arena, mat4{}, false);
+    check(mat4{});
+
+    // the world origin changes
+    mat4 const worldOrigin = mat4::translation(double3{ 1, 2, 3 });
+    scene->prepare(js, arena, worldOrigin, false);
+    check(worldOrigin);
+
+    for (Entity e : entities) {
+        engine->destroy(e);
+    }
+    engine->getEntityManager().destroy(entities.size(), entities.data());
+    engine->destroy(scene);
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, PostProcessResolution) {
+    FEngine* engine = downcast(Engine::create(Engine::Backend::NOOP));
+    FView* view = downcast(engine->createView());
+    using Resolution = View::PostProcessResolutionOptions::Resolution;
+
+    // disabled by default
+    EXPECT_EQ(view->getPostProcessScale(), 1.0f);
+
+    view->setPostProcessResolutionOptions({ .enabled = true, .resolution = Resolution::HALF });
+    EXPECT_EQ(view->getPostProcessScale(), 0.5f);
+
+    view->setPostProcessResolutionOptions({ .enabled = true, .resolution = Resolution::QUARTER });
+    EXPECT_EQ(view->getPostProcessScale(), 0.25f);
+
+    // minResolution can't be higher than resolution
+    view->setPostProcessResolutionOptions({ .enabled = true, .resolution = Resolution::HALF,
+            .dynamic = true, .minResolution = Resolution::FULL });
+    EXPECT_EQ(view->getPostProcessResolutionOptions().minResolution, Resolution::HALF);
+    EXPECT_EQ(view->getPostProcessScale(), 0.5f);
+
+    view->setPostProcessResolutionOptions({ .enabled = false, .resolution = Resolution::HALF });
+    EXPECT_EQ(view->getPostProcessScale(), 1.0f);
+
+    // the dynamic resolution controller lowers the effects' resolution first
+    view->setViewport({ 0, 0, 1280, 720 });
+    view->setDynamicResolutionOptions({ .enabled = true });
+    view->setPostProcessResolutionOptions({ .enabled = true, .resolution = Resolution::FULL,
+            .dynamic = true, .minResolution = Resolution::HALF });
+    EXPECT_EQ(view->getPostProcessScale(), 1.0f);
+
+    Renderer::FrameRateOptions const frameRateOptions{};
+    Renderer::DisplayInfo const displayInfo{};
+    float const target = 1000.0f / displayInfo.refreshRate;
+    auto update = [&](float frameTimeRatio) {
+        FrameInfo info;
+        info.frameTime = info.denoisedFrameTime = FrameInfo::duration(target * frameTimeRatio);
+        info.valid = true;
+        float2 const scale = view->updateScale(*engine, info, frameRateOptions, displayInfo);
+        return scale.x * scale.y;
+    };
+
+    EXPECT_EQ(update(2.0f), 1.0f);
+    EXPECT_EQ(view->getPostProcessScale(), 0.5f);
+
+    // the View's scale is held while the frame time settles, without winding up the controller
+    for (size_t i = 0; i < 15; i++) {
+        EXPECT_EQ(update(2.0f), 1.0f);
+    }
+    // a wound up integral term would lower the scale here
+    EXPECT_EQ(update(1.0f), 1.0f);
+    EXPECT_EQ(view->getPostProcessScale(), 0.5f);
+
+    // the effects are at their minimum resolution, the View's scale is lowered
+    float const lowered = update(2.0f);
+    EXPECT_LT(lowered, 1.0f);
+    EXPECT_EQ(view->getPostProcessScale(), 0.5f);
+
+    // the effects' resolution is raised last, once the View is at its maximum scale
+    EXPECT_GT(update(0.5f), lowered);
+    EXPECT_EQ(view->getPostProcessScale(), 0.5f);
+    float scale = lowered;
+    for (size_t i = 0; i < 10 && view->getPostProcessScale() < 1.0f; i++) {
+        scale = update(0.5f);
+    }
+    EXPECT_EQ(view->getPostProcessScale(), 1.0f);
+    EXPECT_EQ(scale, 1.0f);
+
+    engine->destroy(view);
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, RenderPassRadixSort) {
+    using Command = RenderPass::Command;
+    using SortKey = RenderPass::SortKey;
+
+    JobSystem js;
+    js.adopt();
+
+    std::default_random_engine gen(42);
+
+    // makes a random key using the layout of a color pass command
+    auto makeKey = [&gen](uint32_t materialCount, uint32_t zBucketCount) {
+        std::uniform_int_distribution<uint32_t> channel(0, 3);
+        std::uniform_int_distribution<uint32_t> priority(0, 7);
+        std::uniform_int_distribution<uint32_t> zBucket(0, zBucketCount - 1);
+        std::uniform_int_distribution<uint32_t> material(0, materialCount - 1);
+        RenderPass::CommandKey key = uint64_t(RenderPass::Pass::COLOR);
+        key |= RenderPass::makeField(channel(gen), RenderPass::CHANNEL_MASK,
+                RenderPass::CHANNEL_SHIFT);
+        key |= RenderPass::makeField(priority(gen), RenderPass::PRIORITY_MASK,
+                RenderPass::PRIORITY_SHIFT);
+        key |= RenderPass::makeField(zBucket(gen), RenderPass::Z_BUCKET_MASK,
+                RenderPass::Z_BUCKET_SHIFT);
+        key |= RenderPass::makeMaterialSortingKey(material(gen), 0);
+        return key;
+    };
+
+    auto check = [&js, &gen](std::vector<Command> commands, float sentinelRatio) {
+        std::bernoulli_distribution isSentinel(sentinelRatio);
+        for (size_t i = 0; i < commands.size(); i++) {
+            if (isSentinel(gen)) {
+                commands[i].key = uint64_t(RenderPass::Pass::SENTINEL);
+            }
+            // remember where each command comes from
+            commands[i].primitive.index = uint32_t(i);
+        }
+
+        std::vector<Command> expected(commands);
+        std::sort(expected.begin(), expected.end());
+        size_t const expectedCount = std::partition_point(expected.begin(), expected.end(),
+                [](Command const& c) {
+                    return c.key != uint64_t(RenderPass::Pass::SENTINEL);
+                }) - expected.begin();
+
+        std::vector<Command> sorted(commands);
+        std::vector<SortKey> scratch(sorted.size() * 2);
+        size_t const count = RenderPass::radixSortCommands(js,
+                sorted.data(), sorted.data() + sorted.size(), scratch.data());
+
+        EXPECT_EQ(expectedCount, count);
+        std::vector<bool> seen(commands.size());
+        for (size_t i = 0; i < count; i++) {
+            // keys must be sorted and each command must have moved along with its key
+            uint32_t const index = sorted[i].primitive.index;
+            EXPECT_EQ(expected[i].key, sorted[i].key);
+            EXPECT_EQ(commands[index].key, sorted[i].key);
+            EXPECT_FALSE(seen[index]);
+            seen[index] = true;
+        }
+    };
+
+    for (size_t size : { 1, 1000, 2048, 50000, 200000 }) {
+        std::vector<Command> commands(size);
+
+        // all fields vary
+        for (auto& command : commands) {
+            command.key = makeKey(4096, 1024);
+        }
+        check(commands, 0.0f);
+        check(commands, 0.5f);
+        check(commands, 1.0f);
+
+        // few materials, no z-bucket: most digits are skipped
+        for (auto& command : commands) {
+            command.key = makeKey(3, 1);
+        }
+        check(commands, 0.3f);
+
+        // all keys are equal
+        std::fill(commands.begin(), commands.end(), commands.front());
+        check(commands, 0.3f);
+    }
+
+    js.emancipate();
+}
+
+TEST(FilamentTest, RenderPassInstanceify) {
+    using Command = RenderPass::Command;
+    using PrimitiveInfo = RenderPass::PrimitiveInfo;
+    using CustomCommand = RenderPass::CustomCommand;
+
+    // instanceifyCommands() only compares these pointers, they're never dereferenced
+    auto const* const mi0 = reinterpret_cast<FMaterialInstance const*>(uintptr_t(16));
+    auto const* const mi1 = reinterpret_cast<FMaterialInstance const*>(uintptr_t(32));
+
+    auto makeDraw = [](uint32_t index, FMaterialInstance const* mi, uint32_t primitive) {
+        Command command;
+        command.key = uint64_t(RenderPass::Pass::COLOR) | uint64_t(CustomCommand::PASS);
+        command.primitive.mi = mi;
+        command.primitive.primitiveHandle = backend::Handle<backend::HwRenderPrimitive>(primitive);
+        command.primitive.index = index;
+        command.primitive.instanceCount = 1u | PrimitiveInfo::USER_INSTANCE_MASK;
+        return command;
+    };
+
+    std::vector<Command> commands;
+
+    // identical draws, more than CONFIG_MAX_INSTANCES of them
+    for (uint32_t i = 0; i < CONFIG_MAX_INSTANCES + 2; i++) {
+        commands.push_back(makeDraw(i, mi0, 1));
+    }
+    size_t const identicalEnd = commands.size();
+
+    // custom commands are never instanced
+    for (uint32_t i = 0; i < 2; i++) {
+        Command command = makeDraw(100 + i, mi0, 1);
+        command.key = uint64_t(RenderPass::Pass::COLOR) | uint64_t(CustomCommand::EPILOG);
+        commands.push_back(command);
+    }
+
+    // primitives instanced by the user are never instanced
+    for (uint32_t i = 0; i < 2; i++) {
+        Command command = makeDraw(200 + i, mi0, 1);
+        command.primitive.instanceCount = 3u | PrimitiveInfo::USER_INSTANCE_MASK;
+        commands.push_back(command);
+    }
+
+    // different variants
+    commands.push_back(makeDraw(300, mi0, 2));
+    commands.push_back(makeDraw(301, mi0, 2));
+    commands.back().primitive.materialVariant.setSkinning(true);
+
+    // different material instances
+    commands.push_back(makeDraw(400, mi0, 3));
+    commands.push_back(makeDraw(401, mi1, 3));
+
+    std::vector<Command> const original(commands);
+    std::vector<uint32_t> instances(commands.size());
+    uint32_t const instanceCount = RenderPass::instanceifyCommands(
+            commands.data(), commands.data() + commands.size(), instances.data());
+
+    // the identical draws are merged into two instanced draws
+    EXPECT_EQ(CONFIG_MAX_INSTANCES + 2, instanceCount);
+    EXPECT_EQ(CONFIG_MAX_INSTANCES, commands[0].primitive.instanceCount);
+    EXPECT_EQ(0u, commands[0].primitive.index);
+    EXPECT_EQ(2u, commands[CONFIG_MAX_INSTANCES].primitive.instanceCount);
+    EXPECT_EQ(CONFIG_MAX_INSTANCES, commands[CONFIG_MAX_INSTANCES].primitive.index);
+    for (uint32_t i = 0; i < identicalEnd; i++) {
+        // each instance references the data of the draw it replaces
+        EXPECT_EQ(i, instances[i]);
+        if (i != 0 && i != CONFIG_MAX_INSTANCES) {
+            EXPECT_EQ(uint64_t(RenderPass::Pass::SENTINEL), commands[i].key);
+        }
+    }
+
+    // all the other commands are left untouched
+    for (size_t i = identicalEnd; i < commands.size(); i++) {
+        EXPECT_EQ(original[i].key, commands[i].key);
+        EXPECT_EQ(original[i].primitive.index, commands[i].primitive.index);
+        EXPECT_EQ(original[i].primitive.instanceCount, commands[i].primitive.instanceCount);
+    }
+
+    // nothing to instance
+    std::vector<Command> distinct(original.begin() + identicalEnd, original.end());
+    EXPECT_EQ(0u, RenderPass::instanceifyCommands(
+            distinct.data(), distinct.data() + distinct.size(), instances.data()));
+}
+
+TEST(FilamentTest, RenderPassCommandCache) {
+    using Command = RenderPass::Command;
+    FEngine* engine = downcast(Engine::create(Engine::Backend::NOOP));
+    Scene* publicScene = engine->createScene();
+    FScene* scene = downcast(publicScene);
+    LinearAllocatorArena& arena = engine->getPerRenderPassAllocator();
+    JobSystem& js = engine->getJobSystem();
+    FRenderableManager& rcm = engine->getRenderableManager();
+    FTransformManager& tcm = engine->getTransformManager();
+
+    FVertexBuffer* vb = downcast(VertexBuffer::Builder()
+            .vertexCount(3)
+            .bufferCount(1)
+            .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+            .build(*engine));
+    FIndexBuffer* ib = downcast(IndexBuffer::Builder()
+            .indexCount(3)
+            .bufferType(IndexBuffer::IndexType::USHORT)
+            .build(*engine));
+    FMaterialInstance* mi = engine->getDefaultMaterial()->createInstance("test");
+
+    // the first renderable has two primitives, so that its level of detail can change
+    std::vector<Entity> entities(4);
+    engine->getEntityManager().create(entities.size(), entities.data());
+    for (size_t i = 0; i < entities.size(); i++) {
+        RenderableManager::Builder builder(i ? 1 : 2);
+        for (size_t j = 0; j < (i ? 1 : 2); j++) {
+            builder.geometry(j, RenderableManager::PrimitiveType::TRIANGLES, vb, ib)
+                    .material(j, mi);
+        }
+        builder.boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+                .culling(false)
+                .build(*engine, entities[i]);
+        tcm.create(entities[i], {}, mat4f::translation(float3{ 0, 0, -5.0f - float(i) }));
+        publicScene->addEntity(entities[i]);
+    }
+
+    CameraInfo camera;
+    Variant variant;
+    RenderPass::RenderFlags renderFlags = 0;
+    RenderPass::CommandCache cache;
+    std::vector<Command> storage(256);
+
+    auto prepare = [&]() {
+        scene->prepare(js, arena, mat4{}, false);
+        FScene::RenderableSoa& soa = scene->getRenderableData();
+        std::fill_n(soa.data<FScene::VISIBLE_MASK>(), soa.size(), 1);
+    };
+
+    // generates the commands of a color pass, with or without the cache
+    auto generate = [&](RenderPass::CommandCache* commandCache) {
+        RenderPass::Arena commandArena("Test Command Arena",
+                { storage.data(), storage.data() + storage.size() });
+        FScene::RenderableSoa const& soa = scene->getRenderableData();
+        RenderPass pass(*engine, commandArena);
+        pass.setGeometry(soa, { 0, uint32_t(soa.size()) }, {});
+        pass.setCamera(camera);
+        pass.setRenderFlags(renderFlags);
+        pass.setVariant(variant);
+        pass.setCommandCache(commandCache);
+        pass.appendCommands(*engine, RenderPass::COLOR);
+        return std::vector<Command>(pass.begin(), pass.end());
+    };
+
+    // the cached commands must always be the same as the ones generated without the cache
+    auto check = [&](uint32_t expectedHits, uint32_t expectedMisses) {
+        std::vector<Command> const cached = generate(&cache);
+        EXPECT_EQ(expectedHits, cache.getStats().hits);
+        EXPECT_EQ(expectedMisses, cache.getStats().misses);
+        std::vector<Command> const expected = generate(nullptr);
+        ASSERT_EQ(expected.size(), cached.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            EXPECT_EQ(expected[i].key, cached[i].key);
+            if (expected[i].key != uint64_t(RenderPass::Pass::SENTINEL)) {
+                EXPECT_EQ(expected[i].primitive.mi, cached[i].primitive.mi);
+                EXPECT_EQ(expected[i].primitive.rasterState, cached[i].primitive.rasterState);
+                EXPECT_EQ(expected[i].primitive.primitiveHandle,
+                        cached[i].primitive.primitiveHandle);
+                EXPECT_EQ(expected[i].primitive.index, cached[i].primitive.index);
+                EXPECT_EQ(expected[i].primitive.materialVariant.key,
+                        cached[i].primitive.materialVariant.key);
+            }
+        }
+    };
+
+    // first frame, nothing is cached yet
+    prepare();
+    check(0, 4);
+
+    // nothing changed
+    prepare();
+    check(4, 0);
+
+    // the camera moves, the distance dependent fields are updated
+    camera.model = mat4f::translation(float3{ 1, 2, 3 });
+    camera.view = inverse(camera.model);
+    prepare();
+    check(4, 0);
+
+    // a material instance state baked into the commands changes, setting the same state again
+    // doesn't invalidate the cache.
+    mi->setCullingMode(MaterialInstance::CullingMode::FRONT);
+    prepare();
+    check(0, 4);
+    mi->setCullingMode(MaterialInstance::CullingMode::FRONT);
+    prepare();
+    check(4, 0);
+
+    // the variant or the flags change
+    variant.setFog(true);
+    prepare();
+    check(0, 4);
+    renderFlags = RenderPass::HAS_INVERSE_FRONT_FACES;
+    prepare();
+    check(0, 4);
+
+    // a renderable changes
+    rcm.setBlendOrderAt(rcm.getInstance(entities[1]), 0, 0, 1);
+    prepare();
+    check(3, 1);
+
+    // the visibility of a renderable changes, here the winding order (computed by the scene)
+    tcm.setTransform(tcm.getInstance(entities[2]), mat4f::scaling(float3{ -1, 1, 1 }));
+    prepare();
+    check(3, 1);
+
+    // the level of detail of a renderable changes
+    prepare();
+    FScene::RenderableSoa& soa = scene->getRenderableData();
+    auto const ri = rcm.getInstance(entities[0]);
+    for (size_t i = 0; i < soa.size(); i++) {
+        if (soa.elementAt<FScene::RENDERABLE_INSTANCE>(i) == ri) {
+            Slice<FRenderPrimitive> const& primitives = rcm.getRenderPrimitives(ri, 0);
+            soa.elementAt<FScene::PRIMITIVES>(i) = { primitives.data(), 1 };
+        }
+    }
+    check(3, 1);
+
+    for (Entity e : entities) {
+        engine->destroy(e);
+    }
+    engine->getEntityManager().destroy(entities.size(), entities.data());
+    engine->destroy(mi);
+    engine->destroy(vb);
+    engine->destroy(ib);
+    engine->destroy(scene);
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, ShadowMapCacheKeys) {
+    constexpr uint32_t NO_KEY = ShadowMapManager::NO_SHADOW_CASTER_KEY;
+    constexpr uint32_t VOLATILE_KEY = ShadowMapManager::VOLATILE_SHADOW_CASTER_KEY;
+    FEngine* engine = downcast(Engine::create(Engine::Backend::NOOP));
+    Scene* publicScene = engine->createScene();
+    FScene* scene = downcast(publicScene);
+    LinearAllocatorArena& arena = engine->getPerRenderPassAllocator();
+    JobSystem& js = engine->getJobSystem();
+    FRenderableManager& rcm = engine->getRenderableManager();
+    FTransformManager& tcm = engine->getTransformManager();
+
+    FVertexBuffer* vb = downcast(VertexBuffer::Builder()
+            .vertexCount(3)
+            .bufferCount(1)
+            .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+            .build(*engine));
+    FVertexBuffer* vb1 = downcast(VertexBuffer::Builder()
+            .vertexCount(3)
+            .bufferCount(1)
+            .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+            .build(*engine));
+    FIndexBuffer* ib = downcast(IndexBuffer::Builder()
+            .indexCount(3)
+            .bufferType(IndexBuffer::IndexType::USHORT)
+            .build(*engine));
+    FMaterialInstance* mi = engine->getDefaultMaterial()->createInstance("test");
+
+    // 0 and 1 are regular casters, 2 doesn't cast shadows, 3 is skinned, 4 isn't culled.
+    // 1 has a vertex buffer of its own.
+    std::vector<Entity> entities(5);
+    engine->getEntityManager().create(entities.size(), entities.data());
+    for (size_t i = 0; i < entities.size(); i++) {
+        RenderableManager::Builder builder(1);
+        builder.geometry(0, RenderableManager::PrimitiveType::TRIANGLES, i == 1 ? vb1 : vb, ib)
+                .material(0, mi)
+                .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+                .castShadows(i != 2)
+                .culling(i != 4);
+        if (i == 3) {
+            builder.skinning(1);
+        }
+        builder.build(*engine, entities[i]);
+        tcm.create(entities[i], {}, mat4f::translation(float3{ 0, 0, -5.0f - float(i) }));
+        publicScene->addEntity(entities[i]);
+    }
+
+    // returns the caster keys by entity
+    auto computeKeys = [&](uint8_t visibleLayers = 0x1) {
+        scene->prepare(js, arena, mat4{}, false);
+        FScene::RenderableSoa const& soa = scene->getRenderableData();
+        std::vector<uint32_t> casterKeys(soa.size());
+        ShadowMapManager::computeShadowCasterKeys(rcm, soa, visibleLayers, casterKeys.data());
+        std::vector<uint32_t> keys(entities.size());
+        for (size_t i = 0; i < soa.size(); i++) {
+            auto const ri = soa.elementAt<FScene::RENDERABLE_INSTANCE>(i);
+            for (size_t j = 0; j < entities.size(); j++) {
+                if (rcm.getInstance(entities[j]) == ri) {
+                    keys[j] = casterKeys[i];
+                }
+            }
+        }
+        return keys;
+    };
+
+    std::vector<uint32_t> const keys = computeKeys();
+    EXPECT_GT(keys[0], VOLATILE_KEY);
+    EXPECT_GT(keys[1], VOLATILE_KEY);
+    EXPECT_NE(keys[0], keys[1]);
+    EXPECT_EQ(NO_KEY, keys[2]);
+    EXPECT_EQ(VOLATILE_KEY, keys[3]);
+    EXPECT_GT(keys[4], VOLATILE_KEY);
+
+    // the keys are stable as long as nothing changes
+    EXPECT_EQ(keys, computeKeys());
+
+    // a caster moves, only its key changes
+    tcm.setTransform(tcm.getInstance(entities[1]), mat4f::translation(float3{ 1, 0, -6 }));
+    std::vector<uint32_t> const movedKeys = computeKeys();
+    EXPECT_EQ(keys[0], movedKeys[0]);
+    EXPECT_NE(keys[1], movedKeys[1]);
+    EXPECT_GT(movedKeys[1], VOLATILE_KEY);
+    EXPECT_EQ(keys[4], movedKeys[4]);
+
+    // a caster is modified, or stops casting shadows
+    rcm.setBlendOrderAt(rcm.getInstance(entities[0]), 0, 0, 1);
+    EXPECT_NE(movedKeys[0], computeKeys()[0]);
+    rcm.setCastShadows(rcm.getInstance(entities[0]), false);
+    EXPECT_EQ(NO_KEY, computeKeys()[0]);
+    rcm.setCastShadows(rcm.getInstance(entities[0]), true);
+
+    // renderables not in the View's visible layers don't cast shadows
+    EXPECT_EQ(std::vector<uint32_t>(entities.size(), NO_KEY), computeKeys(0x2));
+
+    // updating a buffer only changes the keys of the casters that use it
+    std::vector<uint32_t> const currentKeys = computeKeys();
+    float3 const positions[3] = {};
+    vb->setBufferAt(*engine, 0, { positions, sizeof(positions) });
+    std::vector<uint32_t> casterKeys = computeKeys();
+    EXPECT_NE(currentKeys[0], casterKeys[0]);
+    EXPECT_EQ(currentKeys[1], casterKeys[1]);
+    EXPECT_NE(currentKeys[4], casterKeys[4]);
+    uint16_t const indices[3] = {};
+    ib->setBuffer(*engine, { indices, sizeof(indices) });
+    EXPECT_NE(casterKeys[1], computeKeys()[1]);
+
+    // directional shadow maps, keys are ordered by entity here
+    casterKeys = computeKeys();
+    std::vector<FRenderableManager::Visibility> visibility(entities.size());
+    for (size_t i = 0; i < entities.size(); i++) {
+        visibility[i] = rcm.getVisibility(rcm.getInstance(entities[i]));
+    }
+    Culler::result_type const bit = VISIBLE_DIR_SHADOW_RENDERABLE;
+    std::vector<Culler::result_type> visibleMask = { bit, bit, bit, 0, 0 };
+    auto hashDirectional = [&](uint32_t seed) {
+        return ShadowMapManager::hashDirectionalShadowCasters(seed, casterKeys.data(),
+                visibility.data(), visibleMask.data(), bit, entities.size());
+    };
+    uint32_t const dirKey = hashDirectional(0);
+    EXPECT_NE(0u, dirKey);
+    EXPECT_EQ(dirKey, hashDirectional(0));
+    EXPECT_NE(dirKey, hashDirectional(1));
+
+    // a caster outside of the shadow map doesn't matter, unless it's not subject to culling
+    casterKeys[3] = casterKeys[1];
+    EXPECT_EQ(dirKey, hashDirectional(0));
+    casterKeys[4]++;
+    EXPECT_NE(dirKey, hashDirectional(0));
+    casterKeys[4]--;
+
+    // a caster inside the shadow map changes
+    casterKeys[1]++;
+    EXPECT_NE(dirKey, hashDirectional(0));
+    casterKeys[1]--;
+    EXPECT_EQ(dirKey, hashDirectional(0));
+
+    // a volatile caster inside the shadow map forces it to be rendered
+    casterKeys[3] = VOLATILE_KEY;
+    visibleMask[3] = bit;
+    EXPECT_EQ(0u, hashDirectional(0));
+
+    // spot shadow maps, all hashed at once
+    casterKeys = computeKeys();
+    std::vector<uint64_t> spotShadowMask = { 0x1, 0x3, 0x7, 0x4, 0x0 };
+    auto hashSpot = [&](uint32_t seed) {
+        std::array<uint32_t, 4> spotKeys{};
+        ShadowMapManager::hashSpotShadowCasters(seed, casterKeys.data(), visibility.data(),
+                spotShadowMask.data(), entities.size(), spotKeys.data(), 3);
+        return spotKeys;
+    };
+    std::array<uint32_t, 4> const spotKeys = hashSpot(0);
+    EXPECT_NE(0u, spotKeys[0]);
+    EXPECT_NE(0u, spotKeys[1]);
+    EXPECT_EQ(0u, spotKeys[2]);     // the skinned renderable is in the third shadow map
+    EXPECT_EQ(0u, spotKeys[3]);     // not written
+    EXPECT_EQ(spotKeys, hashSpot(0));
+
+    casterKeys[1]++;
+    std::array<uint32_t, 4> const movedSpotKeys = hashSpot(0);
+    EXPECT_NE(spotKeys[0], movedSpotKeys[0]);
+    EXPECT_NE(spotKeys[1], movedSpotKeys[1]);
+    casterKeys[1]--;
+    casterKeys[0]++;
+    EXPECT_NE(spotKeys[0], hashSpot(0)[0]);
+    EXPECT_EQ(spotKeys[1], hashSpot(0)[1]);
+    casterKeys[0]--;
+    spotShadowMask[3] = 0x0;
+    EXPECT_NE(0u, hashSpot(0)[2]);
+
+    // the distant cascades are updated in turn
+    EXPECT_EQ(1u, ShadowMapManager::getDistantCascadeToUpdate(0, 2, 4));
+    EXPECT_EQ(2u, ShadowMapManager::getDistantCascadeToUpdate(2, 2, 4));
+    EXPECT_EQ(3u, ShadowMapManager::getDistantCascadeToUpdate(4, 2, 4));
+    EXPECT_EQ(1u, ShadowMapManager::getDistantCascadeToUpdate(6, 2, 4));
+    EXPECT_EQ(0u, ShadowMapManager::getDistantCascadeToUpdate(7, 2, 4));
+    EXPECT_EQ(0u, ShadowMapManager::getDistantCascadeToUpdate(6, 0, 4));
+    EXPECT_EQ(0u, ShadowMapManager::getDistantCascadeToUpdate(6, 2, 1));
+
+    for (Entity e : entities) {
+        engine->destroy(e);
+    }
+    engine->getEntityManager().destroy(entities.size(), entities.data());
+    engine->destroy(mi);
+    engine->destroy(vb);
+    engine->destroy(vb1);
+    engine->destroy(ib);
+    engine->destroy(scene);
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, ResourceAllocatorCache) {
+    using namespace backend;
+    constexpr TextureUsage ATTACHMENT = TextureUsage::COLOR_ATTACHMENT;
+    constexpr TextureUsage SAMPLEABLE = TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE;
+    constexpr std::array<TextureSwizzle, 4> swizzle = {
+            TextureSwizzle::CHANNEL_0, TextureSwizzle::CHANNEL_1,
+            TextureSwizzle::CHANNEL_2, TextureSwizzle::CHANNEL_3 };
+    FEngine* engine = downcast(Engine::create(Engine::Backend::NOOP));
+
+    // only single-sampled 2D textures used only as attachments can be rounded up
+    EXPECT_TRUE(ResourceAllocator::canUseLargerTexture(SamplerType::SAMPLER_2D, 1, 1, ATTACHMENT));
+    EXPECT_TRUE(ResourceAllocator::canUseLargerTexture(SamplerType::SAMPLER_2D, 1, 1,
+            TextureUsage::DEPTH_ATTACHMENT | TextureUsage::STENCIL_ATTACHMENT));
+    EXPECT_FALSE(ResourceAllocator::canUseLargerTexture(SamplerType::SAMPLER_2D, 1, 1, SAMPLEABLE));
+    EXPECT_FALSE(ResourceAllocator::canUseLargerTexture(SamplerType::SAMPLER_2D, 1, 1,
+            ATTACHMENT | TextureUsage::UPLOADABLE));
+    EXPECT_FALSE(ResourceAllocator::canUseLargerTexture(SamplerType::SAMPLER_2D, 1, 4, ATTACHMENT));
+    EXPECT_FALSE(ResourceAllocator::canUseLargerTexture(SamplerType::SAMPLER_2D, 2, 1, ATTACHMENT));
+    EXPECT_FALSE(ResourceAllocator::canUseLargerTexture(
+            SamplerType::SAMPLER_2D_ARRAY, 1, 1, ATTACHMENT));
+
+    Engine::Config config;
+    config.resourceAllocatorCacheSizeMB = 1;
+    config.resourceAllocatorCacheMaxAge = 2;
+    config.resourceAllocatorDimensionBucket = 64;
+    ResourceAllocator allocator(config, engine->getDriverApi());
+
+    auto create = [&](uint32_t width, uint32_t height, uint8_t samples, TextureUsage usage) {
+        return allocator.createTexture("test", SamplerType::SAMPLER_2D, 1,
+                TextureFormat::RGBA8, samples, width, height, 1, swizzle, usage);
+    };
+
+    // an attachment is rounded up to the bucket size, and reused for a slightly different size
+    allocator.destroyTexture(create(100, 100, 1, ATTACHMENT));
+    EXPECT_EQ(128u * 128u * 4u, allocator.getStatistics().cacheSize);
+    allocator.destroyTexture(create(120, 90, 1, ATTACHMENT));
+    EXPECT_EQ(1u, allocator.getStatistics().hitCount);
+    EXPECT_EQ(1u, allocator.getStatistics().missCount);
+
+    // sampleable and multisampled textures keep their exact size
+    allocator.destroyTexture(create(100, 100, 1, SAMPLEABLE));
+    allocator.destroyTexture(create(120, 90, 1, SAMPLEABLE));
+    allocator.destroyTexture(create(100, 100, 4, ATTACHMENT));
+    allocator.destroyTexture(create(120, 90, 4, ATTACHMENT));
+    ResourceAllocator::Statistics stats = allocator.getStatistics();
+    EXPECT_EQ(1u, stats.hitCount);
+    EXPECT_EQ(5u, stats.missCount);
+    EXPECT_EQ(0u, stats.evictionCount);
+    EXPECT_EQ(5u, stats.cacheEntryCount);
+    EXPECT_EQ((128u * 128u + (100u * 100u + 120u * 90u) * 5u) * 4u, stats.cacheSize);
+
+    // unused textures are evicted one per gc() once they reach the maximum age
+    allocator.gc();
+    allocator.gc();
+    EXPECT_EQ(0u, allocator.getStatistics().evictionCount);
+    allocator.gc();
+    EXPECT_EQ(1u, allocator.getStatistics().evictionCount);
+    EXPECT_EQ(4u, allocator.getStatistics().cacheEntryCount);
+    allocator.gc();
+    allocator.gc();
+    allocator.gc();
+    allocator.gc();
+    EXPECT_EQ(5u, allocator.getStatistics().evictionCount);
+    EXPECT_EQ(0u, allocator.getStatistics().cacheEntryCount);
+    EXPECT_EQ(0u, allocator.getStatistics().cacheSize);
+
+    allocator.terminate();
+
+    // the least recently used textures are evicted when the cache is over capacity
+    config.resourceAllocatorCacheMaxAge = 100;
+    ResourceAllocator lruAllocator(config, engine->getDriverApi());
+    std::array<TextureHandle, 5> handles;
+    for (size_t i = 0; i < handles.size(); i++) {
+        handles[i] = lruAllocator.createTexture("test", SamplerType::SAMPLER_2D, 1,
+                TextureFormat::RGBA8, 1, 256, 256 + 64 * i, 1, swizzle, SAMPLEABLE);
+    }
+    constexpr size_t KiB = 1024u;
+    for (size_t i = 0; i < handles.size(); i++) {
+        // from 256 KiB to 512 KiB
+        lruAllocator.destroyTexture(handles[i]);
+        lruAllocator.gc();
+    }
+    stats = lruAllocator.getStatistics();
+    EXPECT_EQ(3u, stats.evictionCount);
+    EXPECT_EQ(2u, stats.cacheEntryCount);
+    EXPECT_EQ((448u + 512u) * KiB, stats.cacheSize);
+    lruAllocator.terminate();
+
+    // a cache size of 0 disables the cache
+    config.resourceAllocatorCacheSizeMB = 0;
+    ResourceAllocator uncachedAllocator(config, engine->getDriverApi());
+    for (size_t i = 0; i < 2; i++) {
+        uncachedAllocator.gc();
+        uncachedAllocator.destroyTexture(uncachedAllocator.createTexture("test",
+                SamplerType::SAMPLER_2D, 1, TextureFormat::RGBA8, 1, 100, 100, 1, swizzle,
+                SAMPLEABLE));
+    }
+    uncachedAllocator.gc();
+    stats = uncachedAllocator.getStatistics();
+    EXPECT_EQ(0u, stats.hitCount);
+    EXPECT_EQ(2u, stats.missCount);
+    EXPECT_EQ(0u, stats.cacheEntryCount);
+    EXPECT_EQ(0u, stats.cacheSize);
+    uncachedAllocator.terminate();
+
+    // the Engine's own allocator
+    EXPECT_EQ(engine->getResourceAllocator().getStatistics().missCount,
+            engine->getResourceAllocatorStatistics().missCount);
+
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, VariantProfile) {
+    // an in-memory blob cache that persists across "sessions"
+    std::map<std::string, std::vector<uint8_t>> blobs;
+    auto createEngine = [&blobs](uint32_t budget) {
+        Engine::Config config;
+        config.variantPrecompilationBudget = budget;
+        FEngine* engine = downcast(Engine::Builder()
+                .backend(Engine::Backend::NOOP)
+                .config(&config)
+                .build());
+        engine->getPlatform()->setBlobFunc(
+                [&blobs](const void* key, size_t keySize, const void* value, size_t valueSize) {
+                    auto const* const v = static_cast<uint8_t const*>(value);
+                    blobs[std::string(static_cast<const char*>(key), keySize)].assign(
+                            v, v + valueSize);
+                },
+                [&blobs](const void* key, size_t keySize, void* value, size_t valueSize) {
+                    auto pos = blobs.find(std::string(static_cast<const char*>(key), keySize));
+                    if (pos == blobs.end()) {
+                        return size_t(0);
+                    }
+                    if (value) {
+                        std::copy_n(pos->second.data(), std::min(valueSize, pos->second.size()),
+                                static_cast<uint8_t*>(value));
+                    }
+                    return pos->second.size();
+                });
+        return engine;
+    };
+    auto createMaterial = [](FEngine* engine) {
+        return downcast(Material::Builder()
+                .package(MATERIALS_DEFAULTMATERIAL_DATA, MATERIALS_DEFAULTMATERIAL_SIZE)
+                .build(*engine));
+    };
+    auto countCachedVariants = [](FMaterial const* material) {
+        size_t count = 0;
+        for (size_t i = 0; i < VARIANT_COUNT; i++) {
+            count += material->isCached(Variant{ Variant::type_t(i) }) ? 1 : 0;
+        }
+        return count;
+    };
+
+    // session 1: the variants used for drawing are recorded, not the ones from compile()
+    FEngine* engine = createEngine(2);
+    FMaterial* material = createMaterial(engine);
+    EXPECT_FALSE(material->hasProfiledVariantsToPrecompile());
+    std::vector<Variant> used;
+    auto const& variants = material->isVariantLit() ?
+            VariantUtils::getLitVariants() : VariantUtils::getUnlitVariants();
+    for (Variant const variant : variants) {
+        if (used.size() < 3 && !Variant::isValidDepthVariant(variant)) {
+            used.push_back(variant);
+        }
+    }
+    ASSERT_EQ(3u, used.size());
+    for (auto it = used.rbegin(); it != used.rend(); ++it) {
+        material->prepareProgram(*it);
+    }
+    size_t const compiledVariantCount = countCachedVariants(material);
+    material->compile(nullptr, [](Material*) {}, 0);
+    EXPECT_LT(compiledVariantCount, countCachedVariants(material));
+    engine->destroy(material);
+    Engine::destroy((Engine**)&engine);
+    ASSERT_EQ(1u, blobs.size());
+    EXPECT_EQ(3u, blobs.begin()->second.size());
+
+    // session 2: the profiled variants are compiled, at most 2 per frame, in the order of
+    // their first use, and the ones that are already compiled are skipped
+    engine = createEngine(2);
+    material = createMaterial(engine);
+    size_t const initialCount = countCachedVariants(material);
+    EXPECT_TRUE(material->hasProfiledVariantsToPrecompile());
+    material->prepareProgram(used[1]);
+    engine->prepare();
+    EXPECT_TRUE(material->isCached(used[2]));
+    EXPECT_TRUE(material->isCached(used[0]));
+    EXPECT_FALSE(material->hasProfiledVariantsToPrecompile());
+    EXPECT_EQ(initialCount + 3, countCachedVariants(material));
+    engine->destroy(material);
+    Engine::destroy((Engine**)&engine);
+
+    // with a budget of 1, a single variant is compiled per frame
+    engine = createEngine(1);
+    material = createMaterial(engine);
+    engine->prepare();
+    EXPECT_TRUE(material->isCached(used[2]));
+    EXPECT_FALSE(material->isCached(used[1]));
+    engine->prepare();
+    EXPECT_TRUE(material->isCached(used[1]));
+    EXPECT_FALSE(material->isCached(used[0]));
+    engine->prepare();
+    EXPECT_TRUE(material->isCached(used[0]));
+    EXPECT_FALSE(material->hasProfiledVariantsToPrecompile());
+    engine->destroy(material);
+    Engine::destroy((Engine**)&engine);
+
+    // invalid profiles are ignored entirely
+    std::vector<uint8_t> const profile = blobs.begin()->second;
+    for (uint8_t const invalid : { uint8_t(VARIANT_COUNT), uint8_t(0xFF),
+            uint8_t(Variant::DEP | Variant::SRE), profile[0] }) {
+        blobs.begin()->second = profile;
+        blobs.begin()->second.push_back(invalid);
+        engine = createEngine(2);
+        material = createMaterial(engine);
+        EXPECT_FALSE(material->hasProfiledVariantsToPrecompile());
+        engine->destroy(material);
+        Engine::destroy((Engine**)&engine);
+    }
+}
+
+TEST(FilamentTest, CommandStreamForkJoin) {
+    FEngine* engine = downcast(Engine::create(Engine::Backend::NOOP));
+    backend::DriverApi& driver = engine->getDriverApi();
+    JobSystem& js = engine->getJobSystem();
+
+    // commands are executed in order by the driver thread
+    std::vector<uint32_t> executed;
+    auto record = [&executed](backend::DriverApi& stream, uint32_t value) {
+        stream.queueCommand([&executed, value]() { executed.push_back(value); });
+    };
+
+    // enough commands per sub-stream to need several chunks
+    constexpr uint32_t SUB_STREAM_COUNT = 4;
+    constexpr uint32_t COMMAND_COUNT = 1000;
+
+    record(driver, 0);
+
+    driver.fork();
+    auto subStreams = FixedCapacityVector<backend::DriverApi>::with_capacity(SUB_STREAM_COUNT);
+    backend::DriverApi* subStreamPointers[SUB_STREAM_COUNT];
+    for (auto& subStream : subStreamPointers) {
+        subStream = &subStreams.emplace_back(&driver);
+    }
+    JobSystem::Job* parent = js.createJob();
+    for (uint32_t i = 0; i < SUB_STREAM_COUNT; i++) {
+        if (i == 2) {
+            continue; // sub-stream 2 stays empty
+        }
+        js.run(jobs::createJob(js, parent, [&, i]() {
+            for (uint32_t j = 0; j < COMMAND_COUNT; j++) {
+                record(*subStreamPointers[i], 1 + i * COMMAND_COUNT + j);
+            }
+        }));
+    }
+    js.runAndWait(parent);
+    driver.join(subStreamPointers, SUB_STREAM_COUNT);
+
+    record(driver, std::numeric_limits<uint32_t>::max());
+    engine->flushAndWait();
+
+    std::vector<uint32_t> expected{ 0 };
+    for (uint32_t i = 0; i < SUB_STREAM_COUNT; i++) {
+        for (uint32_t j = 0; j < COMMAND_COUNT && i != 2; j++) {
+            expected.push_back(1 + i * COMMAND_COUNT + j);
+        }
+    }
+    expected.push_back(std::numeric_limits<uint32_t>::max());
+    EXPECT_EQ(executed, expected);
+
+    Engine::destroy((Engine**)&engine);
+}
+
+TEST(FilamentTest, CommandCaptureReplay) {
+    using namespace filament::backend;
+    FEngine* engine = downcast(Engine::create(Engine::Backend::NOOP));
+    DriverApi& driver = engine->getDriverApi();
+    const char* const path = "filament_test_capture.fcmd";
+
+    using Capture = std::vector<std::aligned_storage_t<16, 16>>;
+    auto load = [path](Capture& capture) {
+        FILE* file = fopen(path, "rb");
+        if (!file) {
+            return size_t(0);
+        }
+        fseek(file, 0, SEEK_END);
+        size_t const size = size_t(ftell(file));
+        fseek(file, 0, SEEK_SET);
+        capture.resize((size + 15) / 16);
+        size_t const read = fread(capture.data(), 1, size, file);
+        fclose(file);
+        remove(path);
+        return read;
+    };
+
+    static uint8_t const data[64] = { 1, 2, 3, 4 };
+    ASSERT_TRUE(engine->startCommandCapture(path));
+    EXPECT_TRUE(driver.isCapturingCommands());
+    BufferObjectHandle const bo = driver.createBufferObject(sizeof(data),
+            BufferObjectBinding::UNIFORM, BufferUsage::DYNAMIC);
+    driver.updateBufferObject(bo, { data, sizeof(data) }, 0);
+    driver.pushGroupMarker("capture");
+    driver.popGroupMarker();
+    driver.destroyBufferObject(bo);
+    engine->stopCommandCapture();
+    EXPECT_FALSE(driver.isCapturingCommands());
+    engine->flushAndWait();
+
+    Capture capture;
+    size_t const size = load(capture);
+    ASSERT_NE(size, 0u);
+
+    // the replay is itself captured, which lets us check the replayed arguments
+    CommandCaptureReader reader(capture.data(), size);
+    ASSERT_TRUE(reader.isValid());
+    ASSERT_TRUE(engine->startCommandCapture(path));
+    std::vector<CommandId> replayed;
+    for (CommandId id; (id = reader.replayNext(driver)) != CommandId::COUNT;) {
+        replayed.push_back(id);
+    }
+    EXPECT_FALSE(reader.isCorrupted());
+    engine->stopCommandCapture();
+    engine->flushAndWait();
+
+    std::vector<CommandId> const expected = {
+            CommandId::createBufferObject, CommandId::updateBufferObject,
+            CommandId::pushGroupMarker, CommandId::popGroupMarker,
+            CommandId::destroyBufferObject };
+    EXPECT_EQ(replayed, expected);
+
+    // The second capture must be identical to the first one (e.g. same payload and marker),
+    // except that the buffer object handle is the one created by the replay, which must have
+    // been used by all the commands that referenced the original handle.
+    Capture recapture;
+    ASSERT_EQ(load(recapture), size);
+    auto const* const original = reinterpret_cast<uint8_t const*>(capture.data());
+    auto* const replay = reinterpret_cast<uint8_t*>(recapture.data());
+    HandleBase::HandleId const originalId = bo.getId();
+    HandleBase::HandleId replayId;
+    // the handle returned by createBufferObject() follows the header and the command id
+    memcpy(&replayId, replay + 16 + sizeof(uint32_t), sizeof(replayId));
+    EXPECT_NE(originalId, replayId);
+    size_t remapped = 0;
+    for (size_t i = 0; i + sizeof(replayId) <= size; i++) {
+        if (!memcmp(original + i, &originalId, sizeof(originalId)) &&
+                !memcmp(replay + i, &replayId, sizeof(replayId))) {
+            memcpy(replay + i, &originalId, sizeof(originalId));
+            remapped++;
+        }
+    }
+    EXPECT_EQ(remapped, 3u); // create, update and destroy
+    EXPECT_EQ(memcmp(original, replay, size), 0);
+
+    // A truncated capture stops the replay before the truncated command
+    CommandCaptureReader truncated(capture.data(), size - 2);
+    ASSERT_TRUE(truncated.isValid());
+    replayed.clear();
+    for (CommandId id; (id = truncated.replayNext(driver)) != CommandId::COUNT;) {
+        replayed.push_back(id);
+    }
+    EXPECT_TRUE(truncated.isCorrupted());
+    EXPECT_EQ(replayed, std::vector<CommandId>(expected.begin(), expected.end() - 1));
+    engine->flushAndWait();
+
+    Engine::destroy((Engine**)&engine);
+}
+
+TEST(FilamentTest, TraceRecording) {
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    const char* const path = "filament_test_trace.json";
+
+    engine->startTracing();
+    engine->flushAndWait();
+    engine->stopTracing();
+
+#if SYSTRACE_HAS_RECORDER
+    auto read = [path]() {
+        std::string trace;
+        FILE* file = fopen(path, "rb");
+        if (file) {
+            char buffer[4096];
+            for (size_t size; (size = fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+                trace.append(buffer, size);
+            }
+            fclose(file);
+            remove(path);
+        }
+        return trace;
+    };
+
+    ASSERT_TRUE(engine->writeTrace(path));
+    std::string const trace = read();
+    EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(trace.find("\"thread_name\""), std::string::npos);
+
+    // recording is stopped, so the events were released when they were written (sections
+    // that were open when recording stopped can still be closed afterwards)
+    ASSERT_TRUE(engine->writeTrace(path));
+    EXPECT_LT(read().size(), trace.size());
+#else
+    EXPECT_FALSE(engine->writeTrace(path));
+#endif
+
+    Engine::destroy(&engine);
+}
+
 TEST(FilamentTest, GoogleLineDirective) {
     {
         char s[512] = "#line 10 \"foobar\"";
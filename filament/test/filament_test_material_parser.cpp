@@ -14,16 +14,26 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <vector>
+
+#include <string.h>
 
 #include <gtest/gtest.h>
 
 #include "MaterialParser.h"
 
+#include <filaflat/ChunkContainer.h>
+#include <filaflat/DictionaryReader.h>
+#include <filaflat/MaterialChunk.h>
+
 #include "filament_test_resources.h"
 
 using namespace filament;
+using namespace filaflat;
+using filamat::ChunkType;
 
 // This test checks that a material compiled with an older version of matc can still be parsed.
 // If this test is failing, it probably means that MATERIAL_VERSION needs to be incremented.
@@ -41,6 +51,163 @@ TEST(MaterialParser, Parse) {
             "See instructions in filament_test_material_parser.cpp" << std::endl;
 }
 
+struct SpirvShader {
+    MaterialChunk::ShaderModel model;
+    Variant variant;
+    MaterialChunk::ShaderStage stage;
+    uint32_t index;     // in the dictionary
+};
+
+static std::vector<SpirvShader> getSpirvShaders(MaterialChunk const& chunk) {
+    std::vector<SpirvShader> shaders;
+    chunk.visitShaders([&](auto model, Variant variant, auto stage) {
+        uint32_t const key = (uint32_t(model) << 16) | (uint32_t(stage) << 8) | variant.key;
+        shaders.push_back({ model, variant, stage, chunk.getOffsets().at(key) });
+    });
+    return shaders;
+}
+
+TEST(MaterialParser, SpirvDecodedOnDemand) {
+    ChunkContainer container(
+            FILAMENT_TEST_RESOURCES_TEST_MATERIAL_DATA, FILAMENT_TEST_RESOURCES_TEST_MATERIAL_SIZE);
+    ASSERT_TRUE(container.parse());
+    BlobDictionary dictionary;
+    ASSERT_TRUE(DictionaryReader::unflatten(container, ChunkType::DictionarySpirv, dictionary));
+    ASSERT_GT(dictionary.size(), 0u);
+
+    ShaderContent spirv;
+    if (!DictionaryReader::decodeSpirv(dictionary[0], spirv)) {
+        GTEST_SKIP() << "SPIR-V is not supported";
+    }
+
+    // the dictionary holds the compressed blobs
+    constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+    for (ShaderContent const& blob : dictionary) {
+        ASSERT_TRUE(DictionaryReader::decodeSpirv(blob, spirv));
+        ASSERT_GE(spirv.size(), sizeof(uint32_t));
+        EXPECT_EQ(SPIRV_MAGIC, *reinterpret_cast<uint32_t const*>(spirv.data()));
+        EXPECT_TRUE(blob.size() < sizeof(uint32_t) ||
+                *reinterpret_cast<uint32_t const*>(blob.data()) != SPIRV_MAGIC);
+    }
+
+    // and the shaders are decoded when they're requested
+    MaterialChunk chunk(container);
+    ASSERT_TRUE(chunk.initialize(ChunkType::MaterialSpirv));
+    std::vector<SpirvShader> const shaders = getSpirvShaders(chunk);
+    ASSERT_EQ(chunk.getShaderCount(), shaders.size());
+    for (SpirvShader const& shader : shaders) {
+        ShaderContent expected;
+        ASSERT_TRUE(DictionaryReader::decodeSpirv(dictionary[shader.index], expected));
+        ASSERT_TRUE(chunk.getShader(spirv, dictionary, shader.model, shader.variant, shader.stage));
+        ASSERT_EQ(expected.size(), spirv.size());
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), spirv.begin()));
+    }
+}
+
+TEST(MaterialParser, SpirvCache) {
+    ChunkContainer container(
+            FILAMENT_TEST_RESOURCES_TEST_MATERIAL_DATA, FILAMENT_TEST_RESOURCES_TEST_MATERIAL_SIZE);
+    ASSERT_TRUE(container.parse());
+    BlobDictionary dictionary;
+    ASSERT_TRUE(DictionaryReader::unflatten(container, ChunkType::DictionarySpirv, dictionary));
+    ASSERT_GT(dictionary.size(), 0u);
+
+    ShaderContent spirv;
+    if (!DictionaryReader::decodeSpirv(dictionary[0], spirv)) {
+        GTEST_SKIP() << "SPIR-V is not supported";
+    }
+
+    // Blobs can't be decoded from this dictionary, so a shader can be retrieved with it only
+    // if its blob is cached.
+    BlobDictionary empty = BlobDictionary::with_capacity(dictionary.size());
+    for (size_t i = 0; i < dictionary.size(); i++) {
+        empty.emplace_back();
+    }
+
+    MaterialChunk chunk(container);
+    ASSERT_TRUE(chunk.initialize(ChunkType::MaterialSpirv));
+
+    // three shaders using different blobs
+    std::vector<SpirvShader> shaders;
+    for (SpirvShader const& shader : getSpirvShaders(chunk)) {
+        if (std::none_of(shaders.begin(), shaders.end(),
+                [&](auto const& s) { return s.index == shader.index; })) {
+            shaders.push_back(shader);
+        }
+    }
+    ASSERT_GE(shaders.size(), 3u);
+    auto get = [&](SpirvShader const& shader, BlobDictionary const& dictionary) {
+        return chunk.getShader(spirv, dictionary, shader.model, shader.variant, shader.stage);
+    };
+
+    // nothing is cached by default
+    EXPECT_TRUE(get(shaders[0], dictionary));
+    EXPECT_FALSE(get(shaders[0], empty));
+
+    // the least recently used blob is evicted
+    chunk.setSpirvCacheCapacity(2);
+    EXPECT_TRUE(get(shaders[0], dictionary));
+    EXPECT_TRUE(get(shaders[1], dictionary));
+    EXPECT_TRUE(get(shaders[0], empty));
+    EXPECT_TRUE(get(shaders[1], empty));
+    EXPECT_TRUE(get(shaders[2], dictionary));
+    EXPECT_FALSE(get(shaders[0], empty));
+    EXPECT_TRUE(get(shaders[1], empty));
+    EXPECT_TRUE(get(shaders[2], empty));
+
+    // a cached blob is the decoded one
+    ShaderContent expected;
+    ASSERT_TRUE(DictionaryReader::decodeSpirv(dictionary[shaders[2].index], expected));
+    ASSERT_EQ(expected.size(), spirv.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), spirv.begin()));
+}
+
+TEST(MaterialParser, InPlacePackage) {
+    // packages used in place must be 8-bytes aligned
+    size_t const size = FILAMENT_TEST_RESOURCES_TEST_MATERIAL_SIZE;
+    std::vector<uint64_t> storage((size + 7) / 8);
+    memcpy(storage.data(), FILAMENT_TEST_RESOURCES_TEST_MATERIAL_DATA, size);
+
+    MaterialParser copied(backend::Backend::OPENGL, storage.data(), size);
+    MaterialParser inPlace(backend::Backend::OPENGL, storage.data(), size, false);
+    ASSERT_TRUE(copied.parse() == MaterialParser::ParseResult::SUCCESS);
+    ASSERT_TRUE(inPlace.parse() == MaterialParser::ParseResult::SUCCESS);
+
+    // both parsers see the same material
+    utils::CString copiedName, inPlaceName;
+    EXPECT_TRUE(copied.getName(&copiedName));
+    EXPECT_TRUE(inPlace.getName(&inPlaceName));
+    EXPECT_EQ(copiedName, inPlaceName);
+
+    uint64_t cacheId = 0, inPlaceCacheId = 0;
+    EXPECT_TRUE(copied.getCacheId(&cacheId));
+    EXPECT_TRUE(inPlace.getCacheId(&inPlaceCacheId));
+    EXPECT_EQ(cacheId, inPlaceCacheId);
+
+    size_t shaderCount = 0;
+    inPlace.getMaterialChunk().visitShaders([&](auto model, Variant variant, auto stage) {
+        ShaderContent expected, shader;
+        EXPECT_TRUE(copied.getShader(expected, model, variant, stage));
+        EXPECT_TRUE(inPlace.getShader(shader, model, variant, stage));
+        ASSERT_EQ(expected.size(), shader.size());
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), shader.begin()));
+        shaderCount++;
+    });
+    EXPECT_GT(shaderCount, 0u);
+
+    // only the in-place parser references the package memory
+    ChunkContainer container(storage.data(), size);
+    ASSERT_TRUE(container.parse());
+    auto [start, end] = container.getChunkRange(ChunkType::MaterialCacheId);
+    ASSERT_EQ(sizeof(uint64_t), size_t(end - start));
+    uint64_t const newCacheId = ~cacheId;
+    memcpy(const_cast<uint8_t*>(start), &newCacheId, sizeof(newCacheId));
+    EXPECT_TRUE(copied.getCacheId(&cacheId));
+    EXPECT_TRUE(inPlace.getCacheId(&inPlaceCacheId));
+    EXPECT_NE(newCacheId, cacheId);
+    EXPECT_EQ(newCacheId, inPlaceCacheId);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -22,9 +22,14 @@
 namespace filaflat {
 
 struct DictionaryReader {
+    // Note that the blobs of a DictionarySpirv chunk are left SMOL-V compressed, use
+    // decodeSpirv() to retrieve the SPIR-V.
     static bool unflatten(ChunkContainer const& container,
             ChunkContainer::Type dictionaryTag,
             BlobDictionary& dictionary);
+
+    // Decodes a blob read from a DictionarySpirv chunk into "spirv".
+    static bool decodeSpirv(ShaderContent const& compressed, ShaderContent& spirv);
 };
 
 } // namespace filaflat
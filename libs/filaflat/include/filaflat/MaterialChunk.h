@@ -52,6 +52,11 @@ public:
 
     uint32_t getShaderCount() const noexcept;
 
+    // SPIR-V blobs are decoded on demand by getShader(). This keeps up to "count" decoded blobs
+    // around, so that blobs shared by several variants are decoded only once. The same
+    // dictionary must then always be passed to getShader(). Disabled (0) by default.
+    void setSpirvCacheCapacity(size_t count);
+
     void visitShaders(utils::Invocable<void(ShaderModel, Variant, ShaderStage)>&& visitor) const;
 
     // These methods are for debugging purposes only (matdbg)
@@ -68,6 +73,14 @@ private:
     const uint8_t* mBase = nullptr;
     tsl::robin_map<uint32_t, uint32_t> mOffsets;
 
+    struct DecodedSpirv {
+        uint32_t index;
+        uint32_t lastUse;
+        ShaderContent spirv;
+    };
+    utils::FixedCapacityVector<DecodedSpirv> mSpirvCache;
+    uint32_t mSpirvCacheTime = 0;
+
     bool getTextShader(Unflattener unflattener,
             BlobDictionary const& dictionary, ShaderContent& shaderContent,
             ShaderModel shaderModel, filament::Variant variant, ShaderStage shaderStage);
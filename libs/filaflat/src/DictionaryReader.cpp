@@ -24,6 +24,8 @@
 #include <smolv.h>
 #endif
 
+#include <utility>
+
 #include <assert.h>
 
 using namespace filamat;
@@ -62,20 +64,10 @@ bool DictionaryReader::unflatten(ChunkContainer const& container,
 
             assert_invariant((intptr_t(compressed) % 8) == 0);
 
-#if defined (FILAMENT_DRIVER_SUPPORTS_VULKAN)
-            size_t spirvSize = smolv::GetDecodedBufferSize(compressed, compressedSize);
-            if (spirvSize == 0) {
-                return false;
-            }
-            ShaderContent spirv(spirvSize);
-            if (!smolv::Decode(compressed, compressedSize, spirv.data(), spirvSize)) {
-                return false;
-            }
-            dictionary.emplace_back(std::move(spirv));
-#else
-            return false;
-#endif
-
+            // SPIR-V blobs are kept SMOL-V compressed, they're decoded on demand by
+            // decodeSpirv(), because typically only a handful of variants are ever used.
+            dictionary.emplace_back(compressedSize);
+            memcpy(dictionary.back().data(), compressed, compressedSize);
         }
         return true;
     } else if (dictionaryTag == ChunkType::DictionaryText) {
@@ -101,4 +93,21 @@ bool DictionaryReader::unflatten(ChunkContainer const& container,
     return false;
 }
 
+bool DictionaryReader::decodeSpirv(ShaderContent const& compressed, ShaderContent& spirv) {
+#if defined (FILAMENT_DRIVER_SUPPORTS_VULKAN)
+    size_t const spirvSize = smolv::GetDecodedBufferSize(compressed.data(), compressed.size());
+    if (spirvSize == 0) {
+        return false;
+    }
+    ShaderContent decoded(spirvSize);
+    if (!smolv::Decode(compressed.data(), compressed.size(), decoded.data(), spirvSize)) {
+        return false;
+    }
+    spirv = std::move(decoded);
+    return true;
+#else
+    return false;
+#endif
+}
+
 } // namespace filaflat
@@ -16,11 +16,14 @@
 
 #include <filaflat/MaterialChunk.h>
 #include <filaflat/ChunkContainer.h>
+#include <filaflat/DictionaryReader.h>
 
 #include <backend/DriverEnums.h>
 
 #include <utils/Log.h>
 
+#include <algorithm>
+
 namespace filaflat {
 
 static inline uint32_t makeKey(
@@ -46,6 +49,10 @@ MaterialChunk::MaterialChunk(ChunkContainer const& container)
 
 MaterialChunk::~MaterialChunk() noexcept = default;
 
+void MaterialChunk::setSpirvCacheCapacity(size_t count) {
+    mSpirvCache = utils::FixedCapacityVector<DecodedSpirv>::with_capacity(count);
+}
+
 bool MaterialChunk::initialize(filamat::ChunkType materialTag) {
 
     if (mBase != nullptr) {
@@ -166,7 +173,30 @@ bool MaterialChunk::getSpirvShader(BlobDictionary const& dictionary,
         return false;
     }
 
-    shaderContent = dictionary[pos->second];
+    uint32_t const index = pos->second;
+
+    // Decoded blobs are often shared by several variants, so keep the most recently used ones.
+    for (auto& entry : mSpirvCache) {
+        if (entry.index == index) {
+            entry.lastUse = ++mSpirvCacheTime;
+            shaderContent = entry.spirv;
+            return true;
+        }
+    }
+
+    if (!DictionaryReader::decodeSpirv(dictionary[index], shaderContent)) {
+        return false;
+    }
+
+    if (mSpirvCache.capacity()) {
+        if (mSpirvCache.size() < mSpirvCache.capacity()) {
+            mSpirvCache.push_back({ index, ++mSpirvCacheTime, shaderContent });
+        } else {
+            auto lru = std::min_element(mSpirvCache.begin(), mSpirvCache.end(),
+                    [](auto const& lhs, auto const& rhs) { return lhs.lastUse < rhs.lastUse; });
+            *lru = { index, ++mSpirvCacheTime, shaderContent };
+        }
+    }
     return true;
 }
 
@@ -17,10 +17,13 @@
 #include "ArchiveCache.h"
 
 #include <uberz/ReadableArchive.h>
+#include <utils/Panic.h>
 #include <utils/memalign.h>
 
 #include <zstd.h>
 
+#include <algorithm>
+
 using namespace utils;
 using namespace filament::uberz;
 
@@ -44,6 +47,18 @@ static bool strIsEqual(const CString& a, const char* b) {
     return strncmp(a.c_str(), b, a.size()) == 0;
 }
 
+// The decompressed archive outlives its materials, so their packages can be used in place rather
+// than copied, as long as they're aligned (archives written by older versions of uberz may not be).
+static Material* createMaterial(Engine& engine, const ArchiveSpec& spec) {
+    Material::Builder builder;
+    if (uintptr_t(spec.package) % 8 == 0) {
+        builder.package(spec.package, spec.packageByteCount, nullptr);
+    } else {
+        builder.package(spec.package, spec.packageByteCount);
+    }
+    return builder.build(engine);
+}
+
 void ArchiveCache::load(const void* archiveData, uint64_t archiveByteCount) {
     assert_invariant(mArchive == nullptr && "Do not call load() twice");
     const uint64_t decompSize = ZSTD_getFrameContentSize(archiveData, archiveByteCount);
@@ -115,9 +130,7 @@ Material* ArchiveCache::getMaterial(const ArchiveRequirements& reqs) {
 
         if (specIsSuitable) {
             if (mMaterials[i] == nullptr) {
-                mMaterials[i] = Material::Builder()
-                    .package(spec.package, spec.packageByteCount)
-                    .build(mEngine);
+                mMaterials[i] = createMaterial(mEngine, spec);
             }
             return mMaterials[i];
         }
@@ -129,9 +142,7 @@ Material* ArchiveCache::getDefaultMaterial() {
     assert_invariant(mArchive && "Please call load() before requesting any materials.");
     assert_invariant(!mMaterials.empty() && "Archive must have at least one material.");
     if (mMaterials[0] == nullptr) {
-        mMaterials[0] = Material::Builder()
-            .package(mArchive->specs[0].package, mArchive->specs[0].packageByteCount)
-            .build(mEngine);
+        mMaterials[0] = createMaterial(mEngine, mArchive->specs[0]);
     }
     return mMaterials[0];
 }
@@ -157,8 +168,15 @@ FeatureMap ArchiveCache::getFeatureMap(Material* material) const {
 }
 
 ArchiveCache::~ArchiveCache() {
-    assert_invariant(mMaterials.size() == 0 &&
-        "Please call destroyMaterials explicitly to ensure correct destruction order");
+    // The materials use their packages in place, so the archive can't be freed before them.
+    const bool materialsDestroyed = std::all_of(mMaterials.begin(), mMaterials.end(),
+            [](Material const* material) { return material == nullptr; });
+    ASSERT_DESTRUCTOR(materialsDestroyed,
+            "Please call destroyMaterials explicitly to ensure correct destruction order");
+    if (UTILS_UNLIKELY(!materialsDestroyed)) {
+        // leak the archive rather than freeing memory that's still in use
+        return;
+    }
     utils::aligned_free(mArchive);
 }
 
@@ -357,6 +357,10 @@ BlobIndex::BlobIndex(ChunkType dictTag, ChunkType matTag, const filaflat::ChunkC
     // Decompress SMOL-V.
     DictionaryReader reader;
     reader.unflatten(cc, mDictTag, mDataBlobs);
+    for (auto& blob : mDataBlobs) {
+        UTILS_UNUSED_IN_RELEASE bool success = DictionaryReader::decodeSpirv(blob, blob);
+        assert_invariant(success);
+    }
 
     filaflat::MaterialChunk matChunk(cc);
     matChunk.initialize(matTag);
@@ -241,9 +241,12 @@ FixedCapacityVector<uint8_t> WritableArchive::serialize() const {
             byteCount += pair.first.size() + 1;
         }
     }
-    size_t filamatOffset = byteCount;
+    // Packages are 8-bytes aligned, which allows the reader to use them in place.
+    auto const align = [](size_t size) { return (size + 7) & ~size_t(7); };
+    size_t filamatOffset = align(byteCount);
+    byteCount = filamatOffset;
     for (const auto& mat : mMaterials) {
-        byteCount += mat.package.size();
+        byteCount += align(mat.package.size());
     }
 
     ReadableArchive archive;
@@ -263,7 +266,7 @@ FixedCapacityVector<uint8_t> WritableArchive::serialize() const {
         spec.packageByteCount = mat.package.size();
         spec.packageOffset = filamatOffset;
         specs.push_back(spec);
-        filamatOffset += mat.package.size();
+        filamatOffset += align(mat.package.size());
         flagCount += mat.flags.size();
     }
 
@@ -299,9 +302,15 @@ FixedCapacityVector<uint8_t> WritableArchive::serialize() const {
     writeCursor += sizeof(ArchiveFlag) * flags.size();
     memcpy(writeCursor, flagNames.data(), charCount);
     writeCursor += charCount;
+    const size_t namesPadding = align(charCount + nameOffset) - (charCount + nameOffset);
+    memset(writeCursor, 0, namesPadding);
+    writeCursor += namesPadding;
     for (const auto& mat : mMaterials) {
+        const size_t packagePadding = align(mat.package.size()) - mat.package.size();
         memcpy(writeCursor, mat.package.data(), mat.package.size());
         writeCursor += mat.package.size();
+        memset(writeCursor, 0, packagePadding);
+        writeCursor += packagePadding;
     }
     assert_invariant(writeCursor - outputBuf.data() == outputBuf.size());
 
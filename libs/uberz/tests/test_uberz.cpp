@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <zstd.h>
+
+#include <uberz/ReadableArchive.h>
+#include <uberz/WritableArchive.h>
+
+using namespace filament;
+using namespace filament::uberz;
+
+class UberzTest : public testing::Test {};
+
+TEST_F(UberzTest, PackagesAreAligned) {
+    // packages and flag names with sizes that are not multiples of 8
+    const std::vector<std::vector<uint8_t>> packages = {
+            { 1, 2, 3 },
+            { 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 },
+            { 17, 18, 19, 20, 21, 22, 23, 24 },
+    };
+
+    WritableArchive writable(packages.size());
+    writable.addMaterial("a", packages[0].data(), packages[0].size());
+    writable.addSpecLine("ShadingModel = lit");
+    writable.addSpecLine("BlendingMode = opaque");
+    writable.addSpecLine("Skinning = optional");
+    writable.addMaterial("b", packages[1].data(), packages[1].size());
+    writable.addSpecLine("ShadingModel = unlit");
+    writable.addSpecLine("Morphing = unsupported");
+    writable.addMaterial("c", packages[2].data(), packages[2].size());
+    writable.setShadingModel(Shading::LIT);
+    writable.setBlendingModel(BlendingMode::MASKED);
+    writable.setFeatureFlag("ClearCoat", ArchiveFeature::REQUIRED);
+
+    const utils::FixedCapacityVector<uint8_t> compressed = writable.serialize();
+    const uint64_t size = ZSTD_getFrameContentSize(compressed.data(), compressed.size());
+    ASSERT_NE(size, ZSTD_CONTENTSIZE_UNKNOWN);
+    ASSERT_NE(size, ZSTD_CONTENTSIZE_ERROR);
+    ASSERT_EQ(size % 8, 0);
+
+    // the archive is meant to be loaded at an 8-bytes aligned address
+    std::vector<uint64_t> storage(size / 8);
+    ASSERT_EQ(ZSTD_decompress(storage.data(), size, compressed.data(), compressed.size()), size);
+
+    auto* archive = (ReadableArchive*) storage.data();
+    ASSERT_EQ(archive->specsCount, packages.size());
+    const auto* specs = (const ArchiveSpec*) (storage.data() + archive->specsOffset / 8);
+    for (size_t i = 0; i < packages.size(); i++) {
+        EXPECT_EQ(specs[i].packageOffset % 8, 0);
+        EXPECT_EQ(specs[i].packageByteCount, packages[i].size());
+        EXPECT_LE(specs[i].packageOffset + specs[i].packageByteCount, size);
+    }
+
+    convertOffsetsToPointers(archive);
+    for (size_t i = 0; i < packages.size(); i++) {
+        const ArchiveSpec& spec = archive->specs[i];
+        EXPECT_EQ(uintptr_t(spec.package) % 8, 0);
+        EXPECT_EQ(memcmp(spec.package, packages[i].data(), packages[i].size()), 0);
+    }
+    EXPECT_EQ(archive->specs[0].flagsCount, 1);
+    EXPECT_STREQ(archive->specs[0].flags[0].name, "Skinning");
+    EXPECT_STREQ(archive->specs[2].flags[0].name, "ClearCoat");
+    EXPECT_EQ(archive->specs[2].blendingMode, BlendingMode::MASKED);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
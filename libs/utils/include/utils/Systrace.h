@@ -37,10 +37,17 @@
 #define FILAMENT_APPLE_SYSTRACE 0
 #endif
 
+// On other platforms, events are recorded by filament itself, see utils/generic/Systrace.h
+#ifndef FILAMENT_GENERIC_SYSTRACE
+#define FILAMENT_GENERIC_SYSTRACE 1
+#endif
+
 #if defined(__ANDROID__)
 #include <utils/android/Systrace.h>
 #elif defined(__APPLE__) && FILAMENT_APPLE_SYSTRACE
 #include <utils/darwin/Systrace.h>
+#elif FILAMENT_GENERIC_SYSTRACE
+#include <utils/generic/Systrace.h>
 #else
 
 #define SYSTRACE_ENABLE()
@@ -58,4 +65,12 @@
 
 #endif // ANDROID
 
+// Recording traces is only supported by the generic implementation
+#ifndef SYSTRACE_HAS_RECORDER
+#define SYSTRACE_HAS_RECORDER 0
+#define SYSTRACE_START_RECORDING()
+#define SYSTRACE_STOP_RECORDING()
+#define SYSTRACE_WRITE_TRACE(path) ((void)(path), false)
+#endif
+
 #endif // TNT_UTILS_SYSTRACE_H
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_UTILS_GENERIC_SYSTRACE_H
+#define TNT_UTILS_GENERIC_SYSTRACE_H
+
+#include <atomic>
+
+#include <stdint.h>
+
+#include <utils/compiler.h>
+
+/*
+ * This implementation doesn't rely on a system tracer, instead events are recorded into
+ * per-thread ring buffers, which can be written as a Chrome trace (chrome://tracing or
+ * https://ui.perfetto.dev) with SYSTRACE_WRITE_TRACE().
+ * Recording is off by default, see SYSTRACE_START_RECORDING().
+ */
+#define SYSTRACE_HAS_RECORDER 1
+
+// enable tracing
+#define SYSTRACE_ENABLE() ::utils::details::Systrace::enable(SYSTRACE_TAG)
+
+// disable tracing
+#define SYSTRACE_DISABLE() ::utils::details::Systrace::disable(SYSTRACE_TAG)
+
+// starts recording events, previously recorded events are discarded
+#define SYSTRACE_START_RECORDING() ::utils::details::Systrace::startRecording()
+
+// stops recording events, recorded events are kept until the next SYSTRACE_START_RECORDING()
+#define SYSTRACE_STOP_RECORDING() ::utils::details::Systrace::stopRecording()
+
+// writes the recorded events to a file as a Chrome trace, returns false on error
+#define SYSTRACE_WRITE_TRACE(path) ::utils::details::Systrace::writeTrace(path)
+
+/**
+ * Creates a Systrace context in the current scope. needed for calling all other systrace
+ * commands below.
+ */
+#define SYSTRACE_CONTEXT() ::utils::details::Systrace ___trctx(SYSTRACE_TAG)
+
+
+// SYSTRACE_NAME traces the beginning and end of the current scope.  To trace
+// the correct start and end times this macro should be declared first in the
+// scope body.
+// It also automatically creates a Systrace context
+#define SYSTRACE_NAME(name) ::utils::details::ScopedTrace ___tracer(SYSTRACE_TAG, name)
+
+// Denotes that a new frame has started processing.
+#define SYSTRACE_FRAME_ID(frame) \
+    ::utils::details::Systrace(SYSTRACE_TAG).frameId(SYSTRACE_TAG, frame)
+
+// SYSTRACE_CALL is an SYSTRACE_NAME that uses the current function name.
+#define SYSTRACE_CALL() SYSTRACE_NAME(__FUNCTION__)
+
+#define SYSTRACE_NAME_BEGIN(name) \
+        ___trctx.traceBegin(SYSTRACE_TAG, name)
+
+#define SYSTRACE_NAME_END() \
+        ___trctx.traceEnd(SYSTRACE_TAG)
+
+
+/**
+ * Trace the beginning of an asynchronous event. Unlike ATRACE_BEGIN/ATRACE_END
+ * contexts, asynchronous events do not need to be nested. The name describes
+ * the event, and the cookie provides a unique identifier for distinguishing
+ * simultaneous events. The name and cookie used to begin an event must be
+ * used to end it.
+ */
+#define SYSTRACE_ASYNC_BEGIN(name, cookie) \
+        ___trctx.asyncBegin(SYSTRACE_TAG, name, cookie)
+
+/**
+ * Trace the end of an asynchronous event.
+ * This should have a corresponding SYSTRACE_ASYNC_BEGIN.
+ */
+#define SYSTRACE_ASYNC_END(name, cookie) \
+        ___trctx.asyncEnd(SYSTRACE_TAG, name, cookie)
+
+/**
+ * Traces an integer counter value.  name is used to identify the counter.
+ * This can be used to track how a value changes over time.
+ */
+#define SYSTRACE_VALUE32(name, val) \
+        ___trctx.value(SYSTRACE_TAG, name, int32_t(val))
+
+#define SYSTRACE_VALUE64(name, val) \
+        ___trctx.value(SYSTRACE_TAG, name, int64_t(val))
+
+// ------------------------------------------------------------------------------------------------
+// No user serviceable code below...
+// ------------------------------------------------------------------------------------------------
+
+namespace utils {
+namespace details {
+
+class Systrace {
+   public:
+
+    enum tags {
+        NEVER       = SYSTRACE_TAG_NEVER,
+        ALWAYS      = SYSTRACE_TAG_ALWAYS,
+        FILAMENT    = SYSTRACE_TAG_FILAMENT,
+        JOBSYSTEM   = SYSTRACE_TAG_JOBSYSTEM
+        // we could define more TAGS here, as we need them.
+    };
+
+    enum class EventType : uint8_t {
+        BEGIN,          // beginning of a section
+        END,            // end of a section
+        COMPLETE,       // a whole section, value is its duration
+        ASYNC_BEGIN,    // value is the cookie
+        ASYNC_END,      // value is the cookie
+        COUNTER,        // value is the counter's value
+        FRAME           // value is the frame id
+    };
+
+    explicit Systrace(uint32_t tag) noexcept {
+        if (tag) init(tag);
+    }
+
+    static void enable(uint32_t tags) noexcept;
+    static void disable(uint32_t tags) noexcept;
+
+    static void startRecording() noexcept;
+    static void stopRecording() noexcept;
+    static bool writeTrace(const char* path) noexcept;
+
+    inline void traceBegin(uint32_t tag, const char* name) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record(EventType::BEGIN, name, 0);
+        }
+    }
+
+    inline void traceEnd(uint32_t tag) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record(EventType::END, nullptr, 0);
+        }
+    }
+
+    inline void asyncBegin(uint32_t tag, const char* name, int32_t cookie) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record(EventType::ASYNC_BEGIN, name, cookie);
+        }
+    }
+
+    inline void asyncEnd(uint32_t tag, const char* name, int32_t cookie) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record(EventType::ASYNC_END, name, cookie);
+        }
+    }
+
+    inline void value(uint32_t tag, const char* name, int32_t value) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record(EventType::COUNTER, name, value);
+        }
+    }
+
+    inline void value(uint32_t tag, const char* name, int64_t value) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record(EventType::COUNTER, name, value);
+        }
+    }
+
+    inline void frameId(uint32_t tag, uint32_t frame) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record(EventType::FRAME, "frame", frame);
+        }
+    }
+
+   private:
+    friend class ScopedTrace;
+
+    // set when events are being recorded, the other bits are the enabled tags
+    static constexpr uint32_t RECORDING = 0x80000000u;
+
+    static std::atomic<uint32_t> sState;
+
+    inline void init(uint32_t tag) noexcept {
+        // must be called first
+        uint32_t const state = sState.load(std::memory_order_relaxed);
+        mIsTracingEnabled = (state & RECORDING) && ((state | SYSTRACE_TAG_ALWAYS) & tag);
+    }
+
+    // returns a timestamp in nanoseconds
+    static int64_t now() noexcept;
+
+    static void record(EventType type, const char* name, int64_t value) noexcept;
+    static void record(EventType type, const char* name, int64_t value, int64_t timestamp) noexcept;
+
+    // cached values for faster access, no need to be initialized
+    bool mIsTracingEnabled;
+};
+
+// ------------------------------------------------------------------------------------------------
+
+class ScopedTrace {
+   public:
+    // the whole section is recorded as a single event when the scope ends
+    inline ScopedTrace(uint32_t tag, const char* name) noexcept
+            : mTrace(tag), mName(name), mTag(tag) {
+        if (mTag && UTILS_UNLIKELY(mTrace.mIsTracingEnabled)) {
+            mStart = Systrace::now();
+        }
+    }
+
+    inline ~ScopedTrace() noexcept {
+        if (mTag && UTILS_UNLIKELY(mTrace.mIsTracingEnabled)) {
+            Systrace::record(Systrace::EventType::COMPLETE,
+                    mName, Systrace::now() - mStart, mStart);
+        }
+    }
+
+    inline void value(uint32_t tag, const char* name, int32_t v) noexcept {
+        mTrace.value(tag, name, v);
+    }
+
+    inline void value(uint32_t tag, const char* name, int64_t v) noexcept {
+        mTrace.value(tag, name, v);
+    }
+
+   private:
+    Systrace mTrace;
+    const char* mName;
+    const uint32_t mTag;
+    int64_t mStart = 0;
+};
+
+} // namespace details
+} // namespace utils
+
+#endif // TNT_UTILS_GENERIC_SYSTRACE_H
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <utils/Systrace.h>
+
+#if SYSTRACE_HAS_RECORDER
+
+#include <utils/Mutex.h>
+#include <utils/SpinLock.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+namespace utils {
+namespace details {
+
+namespace {
+
+// Each thread records its events into its own ring buffer, so recording never contends with
+// other threads. When a buffer is full, the oldest events are overwritten. Buffers are allocated
+// when a thread records its first event, and released once recording is stopped and the trace
+// is written.
+constexpr size_t EVENTS_PER_THREAD = 8192;
+
+// names are copied, so they don't need to outlive the event (e.g. FrameGraph pass names)
+constexpr size_t MAX_NAME_LENGTH = 47;
+
+struct Event {
+    int64_t timestamp;
+    int64_t value;
+    Systrace::EventType type;
+    char name[MAX_NAME_LENGTH];
+};
+
+static_assert(sizeof(Event) == 64);
+
+struct ThreadEvents {
+    // only contended while the trace is written or recording restarts
+    SpinLock lock;
+    uint64_t count = 0;
+    uint32_t tid = 0;
+    char name[32] = {};
+    std::unique_ptr<Event[]> events;
+};
+
+struct Recorder {
+    Mutex lock;
+    std::vector<std::unique_ptr<ThreadEvents>> threads;
+    int64_t start = 0;
+};
+
+// never destroyed, threads can record events until the very end
+Recorder& getRecorder() noexcept {
+    static Recorder* const recorder = new Recorder;
+    return *recorder;
+}
+
+thread_local ThreadEvents* tThreadEvents = nullptr;
+
+ThreadEvents& getThreadEvents() noexcept {
+    ThreadEvents* events = tThreadEvents;
+    if (UTILS_UNLIKELY(!events)) {
+        Recorder& recorder = getRecorder();
+        std::lock_guard<Mutex> const guard(recorder.lock);
+        events = recorder.threads.emplace_back(std::make_unique<ThreadEvents>()).get();
+        events->tid = uint32_t(recorder.threads.size());
+#if defined(__linux__) || defined(__APPLE__)
+        pthread_getname_np(pthread_self(), events->name, sizeof(events->name));
+#endif
+        if (!events->name[0]) {
+            snprintf(events->name, sizeof(events->name), "thread %u", events->tid);
+        }
+        tThreadEvents = events;
+    }
+    return *events;
+}
+
+void writeString(FILE* out, const char* s) noexcept {
+    fputc('"', out);
+    for (; *s; s++) {
+        char const c = *s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if ((unsigned char)c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+} // anonymous namespace
+
+std::atomic<uint32_t> Systrace::sState{ 0 };
+
+void Systrace::enable(uint32_t tags) noexcept {
+    sState.fetch_or(tags & ~RECORDING, std::memory_order_relaxed);
+}
+
+void Systrace::disable(uint32_t tags) noexcept {
+    sState.fetch_and(~(tags & ~RECORDING), std::memory_order_relaxed);
+}
+
+int64_t Systrace::now() noexcept {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Systrace::startRecording() noexcept {
+    Recorder& recorder = getRecorder();
+    std::lock_guard<Mutex> const guard(recorder.lock);
+    for (auto const& thread : recorder.threads) {
+        std::lock_guard<SpinLock> const threadGuard(thread->lock);
+        thread->count = 0;
+    }
+    recorder.start = now();
+    sState.fetch_or(RECORDING, std::memory_order_relaxed);
+}
+
+void Systrace::stopRecording() noexcept {
+    sState.fetch_and(~RECORDING, std::memory_order_relaxed);
+}
+
+void Systrace::record(EventType type, const char* name, int64_t value) noexcept {
+    record(type, name, value, now());
+}
+
+void Systrace::record(EventType type, const char* name, int64_t value,
+        int64_t timestamp) noexcept {
+    ThreadEvents& thread = getThreadEvents();
+    std::lock_guard<SpinLock> const guard(thread.lock);
+    if (UTILS_UNLIKELY(!thread.events)) {
+        thread.events.reset(new Event[EVENTS_PER_THREAD]);
+    }
+    Event& event = thread.events[thread.count++ % EVENTS_PER_THREAD];
+    event.timestamp = timestamp;
+    event.value = value;
+    event.type = type;
+    if (name) {
+        strncpy(event.name, name, MAX_NAME_LENGTH - 1);
+        event.name[MAX_NAME_LENGTH - 1] = 0;
+    } else {
+        event.name[0] = 0;
+    }
+}
+
+bool Systrace::writeTrace(const char* path) noexcept {
+    FILE* const out = fopen(path, "w");
+    if (!out) {
+        return false;
+    }
+
+    Recorder& recorder = getRecorder();
+    std::lock_guard<Mutex> const guard(recorder.lock);
+
+    // once recording is stopped, the events are dropped as they're written
+    bool const release = !(sState.load(std::memory_order_relaxed) & RECORDING);
+
+    // timestamps are in microseconds, relative to the start of the recording
+    int64_t const start = recorder.start;
+    auto const us = [start](int64_t t) { return double(t - start) * 1e-3; };
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    std::unique_ptr<Event[]> events{ new Event[EVENTS_PER_THREAD] };
+    for (auto const& thread : recorder.threads) {
+        // copy the events out, so the thread is not blocked while we write them
+        size_t count;
+        {
+            std::lock_guard<SpinLock> const threadGuard(thread->lock);
+            uint64_t const total = thread->count;
+            count = size_t(std::min<uint64_t>(total, EVENTS_PER_THREAD));
+            for (size_t i = 0; i < count; i++) {
+                events[i] = thread->events[(total - count + i) % EVENTS_PER_THREAD];
+            }
+            if (release) {
+                thread->events.reset();
+                thread->count = 0;
+            }
+        }
+        if (!count) {
+            continue;
+        }
+
+        uint32_t const tid = thread->tid;
+        fprintf(out, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%u,"
+                     "\"args\":{\"name\":", first ? "" : ",\n", tid);
+        writeString(out, thread->name);
+        fprintf(out, "}}");
+        first = false;
+
+        for (size_t i = 0; i < count; i++) {
+            Event const& e = events[i];
+            switch (e.type) {
+                case EventType::BEGIN:
+                    fprintf(out, ",\n{\"ph\":\"B\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"name\":",
+                            tid, us(e.timestamp));
+                    writeString(out, e.name);
+                    break;
+                case EventType::END:
+                    fprintf(out, ",\n{\"ph\":\"E\",\"pid\":0,\"tid\":%u,\"ts\":%.3f",
+                            tid, us(e.timestamp));
+                    break;
+                case EventType::COMPLETE:
+                    fprintf(out, ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,"
+                                 "\"dur\":%.3f,\"name\":",
+                            tid, us(e.timestamp), double(e.value) * 1e-3);
+                    writeString(out, e.name);
+                    break;
+                case EventType::ASYNC_BEGIN:
+                case EventType::ASYNC_END:
+                    fprintf(out, ",\n{\"ph\":\"%c\",\"cat\":\"async\",\"id\":%lld,\"pid\":0,"
+                                 "\"tid\":%u,\"ts\":%.3f,\"name\":",
+                            e.type == EventType::ASYNC_BEGIN ? 'b' : 'e',
+                            (long long)e.value, tid, us(e.timestamp));
+                    writeString(out, e.name);
+                    break;
+                case EventType::COUNTER:
+                    fprintf(out, ",\n{\"ph\":\"C\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,"
+                                 "\"args\":{\"value\":%lld},\"name\":",
+                            tid, us(e.timestamp), (long long)e.value);
+                    writeString(out, e.name);
+                    break;
+                case EventType::FRAME:
+                    fprintf(out, ",\n{\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,"
+                                 "\"args\":{\"id\":%lld},\"name\":",
+                            tid, us(e.timestamp), (long long)e.value);
+                    writeString(out, e.name);
+                    break;
+            }
+            fputc('}', out);
+        }
+    }
+    fprintf(out, "\n]}\n");
+
+    bool const success = !ferror(out);
+    return (fclose(out) == 0) && success;
+}
+
+} // namespace details
+} // namespace utils
+
+#endif // SYSTRACE_HAS_RECORDER
@@ -76,6 +76,8 @@ using TemporalAntiAliasingOptions = filament::View::TemporalAntiAliasingOptions;
 using VignetteOptions = filament::View::VignetteOptions;
 using VsmShadowOptions = filament::View::VsmShadowOptions;
 using GuardBandOptions = filament::View::GuardBandOptions;
+using ShadowCacheOptions = filament::View::ShadowCacheOptions;
+using PostProcessResolutionOptions = filament::View::PostProcessResolutionOptions;
 using LightManager = filament::LightManager;
 
 // These functions push all editable property values to their respective Filament objects.
@@ -185,6 +187,8 @@ struct ViewSettings {
     VignetteOptions vignette;
     VsmShadowOptions vsmShadowOptions;
     GuardBandOptions guardBand;
+    ShadowCacheOptions shadowCache;
+    PostProcessResolutionOptions postProcessResolution;
 
     // Custom View Options
     ColorGradingSettings colorGrading;
@@ -265,6 +265,10 @@ static int parse(jsmntok_t const* tokens, int i, const char* jsonChunk, ViewSett
             i = parse(tokens, i + 1, jsonChunk, &out->shadowType);
         } else if (compare(tok, jsonChunk, "guardBand") == 0) {
             i = parse(tokens, i + 1, jsonChunk, &out->guardBand);
+        } else if (compare(tok, jsonChunk, "shadowCache") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->shadowCache);
+        } else if (compare(tok, jsonChunk, "postProcessResolution") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->postProcessResolution);
         } else if (compare(tok, jsonChunk, "vsmShadowOptions") == 0) {
             i = parse(tokens, i + 1, jsonChunk, &out->vsmShadowOptions);
         } else if (compare(tok, jsonChunk, "postProcessingEnabled") == 0) {
@@ -526,6 +530,8 @@ void applySettings(Engine* engine, const ViewSettings& settings, View* dest) {
     dest->setShadowType(settings.shadowType);
     dest->setVsmShadowOptions(settings.vsmShadowOptions);
     dest->setGuardBandOptions(settings.guardBand);
+    dest->setShadowCacheOptions(settings.shadowCache);
+    dest->setPostProcessResolutionOptions(settings.postProcessResolution);
     dest->setPostProcessingEnabled(settings.postProcessingEnabled);
 }
 
@@ -828,6 +834,8 @@ static std::ostream& operator<<(std::ostream& out, const ViewSettings& in) {
         << "\"shadowType\": " << (in.shadowType) << ",\n"
         << "\"vsmShadowOptions\": " << (in.vsmShadowOptions) << ",\n"
         << "\"guardBand\": " << (in.guardBand) << ",\n"
+        << "\"shadowCache\": " << (in.shadowCache) << ",\n"
+        << "\"postProcessResolution\": " << (in.postProcessResolution) << ",\n"
         << "\"postProcessingEnabled\": " << to_string(in.postProcessingEnabled) << "\n"
         << "}";
 }
@@ -868,4 +868,87 @@ std::ostream& operator<<(std::ostream& out, const SoftShadowOptions& in) {
         << "}";
 }
 
+int parse(jsmntok_t const* tokens, int i, const char* jsonChunk, ShadowCacheOptions* out) {
+    CHECK_TOKTYPE(tokens[i], JSMN_OBJECT);
+    int size = tokens[i++].size;
+    for (int j = 0; j < size; ++j) {
+        const jsmntok_t tok = tokens[i];
+        CHECK_KEY(tok);
+        if (compare(tok, jsonChunk, "enabled") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->enabled);
+        } else if (compare(tok, jsonChunk, "distantCascadeUpdateInterval") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->distantCascadeUpdateInterval);
+        } else {
+            slog.w << "Invalid ShadowCacheOptions key: '" << STR(tok, jsonChunk) << "'" << io::endl;
+            i = parse(tokens, i + 1);
+        }
+        if (i < 0) {
+            slog.e << "Invalid ShadowCacheOptions value: '" << STR(tok, jsonChunk) << "'" << io::endl;
+            return i;
+        }
+    }
+    return i;
+}
+
+std::ostream& operator<<(std::ostream& out, const ShadowCacheOptions& in) {
+    return out << "{\n"
+        << "\"enabled\": " << to_string(in.enabled) << ",\n"
+        << "\"distantCascadeUpdateInterval\": " << int(in.distantCascadeUpdateInterval) << "\n"
+        << "}";
+}
+
+int parse(jsmntok_t const* tokens, int i, const char* jsonChunk, PostProcessResolutionOptions::Resolution* out) {
+    if (0 == compare(tokens[i], jsonChunk, "FULL")) { *out = PostProcessResolutionOptions::Resolution::FULL; }
+    else if (0 == compare(tokens[i], jsonChunk, "HALF")) { *out = PostProcessResolutionOptions::Resolution::HALF; }
+    else if (0 == compare(tokens[i], jsonChunk, "QUARTER")) { *out = PostProcessResolutionOptions::Resolution::QUARTER; }
+    else {
+        slog.w << "Invalid PostProcessResolutionOptions::Resolution: '" << STR(tokens[i], jsonChunk) << "'" << io::endl;
+    }
+    return i + 1;
+}
+
+std::ostream& operator<<(std::ostream& out, PostProcessResolutionOptions::Resolution in) {
+    switch (in) {
+        case PostProcessResolutionOptions::Resolution::FULL: return out << "\"FULL\"";
+        case PostProcessResolutionOptions::Resolution::HALF: return out << "\"HALF\"";
+        case PostProcessResolutionOptions::Resolution::QUARTER: return out << "\"QUARTER\"";
+    }
+    return out << "\"INVALID\"";
+}
+
+int parse(jsmntok_t const* tokens, int i, const char* jsonChunk, PostProcessResolutionOptions* out) {
+    CHECK_TOKTYPE(tokens[i], JSMN_OBJECT);
+    int size = tokens[i++].size;
+    for (int j = 0; j < size; ++j) {
+        const jsmntok_t tok = tokens[i];
+        CHECK_KEY(tok);
+        if (compare(tok, jsonChunk, "enabled") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->enabled);
+        } else if (compare(tok, jsonChunk, "resolution") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->resolution);
+        } else if (compare(tok, jsonChunk, "dynamic") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->dynamic);
+        } else if (compare(tok, jsonChunk, "minResolution") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->minResolution);
+        } else {
+            slog.w << "Invalid PostProcessResolutionOptions key: '" << STR(tok, jsonChunk) << "'" << io::endl;
+            i = parse(tokens, i + 1);
+        }
+        if (i < 0) {
+            slog.e << "Invalid PostProcessResolutionOptions value: '" << STR(tok, jsonChunk) << "'" << io::endl;
+            return i;
+        }
+    }
+    return i;
+}
+
+std::ostream& operator<<(std::ostream& out, const PostProcessResolutionOptions& in) {
+    return out << "{\n"
+        << "\"enabled\": " << to_string(in.enabled) << ",\n"
+        << "\"resolution\": " << (in.resolution) << ",\n"
+        << "\"dynamic\": " << to_string(in.dynamic) << ",\n"
+        << "\"minResolution\": " << (in.minResolution) << "\n"
+        << "}";
+}
+
 } // namespace filament::viewer
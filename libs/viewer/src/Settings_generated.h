@@ -93,4 +93,13 @@ std::ostream& operator<<(std::ostream& out, const VsmShadowOptions& in);
 int parse(jsmntok_t const* tokens, int i, const char* jsonChunk, SoftShadowOptions* out);
 std::ostream& operator<<(std::ostream& out, const SoftShadowOptions& in);
 
+int parse(jsmntok_t const* tokens, int i, const char* jsonChunk, ShadowCacheOptions* out);
+std::ostream& operator<<(std::ostream& out, const ShadowCacheOptions& in);
+
+int parse(jsmntok_t const* tokens, int i, const char* jsonChunk, PostProcessResolutionOptions::Resolution* out);
+std::ostream& operator<<(std::ostream& out, PostProcessResolutionOptions::Resolution in);
+
+int parse(jsmntok_t const* tokens, int i, const char* jsonChunk, PostProcessResolutionOptions* out);
+std::ostream& operator<<(std::ostream& out, const PostProcessResolutionOptions& in);
+
 } // namespace filament::viewer
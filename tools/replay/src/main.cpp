@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "private/backend/CommandBufferQueue.h"
+#include "private/backend/CommandCapture.h"
+#include "private/backend/CommandStream.h"
+#include "private/backend/Driver.h"
+#include "private/backend/PlatformFactory.h"
+
+#include <backend/Platform.h>
+
+#include <getopt/getopt.h>
+
+#include <utils/Path.h>
+#include <utils/memalign.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+
+using namespace filament::backend;
+using namespace utils;
+
+using clock_type = std::chrono::steady_clock;
+
+static Backend g_backend = Backend::NOOP;
+static size_t g_iterations = 1;
+static uint32_t g_width = 0;
+static uint32_t g_height = 0;
+static size_t g_bufferSizeMB = 16;
+
+static void printUsage(const char* name) {
+    std::string execName(Path(name).getName());
+    std::string usage(
+            "REPLAY replays a backend command capture and measures the time spent in the backend\n"
+            "Captures are created with Engine::startCommandCapture()\n"
+            "Usage:\n"
+            "    REPLAY [options] <capture file>\n"
+            "\n"
+            "Options:\n"
+            "   --help, -h\n"
+            "       Print this message\n\n"
+            "   --license\n"
+            "       Print copyright and license information\n\n"
+            "   --api, -a\n"
+            "       Backend to replay the capture with: noop (default), opengl, vulkan or metal\n\n"
+            "   --iterations=<count>, -i <count>\n"
+            "       Number of times the capture is replayed (default: 1)\n\n"
+            "   --size=<width>x<height>, -s <width>x<height>\n"
+            "       Create headless swap chains of that size instead of windowed ones,\n"
+            "       this is required to replay a capture with a real backend\n\n"
+            "   --buffer=<size>, -b <size>\n"
+            "       Size of the command buffer in MiB (default: 16)\n\n"
+    );
+
+    const std::string from("REPLAY");
+    for (size_t pos = usage.find(from); pos != std::string::npos; pos = usage.find(from, pos)) {
+        usage.replace(pos, from.length(), execName);
+    }
+    printf("%s", usage.c_str());
+}
+
+static void license() {
+    static const char *license[] = {
+        #include "licenses/licenses.inc"
+        nullptr
+    };
+
+    const char **p = &license[0];
+    while (*p)
+        std::cout << *p++ << std::endl;
+}
+
+static int handleArguments(int argc, char* argv[]) {
+    static constexpr const char* OPTSTR = "hla:i:s:b:";
+    static const struct option OPTIONS[] = {
+            { "help",             no_argument, nullptr, 'h' },
+            { "license",          no_argument, nullptr, 'l' },
+            { "api",        required_argument, nullptr, 'a' },
+            { "iterations", required_argument, nullptr, 'i' },
+            { "size",       required_argument, nullptr, 's' },
+            { "buffer",     required_argument, nullptr, 'b' },
+            { nullptr, 0, nullptr, 0 }  // termination of the option list
+    };
+
+    int opt;
+    int optionIndex = 0;
+
+    while ((opt = getopt_long(argc, argv, OPTSTR, OPTIONS, &optionIndex)) >= 0) {
+        std::string arg(optarg ? optarg : "");
+        switch (opt) {
+            default:
+            case 'h':
+                printUsage(argv[0]);
+                exit(0);
+            case 'l':
+                license();
+                exit(0);
+            case 'a':
+                if (arg == "noop") {
+                    g_backend = Backend::NOOP;
+                } else if (arg == "opengl") {
+                    g_backend = Backend::OPENGL;
+                } else if (arg == "vulkan") {
+                    g_backend = Backend::VULKAN;
+                } else if (arg == "metal") {
+                    g_backend = Backend::METAL;
+                } else {
+                    std::cerr << "Unrecognized backend. Must be 'noop'|'opengl'|'vulkan'|'metal'."
+                              << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'i':
+                g_iterations = std::max(1, std::stoi(arg));
+                break;
+            case 's':
+                if (sscanf(arg.c_str(), "%ux%u", &g_width, &g_height) != 2) {
+                    std::cerr << "Invalid size, must be <width>x<height>." << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'b':
+                g_bufferSizeMB = std::max(1, std::stoi(arg));
+                break;
+        }
+    }
+
+    return optind;
+}
+
+int main(int argc, char* argv[]) {
+    int const optionIndex = handleArguments(argc, argv);
+    if (optionIndex >= argc) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Path const path(argv[optionIndex]);
+    std::ifstream in(path.getPath(), std::ifstream::binary | std::ifstream::ate);
+    if (!in) {
+        std::cerr << "Could not open " << path << std::endl;
+        return 1;
+    }
+
+    // BufferDescriptor payloads are used in place and must be aligned
+    size_t const size = size_t(in.tellg());
+    void* const data = utils::aligned_alloc(size, 16);
+    in.seekg(0);
+    in.read(static_cast<char*>(data), std::streamsize(size));
+    in.close();
+
+    CommandCaptureReader reader(data, size);
+    if (!reader.isValid()) {
+        std::cerr << path << " is not a command capture, or was made by another version of "
+                "filament" << std::endl;
+        utils::aligned_free(data);
+        return 1;
+    }
+    reader.setHeadlessSwapChainSize(g_width, g_height);
+
+    Backend backend = g_backend;
+    Platform* platform = PlatformFactory::create(&backend);
+    if (!platform || backend != g_backend) {
+        std::cerr << "Backend " << backendToString(g_backend) << " is not available" << std::endl;
+        utils::aligned_free(data);
+        return 1;
+    }
+    Driver* const driver = platform->createDriver(nullptr, {});
+
+    // the whole buffer is executed as soon as half of the required size is used, so that
+    // flush() never has to wait.
+    size_t const bufferSize = g_bufferSizeMB * 1024u * 1024u;
+    size_t const requiredSize = bufferSize / 2;
+    CommandBufferQueue queue(requiredSize, bufferSize);
+    CircularBuffer const& circularBuffer = queue.getCircularBuffer();
+    CommandStream stream(*driver, queue.getCircularBuffer());
+    stream.debugThreading();
+
+    clock_type::duration recordTime{};
+    clock_type::duration executeTime{};
+    std::vector<clock_type::duration> frameTimes;
+
+    auto execute = [&]() -> clock_type::duration {
+        if (circularBuffer.empty()) {
+            // waitForCommands() would block
+            return {};
+        }
+        auto const start = clock_type::now();
+        queue.flush();
+        for (auto const& buffer : queue.waitForCommands()) {
+            if (buffer.begin) {
+                stream.execute(buffer.begin);
+                queue.releaseBuffer(buffer);
+            }
+        }
+        driver->purge();
+        auto const duration = clock_type::now() - start;
+        executeTime += duration;
+        return duration;
+    };
+
+    size_t commandCount = 0;
+    bool corrupted = false;
+    for (size_t i = 0; i < g_iterations && !corrupted; i++) {
+        reader.rewind();
+        clock_type::duration frameTime{};
+        auto start = clock_type::now();
+        CommandId id;
+        while ((id = reader.replayNext(stream)) != CommandId::COUNT) {
+            commandCount++;
+            bool const endOfFrame = id == CommandId::endFrame;
+            size_t const used = size_t(static_cast<char const*>(circularBuffer.getHead()) -
+                    static_cast<char const*>(circularBuffer.getTail()));
+            if (endOfFrame || used >= requiredSize / 2) {
+                auto const end = clock_type::now();
+                recordTime += end - start;
+                frameTime += end - start + execute();
+                if (endOfFrame) {
+                    frameTimes.push_back(frameTime);
+                    frameTime = {};
+                }
+                start = clock_type::now();
+            }
+        }
+        recordTime += clock_type::now() - start;
+        execute();
+        corrupted = reader.isCorrupted();
+    }
+
+    driver->terminate();
+    delete driver;
+    PlatformFactory::destroy(&platform);
+    utils::aligned_free(data);
+
+    if (corrupted) {
+        std::cerr << path << " is truncated or corrupted, replay stopped after "
+                << commandCount << " commands" << std::endl;
+        return 1;
+    }
+
+    using ms = std::chrono::duration<double, std::milli>;
+    std::cout << "backend:   " << backendToString(g_backend) << std::endl;
+    std::cout << "commands:  " << commandCount << std::endl;
+    std::cout << "recording: " << ms(recordTime).count() << " ms" << std::endl;
+    std::cout << "execution: " << ms(executeTime).count() << " ms" << std::endl;
+    if (!frameTimes.empty()) {
+        std::sort(frameTimes.begin(), frameTimes.end());
+        clock_type::duration total{};
+        for (auto const& t : frameTimes) {
+            total += t;
+        }
+        std::cout << "frames:    " << frameTimes.size() << std::endl;
+        std::cout << "average:   " << ms(total).count() / double(frameTimes.size())
+                  << " ms/frame" << std::endl;
+        std::cout << "median:    " << ms(frameTimes[frameTimes.size() / 2]).count()
+                  << " ms/frame" << std::endl;
+        std::cout << "max:       " << ms(frameTimes.back()).count() << " ms/frame" << std::endl;
+    }
+    return 0;
+}
@@ -339,6 +339,18 @@ Filament.loadClassExtensions = function() {
         this._setGuardBandOptions(options);
     };
 
+    /// setShadowCacheOptions ::method::
+    Filament.View.prototype.setShadowCacheOptions = function(overrides) {
+        const options = this.setShadowCacheOptionsDefaults(overrides);
+        this._setShadowCacheOptions(options);
+    };
+
+    /// setPostProcessResolutionOptions ::method::
+    Filament.View.prototype.setPostProcessResolutionOptions = function(overrides) {
+        const options = this.setPostProcessResolutionOptionsDefaults(overrides);
+        this._setPostProcessResolutionOptions(options);
+    };
+
     /// BufferObject ::core class::
 
     /// setBuffer ::method::
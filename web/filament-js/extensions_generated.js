@@ -182,4 +182,22 @@ Filament.loadGeneratedExtensions = function() {
         return Object.assign(options, overrides);
     };
 
+    Filament.View.prototype.setShadowCacheOptionsDefaults = function(overrides) {
+        const options = {
+            enabled: false,
+            distantCascadeUpdateInterval: 0,
+        };
+        return Object.assign(options, overrides);
+    };
+
+    Filament.View.prototype.setPostProcessResolutionOptionsDefaults = function(overrides) {
+        const options = {
+            enabled: false,
+            resolution: Filament.View$PostProcessResolutionOptions$Resolution.FULL,
+            dynamic: false,
+            minResolution: Filament.View$PostProcessResolutionOptions$Resolution.QUARTER,
+        };
+        return Object.assign(options, overrides);
+    };
+
 };
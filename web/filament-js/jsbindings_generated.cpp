@@ -148,4 +148,16 @@ value_object<View::SoftShadowOptions>("View$SoftShadowOptions")
     .field("penumbraRatioScale", &View::SoftShadowOptions::penumbraRatioScale)
     ;
 
+value_object<View::ShadowCacheOptions>("View$ShadowCacheOptions")
+    .field("enabled", &View::ShadowCacheOptions::enabled)
+    .field("distantCascadeUpdateInterval", &View::ShadowCacheOptions::distantCascadeUpdateInterval)
+    ;
+
+value_object<View::PostProcessResolutionOptions>("View$PostProcessResolutionOptions")
+    .field("enabled", &View::PostProcessResolutionOptions::enabled)
+    .field("resolution", &View::PostProcessResolutionOptions::resolution)
+    .field("dynamic", &View::PostProcessResolutionOptions::dynamic)
+    .field("minResolution", &View::PostProcessResolutionOptions::minResolution)
+    ;
+
 } // EMSCRIPTEN_BINDINGS
@@ -50,4 +50,10 @@ enum_<View::ShadowType>("View$ShadowType")
     .value("PCSS", View::ShadowType::PCSS)
     ;
 
+enum_<View::PostProcessResolutionOptions::Resolution>("View$PostProcessResolutionOptions$Resolution")
+    .value("FULL", View::PostProcessResolutionOptions::Resolution::FULL)
+    .value("HALF", View::PostProcessResolutionOptions::Resolution::HALF)
+    .value("QUARTER", View::PostProcessResolutionOptions::Resolution::QUARTER)
+    ;
+
 } // EMSCRIPTEN_BINDINGS